@@ -0,0 +1,23 @@
+# Compiles SOURCE to OUTPUT with GLSLC, reusing CACHE_DIR/<hash>.spv when a shader with the same source
+# and compiler was already compiled. The cache survives clean rebuilds and branch switches, and can be
+# shared between build directories. Shaders don't use #include so the source alone determines the output.
+
+file(SHA256 ${SOURCE} SOURCE_HASH)
+string(SHA256 KEY "${SOURCE_HASH}|${GLSLC}")
+set(CACHED ${CACHE_DIR}/${KEY}.spv)
+
+get_filename_component(OUTPUT_DIR ${OUTPUT} DIRECTORY)
+file(MAKE_DIRECTORY ${OUTPUT_DIR} ${CACHE_DIR})
+
+if (NOT EXISTS ${CACHED})
+    execute_process(
+            COMMAND ${GLSLC} ${SOURCE} -o ${CACHED}.tmp
+            RESULT_VARIABLE RESULT)
+    if (NOT RESULT EQUAL 0)
+        file(REMOVE ${CACHED}.tmp)
+        message(FATAL_ERROR "failed to compile ${SOURCE}")
+    endif()
+    file(RENAME ${CACHED}.tmp ${CACHED})
+endif()
+
+file(COPY_FILE ${CACHED} ${OUTPUT})
@@ -0,0 +1,34 @@
+#version 450 core
+// BINDLESS is defined by the renderer when GL_ARB_bindless_texture is supported
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+
+layout(location = 0) in vec3 in_normal;
+layout(location = 1) in vec2 in_uv;
+layout(location = 2) flat in uint in_texture;
+
+layout(location = 0) out vec4 out_color;
+
+#ifdef BINDLESS
+// OpenGlBindless, resident texture handles indexed with the bindless handle
+layout(std430, binding = 0) readonly buffer TextureHandles {
+	uvec2 texture_handles[];
+};
+#endif
+
+const vec3 LIGHT_DIR = normalize(vec3(0.4, 1.0, 0.3));
+// OpenGlBindless::NONE
+const uint NO_TEXTURE = 0xffffffffu;
+
+void main() {
+	vec3 albedo = vec3(1.0);
+#ifdef BINDLESS
+	// handles are plain values, so indexing them per instance needs no nonuniform qualifier
+	if (in_texture != NO_TEXTURE) {
+		albedo = texture(sampler2D(texture_handles[in_texture]), in_uv).rgb;
+	}
+#endif
+	float light = max(dot(normalize(in_normal), LIGHT_DIR), 0.0) * 0.8 + 0.2;
+	out_color = vec4(albedo * light, 1.0);
+}
@@ -0,0 +1,36 @@
+#version 450 core
+
+// instanced only, the opengl backend draws everything through the batched stream
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec2 in_normal;
+layout(location = 2) in vec2 in_uv;
+
+// per instance, matches InstanceData in gpu_mesh.hpp
+layout(location = 3) in mat4 in_model;
+layout(location = 7) in vec3 in_dequantize_offset;
+layout(location = 8) in vec3 in_dequantize_scale;
+layout(location = 9) in uint in_texture;
+
+// VIEW_PROJECTION_LOCATION in opengl_renderer.cpp
+layout(location = 0) uniform mat4 view_projection;
+
+layout(location = 0) out vec3 out_normal;
+layout(location = 1) out vec2 out_uv;
+layout(location = 2) flat out uint out_texture;
+
+// inverse of encode_octahedral in mesh.cpp
+vec3 decode_octahedral(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	vec3 position = in_dequantize_offset + in_position * in_dequantize_scale;
+	gl_Position = view_projection * in_model * vec4(position, 1.0);
+	out_normal = mat3(in_model) * decode_octahedral(in_normal);
+	out_uv = in_uv;
+	out_texture = in_texture;
+}
@@ -0,0 +1,28 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 in_normal;
+layout(location = 1) in vec2 in_uv;
+layout(location = 2) flat in uint in_texture;
+
+layout(location = 0) out vec4 out_color;
+
+// VulkanBindless, the arrays are indexed with handles
+layout(set = 0, binding = 0) uniform texture2D textures[];
+layout(set = 0, binding = 1) uniform sampler samplers[];
+
+const vec3 LIGHT_DIR = normalize(vec3(0.4, 1.0, 0.3));
+// VulkanBindless::NONE
+const uint NO_TEXTURE = 0xffffffffu;
+// the renderer's default sampler is registered first
+const uint DEFAULT_SAMPLER = 0;
+
+void main() {
+	vec3 albedo = vec3(1.0);
+	// instanced draws of different meshes can have different textures, so the index isn't uniform
+	if (in_texture != NO_TEXTURE) {
+		albedo = texture(sampler2D(textures[nonuniformEXT(in_texture)], samplers[DEFAULT_SAMPLER]), in_uv).rgb;
+	}
+	float light = max(dot(normalize(in_normal), LIGHT_DIR), 0.0) * 0.8 + 0.2;
+	out_color = vec4(albedo * light, 1.0);
+}
@@ -0,0 +1,47 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec2 in_normal;
+layout(location = 2) in vec2 in_uv;
+
+// per instance, matches InstanceData in gpu_mesh.hpp
+layout(location = 3) in mat4 in_model;
+layout(location = 7) in vec3 in_dequantize_offset;
+layout(location = 8) in vec3 in_dequantize_scale;
+layout(location = 9) in uint in_texture;
+
+// matches InstancedPushConstants in vulkan_renderer.cpp
+layout(push_constant) uniform PushConstants {
+	mat4 view_projection;
+	uint texture_table;
+} pc;
+
+// VulkanBindless storage buffers, the streamer's tables map texture ids to the bindless handle of their image
+layout(std430, set = 0, binding = 2) readonly buffer TextureTable {
+	uint handles[];
+} texture_tables[];
+
+// VulkanBindless::NONE
+const uint NO_TEXTURE = 0xffffffffu;
+
+layout(location = 0) out vec3 out_normal;
+layout(location = 1) out vec2 out_uv;
+layout(location = 2) flat out uint out_texture;
+
+// inverse of encode_octahedral in mesh.cpp
+vec3 decode_octahedral(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	vec3 position = in_dequantize_offset + in_position * in_dequantize_scale;
+	gl_Position = pc.view_projection * in_model * vec4(position, 1.0);
+	out_normal = mat3(in_model) * decode_octahedral(in_normal);
+	out_uv = in_uv;
+	out_texture = in_texture == NO_TEXTURE ? NO_TEXTURE : texture_tables[pc.texture_table].handles[in_texture];
+}
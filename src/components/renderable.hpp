@@ -0,0 +1,9 @@
+#pragma once
+#include "types.hpp"
+
+class GpuMesh;
+
+struct Renderable {
+	const GpuMesh* mesh;
+	u32 material;
+};
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "transform.hpp"
+#include <algorithm>
+
+void transforms_to_matrices(const Transform* transforms, Mat4* out, usize count) {
+	// the kernels want separate streams, transforms are split into them in cache sized groups
+	constexpr usize GROUP = 64;
+	Vec3<f32> positions[GROUP];
+	Quat rotations[GROUP];
+	Vec3<f32> scales[GROUP];
+
+	for (usize start = 0; start < count; start += GROUP) {
+		auto n = std::min(GROUP, count - start);
+		for (usize i = 0; i < n; ++i) {
+			positions[i] = transforms[start + i].position;
+			rotations[i] = transforms[start + i].rotation;
+			scales[i] = transforms[start + i].scale;
+		}
+		compose_trs(positions, rotations, scales, out + start, n);
+	}
+}
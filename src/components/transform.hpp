@@ -1,8 +1,18 @@
 #pragma once
 #include "types.hpp"
+#include "math/vec.hpp"
+#include "math/quat.hpp"
+#include "math/mat.hpp"
 
 struct Transform {
 	Vec3<f32> position {0, 0, 0};
-	Vec3<f32> rotation {0, 0, 0};
+	Quat rotation {Quat::identity()};
 	Vec3<f32> scale {1, 1, 1};
-};
\ No newline at end of file
+
+	[[nodiscard]] Mat4 matrix() const {
+		return Mat4::trs(position, rotation, scale);
+	}
+};
+
+/// Builds the model matrices for count transforms using the simd trs kernels.
+void transforms_to_matrices(const Transform* transforms, Mat4* out, usize count);
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "transform_store.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+u32 TransformStore::checked_index(TransformId id) const {
+	if (!alive(id)) {
+		throw std::runtime_error("transform: id was destroyed");
+	}
+	return slots[id.index].index;
+}
+
+TransformId TransformStore::create(const Transform& transform, TransformId parent) {
+	auto parent_index = parent == NONE ? NONE_INDEX : checked_index(parent);
+	auto index = as<u32>(positions.size());
+
+	positions.push_back(transform.position);
+	rotations.push_back(transform.rotation);
+	scales.push_back(transform.scale);
+	parents.push_back(parent_index);
+	local_matrices.push_back(Mat4::identity());
+	world_matrices.push_back(Mat4::identity());
+	alive_flags.push_back(true);
+
+	dirty_bits.resize(index / 64 + 1);
+	changed_bits.resize(index / 64 + 1);
+	mark_dirty(index);
+
+	u32 slot;
+	if (!free_slots.empty()) {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	else {
+		slot = as<u32>(slots.size());
+		slots.push_back({});
+	}
+	slots[slot].index = index;
+	index_to_slot.push_back(slot);
+
+	return {slot, slots[slot].generation};
+}
+
+void TransformStore::destroy(TransformId id) {
+	// a stale id's slot is either free or reused by a newer transform
+	if (!alive(id)) {
+		return;
+	}
+	alive_flags[slots[id.index].index] = false;
+	needs_compact = true;
+}
+
+void TransformStore::set_parent(TransformId id, TransformId parent) {
+	auto parent_index = parent == NONE ? NONE_INDEX : checked_index(parent);
+	if (!alive(id)) {
+		return;
+	}
+	auto index = slots[id.index].index;
+	// a cycle would have no root to start propagation from
+	for (auto node = parent_index; node != NONE_INDEX; node = parents[node]) {
+		if (node == index) {
+			throw std::runtime_error("transform: can't parent a transform to itself or one of its descendants");
+		}
+	}
+	parents[index] = parent_index;
+	mark_dirty(index);
+
+	if (parent_index != NONE_INDEX && parent_index > index) {
+		needs_sort = true;
+	}
+}
+
+void TransformStore::set_position(TransformId id, const Vec3<f32>& position) {
+	if (!alive(id)) {
+		return;
+	}
+	auto index = slots[id.index].index;
+	positions[index] = position;
+	mark_dirty(index);
+}
+
+void TransformStore::set_rotation(TransformId id, const Quat& rotation) {
+	if (!alive(id)) {
+		return;
+	}
+	auto index = slots[id.index].index;
+	rotations[index] = rotation;
+	mark_dirty(index);
+}
+
+void TransformStore::set_scale(TransformId id, const Vec3<f32>& scale) {
+	if (!alive(id)) {
+		return;
+	}
+	auto index = slots[id.index].index;
+	scales[index] = scale;
+	mark_dirty(index);
+}
+
+void TransformStore::set(TransformId id, const Transform& transform) {
+	if (!alive(id)) {
+		return;
+	}
+	auto index = slots[id.index].index;
+	positions[index] = transform.position;
+	rotations[index] = transform.rotation;
+	scales[index] = transform.scale;
+	mark_dirty(index);
+}
+
+Transform TransformStore::get(TransformId id) const {
+	auto index = checked_index(id);
+	return {
+		.position = positions[index],
+		.rotation = rotations[index],
+		.scale = scales[index]
+	};
+}
+
+void TransformStore::update() {
+	// compacting relies on parents coming first to reach every descendant of a destroyed transform
+	if (needs_sort) {
+		sort_topologically();
+	}
+	if (needs_compact) {
+		compact();
+	}
+
+	// local matrices are rebuilt in contiguous runs of dirty entries so the batch kernel sees long streams
+	for (usize word = 0; word < dirty_bits.size(); ++word) {
+		auto bits = dirty_bits[word];
+		while (bits) {
+			u32 start = std::countr_zero(bits);
+			u32 run = std::countr_one(bits >> start);
+			auto index = word * 64 + start;
+			compose_trs(&positions[index], &rotations[index], &scales[index], &local_matrices[index], run);
+
+			bits &= run == 64 ? 0 : ~(((u64 {1} << run) - 1) << start);
+		}
+	}
+
+	// parents always come first so their world matrices are final by the time a child is reached
+	for (u32 i = 0; i < positions.size(); ++i) {
+		auto parent = parents[i];
+		if (parent == NONE_INDEX) {
+			if (is_dirty(i)) {
+				world_matrices[i] = local_matrices[i];
+			}
+		}
+		else if (is_dirty(i) || is_dirty(parent)) {
+			mark_dirty(i);
+			world_matrices[i] = world_matrices[parent] * local_matrices[i];
+		}
+	}
+
+	changed_bits.swap(dirty_bits);
+	std::fill(dirty_bits.begin(), dirty_bits.end(), 0);
+}
+
+void TransformStore::compact() {
+	std::vector<u32> order;
+	order.reserve(positions.size());
+
+	for (u32 i = 0; i < positions.size(); ++i) {
+		// children of destroyed parents die with them
+		if (alive_flags[i] && parents[i] != NONE_INDEX && !alive_flags[parents[i]]) {
+			alive_flags[i] = false;
+		}
+
+		if (alive_flags[i]) {
+			order.push_back(i);
+		}
+		else {
+			// ids handed out for this slot so far become stale
+			auto& slot = slots[index_to_slot[i]];
+			slot.index = NONE_INDEX;
+			++slot.generation;
+			free_slots.push_back(index_to_slot[i]);
+		}
+	}
+
+	permute(order);
+	needs_compact = false;
+}
+
+void TransformStore::sort_topologically() {
+	std::vector<u32> depth(positions.size(), UINT32_MAX);
+	for (u32 i = 0; i < positions.size(); ++i) {
+		u32 d = 0;
+		auto node = i;
+		while (parents[node] != NONE_INDEX && depth[node] == UINT32_MAX) {
+			node = parents[node];
+			++d;
+		}
+		if (depth[node] != UINT32_MAX) {
+			d += depth[node];
+		}
+		depth[i] = d;
+	}
+
+	std::vector<u32> order(positions.size());
+	for (u32 i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+		return depth[a] < depth[b];
+	});
+
+	permute(order);
+	needs_sort = false;
+}
+
+void TransformStore::permute(const std::vector<u32>& order) {
+	std::vector<u32> remap(positions.size(), NONE_INDEX);
+	for (u32 i = 0; i < order.size(); ++i) {
+		remap[order[i]] = i;
+	}
+
+	auto gather = [&]<typename T>(std::vector<T>& v) {
+		std::vector<T> result;
+		result.reserve(order.size());
+		for (auto old : order) {
+			result.push_back(v[old]);
+		}
+		v = std::move(result);
+	};
+
+	gather(positions);
+	gather(rotations);
+	gather(scales);
+	gather(local_matrices);
+	gather(world_matrices);
+	gather(index_to_slot);
+	// sorting keeps destroyed entries until the compaction after it
+	gather(alive_flags);
+
+	std::vector<u32> new_parents(order.size());
+	std::vector<u64> new_dirty(order.size() / 64 + 1);
+	for (u32 i = 0; i < order.size(); ++i) {
+		auto old = order[i];
+		new_parents[i] = parents[old] == NONE_INDEX ? NONE_INDEX : remap[parents[old]];
+		if (is_dirty(old)) {
+			new_dirty[i / 64] |= u64 {1} << i % 64;
+		}
+		slots[index_to_slot[i]].index = i;
+	}
+	parents = std::move(new_parents);
+	dirty_bits = std::move(new_dirty);
+	changed_bits.assign(dirty_bits.size(), 0);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "types.hpp"
+#include "transform.hpp"
+#include <vector>
+
+/// Slot plus the generation of the slot, ids of destroyed transforms stay stale after the slot is reused.
+struct TransformId {
+	u32 index;
+	u32 generation;
+
+	constexpr bool operator==(const TransformId&) const = default;
+};
+
+/// Structure of arrays storage for a transform hierarchy.
+/// Entries are kept sorted so that every parent comes before its children, which makes
+/// world matrix propagation a single linear pass. Only entries marked dirty since the last
+/// update (and their descendants) have their matrices rebuilt.
+class TransformStore {
+public:
+	/// Throws if parent was destroyed.
+	TransformId create(const Transform& transform, TransformId parent = NONE);
+	/// Destroys the transform together with all of its descendants, does nothing if it was already destroyed.
+	void destroy(TransformId id);
+	/// Destroyed transforms are dead right away, their slots are freed by the next update.
+	[[nodiscard]] bool alive(TransformId id) const {
+		return id.index < slots.size() && slots[id.index].generation == id.generation
+			&& slots[id.index].index != NONE_INDEX && alive_flags[slots[id.index].index];
+	}
+
+	/// Throws if parent is the transform itself, one of its descendants or was destroyed.
+	/// Setters do nothing if the transform was destroyed.
+	void set_parent(TransformId id, TransformId parent);
+	void set_position(TransformId id, const Vec3<f32>& position);
+	void set_rotation(TransformId id, const Quat& rotation);
+	void set_scale(TransformId id, const Vec3<f32>& scale);
+	void set(TransformId id, const Transform& transform);
+
+	/// Throws if the transform was destroyed.
+	[[nodiscard]] Transform get(TransformId id) const;
+	/// Throws if the transform was destroyed.
+	[[nodiscard]] const Mat4& world_matrix(TransformId id) const {
+		return world_matrices[checked_index(id)];
+	}
+
+	/// Rebuilds local and world matrices of everything that changed since the last update.
+	void update();
+
+	[[nodiscard]] usize size() const {
+		return positions.size();
+	}
+	/// Dense index of an id, only valid until the next update. Throws if the transform was destroyed.
+	[[nodiscard]] u32 index_of(TransformId id) const {
+		return checked_index(id);
+	}
+	[[nodiscard]] TransformId id_at(u32 index) const {
+		auto slot = index_to_slot[index];
+		return {slot, slots[slot].generation};
+	}
+	/// Whether the world matrix at a dense index was rebuilt by the last update.
+	[[nodiscard]] bool changed(u32 index) const {
+		return changed_bits[index / 64] & u64 {1} << index % 64;
+	}
+	[[nodiscard]] const Mat4* world_data() const {
+		return world_matrices.data();
+	}
+
+	constexpr static TransformId NONE {UINT32_MAX, 0};
+private:
+	constexpr static u32 NONE_INDEX = UINT32_MAX;
+
+	struct Slot {
+		/// dense index, NONE_INDEX while the slot is free
+		u32 index;
+		u32 generation;
+	};
+
+	[[nodiscard]] u32 checked_index(TransformId id) const;
+	void mark_dirty(u32 index) {
+		dirty_bits[index / 64] |= u64 {1} << index % 64;
+	}
+	[[nodiscard]] bool is_dirty(u32 index) const {
+		return dirty_bits[index / 64] & u64 {1} << index % 64;
+	}
+	void compact();
+	void sort_topologically();
+	void permute(const std::vector<u32>& order);
+
+	std::vector<Vec3<f32>> positions {};
+	std::vector<Quat> rotations {};
+	std::vector<Vec3<f32>> scales {};
+	/// dense index of the parent, always smaller than the index of the child, NONE_INDEX for roots
+	std::vector<u32> parents {};
+	std::vector<Mat4> local_matrices {};
+	std::vector<Mat4> world_matrices {};
+	std::vector<u64> dirty_bits {};
+	std::vector<u64> changed_bits {};
+	std::vector<bool> alive_flags {};
+
+	std::vector<Slot> slots {};
+	std::vector<u32> index_to_slot {};
+	std::vector<u32> free_slots {};
+	bool needs_compact {};
+	bool needs_sort {};
+};
\ No newline at end of file
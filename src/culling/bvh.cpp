@@ -0,0 +1,435 @@
+#include "bvh.hpp"
+#include "jobs/job_system.hpp"
+#include "math/simd.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+/// nodes kept on the traversal stack before the traversal recurses
+constexpr u32 STACK_SIZE = 64;
+constexpr u32 BIN_COUNT = 16;
+
+static Aabb empty_aabb() {
+	constexpr auto inf = std::numeric_limits<f32>::infinity();
+	return {{inf, inf, inf}, {-inf, -inf, -inf}};
+}
+
+static Vec3<f32> min(const Vec3<f32>& a, const Vec3<f32>& b) {
+	return {std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)};
+}
+
+static Vec3<f32> max(const Vec3<f32>& a, const Vec3<f32>& b) {
+	return {std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)};
+}
+
+static Aabb merge(const Aabb& a, const Aabb& b) {
+	return {min(a.min, b.min), max(a.max, b.max)};
+}
+
+static f32 surface_area(const Aabb& bounds) {
+	auto d = bounds.max - bounds.min;
+	if (d.x < 0) {
+		return 0;
+	}
+	return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static f32 component(const Vec3<f32>& v, u32 axis) {
+	return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+u32 Bvh::insert(const Aabb& bounds, u32 user) {
+	u32 proxy;
+	if (!free_proxies.empty()) {
+		proxy = free_proxies.back();
+		free_proxies.pop_back();
+	}
+	else {
+		proxy = as<u32>(proxies.size());
+		proxies.emplace_back();
+	}
+	proxies[proxy] = {.bounds = bounds, .user = user, .slot = UINT32_MAX, .alive = true};
+	needs_build = true;
+	return proxy;
+}
+
+void Bvh::remove(u32 proxy) {
+	proxies[proxy].alive = false;
+	proxies[proxy].slot = UINT32_MAX;
+	free_proxies.push_back(proxy);
+	needs_build = true;
+}
+
+void Bvh::set_bounds(u32 proxy, const Aabb& bounds) {
+	proxies[proxy].bounds = bounds;
+	dirty.push_back(proxy);
+}
+
+void Bvh::update() {
+	PROFILE_ZONE("Bvh::update");
+	if (needs_build) {
+		build();
+	}
+	else if (!dirty.empty()) {
+		// only the leaves of moved objects and their ancestors are refitted
+		for (auto proxy : dirty) {
+			auto slot = proxies[proxy].slot;
+			write_slot(slot, proxies[proxy].bounds);
+			for (auto node = slot_leaves[slot]; node != UINT32_MAX && !node_dirty[node]; node = parents[node]) {
+				node_dirty[node] = true;
+				dirty_nodes.push_back(node);
+			}
+		}
+		if (refit(false) > built_cost * REBUILD_RATIO) {
+			build();
+		}
+	}
+	dirty.clear();
+}
+
+void Bvh::write_slot(u32 slot, const Aabb& bounds) {
+	auto center = (bounds.min + bounds.max) * 0.5f;
+	auto extent = (bounds.max - bounds.min) * 0.5f;
+	center_x[slot] = center.x;
+	center_y[slot] = center.y;
+	center_z[slot] = center.z;
+	extent_x[slot] = extent.x;
+	extent_y[slot] = extent.y;
+	extent_z[slot] = extent.z;
+}
+
+void Bvh::build() {
+	PROFILE_ZONE("Bvh::build");
+	std::vector<u32> order;
+	order.reserve(object_count());
+	std::vector<Vec3<f32>> centers(proxies.size());
+	for (u32 i = 0; i < proxies.size(); ++i) {
+		if (proxies[i].alive) {
+			order.push_back(i);
+			centers[i] = (proxies[i].bounds.min + proxies[i].bounds.max) * 0.5f;
+		}
+	}
+
+	nodes.clear();
+	needs_build = false;
+	auto count = as<u32>(order.size());
+	for (auto* v : {&center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z}) {
+		v->assign(count + LEAF_SIZE, 0);
+	}
+	slot_users.resize(count);
+	slot_leaves.resize(count);
+	if (!count) {
+		built_cost = 0;
+		return;
+	}
+
+	nodes.emplace_back();
+	parents.assign(1, UINT32_MAX);
+	build_node(0, 0, count, order, centers);
+	node_dirty.assign(nodes.size(), false);
+	dirty_nodes.clear();
+
+	for (u32 slot = 0; slot < count; ++slot) {
+		auto& proxy = proxies[order[slot]];
+		proxy.slot = slot;
+		slot_users[slot] = proxy.user;
+		write_slot(slot, proxy.bounds);
+	}
+	built_cost = refit(true);
+}
+
+void Bvh::build_node(u32 index, u32 begin, u32 end, std::vector<u32>& order, const std::vector<Vec3<f32>>& centers) {
+	auto bounds = empty_aabb();
+	auto center_bounds = empty_aabb();
+	for (u32 i = begin; i < end; ++i) {
+		bounds = merge(bounds, proxies[order[i]].bounds);
+		center_bounds = merge(center_bounds, {centers[order[i]], centers[order[i]]});
+	}
+	nodes[index] = {.bounds = bounds, .first = begin, .count = end - begin, .child = 0};
+	if (end - begin <= LEAF_SIZE) {
+		std::fill(slot_leaves.begin() + begin, slot_leaves.begin() + end, index);
+		return;
+	}
+
+	// binned surface area heuristic along the axis with the widest spread of centers
+	auto spread = center_bounds.max - center_bounds.min;
+	u32 axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : spread.y >= spread.z ? 1 : 2;
+	auto low = component(center_bounds.min, axis);
+	auto width = component(spread, axis);
+
+	auto mid = begin + (end - begin) / 2;
+	if (width > 0) {
+		auto scale = BIN_COUNT / width;
+		auto bin_of = [&](u32 proxy) {
+			return std::min(as<u32>((component(centers[proxy], axis) - low) * scale), BIN_COUNT - 1);
+		};
+
+		Aabb bin_bounds[BIN_COUNT];
+		u32 bin_counts[BIN_COUNT] {};
+		for (auto& b : bin_bounds) {
+			b = empty_aabb();
+		}
+		for (u32 i = begin; i < end; ++i) {
+			auto bin = bin_of(order[i]);
+			bin_bounds[bin] = merge(bin_bounds[bin], proxies[order[i]].bounds);
+			++bin_counts[bin];
+		}
+
+		// right_cost[i] covers bins i and up, the split before bin i puts everything below it on the left
+		f32 right_cost[BIN_COUNT];
+		auto right = empty_aabb();
+		u32 right_count = 0;
+		for (u32 i = BIN_COUNT; i-- > 1;) {
+			right = merge(right, bin_bounds[i]);
+			right_count += bin_counts[i];
+			right_cost[i] = surface_area(right) * as<f32>(right_count);
+		}
+
+		auto left = empty_aabb();
+		u32 left_count = 0;
+		u32 best_split = 0;
+		auto best_cost = std::numeric_limits<f32>::infinity();
+		for (u32 i = 1; i < BIN_COUNT; ++i) {
+			left = merge(left, bin_bounds[i - 1]);
+			left_count += bin_counts[i - 1];
+			if (!left_count || left_count == end - begin) {
+				continue;
+			}
+			auto cost = surface_area(left) * as<f32>(left_count) + right_cost[i];
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_split = i;
+			}
+		}
+
+		if (best_split) {
+			mid = as<u32>(std::partition(order.begin() + begin, order.begin() + end, [&](u32 proxy) {
+				return bin_of(proxy) < best_split;
+			}) - order.begin());
+		}
+	}
+
+	auto child = as<u32>(nodes.size());
+	nodes.resize(nodes.size() + 2);
+	parents.resize(parents.size() + 2, index);
+	nodes[index].child = child;
+	build_node(child, begin, mid, order, centers);
+	build_node(child + 1, mid, end, order, centers);
+}
+
+static f32 node_cost(const Aabb& bounds, u32 count, bool leaf) {
+	return leaf ? surface_area(bounds) * as<f32>(count) : surface_area(bounds);
+}
+
+void Bvh::refit_node(u32 index) {
+	auto& node = nodes[index];
+	if (node.child) {
+		node.bounds = merge(nodes[node.child].bounds, nodes[node.child + 1].bounds);
+		return;
+	}
+
+	auto bounds = empty_aabb();
+	for (u32 slot = node.first; slot < node.first + node.count; ++slot) {
+		bounds.min.x = std::min(bounds.min.x, center_x[slot] - extent_x[slot]);
+		bounds.min.y = std::min(bounds.min.y, center_y[slot] - extent_y[slot]);
+		bounds.min.z = std::min(bounds.min.z, center_z[slot] - extent_z[slot]);
+		bounds.max.x = std::max(bounds.max.x, center_x[slot] + extent_x[slot]);
+		bounds.max.y = std::max(bounds.max.y, center_y[slot] + extent_y[slot]);
+		bounds.max.z = std::max(bounds.max.z, center_z[slot] + extent_z[slot]);
+	}
+	node.bounds = bounds;
+}
+
+f32 Bvh::refit(bool all) {
+	PROFILE_ZONE("Bvh::refit");
+	// children always come after their parent, so walking in reverse index order sees them first.
+	// Sorting only pays off while few nodes are dirty, otherwise every node's flag is checked.
+	if (all || dirty_nodes.size() * 8 > nodes.size()) {
+		if (all) {
+			tree_cost = 0;
+		}
+		for (auto i = as<u32>(nodes.size()); i-- > 0;) {
+			if (!all && !node_dirty[i]) {
+				continue;
+			}
+			node_dirty[i] = false;
+			const auto& node = nodes[i];
+			if (!all) {
+				tree_cost -= node_cost(node.bounds, node.count, !node.child);
+			}
+			refit_node(i);
+			tree_cost += node_cost(node.bounds, node.count, !node.child);
+		}
+	}
+	else {
+		std::sort(dirty_nodes.begin(), dirty_nodes.end(), std::greater {});
+		for (auto i : dirty_nodes) {
+			node_dirty[i] = false;
+			const auto& node = nodes[i];
+			tree_cost -= node_cost(node.bounds, node.count, !node.child);
+			refit_node(i);
+			tree_cost += node_cost(node.bounds, node.count, !node.child);
+		}
+	}
+	dirty_nodes.clear();
+
+	// relative to the root so a tree that only moved or grew as a whole keeps its cost
+	auto root_area = surface_area(nodes[0].bounds);
+	return root_area > 0 ? tree_cost / root_area : 0;
+}
+
+void Bvh::cull(const Frustum& frustum, std::vector<u32>& visible) const {
+	PROFILE_ZONE("Bvh::cull");
+	if (!nodes.empty()) {
+		cull_subtree(0, frustum, visible);
+	}
+}
+
+void Bvh::cull_subtree(u32 root, const Frustum& frustum, std::vector<u32>& visible) const {
+	u32 stack[STACK_SIZE];
+	u32 size = 0;
+	stack[size++] = root;
+
+	while (size) {
+		const auto& node = nodes[stack[--size]];
+		auto containment = frustum_test(frustum, node.bounds);
+		if (containment == Containment::Outside) {
+			continue;
+		}
+		// a subtree's objects are contiguous, so a fully visible one is copied without testing anything in it
+		if (containment == Containment::Inside) {
+			visible.insert(visible.end(), slot_users.begin() + node.first, slot_users.begin() + node.first + node.count);
+			continue;
+		}
+		if (!node.child) {
+			cull_leaf(node, frustum, visible);
+			continue;
+		}
+
+		// everything on the stack comes after this node, so recursing on overflow keeps the order
+		if (size + 2 > STACK_SIZE) {
+			cull_subtree(node.child, frustum, visible);
+			cull_subtree(node.child + 1, frustum, visible);
+			continue;
+		}
+		// the left child is popped first so objects come out in leaf order
+		stack[size++] = node.child + 1;
+		stack[size++] = node.child;
+	}
+}
+
+void Bvh::cull_leaf(const Node& node, const Frustum& f, std::vector<u32>& visible) const {
+	static_assert(LEAF_SIZE <= 8);
+	u32 outside = 0;
+	auto first = node.first;
+
+#if defined(GAME_SIMD_AVX)
+	auto cx = _mm256_loadu_ps(center_x.data() + first);
+	auto cy = _mm256_loadu_ps(center_y.data() + first);
+	auto cz = _mm256_loadu_ps(center_z.data() + first);
+	auto ex = _mm256_loadu_ps(extent_x.data() + first);
+	auto ey = _mm256_loadu_ps(extent_y.data() + first);
+	auto ez = _mm256_loadu_ps(extent_z.data() + first);
+	auto out = _mm256_setzero_ps();
+	for (u32 p = 0; p < Frustum::PLANE_COUNT; ++p) {
+		auto distance = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.x[p]), cx), _mm256_mul_ps(_mm256_set1_ps(f.y[p]), cy)),
+			_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.z[p]), cz), _mm256_set1_ps(f.w[p])));
+		auto radius = _mm256_add_ps(
+			_mm256_add_ps(
+				_mm256_mul_ps(_mm256_set1_ps(std::abs(f.x[p])), ex),
+				_mm256_mul_ps(_mm256_set1_ps(std::abs(f.y[p])), ey)),
+			_mm256_mul_ps(_mm256_set1_ps(std::abs(f.z[p])), ez));
+		out = _mm256_or_ps(out, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+	}
+	outside = as<u32>(_mm256_movemask_ps(out));
+#elif defined(GAME_SIMD_SSE)
+	for (u32 i = 0; i < node.count; i += 4) {
+		auto cx = _mm_loadu_ps(center_x.data() + first + i);
+		auto cy = _mm_loadu_ps(center_y.data() + first + i);
+		auto cz = _mm_loadu_ps(center_z.data() + first + i);
+		auto ex = _mm_loadu_ps(extent_x.data() + first + i);
+		auto ey = _mm_loadu_ps(extent_y.data() + first + i);
+		auto ez = _mm_loadu_ps(extent_z.data() + first + i);
+		auto out = _mm_setzero_ps();
+		for (u32 p = 0; p < Frustum::PLANE_COUNT; ++p) {
+			auto distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.x[p]), cx), _mm_mul_ps(_mm_set1_ps(f.y[p]), cy)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.z[p]), cz), _mm_set1_ps(f.w[p])));
+			auto radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(f.x[p])), ex), _mm_mul_ps(_mm_set1_ps(std::abs(f.y[p])), ey)),
+				_mm_mul_ps(_mm_set1_ps(std::abs(f.z[p])), ez));
+			out = _mm_or_ps(out, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+		outside |= as<u32>(_mm_movemask_ps(out)) << i;
+	}
+#else
+	for (u32 i = 0; i < node.count; ++i) {
+		auto slot = first + i;
+		for (u32 p = 0; p < Frustum::PLANE_COUNT; ++p) {
+			auto distance = f.x[p] * center_x[slot] + f.y[p] * center_y[slot] + f.z[p] * center_z[slot] + f.w[p];
+			auto radius = std::abs(f.x[p]) * extent_x[slot] + std::abs(f.y[p]) * extent_y[slot]
+				+ std::abs(f.z[p]) * extent_z[slot];
+			if (distance + radius < 0) {
+				outside |= 1u << i;
+				break;
+			}
+		}
+	}
+#endif
+
+	auto inside = ~outside & ((1u << node.count) - 1);
+	for (; inside; inside &= inside - 1) {
+		visible.push_back(slot_users[first + std::countr_zero(inside)]);
+	}
+}
+
+void Bvh::cull_parallel(JobSystem& jobs, const Frustum& frustum, std::vector<u32>& visible) {
+	PROFILE_ZONE("Bvh::cull_parallel");
+	if (nodes.empty()) {
+		return;
+	}
+
+	// split the tree until there are a few subtrees per worker, in order and without the invisible ones
+	auto target = jobs.thread_count() * 4;
+	task_roots.assign(1, 0);
+	bool split = true;
+	while (split && task_roots.size() < target) {
+		split = false;
+		split_roots.clear();
+		for (auto index : task_roots) {
+			const auto& node = nodes[index];
+			auto containment = frustum_test(frustum, node.bounds);
+			if (containment == Containment::Outside) {
+				continue;
+			}
+			if (containment == Containment::Inside || !node.child) {
+				split_roots.push_back(index);
+				continue;
+			}
+			split_roots.push_back(node.child);
+			split_roots.push_back(node.child + 1);
+			split = true;
+		}
+		task_roots.swap(split_roots);
+	}
+
+	if (task_visible.size() < task_roots.size()) {
+		task_visible.resize(task_roots.size());
+	}
+	JobCounter counter;
+	jobs.parallel_for(as<u32>(task_roots.size()), 1, [this, &frustum](u32 begin, u32 end) {
+		for (u32 i = begin; i < end; ++i) {
+			task_visible[i].clear();
+			cull_subtree(task_roots[i], frustum, task_visible[i]);
+		}
+	}, counter);
+	jobs.wait(counter);
+
+	for (u32 i = 0; i < task_roots.size(); ++i) {
+		visible.insert(visible.end(), task_visible[i].begin(), task_visible[i].end());
+	}
+}
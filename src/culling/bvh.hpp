@@ -0,0 +1,89 @@
+#pragma once
+#include "types.hpp"
+#include "frustum.hpp"
+#include "mesh/mesh.hpp"
+#include <vector>
+
+class JobSystem;
+
+/// Bounding volume hierarchy over object bounds for visibility queries. Leaves hold up to LEAF_SIZE objects
+/// whose bounds are kept as structure of arrays in leaf order, so a leaf is tested against the frustum four
+/// or eight objects per instruction and every subtree covers a contiguous range of objects.
+/// Moving objects only refit the node bounds, the tree is rebuilt after inserts and removes or once
+/// refitting has made it noticeably worse.
+class Bvh {
+public:
+	/// Returns the proxy used to change or remove the object, culling reports user for it.
+	u32 insert(const Aabb& bounds, u32 user);
+	void remove(u32 proxy);
+	void set_bounds(u32 proxy, const Aabb& bounds);
+	/// Applies the changes made since the last update, queries only see them afterwards.
+	void update();
+
+	/// Appends the user value of every object intersecting the frustum.
+	void cull(const Frustum& frustum, std::vector<u32>& visible) const;
+	/// Same as cull with subtrees spread over the job system, the result is in the same order.
+	void cull_parallel(JobSystem& jobs, const Frustum& frustum, std::vector<u32>& visible);
+
+	[[nodiscard]] u32 object_count() const {
+		return as<u32>(proxies.size() - free_proxies.size());
+	}
+	[[nodiscard]] u32 node_count() const {
+		return as<u32>(nodes.size());
+	}
+
+	constexpr static u32 LEAF_SIZE = 8;
+	/// refitted trees whose surface area heuristic cost grew by this factor since the build are rebuilt
+	constexpr static f32 REBUILD_RATIO = 1.5f;
+private:
+	struct Node {
+		Aabb bounds;
+		/// objects of the whole subtree
+		u32 first;
+		u32 count;
+		/// left child with the right one following it, 0 for leaves
+		u32 child;
+	};
+
+	struct Proxy {
+		Aabb bounds;
+		u32 user;
+		/// position in leaf order, UINT32_MAX until the next build
+		u32 slot;
+		bool alive;
+	};
+
+	void build();
+	void build_node(u32 node, u32 begin, u32 end, std::vector<u32>& order, const std::vector<Vec3<f32>>& centers);
+	/// Recomputes the bounds of every node, or only of the dirty ones, and returns the tree's cost.
+	f32 refit(bool all);
+	void refit_node(u32 index);
+	void write_slot(u32 slot, const Aabb& bounds);
+	void cull_subtree(u32 root, const Frustum& frustum, std::vector<u32>& visible) const;
+	void cull_leaf(const Node& node, const Frustum& frustum, std::vector<u32>& visible) const;
+
+	std::vector<Node> nodes {};
+	std::vector<u32> parents {};
+	std::vector<u8> node_dirty {};
+	/// nodes whose bounds have to be refitted in the next update
+	std::vector<u32> dirty_nodes {};
+	std::vector<Proxy> proxies {};
+	std::vector<u32> free_proxies {};
+	/// proxies whose bounds changed since the last update
+	std::vector<u32> dirty {};
+	bool needs_build {};
+	/// unnormalized surface area heuristic cost, kept up to date by refits
+	f32 tree_cost {};
+	f32 built_cost {};
+
+	/// object bounds in leaf order, padded by LEAF_SIZE so simd loads past the last object stay in bounds
+	std::vector<f32> center_x {}, center_y {}, center_z {};
+	std::vector<f32> extent_x {}, extent_y {}, extent_z {};
+	std::vector<u32> slot_users {};
+	std::vector<u32> slot_leaves {};
+
+	/// subtrees and their results of cull_parallel, kept to reuse the allocations
+	std::vector<u32> task_roots {};
+	std::vector<u32> split_roots {};
+	std::vector<std::vector<u32>> task_visible {};
+};
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "frustum.hpp"
+#include "math/simd.hpp"
+#include <cmath>
+
+Frustum Frustum::from_view_projection(const Mat4& m) {
+	// Gribb-Hartmann, every plane is a sum or difference of the matrix rows
+	auto row = [&](usize r) {
+		return Vec4<f32> {m(r, 0), m(r, 1), m(r, 2), m(r, 3)};
+	};
+	const Vec4<f32> planes[PLANE_COUNT] {
+		row(3) + row(0),
+		row(3) - row(0),
+		row(3) + row(1),
+		row(3) - row(1),
+		// vulkan depth starts at 0 so the near plane is the z row alone
+		row(2),
+		row(3) - row(2)
+	};
+
+	Frustum frustum {};
+	for (u32 i = 0; i < PLANE_COUNT; ++i) {
+		const auto& p = planes[i];
+		auto length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+		frustum.x[i] = p.x / length;
+		frustum.y[i] = p.y / length;
+		frustum.z[i] = p.z / length;
+		frustum.w[i] = p.w / length;
+	}
+	for (u32 i = PLANE_COUNT; i < 8; ++i) {
+		frustum.w[i] = 1e30f;
+	}
+	return frustum;
+}
+
+Containment frustum_test(const Frustum& f, const Aabb& bounds) {
+	auto center = (bounds.min + bounds.max) * 0.5f;
+	auto extent = (bounds.max - bounds.min) * 0.5f;
+
+#ifdef GAME_SIMD_SSE
+	const auto abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	auto cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+	auto ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+
+	int outside = 0;
+	int inside = 0;
+	for (usize i = 0; i < 8; i += 4) {
+		auto px = _mm_load_ps(f.x + i), py = _mm_load_ps(f.y + i), pz = _mm_load_ps(f.z + i);
+		auto distance = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)),
+			_mm_add_ps(_mm_mul_ps(pz, cz), _mm_load_ps(f.w + i)));
+		auto radius = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_and_ps(px, abs_mask), ex), _mm_mul_ps(_mm_and_ps(py, abs_mask), ey)),
+			_mm_mul_ps(_mm_and_ps(pz, abs_mask), ez));
+		outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())) << i;
+		inside |= _mm_movemask_ps(_mm_cmpge_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps())) << i;
+	}
+	if (outside) {
+		return Containment::Outside;
+	}
+	return inside == 0xFF ? Containment::Inside : Containment::Intersecting;
+#else
+	bool inside = true;
+	for (u32 i = 0; i < Frustum::PLANE_COUNT; ++i) {
+		auto distance = f.x[i] * center.x + f.y[i] * center.y + f.z[i] * center.z + f.w[i];
+		auto radius = std::abs(f.x[i]) * extent.x + std::abs(f.y[i]) * extent.y + std::abs(f.z[i]) * extent.z;
+		if (distance + radius < 0) {
+			return Containment::Outside;
+		}
+		inside &= distance - radius >= 0;
+	}
+	return inside ? Containment::Inside : Containment::Intersecting;
+#endif
+}
+
+Aabb transform_aabb(const Aabb& bounds, const Mat4& m) {
+	// Arvo, the new extent is the old one transformed by the absolute rotation scale part
+	auto center = m.transform_point((bounds.min + bounds.max) * 0.5f);
+	auto extent = (bounds.max - bounds.min) * 0.5f;
+	Vec3<f32> new_extent {
+		std::abs(m(0, 0)) * extent.x + std::abs(m(0, 1)) * extent.y + std::abs(m(0, 2)) * extent.z,
+		std::abs(m(1, 0)) * extent.x + std::abs(m(1, 1)) * extent.y + std::abs(m(1, 2)) * extent.z,
+		std::abs(m(2, 0)) * extent.x + std::abs(m(2, 1)) * extent.y + std::abs(m(2, 2)) * extent.z
+	};
+	return {center - new_extent, center + new_extent};
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "types.hpp"
+#include "math/mat.hpp"
+#include "mesh/mesh.hpp"
+
+/// The six planes bounding a view projection, stored as structure of arrays so one box can be tested
+/// against four planes per instruction. A point p is inside when x * p.x + y * p.y + z * p.z + w >= 0 for
+/// every plane, the two padding planes accept everything.
+struct Frustum {
+	constexpr static u32 PLANE_COUNT = 6;
+
+	alignas(32) f32 x[8];
+	alignas(32) f32 y[8];
+	alignas(32) f32 z[8];
+	alignas(32) f32 w[8];
+
+	/// Planes of a vulkan clip space view projection (depth 0 to 1), normalized so w is a distance.
+	static Frustum from_view_projection(const Mat4& view_projection);
+};
+
+enum class Containment : u8 {
+	Outside,
+	Intersecting,
+	Inside
+};
+
+[[nodiscard]] Containment frustum_test(const Frustum& frustum, const Aabb& bounds);
+
+/// Bounds of the box after transforming it by m, exact for affine matrices.
+[[nodiscard]] Aabb transform_aabb(const Aabb& bounds, const Mat4& m);
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "draw_batcher.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+
+void DrawBatcher::build(std::span<const DrawCommand> draws, InstanceData* instances) {
+	PROFILE_ZONE("DrawBatcher::build");
+
+	// index type, then the mesh's first index, which is unique per mesh in the arena.
+	// Every draw uses the instanced mesh material for now, more materials would go in the bits above.
+	sorted_draws.resize(draws.size());
+	for (u32 i = 0; i < draws.size(); ++i) {
+		const auto& mesh = *draws[i].mesh;
+		u64 wide_indices = mesh.index_type == vk::IndexType::eUint32;
+		sorted_draws[i] = {
+			.key = wide_indices << 32 | (mesh.indices.first + mesh.lods[0].index_offset),
+			.draw = i
+		};
+	}
+	std::sort(sorted_draws.begin(), sorted_draws.end(), [](const SortedDraw& a, const SortedDraw& b) {
+		return a.key < b.key;
+	});
+
+	batch_list.clear();
+	run_list.clear();
+	u64 last_key = UINT64_MAX;
+	for (u32 i = 0; i < sorted_draws.size(); ++i) {
+		const auto& draw = draws[sorted_draws[i].draw];
+		const auto& mesh = *draw.mesh;
+		instances[i] = mesh.instance(draw.model);
+
+		auto key = sorted_draws[i].key;
+		if (key == last_key) {
+			++batch_list.back().instance_count;
+			continue;
+		}
+		if (last_key == UINT64_MAX || key >> 32 != last_key >> 32) {
+			run_list.push_back({
+				.first_batch = as<u32>(batch_list.size()),
+				.batch_count = 0,
+				.wide_indices = (key >> 32) != 0
+			});
+		}
+		last_key = key;
+		++run_list.back().batch_count;
+
+		const auto& lod = mesh.lods[0];
+		batch_list.push_back({
+			.index_count = lod.index_count,
+			.instance_count = 1,
+			.first_index = mesh.indices.first + lod.index_offset,
+			.vertex_offset = as<i32>(mesh.vertices.first),
+			.first_instance = i
+		});
+	}
+}
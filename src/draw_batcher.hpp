@@ -0,0 +1,48 @@
+#pragma once
+#include "types.hpp"
+#include "draw_command.hpp"
+#include "mesh/gpu_mesh.hpp"
+#include <span>
+#include <vector>
+
+/// One instanced indexed draw. Laid out like VkDrawIndexedIndirectCommand and gl's DrawElementsIndirectCommand,
+/// so both backends copy the batches into their indirect buffers as they are.
+struct DrawBatch {
+	u32 index_count;
+	u32 instance_count;
+	u32 first_index;
+	i32 vertex_offset;
+	u32 first_instance;
+};
+
+/// Consecutive batches with the same index type, drawn with one multi draw indirect call.
+struct DrawRun {
+	u32 first_batch;
+	u32 batch_count;
+	bool wide_indices;
+};
+
+/// Turns a frame's queued draws into instanced batches. Shared by the backends so they draw the same stream.
+class DrawBatcher {
+public:
+	/// Sorts the draws by index type and mesh and merges draws of the same mesh into one batch.
+	/// Writes one instance per draw in batch order. The writes go front to back, so instances can point into
+	/// write combined memory.
+	void build(std::span<const DrawCommand> draws, InstanceData* instances);
+
+	[[nodiscard]] std::span<const DrawBatch> batches() const {
+		return batch_list;
+	}
+	[[nodiscard]] std::span<const DrawRun> runs() const {
+		return run_list;
+	}
+private:
+	struct SortedDraw {
+		u64 key;
+		u32 draw;
+	};
+	std::vector<SortedDraw> sorted_draws {};
+	/// the mapped memory is never read, so the batches are merged here first
+	std::vector<DrawBatch> batch_list {};
+	std::vector<DrawRun> run_list {};
+};
\ No newline at end of file
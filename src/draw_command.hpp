@@ -0,0 +1,10 @@
+#pragma once
+#include "math/mat.hpp"
+
+class GpuMesh;
+
+/// A single mesh draw, used for submitting many draws at once.
+struct DrawCommand {
+	Mat4 model;
+	const GpuMesh* mesh;
+};
\ No newline at end of file
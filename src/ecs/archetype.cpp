@@ -0,0 +1,93 @@
+#include "archetype.hpp"
+#include <bit>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+constexpr usize COLUMN_ALIGN = 64;
+
+static constexpr usize align_up(usize value, usize alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+Archetype::Archetype(ComponentMask mask) : mask {mask} {
+	const auto& infos = component_registry().infos;
+
+	usize row_size = sizeof(Entity);
+	for (auto bits = mask; bits; bits &= bits - 1) {
+		auto component = as<ComponentId>(std::countr_zero(bits));
+		components.push_back(component);
+		row_size += infos[component].size;
+	}
+
+	// every column starts on its own cache line, which also satisfies any component alignment
+	auto padding = COLUMN_ALIGN * (components.size() + 1);
+	if (padding + row_size > CHUNK_SIZE) {
+		throw std::runtime_error("ecs: a row of the archetype's components doesn't fit in a chunk");
+	}
+	capacity = as<u32>((CHUNK_SIZE - padding) / row_size);
+
+	usize offset = align_up(sizeof(Entity) * capacity, COLUMN_ALIGN);
+	for (auto component : components) {
+		column_offsets[component] = as<u32>(offset);
+		offset = align_up(offset + as<usize>(infos[component].size) * capacity, COLUMN_ALIGN);
+	}
+}
+
+Archetype::~Archetype() {
+	for (auto& chunk : chunks) {
+		operator delete(chunk.data, std::align_val_t {COLUMN_ALIGN});
+	}
+}
+
+Archetype::Location Archetype::push(Entity entity) {
+	if (!used_chunks || chunks[used_chunks - 1].count == capacity) {
+		if (used_chunks == chunks.size()) {
+			chunks.push_back({
+				.data = as<u8*>(operator new(CHUNK_SIZE, std::align_val_t {COLUMN_ALIGN})),
+				.count = 0
+			});
+		}
+		++used_chunks;
+	}
+
+	auto chunk_index = used_chunks - 1;
+	auto& chunk = chunks[chunk_index];
+	auto row = chunk.count++;
+	entities(chunk)[row] = entity;
+
+	return {chunk_index, row};
+}
+
+Entity Archetype::remove(Location location) {
+	const auto& infos = component_registry().infos;
+
+	auto& last_chunk = chunks[used_chunks - 1];
+	auto last_row = last_chunk.count - 1;
+
+	Entity moved = NULL_ENTITY;
+	if (location.chunk != used_chunks - 1 || location.row != last_row) {
+		auto& chunk = chunks[location.chunk];
+		moved = entities(last_chunk)[last_row];
+		entities(chunk)[location.row] = moved;
+
+		for (auto component : components) {
+			auto size = infos[component].size;
+			memcpy(
+				column(chunk, component) + as<usize>(location.row) * size,
+				column(last_chunk, component) + as<usize>(last_row) * size,
+				size);
+		}
+	}
+
+	if (--last_chunk.count == 0) {
+		--used_chunks;
+		// one empty chunk is kept as a spare, anything beyond that is released
+		while (chunks.size() > used_chunks + 1) {
+			operator delete(chunks.back().data, std::align_val_t {COLUMN_ALIGN});
+			chunks.pop_back();
+		}
+	}
+
+	return moved;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "types.hpp"
+#include "component.hpp"
+#include <vector>
+
+struct Entity {
+	u32 index;
+	u32 generation;
+
+	constexpr bool operator==(const Entity&) const = default;
+};
+
+constexpr Entity NULL_ENTITY {UINT32_MAX, 0};
+
+/// Fixed size block holding up to Archetype::capacity entities, every component is stored as its own
+/// column so iterating a component is a linear walk over a plain array.
+struct Chunk {
+	u8* data;
+	u32 count;
+};
+
+/// Storage for all entities with exactly the same set of components.
+class Archetype {
+public:
+	explicit Archetype(ComponentMask mask);
+	~Archetype();
+	Archetype(const Archetype&) = delete;
+	Archetype& operator=(const Archetype&) = delete;
+
+	struct Location {
+		u32 chunk;
+		u32 row;
+	};
+
+	/// Appends an entity with uninitialized components.
+	Location push(Entity entity);
+	/// Removes a row by moving the last entity of the archetype into it.
+	/// Returns the entity that now occupies the row, or NULL_ENTITY if the row was the last one.
+	Entity remove(Location location);
+
+	[[nodiscard]] u8* column(const Chunk& chunk, ComponentId component) const {
+		return chunk.data + column_offsets[component];
+	}
+	[[nodiscard]] u8* component(Location location, ComponentId component) const {
+		return column(chunks[location.chunk], component) + as<usize>(location.row) * component_registry().infos[component].size;
+	}
+	[[nodiscard]] Entity* entities(const Chunk& chunk) const {
+		return cast<Entity*>(chunk.data);
+	}
+	[[nodiscard]] bool has(ComponentId component) const {
+		return mask & ComponentMask {1} << component;
+	}
+
+	constexpr static usize CHUNK_SIZE = 16 * 1024;
+
+	ComponentMask mask;
+	std::vector<ComponentId> components {};
+	u32 capacity {};
+	/// chunks are filled in order, only the last one with entities can be partially full
+	std::vector<Chunk> chunks {};
+	u32 used_chunks {};
+
+	/// cached archetype transitions for adding/removing a component
+	Archetype* add_edges[MAX_COMPONENTS] {};
+	Archetype* remove_edges[MAX_COMPONENTS] {};
+private:
+	u32 column_offsets[MAX_COMPONENTS] {};
+};
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include "types.hpp"
+#include "world.hpp"
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <vector>
+
+/// Records structural changes so they can be made from inside (parallel) queries and applied to the world later.
+/// Commands are stored back to back in one byte buffer, recording never allocates once it has grown.
+/// Every thread records into its own buffer.
+class CommandBuffer {
+public:
+	template<typename... Ts>
+	void create(const Ts&... components) {
+		push(
+			[](World& world, const u8* payload) {
+				std::tuple<Ts...> values {read<Ts>(payload)...};
+				std::apply([&](const Ts&... v) {
+					world.create(v...);
+				}, values);
+			},
+			components...);
+	}
+
+	void destroy(Entity entity) {
+		push(
+			[](World& world, const u8* payload) {
+				auto e = read<Entity>(payload);
+				if (world.alive(e)) {
+					world.destroy(e);
+				}
+			},
+			entity);
+	}
+
+	template<typename T>
+	void add(Entity entity, const T& component) {
+		push(
+			[](World& world, const u8* payload) {
+				auto e = read<Entity>(payload);
+				auto value = read<T>(payload);
+				if (world.alive(e)) {
+					world.add(e, value);
+				}
+			},
+			entity,
+			component);
+	}
+
+	template<typename T>
+	void remove(Entity entity) {
+		push(
+			[](World& world, const u8* payload) {
+				auto e = read<Entity>(payload);
+				if (world.alive(e)) {
+					world.remove<T>(e);
+				}
+			},
+			entity);
+	}
+
+	/// Applies the commands in recording order and clears the buffer.
+	void apply(World& world) {
+		const u8* ptr = data.data();
+		const u8* end = ptr + data.size();
+		while (ptr < end) {
+			auto header = read<Header>(ptr);
+			header.fn(world, ptr);
+			ptr += header.size;
+		}
+		data.clear();
+	}
+
+	[[nodiscard]] bool empty() const {
+		return data.empty();
+	}
+private:
+	using ApplyFn = void (*)(World& world, const u8* payload);
+
+	struct Header {
+		ApplyFn fn;
+		u32 size;
+	};
+
+	template<typename T>
+	static T read(const u8*& ptr) {
+		alignas(T) u8 storage[sizeof(T)];
+		memcpy(storage, ptr, sizeof(T));
+		ptr += sizeof(T);
+		return *std::launder(cast<T*>(storage));
+	}
+
+	template<typename... Ts>
+	void push(ApplyFn fn, const Ts&... values) {
+		Header header {fn, as<u32>((sizeof(Ts) + ... + 0))};
+		auto offset = data.size();
+		data.resize(offset + sizeof(Header) + header.size);
+
+		auto ptr = data.data() + offset;
+		memcpy(ptr, &header, sizeof(Header));
+		ptr += sizeof(Header);
+		((memcpy(ptr, &values, sizeof(Ts)), ptr += sizeof(Ts)), ...);
+	}
+
+	std::vector<u8> data {};
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include "types.hpp"
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+
+using ComponentId = u32;
+using ComponentMask = u64;
+
+constexpr u32 MAX_COMPONENTS = 64;
+
+struct ComponentInfo {
+	u32 size;
+	u32 align;
+};
+
+/// Fixed storage so registered entries can be read while other threads register new types.
+struct ComponentRegistry {
+	ComponentInfo infos[MAX_COMPONENTS] {};
+	u32 count {};
+	std::mutex lock {};
+};
+
+inline ComponentRegistry& component_registry() {
+	static ComponentRegistry registry;
+	return registry;
+}
+
+/// Sequential id of a component type, assigned on first use.
+template<typename T>
+ComponentId component_id() {
+	static_assert(std::is_trivially_copyable_v<T>, "components are relocated between chunks with memcpy");
+
+	static const ComponentId id = [] {
+		auto& registry = component_registry();
+		std::lock_guard guard {registry.lock};
+		if (registry.count == MAX_COMPONENTS) {
+			throw std::runtime_error("ecs: too many component types");
+		}
+		registry.infos[registry.count] = {sizeof(T), alignof(T)};
+		return registry.count++;
+	}();
+	return id;
+}
+
+template<typename... Ts>
+ComponentMask component_mask() {
+	return ((ComponentMask {1} << component_id<std::remove_const_t<Ts>>()) | ... | 0);
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "world.hpp"
+
+void World::destroy(Entity entity) {
+	// a stale handle's slot is either free or reused by a newer entity
+	if (!alive(entity)) {
+		return;
+	}
+	auto& record = records[entity.index];
+	auto moved = record.archetype->remove(record.location);
+	if (moved != NULL_ENTITY) {
+		records[moved.index].location = record.location;
+	}
+
+	record.archetype = nullptr;
+	++record.generation;
+	free_indices.push_back(entity.index);
+}
+
+Entity World::alloc_entity() {
+	if (!free_indices.empty()) {
+		auto index = free_indices.back();
+		free_indices.pop_back();
+		return {index, records[index].generation};
+	}
+
+	records.push_back({});
+	return {as<u32>(records.size() - 1), 0};
+}
+
+Archetype* World::archetype_for(ComponentMask mask) {
+	auto& archetype = archetypes[mask];
+	if (!archetype) {
+		archetype = std::make_unique<Archetype>(mask);
+		archetype_list.push_back(archetype.get());
+	}
+	return archetype.get();
+}
+
+void World::move_entity(Entity entity, Archetype* dst) {
+	auto& record = records[entity.index];
+	auto src = record.archetype;
+	auto src_location = record.location;
+	auto dst_location = dst->push(entity);
+
+	const auto& infos = component_registry().infos;
+	for (auto component : src->components) {
+		if (dst->has(component)) {
+			memcpy(dst->component(dst_location, component), src->component(src_location, component), infos[component].size);
+		}
+	}
+
+	auto moved = src->remove(src_location);
+	if (moved != NULL_ENTITY) {
+		records[moved.index].location = src_location;
+	}
+
+	record.archetype = dst;
+	record.location = dst_location;
+}
+
+void World::add_raw(Entity entity, ComponentId component, const void* data) {
+	if (!alive(entity)) {
+		return;
+	}
+	auto& record = records[entity.index];
+	auto archetype = record.archetype;
+
+	if (!archetype->has(component)) {
+		auto& edge = archetype->add_edges[component];
+		if (!edge) {
+			edge = archetype_for(archetype->mask | ComponentMask {1} << component);
+		}
+		move_entity(entity, edge);
+		archetype = edge;
+	}
+
+	memcpy(archetype->component(record.location, component), data, component_registry().infos[component].size);
+}
+
+void World::remove_raw(Entity entity, ComponentId component) {
+	if (!alive(entity)) {
+		return;
+	}
+	auto archetype = records[entity.index].archetype;
+	if (!archetype->has(component)) {
+		return;
+	}
+
+	auto& edge = archetype->remove_edges[component];
+	if (!edge) {
+		edge = archetype_for(archetype->mask & ~(ComponentMask {1} << component));
+	}
+	move_entity(entity, edge);
+}
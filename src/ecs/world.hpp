@@ -0,0 +1,138 @@
+#pragma once
+#include "types.hpp"
+#include "archetype.hpp"
+#include "jobs/job_system.hpp"
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/// Archetype based entity storage. Structural changes (create, destroy, add, remove) move entities between
+/// archetypes and must not happen while a query is iterating, record them into a CommandBuffer instead.
+class World {
+public:
+	World() = default;
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Ts>
+	Entity create(const Ts&... components) {
+		auto archetype = archetype_for(component_mask<Ts...>());
+		auto entity = alloc_entity();
+		auto location = archetype->push(entity);
+		records[entity.index].archetype = archetype;
+		records[entity.index].location = location;
+		(memcpy(archetype->component(location, component_id<Ts>()), &components, sizeof(Ts)), ...);
+		return entity;
+	}
+
+	/// Does nothing if the entity was already destroyed.
+	void destroy(Entity entity);
+	[[nodiscard]] bool alive(Entity entity) const {
+		return entity.index < records.size() && records[entity.index].generation == entity.generation
+			&& records[entity.index].archetype;
+	}
+
+	/// Adding to or removing from a destroyed entity does nothing.
+	template<typename T>
+	void add(Entity entity, const T& component) {
+		add_raw(entity, component_id<T>(), &component);
+	}
+
+	template<typename T>
+	void remove(Entity entity) {
+		remove_raw(entity, component_id<T>());
+	}
+
+	/// Returns null if the entity doesn't have the component or was destroyed, the pointer is invalidated by
+	/// structural changes.
+	template<typename T>
+	T* get(Entity entity) {
+		if (!alive(entity)) {
+			return nullptr;
+		}
+		const auto& record = records[entity.index];
+		auto id = component_id<T>();
+		if (!record.archetype->has(id)) {
+			return nullptr;
+		}
+		return cast<T*>(record.archetype->component(record.location, id));
+	}
+
+	template<typename T>
+	[[nodiscard]] bool has(Entity entity) const {
+		return alive(entity) && records[entity.index].archetype->has(component_id<T>());
+	}
+
+	/// Calls fn(count, entities, columns...) for every chunk containing all of Ts.
+	/// Columns are plain arrays, loops over them are straightforward for the compiler to vectorize.
+	template<typename... Ts, typename F>
+	void each_chunk(F&& fn) {
+		auto mask = component_mask<Ts...>();
+		for (auto archetype : archetype_list) {
+			if ((archetype->mask & mask) != mask) {
+				continue;
+			}
+			for (u32 i = 0; i < archetype->used_chunks; ++i) {
+				const auto& chunk = archetype->chunks[i];
+				fn(chunk.count, archetype->entities(chunk), column<Ts>(archetype, chunk)...);
+			}
+		}
+	}
+
+	/// Calls fn(components&...) for every entity containing all of Ts.
+	template<typename... Ts, typename F>
+	void each(F&& fn) {
+		each_chunk<Ts...>([&](u32 count, const Entity*, Ts*... columns) {
+			for (u32 i = 0; i < count; ++i) {
+				fn(columns[i]...);
+			}
+		});
+	}
+
+	/// Like each_chunk but chunks are spread over the job system, fn is called concurrently
+	/// and must not make structural changes.
+	template<typename... Ts, typename F>
+	void par_each_chunk(JobSystem& jobs, const F& fn) {
+		auto mask = component_mask<Ts...>();
+		JobCounter counter;
+		for (auto archetype : archetype_list) {
+			if ((archetype->mask & mask) != mask) {
+				continue;
+			}
+			for (u32 i = 0; i < archetype->used_chunks; ++i) {
+				jobs.submit([&fn, archetype, i] {
+					const auto& chunk = archetype->chunks[i];
+					fn(chunk.count, archetype->entities(chunk), column<Ts>(archetype, chunk)...);
+				}, &counter);
+			}
+		}
+		jobs.wait(counter);
+	}
+
+	[[nodiscard]] usize entity_count() const {
+		return records.size() - free_indices.size();
+	}
+private:
+	struct Record {
+		Archetype* archetype;
+		Archetype::Location location;
+		u32 generation;
+	};
+
+	template<typename T>
+	static T* column(Archetype* archetype, const Chunk& chunk) {
+		return cast<T*>(archetype->column(chunk, component_id<std::remove_const_t<T>>()));
+	}
+
+	Entity alloc_entity();
+	Archetype* archetype_for(ComponentMask mask);
+	void move_entity(Entity entity, Archetype* dst);
+	void add_raw(Entity entity, ComponentId component, const void* data);
+	void remove_raw(Entity entity, ComponentId component);
+
+	std::vector<Record> records {};
+	std::vector<u32> free_indices {};
+	std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> archetypes {};
+	std::vector<Archetype*> archetype_list {};
+};
\ No newline at end of file
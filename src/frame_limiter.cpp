@@ -0,0 +1,23 @@
+#include "frame_limiter.hpp"
+#include <thread>
+
+FrameLimiter::FrameLimiter(u32 max_fps) {
+	if (max_fps) {
+		period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds {1}) / max_fps;
+	}
+}
+
+void FrameLimiter::wait() {
+	if (period == period.zero()) {
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (now < next) {
+		std::this_thread::sleep_until(next);
+		now = next;
+	}
+	// deadlines advance by whole periods so sleep overshoot doesn't accumulate,
+	// after falling behind by more than a frame the schedule starts over
+	next = now - next > period ? now + period : next + period;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "types.hpp"
+#include <chrono>
+
+/// Caps the frame rate by sleeping. Waiting at the start of a frame, before input is read,
+/// keeps the time between reading input and presenting it short.
+class FrameLimiter {
+public:
+	/// 0 doesn't limit
+	explicit FrameLimiter(u32 max_fps);
+	void wait();
+private:
+	std::chrono::steady_clock::duration period {};
+	std::chrono::steady_clock::time_point next {};
+};
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include "types.hpp"
+#include <atomic>
+
+/// Lock free bounded queue from one producer thread to one consumer thread. Each side only writes its own
+/// index, so neither ever waits, a full queue rejects the value instead.
+template<typename T, u32 CAPACITY>
+class EventQueue {
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity has to be a power of two");
+public:
+	/// Producer side, returns false if the queue is full.
+	bool push(const T& value) {
+		auto t = tail.load(std::memory_order_relaxed);
+		if (t - head_cache == CAPACITY) {
+			head_cache = head.load(std::memory_order_acquire);
+			if (t - head_cache == CAPACITY) {
+				return false;
+			}
+		}
+		slots[t % CAPACITY] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Consumer side, returns false if the queue is empty.
+	bool pop(T& value) {
+		auto h = head.load(std::memory_order_relaxed);
+		if (h == tail_cache) {
+			tail_cache = tail.load(std::memory_order_acquire);
+			if (h == tail_cache) {
+				return false;
+			}
+		}
+		value = slots[h % CAPACITY];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+private:
+	T slots[CAPACITY] {};
+	/// the indices only grow, on separate lines with the other side's cached copy so polling doesn't bounce them
+	alignas(64) std::atomic<u64> tail {};
+	u64 head_cache {};
+	alignas(64) std::atomic<u64> head {};
+	u64 tail_cache {};
+};
\ No newline at end of file
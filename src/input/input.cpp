@@ -0,0 +1,17 @@
+#include "input.hpp"
+#include "profiler/profiler.hpp"
+
+void Input::pump(const std::function<void(const SDL_Event& event)>& on_window_event) {
+	PROFILE_ZONE("Input::pump");
+	// everything read by one pump arrived since the previous one, its time is when it became visible to the game
+	auto now = std::chrono::steady_clock::now();
+	SDL_Event event;
+	while (SDL_PollEvent(&event)) {
+		if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT) {
+			on_window_event(event);
+		}
+		else if (!events.push({.time = now, .event = event})) {
+			++dropped;
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "types.hpp"
+#include "event_queue.hpp"
+#include <SDL.h>
+#include <chrono>
+#include <functional>
+
+struct InputEvent {
+	/// when pump took the event from the os, the start of its latency
+	std::chrono::steady_clock::time_point time;
+	SDL_Event event;
+};
+
+/// Hands keyboard, mouse and controller events to the simulation thread. SDL only reads the os queue on the
+/// thread that created the window, so the main thread pumps it at several points of a frame and every event
+/// is timestamped and queued right away instead of waiting for the next frame's poll. The simulation takes
+/// them at the start of its next tick.
+class Input {
+public:
+	/// Reads the os events. Quit and window events go to on_window_event on the calling thread, everything
+	/// else is queued for poll. Has to be called from the thread that created the window.
+	void pump(const std::function<void(const SDL_Event& event)>& on_window_event);
+
+	/// Next queued event, only call from one thread.
+	bool poll(InputEvent& event) {
+		return events.pop(event);
+	}
+
+	/// Events lost because the consumer didn't keep up.
+	[[nodiscard]] u64 dropped_events() const {
+		return dropped;
+	}
+private:
+	/// holds the input of several frames if a tick stalls
+	EventQueue<InputEvent, 1024> events {};
+	u64 dropped {};
+};
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "job_system.hpp"
+#include "profiler/profiler.hpp"
+
+/// Job system whose worker thread this is, with the worker's index. Every instance compares against itself,
+/// so several job systems can exist side by side.
+static thread_local struct {
+	const JobSystem* system;
+	u32 index;
+} current_worker {nullptr, UINT32_MAX};
+
+bool JobDeque::push(Job* job) {
+	auto b = bottom.load(std::memory_order_relaxed);
+	auto t = top.load(std::memory_order_acquire);
+	if (b - t >= as<i64>(CAPACITY)) {
+		return false;
+	}
+
+	buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	// publishes the job to thieves, pairs with the acquire load of bottom in steal
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+Job* JobDeque::pop() {
+	auto b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	auto job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		// last job, race against thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobDeque::steal() {
+	auto t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto b = bottom.load(std::memory_order_acquire);
+	if (t >= b) {
+		return nullptr;
+	}
+
+	auto job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	return job;
+}
+
+JobSystem::JobSystem(u32 thread_count) {
+	if (!thread_count) {
+		thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	for (u32 i = 0; i < thread_count; ++i) {
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->steal_seed = i * 0x9E3779B9 + 1;
+	}
+	external_storage = std::make_unique<Job[]>(JobDeque::CAPACITY);
+
+	creating_thread = std::this_thread::get_id();
+	for (u32 i = 1; i < thread_count; ++i) {
+		threads.emplace_back([this, i] {
+			worker_main(i);
+		});
+	}
+}
+
+JobSystem::~JobSystem() {
+	running.store(false);
+	{
+		std::lock_guard guard {sleep_lock};
+	}
+	sleep_cv.notify_all();
+	threads.clear();
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	auto index = thread_index();
+	while (!counter.done()) {
+		if (auto job = find_job(index)) {
+			execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	// the thread that finished the last job may still be holding the lock, the counter must outlive that
+	std::lock_guard guard {counter.lock};
+}
+
+u32 JobSystem::thread_index() const {
+	if (current_worker.system == this) {
+		return current_worker.index;
+	}
+	return std::this_thread::get_id() == creating_thread ? 0 : UINT32_MAX;
+}
+
+Job* JobSystem::alloc_job() {
+	auto index = thread_index();
+
+	while (true) {
+		if (index != UINT32_MAX) {
+			auto& worker = *workers[index];
+			auto& job = worker.jobs[worker.next_job++ % JobDeque::CAPACITY];
+			if (!job.in_use.load(std::memory_order_acquire)) {
+				job.in_use.store(true, std::memory_order_relaxed);
+				return &job;
+			}
+		}
+		else {
+			std::lock_guard guard {external_lock};
+			auto& job = external_storage[external_next++ % JobDeque::CAPACITY];
+			if (!job.in_use.load(std::memory_order_acquire)) {
+				job.in_use.store(true, std::memory_order_relaxed);
+				return &job;
+			}
+		}
+
+		// the ring wrapped around onto a job that hasn't run yet, help until it has
+		if (auto other = find_job(index)) {
+			execute(other);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::enqueue(Job* job) {
+	auto index = thread_index();
+	if (index != UINT32_MAX) {
+		if (!workers[index]->deque.push(job)) {
+			execute(job);
+			return;
+		}
+	}
+	else {
+		std::lock_guard guard {external_lock};
+		external_jobs.push_back(job);
+	}
+
+	work_generation.fetch_add(1);
+	if (sleeping.load()) {
+		{
+			std::lock_guard guard {sleep_lock};
+		}
+		sleep_cv.notify_one();
+	}
+}
+
+Job* JobSystem::find_job(u32 index) {
+	if (index != UINT32_MAX) {
+		if (auto job = workers[index]->deque.pop()) {
+			return job;
+		}
+	}
+
+	{
+		std::lock_guard guard {external_lock};
+		if (!external_jobs.empty()) {
+			auto job = external_jobs.front();
+			external_jobs.pop_front();
+			return job;
+		}
+	}
+
+	auto count = as<u32>(workers.size());
+	u32 start = 0;
+	if (index != UINT32_MAX) {
+		auto& seed = workers[index]->steal_seed;
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		start = seed % count;
+	}
+
+	for (u32 i = 0; i < count; ++i) {
+		auto victim = (start + i) % count;
+		if (victim == index) {
+			continue;
+		}
+		if (auto job = workers[victim]->deque.steal()) {
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::execute(Job* job) {
+	job->invoke(*job);
+	auto counter = job->counter;
+	job->in_use.store(false, std::memory_order_release);
+
+	if (!counter) {
+		return;
+	}
+
+	std::vector<Job*> ready;
+	{
+		std::lock_guard guard {counter->lock};
+		if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			ready.swap(counter->continuations);
+		}
+	}
+	for (auto continuation : ready) {
+		enqueue(continuation);
+	}
+}
+
+void JobSystem::worker_main(u32 index) {
+	current_worker = {this, index};
+	PROFILE_THREAD("worker");
+
+	constexpr u32 SPIN_COUNT = 64;
+	u32 idle = 0;
+	while (running.load(std::memory_order_relaxed)) {
+		auto generation = work_generation.load();
+		if (auto job = find_job(index)) {
+			execute(job);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < SPIN_COUNT) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock guard {sleep_lock};
+		sleeping.fetch_add(1);
+		sleep_cv.wait(guard, [&] {
+			return work_generation.load() != generation || !running.load();
+		});
+		sleeping.fetch_sub(1);
+		idle = 0;
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+/// Counts unfinished jobs. Jobs can be made to depend on a counter, they are only queued once it reaches zero.
+struct JobCounter {
+	std::atomic<u32> value {};
+	std::mutex lock {};
+	std::vector<Job*> continuations {};
+
+	[[nodiscard]] bool done() const {
+		return value.load(std::memory_order_acquire) == 0;
+	}
+};
+
+struct Job {
+	constexpr static usize STORAGE_SIZE = 64;
+
+	void (*invoke)(Job& job);
+	JobCounter* counter;
+	std::atomic<bool> in_use;
+	alignas(16) u8 storage[STORAGE_SIZE];
+};
+
+/// Bounded Chase-Lev work stealing deque, the owner pushes and pops at the bottom while other threads steal from the top.
+class JobDeque {
+public:
+	bool push(Job* job);
+	Job* pop();
+	Job* steal();
+
+	constexpr static usize CAPACITY = 4096;
+private:
+	alignas(64) std::atomic<i64> top {};
+	alignas(64) std::atomic<i64> bottom {};
+	std::atomic<Job*> buffer[CAPACITY] {};
+};
+
+/// Work stealing scheduler with one deque per worker thread. Threads that wait on a counter keep executing
+/// other jobs until it reaches zero instead of blocking, so jobs may freely wait on jobs they spawned.
+class JobSystem {
+public:
+	/// thread_count includes the creating thread, 0 uses every hardware thread
+	explicit JobSystem(u32 thread_count = 0);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/// Queues fn, counter is incremented now and decremented once fn has run.
+	/// If dependency is given the job isn't started before that counter reaches zero.
+	template<typename F>
+	void submit(F&& fn, JobCounter* counter = nullptr, JobCounter* dependency = nullptr) {
+		using Fn = std::decay_t<F>;
+		static_assert(sizeof(Fn) <= Job::STORAGE_SIZE, "job closure is too big, capture by reference instead");
+		static_assert(alignof(Fn) <= 16);
+
+		auto job = alloc_job();
+		new (job->storage) Fn {std::forward<F>(fn)};
+		job->invoke = [](Job& j) {
+			auto& f = *std::launder(cast<Fn*>(j.storage));
+			f();
+			f.~Fn();
+		};
+		job->counter = counter;
+		if (counter) {
+			counter->value.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (dependency) {
+			std::lock_guard guard {dependency->lock};
+			if (!dependency->done()) {
+				dependency->continuations.push_back(job);
+				return;
+			}
+		}
+		enqueue(job);
+	}
+
+	/// Splits [0, count) into batches of batch_size and runs fn(begin, end) for each of them.
+	/// fn is copied into every job so it should capture by reference.
+	template<typename F>
+	void parallel_for(u32 count, u32 batch_size, const F& fn, JobCounter& counter) {
+		for (u32 begin = 0; begin < count; begin += batch_size) {
+			auto end = std::min(begin + batch_size, count);
+			submit([fn, begin, end] {
+				fn(begin, end);
+			}, &counter);
+		}
+	}
+
+	/// Executes other jobs until counter reaches zero.
+	void wait(JobCounter& counter);
+
+	[[nodiscard]] u32 thread_count() const {
+		return as<u32>(workers.size());
+	}
+	/// Index of the calling worker, the thread that created the job system is 0.
+	/// Threads that aren't workers of this job system return UINT32_MAX, even if they work for another one.
+	[[nodiscard]] u32 thread_index() const;
+private:
+	struct Worker {
+		JobDeque deque {};
+		Job jobs[JobDeque::CAPACITY] {};
+		u32 next_job {};
+		u32 steal_seed {};
+	};
+
+	Job* alloc_job();
+	void enqueue(Job* job);
+	Job* find_job(u32 index);
+	void execute(Job* job);
+	void worker_main(u32 index);
+
+	std::vector<std::unique_ptr<Worker>> workers {};
+	std::vector<std::jthread> threads {};
+	/// worker 0, it runs jobs while it waits
+	std::thread::id creating_thread {};
+
+	/// jobs submitted from threads that aren't workers
+	std::mutex external_lock {};
+	std::deque<Job*> external_jobs {};
+	std::unique_ptr<Job[]> external_storage {};
+	u32 external_next {};
+
+	std::mutex sleep_lock {};
+	std::condition_variable sleep_cv {};
+	std::atomic<u64> work_generation {};
+	std::atomic<u32> sleeping {};
+	std::atomic<bool> running {true};
+};
\ No newline at end of file
@@ -1,40 +1,269 @@
-#include <iostream>
 #include "logger.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstring>
 
-Logger::Logger(std::string_view filename) {
-	file = std::ofstream {filename.data()};
-	is_file = true;
+Logger::Logger() : Logger {stdout} {}
+
+Logger::Logger(std::string_view filename) : Logger {std::fopen(std::string {filename}.c_str(), "w")} {
+	if (out == stdout) {
+		warn("log", "failed to open {}, logging to stdout", filename);
+	}
+}
+
+Logger::Logger(std::FILE* file) : out {file ? file : stdout}, records {new Record[CAPACITY]} {
+	for (u64 i = 0; i < CAPACITY; ++i) {
+		records[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	thread = std::jthread {[this](const std::stop_token& stop) {
+		consumer_main(stop);
+	}};
+}
+
+Logger::~Logger() {
+	thread.request_stop();
+	wake_cv.notify_one();
+	thread.join();
+	if (out != stdout) {
+		std::fclose(out);
+	}
 }
 
 void Logger::log(std::string_view area, std::string_view text, LogLevel level) {
-	std::string str;
-	str.reserve(area.size() + text.size() + 2 + 8);
-	str += '[';
-	str += area;
-	str += "]";
-	if (level == LogLevel::Info) {
-		str += "[info]: ";
+	if (level < MIN_LOG_LEVEL) {
+		return;
+	}
+
+	u64 position;
+	auto record = claim(level, area, nullptr, position);
+	if (!record) {
+		return;
+	}
+	auto size = std::min(text.size(), sizeof(record->payload) - record->size);
+	memcpy(record->payload + record->size, text.data(), size);
+	record->size += size;
+	record->truncated = size < text.size();
+	publish(*record, position);
+}
+
+void Logger::flush() {
+	auto target = write_pos.load(std::memory_order_acquire);
+	wake_cv.notify_one();
+	std::unique_lock lock {flush_lock};
+	flushed_cv.wait(lock, [&] {
+		return read_pos.load(std::memory_order_acquire) >= target;
+	});
+}
+
+Logger::Record* Logger::claim(LogLevel level, std::string_view area, const char* fmt, u64& position) {
+	auto pos = write_pos.load(std::memory_order_relaxed);
+	Record* record;
+	while (true) {
+		record = &records[pos % CAPACITY];
+		auto sequence = record->sequence.load(std::memory_order_acquire);
+		auto diff = as<i64>(sequence - pos);
+		if (diff == 0) {
+			if (write_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			// the consumer is a whole lap behind
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		else {
+			pos = write_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	position = pos;
+	auto area_size = std::min(area.size(), MAX_AREA_SIZE);
+	record->fmt = fmt;
+	record->level = level;
+	record->area_size = as<u8>(area_size);
+	record->truncated = false;
+	record->size = as<u16>(area_size);
+	memcpy(record->payload, area.data(), area_size);
+	return record;
+}
+
+void Logger::publish(Record& record, u64 position) {
+	auto level = record.level;
+	record.sequence.store(position + 1, std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_seq_cst)) {
+		wake_cv.notify_one();
+	}
+	// errors usually come right before the program dies, make sure they are out
+	if (level == LogLevel::Error) {
+		flush();
 	}
-	else if (level == LogLevel::Warn) {
-		str += "[warn]: ";
+}
+
+void Logger::append_arg(Record& record, ArgType type, const void* data, usize size) {
+	auto remaining = sizeof(record.payload) - record.size;
+	auto header = type == ArgType::String ? 1 + sizeof(u16) : 1;
+	if (record.truncated || remaining < header + (type == ArgType::String ? 0 : size)) {
+		record.truncated = true;
+		return;
+	}
+
+	auto ptr = record.payload + record.size;
+	*ptr++ = as<u8>(type);
+	if (type == ArgType::String) {
+		if (size > remaining - header) {
+			size = remaining - header;
+			record.truncated = true;
+		}
+		auto length = as<u16>(size);
+		memcpy(ptr, &length, sizeof(length));
+		ptr += sizeof(length);
 	}
-	else if (level == LogLevel::Error) {
-		str += "[err]: ";
+	memcpy(ptr, data, size);
+	record.size += as<u16>(header + size);
+}
+
+template<typename T>
+static void append_number(std::string& out, T value) {
+	char buffer[32];
+	std::to_chars_result result;
+	if constexpr (std::is_floating_point_v<T>) {
+		// same as printf %g
+		result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+	}
+	else {
+		result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	}
+	out.append(buffer, result.ptr);
+}
+
+void Logger::format(std::string& out, const Record& record) {
+	out += '[';
+	out.append(cast<const char*>(record.payload), record.area_size);
+	switch (record.level) {
+		case LogLevel::Info:
+			out += "][info]: ";
+			break;
+		case LogLevel::Warn:
+			out += "][warn]: ";
+			break;
+		case LogLevel::Error:
+			out += "][err]: ";
+			break;
 	}
-	str += text;
-	str += '\n';
 
+	const u8* ptr = record.payload + record.area_size;
+	const u8* end = record.payload + record.size;
 
-	if (is_file) {
-		file << str;
+	if (!record.fmt) {
+		out.append(cast<const char*>(ptr), end - ptr);
 	}
 	else {
-		std::cout << str;
+		for (auto fmt = record.fmt; *fmt; ++fmt) {
+			if (fmt[0] != '{' || fmt[1] != '}') {
+				out += *fmt;
+				continue;
+			}
+			++fmt;
+			if (ptr == end) {
+				continue;
+			}
+
+			auto type = as<ArgType>(*ptr++);
+			switch (type) {
+				case ArgType::Signed: {
+					i64 v;
+					memcpy(&v, ptr, sizeof(v));
+					ptr += sizeof(v);
+					append_number(out, v);
+					break;
+				}
+				case ArgType::Unsigned: {
+					u64 v;
+					memcpy(&v, ptr, sizeof(v));
+					ptr += sizeof(v);
+					append_number(out, v);
+					break;
+				}
+				case ArgType::Float: {
+					f64 v;
+					memcpy(&v, ptr, sizeof(v));
+					ptr += sizeof(v);
+					append_number(out, v);
+					break;
+				}
+				case ArgType::Bool:
+					out += *ptr++ ? "true" : "false";
+					break;
+				case ArgType::Char:
+					out += as<char>(*ptr++);
+					break;
+				case ArgType::String: {
+					u16 length;
+					memcpy(&length, ptr, sizeof(length));
+					ptr += sizeof(length);
+					out.append(cast<const char*>(ptr), length);
+					ptr += length;
+					break;
+				}
+			}
+		}
+	}
+
+	if (record.truncated) {
+		out += "...";
 	}
+	out += '\n';
 }
 
-Logger::~Logger() {
-	if (is_file) {
-		file.close();
+void Logger::consumer_main(const std::stop_token& stop) {
+	std::string buffer;
+	auto pos = read_pos.load(std::memory_order_relaxed);
+
+	while (true) {
+		auto start = pos;
+		while (true) {
+			auto& record = records[pos % CAPACITY];
+			if (record.sequence.load(std::memory_order_acquire) != pos + 1) {
+				break;
+			}
+			format(buffer, record);
+			record.sequence.store(pos + CAPACITY, std::memory_order_release);
+			++pos;
+		}
+
+		if (auto count = dropped.exchange(0, std::memory_order_relaxed)) {
+			buffer += "[log][warn]: dropped ";
+			buffer += std::to_string(count);
+			buffer += " messages, the queue was full\n";
+		}
+
+		if (!buffer.empty()) {
+			std::fwrite(buffer.data(), 1, buffer.size(), out);
+			std::fflush(out);
+			buffer.clear();
+		}
+
+		if (pos != start) {
+			read_pos.store(pos, std::memory_order_release);
+			{
+				std::lock_guard guard {flush_lock};
+			}
+			flushed_cv.notify_all();
+			continue;
+		}
+
+		if (stop.stop_requested()) {
+			break;
+		}
+
+		std::unique_lock lock {wake_lock};
+		sleeping.store(true, std::memory_order_seq_cst);
+		// producers check sleeping after publishing, a record published before the flag was set is seen here.
+		// a wakeup that still slips through is bounded by the timeout
+		if (records[pos % CAPACITY].sequence.load(std::memory_order_seq_cst) != pos + 1) {
+			wake_cv.wait_for(lock, std::chrono::milliseconds {10});
+		}
+		sleeping.store(false, std::memory_order_relaxed);
 	}
 }
@@ -1,6 +1,14 @@
 #pragma once
+#include "types.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
-#include <fstream>
+#include <thread>
+#include <type_traits>
 
 enum class LogLevel {
 	Info,
@@ -8,15 +16,144 @@ enum class LogLevel {
 	Error
 };
 
+#ifndef GAME_LOG_LEVEL
+#define GAME_LOG_LEVEL 0
+#endif
+
+/// info, warn and error calls below this level are compiled out
+constexpr LogLevel MIN_LOG_LEVEL = as<LogLevel>(GAME_LOG_LEVEL);
+
+/// Asynchronous logger. Callers copy their message into a lock free multi producer ring and return,
+/// a background thread formats the queued records and writes them out in batches.
+/// When the ring is full messages are dropped rather than blocking, the drop count is logged later.
 class Logger {
 public:
-	Logger() : is_file {false} {}
-	~Logger();
+	Logger();
 	explicit Logger(std::string_view filename);
+	~Logger();
+	Logger(const Logger&) = delete;
+	Logger& operator=(const Logger&) = delete;
+
+	/// Queues already formatted text, errors are flushed before returning.
 	void log(std::string_view area, std::string_view text, LogLevel level = LogLevel::Info);
+
+	// Every {} in fmt is replaced by the next argument. Arguments are copied into the record
+	// and formatted on the logger thread, fmt isn't copied and has to be a string literal.
+
+	template<typename... Args>
+	void info(std::string_view area, const char* fmt, const Args&... args) {
+		if constexpr (LogLevel::Info >= MIN_LOG_LEVEL) {
+			push(LogLevel::Info, area, fmt, args...);
+		}
+	}
+
+	template<typename... Args>
+	void warn(std::string_view area, const char* fmt, const Args&... args) {
+		if constexpr (LogLevel::Warn >= MIN_LOG_LEVEL) {
+			push(LogLevel::Warn, area, fmt, args...);
+		}
+	}
+
+	template<typename... Args>
+	void error(std::string_view area, const char* fmt, const Args&... args) {
+		if constexpr (LogLevel::Error >= MIN_LOG_LEVEL) {
+			push(LogLevel::Error, area, fmt, args...);
+		}
+	}
+
+	/// Blocks until everything logged before the call has been written.
+	void flush();
 private:
-	bool is_file;
-	union {
-		std::ofstream file;
+	enum class ArgType : u8 {
+		Signed,
+		Unsigned,
+		Float,
+		Bool,
+		Char,
+		String
 	};
+
+	constexpr static usize RECORD_SIZE = 256;
+	constexpr static u64 CAPACITY = 4096;
+	/// longer area names are cut, the rest of the payload is left for the message
+	constexpr static usize MAX_AREA_SIZE = 32;
+
+	struct alignas(64) Record {
+		/// position + 1 once published, position + CAPACITY once consumed and free for the next lap
+		std::atomic<u64> sequence;
+		/// null for plain text records
+		const char* fmt;
+		LogLevel level;
+		u8 area_size;
+		bool truncated;
+		u16 size;
+		u8 payload[RECORD_SIZE - 24];
+	};
+	static_assert(sizeof(Record) == RECORD_SIZE);
+	static_assert(MAX_AREA_SIZE < sizeof(Record::payload) / 2);
+
+	explicit Logger(std::FILE* file);
+
+	template<typename... Args>
+	void push(LogLevel level, std::string_view area, const char* fmt, const Args&... args) {
+		u64 position;
+		auto record = claim(level, area, fmt, position);
+		if (!record) {
+			return;
+		}
+		(encode(*record, args), ...);
+		publish(*record, position);
+	}
+
+	template<typename T>
+	static void encode(Record& record, const T& value) {
+		using U = std::remove_cvref_t<T>;
+		if constexpr (std::is_same_v<U, bool>) {
+			u8 v = value;
+			append_arg(record, ArgType::Bool, &v, 1);
+		}
+		else if constexpr (std::is_same_v<U, char>) {
+			append_arg(record, ArgType::Char, &value, 1);
+		}
+		else if constexpr (std::is_enum_v<U>) {
+			encode(record, as<std::underlying_type_t<U>>(value));
+		}
+		else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+			i64 v = value;
+			append_arg(record, ArgType::Signed, &v, sizeof(v));
+		}
+		else if constexpr (std::is_integral_v<U>) {
+			u64 v = value;
+			append_arg(record, ArgType::Unsigned, &v, sizeof(v));
+		}
+		else if constexpr (std::is_floating_point_v<U>) {
+			f64 v = value;
+			append_arg(record, ArgType::Float, &v, sizeof(v));
+		}
+		else {
+			static_assert(std::is_convertible_v<const T&, std::string_view>, "unsupported log argument type");
+			std::string_view v = value;
+			append_arg(record, ArgType::String, v.data(), v.size());
+		}
+	}
+
+	Record* claim(LogLevel level, std::string_view area, const char* fmt, u64& position);
+	void publish(Record& record, u64 position);
+	static void append_arg(Record& record, ArgType type, const void* data, usize size);
+	static void format(std::string& out, const Record& record);
+	void consumer_main(const std::stop_token& stop);
+
+	std::FILE* out;
+	std::unique_ptr<Record[]> records;
+	alignas(64) std::atomic<u64> write_pos {};
+	alignas(64) std::atomic<u64> read_pos {};
+	std::atomic<u64> dropped {};
+
+	std::atomic<bool> sleeping {};
+	std::mutex wake_lock {};
+	std::condition_variable wake_cv {};
+	std::mutex flush_lock {};
+	std::condition_variable flushed_cv {};
+
+	std::jthread thread;
 };
\ No newline at end of file
@@ -1,24 +1,390 @@
 #include "window.hpp"
 #include "renderer.hpp"
 #include "logger.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/mesh_file.hpp"
+#include "culling/bvh.hpp"
+#include "jobs/job_system.hpp"
+#include "profiler/profiler.hpp"
+#include "frame_limiter.hpp"
+#include "simulation/simulation.hpp"
+#include "input/input.hpp"
+#include "ecs/world.hpp"
+#include "components/renderable.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <numbers>
+#include <string>
+#include <vector>
 
-int main() {
-	Window window {"game", 800, 600, Platform::Vulkan};
+constexpr u32 WIDTH = 800;
+constexpr u32 HEIGHT = 600;
+/// frames excluded from the statistics while pipelines, caches and clocks settle
+constexpr u32 WARMUP_FRAMES = 10;
+
+/// Turns an entity around the y axis, speed times the simulation's angle.
+struct Spin {
+	f32 speed;
+};
+
+struct Options {
+	bool headless {};
+	/// 0 runs until the window is closed
+	u32 frames {};
+	/// chrome trace written on exit
+	std::string trace {};
+	/// 0 doesn't limit
+	u32 max_fps {};
+	/// simulation ticks per second, independent of the frame rate
+	u32 tick_rate {60};
+	/// mesh file drawn instead of the cube
+	std::string mesh {};
+	/// texture file from texture_convert the mesh is drawn with
+	std::string texture {};
+	/// record every draw separately on the job system instead of submitting instanced batches
+	bool parallel_recording {};
+	/// only builds with the dynamic render backend support more than one
+	Platform platform {DEFAULT_PLATFORM};
+	RendererSettings settings {};
+};
+
+static PresentMode parse_present_mode(std::string_view name) {
+	if (name == "fifo") {
+		return PresentMode::Fifo;
+	}
+	else if (name == "relaxed") {
+		return PresentMode::FifoRelaxed;
+	}
+	else if (name == "immediate") {
+		return PresentMode::Immediate;
+	}
+	return PresentMode::Mailbox;
+}
+
+static Options parse_options(int argc, char** argv) {
+	Options options {};
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			options.headless = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			options.frames = as<u32>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			options.trace = argv[++i];
+		}
+		else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+			options.mesh = argv[++i];
+		}
+		else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc) {
+			options.texture = argv[++i];
+		}
+		else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+			options.settings.texture_budget = std::stoull(argv[++i]) * 1024 * 1024;
+		}
+		else if (strcmp(argv[i], "--parallel") == 0) {
+			options.parallel_recording = true;
+		}
+		else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+			options.platform = strcmp(argv[++i], "opengl") == 0 ? Platform::OpenGL : Platform::Vulkan;
+		}
+		else if (strcmp(argv[i], "--gpu-culling") == 0) {
+			options.settings.gpu_culling = true;
+		}
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+			options.max_fps = as<u32>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+			options.tick_rate = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--present") == 0 && i + 1 < argc) {
+			options.settings.present_mode = parse_present_mode(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+			options.settings.frames_in_flight = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+	}
+	// headless has no window to close
+	if (options.headless && !options.frames) {
+		options.frames = 1000;
+	}
+	return options;
+}
+
+static void log_percentiles(Logger& logger, std::string_view name, std::vector<f64>& samples) {
+	if (samples.empty()) {
+		logger.info("bench", "{}: no samples", name);
+		return;
+	}
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&](f64 p) {
+		return samples[std::min(as<usize>(p * as<f64>(samples.size())), samples.size() - 1)];
+	};
+	logger.info("bench", "{}: p50 {}ms p95 {}ms p99 {}ms max {}ms",
+		name, percentile(0.5), percentile(0.95), percentile(0.99), samples.back());
+}
+
+int main(int argc, char** argv) {
+	auto options = parse_options(argc, argv);
+	PROFILE_THREAD("main");
+
+	auto start = std::chrono::steady_clock::now();
 	Logger logger {};
-	Renderer renderer {&window, Platform::Vulkan, &logger};
+	JobSystem jobs {};
+	std::unique_ptr<Window> window;
+	std::unique_ptr<Renderer> renderer;
+	if (options.headless) {
+		renderer = create_renderer(WIDTH, HEIGHT, options.platform, &logger, jobs, options.settings);
+	}
+	else {
+		window = std::make_unique<Window>("game", WIDTH, HEIGHT, options.platform);
+		renderer = create_renderer(window.get(), options.platform, &logger, jobs, options.settings);
+	}
+
+	renderer->set_clear_color(0, 1, 0, 1);
+
+	GpuMesh mesh;
+	if (options.mesh.empty()) {
+		mesh = renderer->upload(Mesh::cube());
+	}
+	else {
+		// only mapped until the upload has copied it into the staging buffer
+		try {
+			mesh = renderer->upload(MeshFile {options.mesh}.view());
+		}
+		catch (const std::exception& e) {
+			logger.log("main", e.what(), LogLevel::Error);
+			return 1;
+		}
+	}
 
-	renderer.set_clear_color(0, 1, 0, 1);
+	// a file that fails to load is logged by the renderer and the mesh stays untextured
+	if (!options.texture.empty()) {
+		mesh.texture = renderer->load_texture(options.texture);
+	}
+
+	// a grid of meshes spinning in place, once the simulation starts its thread owns the world and the renderer
+	// only sees snapshots
+	constexpr i32 GRID_SIZE = 64;
+	World world;
+	for (i32 z = 0; z < GRID_SIZE; ++z) {
+		for (i32 x = 0; x < GRID_SIZE; ++x) {
+			world.create(
+				Transform {.position = {as<f32>(x - GRID_SIZE / 2) * 2, 0, as<f32>(z - GRID_SIZE / 2) * 2}},
+				Renderable {.mesh = &mesh, .material = 0},
+				// neighbours turn at different speeds so the motion is visible at any tick rate
+				Spin {.speed = as<f32>((z * GRID_SIZE + x) % 7 + 1) * 0.25f});
+		}
+	}
+
+	// snapshots list the transforms in query order, which doesn't change without structural changes
+	std::vector<DrawCommand> draws;
+	world.each<const Renderable>([&](const Renderable& renderable) {
+		draws.push_back({.model = Mat4::identity(), .mesh = renderable.mesh});
+	});
+
+	// only pumped with a window, it has to outlive the simulation that reads it
+	Input input;
+	Simulation simulation {options.tick_rate, [&world, &input, angle = 0.0, direction = 1.0](SimulationSnapshot& snapshot, f64 dt) mutable {
+		// space reverses the spin, the snapshot carries the time of the oldest input it reacts to
+		InputEvent event;
+		while (input.poll(event)) {
+			if (event.event.type == SDL_KEYDOWN && event.event.key.keysym.sym == SDLK_SPACE && !event.event.key.repeat) {
+				direction = -direction;
+				if (!snapshot.input_time) {
+					snapshot.input_time = event.time;
+				}
+			}
+		}
+
+		// every spin speed turns a whole number of times in 8 pi, so wrapping there doesn't make anything jump
+		angle = std::fmod(angle + dt * direction, 8 * std::numbers::pi);
+		snapshot.transforms.clear();
+		world.each<Transform, const Spin>([&](Transform& transform, const Spin& spin) {
+			transform.rotation = Quat::from_axis_angle({0, 1, 0}, as<f32>(angle) * spin.speed);
+			snapshot.transforms.push_back(transform);
+		});
+	}};
+	simulation.start();
+
+	std::vector<Transform> transforms;
+	std::vector<Mat4> models;
+	simulation.interpolate(transforms);
+	models.resize(transforms.size());
+	transforms_to_matrices(transforms.data(), models.data(), transforms.size());
+
+	for (u32 i = 0; i < draws.size(); ++i) {
+		draws[i].model = models[i];
+	}
+
+	// the tree is built once and refitted as the objects turn
+	Bvh bvh;
+	std::vector<u32> proxies;
+	for (u32 i = 0; i < draws.size(); ++i) {
+		proxies.push_back(bvh.insert(transform_aabb(mesh.bounds, draws[i].model), i));
+	}
+	bvh.update();
+	std::vector<u32> visible;
+	std::vector<DrawCommand> visible_draws;
+	visible_draws.reserve(draws.size());
+
+	// with gpu culling the objects are added once and only their matrices are updated per frame
+	bool gpu_culling = options.settings.gpu_culling;
+	std::vector<u32> objects;
+	if (gpu_culling) {
+		try {
+			for (const auto& draw : draws) {
+				objects.push_back(renderer->add_object(mesh, draw.model));
+			}
+		}
+		catch (const std::exception& e) {
+			logger.log("main", e.what(), LogLevel::Warn);
+			gpu_culling = false;
+		}
+	}
+
+	Frustum frustum {};
+	auto update_camera = [&](u32 width, u32 height) {
+		auto aspect = as<f32>(width) / as<f32>(height);
+		auto view_projection = Mat4::perspective(std::numbers::pi_v<f32> / 3, aspect, 0.1f, 500)
+			* Mat4::look_at({0, 40, 80}, {0, 0, 0}, {0, 1, 0});
+		renderer->set_view_projection(view_projection);
+		frustum = Frustum::from_view_projection(view_projection);
+	};
+	update_camera(WIDTH, HEIGHT);
+
+	FrameLimiter limiter {options.max_fps};
+
+	std::vector<f64> cpu_times;
+	std::vector<f64> gpu_times;
+	std::vector<f64> cull_times;
+	std::vector<f64> input_latencies;
+	cpu_times.reserve(options.frames);
+	gpu_times.reserve(options.frames);
+	cull_times.reserve(options.frames);
+	auto last_frame = std::chrono::steady_clock::now();
 
 	bool running = true;
-	while (running) {
-		SDL_Event event;
-		while (SDL_PollEvent(&event)) {
-			if (event.type == SDL_QUIT) {
-				running = false;
+	auto on_window_event = [&](const SDL_Event& event) {
+		if (event.type == SDL_QUIT) {
+			running = false;
+		}
+		else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+			renderer->resize();
+			// a minimized window reports a zero size
+			if (event.window.data1 > 0 && event.window.data2 > 0) {
+				update_camera(as<u32>(event.window.data1), as<u32>(event.window.data2));
+			}
+		}
+	};
+	for (u32 frame = 0; running && (!options.frames || frame < options.frames); ++frame) {
+		PROFILE_ZONE("frame");
+		limiter.wait();
+
+		// pumped after every wait of the frame, input arriving during one reaches the simulation before the next
+		if (window) {
+			input.pump(on_window_event);
+		}
+
+		// the state between the latest two ticks, however long the last frame took
+		simulation.interpolate(transforms);
+		transforms_to_matrices(transforms.data(), models.data(), transforms.size());
+		for (u32 i = 0; i < draws.size(); ++i) {
+			draws[i].model = models[i];
+			if (gpu_culling) {
+				renderer->update_object(objects[i], models[i]);
+			}
+			else {
+				bvh.set_bounds(proxies[i], transform_aabb(mesh.bounds, models[i]));
+			}
+		}
+
+		if (!gpu_culling) {
+			auto cull_start = std::chrono::steady_clock::now();
+			bvh.update();
+			visible.clear();
+			bvh.cull_parallel(jobs, frustum, visible);
+			visible_draws.clear();
+			for (auto index : visible) {
+				visible_draws.push_back(draws[index]);
+			}
+			if (frame >= WARMUP_FRAMES) {
+				cull_times.push_back(std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - cull_start).count());
 			}
 		}
 
-		renderer.begin(true);
-		renderer.finish();
+		renderer->begin(true);
+		// the first frame showing a tick that reacted to input
+		if (auto input_time = simulation.take_input_time()) {
+			renderer->mark_input(*input_time);
+		}
+		// gpu culled objects are drawn at finish without being submitted
+		if (!gpu_culling && options.parallel_recording) {
+			renderer->render_parallel(jobs, visible_draws);
+		}
+		else if (!gpu_culling) {
+			renderer->submit(visible_draws);
+		}
+		renderer->finish();
+		if (window) {
+			input.pump(on_window_event);
+		}
+
+		// the cpu time covers the whole frame including waiting on the gpu, the gpu time lags a few frames behind
+		auto now = std::chrono::steady_clock::now();
+		if (frame == 0) {
+			logger.info("startup", "first frame submitted after {}ms", std::chrono::duration<f64, std::milli>(now - start).count());
+		}
+		if (frame >= WARMUP_FRAMES) {
+			cpu_times.push_back(std::chrono::duration<f64, std::milli>(now - last_frame).count());
+			if (auto gpu_time = renderer->gpu_frame_time(); gpu_time > 0) {
+				gpu_times.push_back(gpu_time);
+			}
+		}
+		if (auto latency = renderer->take_input_latency(); latency > 0) {
+			input_latencies.push_back(latency);
+		}
+		last_frame = now;
+	}
+
+	simulation.stop();
+	logger.info("simulation", "{} ticks at {} per second, {} dropped",
+		simulation.latest_tick(), options.tick_rate, simulation.dropped_ticks());
+	if (input.dropped_events()) {
+		logger.warn("input", "{} events dropped", input.dropped_events());
+	}
+	// only interactive runs produce input
+	if (!input_latencies.empty()) {
+		log_percentiles(logger, "input latency", input_latencies);
+	}
+
+	for (auto object : objects) {
+		renderer->remove_object(object);
+	}
+	renderer->destroy_texture(mesh.texture);
+	renderer->destroy(mesh);
+
+	if (options.frames) {
+		if (gpu_culling) {
+			logger.info("bench", "{} frames, {} draws culled on the gpu", cpu_times.size(), draws.size());
+		}
+		else {
+			logger.info("bench", "{} frames, {} of {} draws visible", cpu_times.size(), visible_draws.size(), draws.size());
+		}
+		log_percentiles(logger, "cpu", cpu_times);
+		log_percentiles(logger, "gpu", gpu_times);
+		log_percentiles(logger, "cull", cull_times);
+	}
+
+	if (!options.trace.empty()) {
+		if (!PROFILER_ENABLED) {
+			logger.log("profiler", "built without GAME_PROFILER, the trace will be empty", LogLevel::Warn);
+		}
+		if (!profile_write_trace(options.trace)) {
+			logger.error("profiler", "failed to write trace to {}", options.trace);
+		}
 	}
 }
\ No newline at end of file
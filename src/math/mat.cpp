@@ -0,0 +1,369 @@
+#include "mat.hpp"
+#include "simd.hpp"
+
+#ifdef GAME_SIMD_SSE
+// shuffle lanes x, y from a and z, w from b
+#define SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define SWIZZLE(v, x, y, z, w) SHUFFLE(v, v, x, y, z, w)
+
+static inline __m128 load_col(const Mat4& m, usize col) {
+	return _mm_load_ps(m.m + col * 4);
+}
+
+static inline __m128 linear_combine(const Mat4& m, __m128 x, __m128 y, __m128 z, __m128 w) {
+	auto r = _mm_mul_ps(load_col(m, 0), x);
+	r = _mm_add_ps(r, _mm_mul_ps(load_col(m, 1), y));
+	r = _mm_add_ps(r, _mm_mul_ps(load_col(m, 2), z));
+	return _mm_add_ps(r, _mm_mul_ps(load_col(m, 3), w));
+}
+
+// 2x2 matrices packed as (a0 a1 a2 a3) = | a0 a1 |
+//                                        | a2 a3 |
+static inline __m128 mat2_mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(a) * b
+static inline __m128 mat2_adj_mul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(SWIZZLE(a, 1, 1, 2, 2), SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// a * adj(b)
+static inline __m128 mat2_mul_adj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+static inline void load_vec3x4(const Vec3<f32>* v, __m128& x, __m128& y, __m128& z) {
+	// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+	auto ptr = &v->x;
+	auto a = _mm_loadu_ps(ptr);
+	auto b = _mm_loadu_ps(ptr + 4);
+	auto c = _mm_loadu_ps(ptr + 8);
+
+	x = SHUFFLE(SHUFFLE(a, b, 0, 3, 0, 2), SHUFFLE(b, c, 2, 3, 0, 1), 0, 1, 0, 3);
+	y = SHUFFLE(SHUFFLE(a, b, 1, 1, 0, 0), SHUFFLE(b, c, 3, 3, 2, 2), 0, 2, 0, 2);
+	z = SHUFFLE(SHUFFLE(a, b, 2, 2, 1, 1), SHUFFLE(c, c, 0, 0, 3, 3), 0, 2, 0, 2);
+}
+
+static inline void load_quatx4(const Quat* q, __m128& x, __m128& y, __m128& z, __m128& w) {
+	x = _mm_loadu_ps(&q[0].x);
+	y = _mm_loadu_ps(&q[1].x);
+	z = _mm_loadu_ps(&q[2].x);
+	w = _mm_loadu_ps(&q[3].x);
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+/// Stores four matrices given as one lane per matrix for every element of the upper 3x4 part.
+static inline void store_affine4(Mat4* out, const __m128 (&e)[12]) {
+	const auto zero = _mm_setzero_ps();
+	const auto one = _mm_set1_ps(1);
+
+	for (usize col = 0; col < 4; ++col) {
+		auto r0 = e[col * 3];
+		auto r1 = e[col * 3 + 1];
+		auto r2 = e[col * 3 + 2];
+		auto r3 = col == 3 ? one : zero;
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_store_ps(out[0].m + col * 4, r0);
+		_mm_store_ps(out[1].m + col * 4, r1);
+		_mm_store_ps(out[2].m + col * 4, r2);
+		_mm_store_ps(out[3].m + col * 4, r3);
+	}
+}
+#endif
+
+Mat4 Mat4::trs(const Vec3<f32>& position, const Quat& rotation, const Vec3<f32>& scale) {
+	auto [x, y, z, w] = rotation;
+	f32 xx = x * x, yy = y * y, zz = z * z;
+	f32 xy = x * y, xz = x * z, yz = y * z;
+	f32 wx = w * x, wy = w * y, wz = w * z;
+
+	return {{
+		(1 - 2 * (yy + zz)) * scale.x, 2 * (xy + wz) * scale.x, 2 * (xz - wy) * scale.x, 0,
+		2 * (xy - wz) * scale.y, (1 - 2 * (xx + zz)) * scale.y, 2 * (yz + wx) * scale.y, 0,
+		2 * (xz + wy) * scale.z, 2 * (yz - wx) * scale.z, (1 - 2 * (xx + yy)) * scale.z, 0,
+		position.x, position.y, position.z, 1
+	}};
+}
+
+Mat4 Mat4::perspective(f32 fov_y, f32 aspect, f32 z_near, f32 z_far) {
+	auto f = 1.0f / std::tan(fov_y / 2);
+	return {{
+		f / aspect, 0, 0, 0,
+		0, -f, 0, 0,
+		0, 0, z_far / (z_near - z_far), -1,
+		0, 0, z_near * z_far / (z_near - z_far), 0
+	}};
+}
+
+Mat4 Mat4::look_at(const Vec3<f32>& eye, const Vec3<f32>& target, const Vec3<f32>& up) {
+	auto f = (target - eye).normalized();
+	auto s = f.cross(up).normalized();
+	auto u = s.cross(f);
+	return {{
+		s.x, u.x, -f.x, 0,
+		s.y, u.y, -f.y, 0,
+		s.z, u.z, -f.z, 0,
+		-s.dot(eye), -u.dot(eye), f.dot(eye), 1
+	}};
+}
+
+Mat4 Mat4::operator*(const Mat4& rhs) const {
+#ifdef GAME_SIMD_SSE
+	Mat4 r;
+	for (usize col = 0; col < 4; ++col) {
+		auto b = load_col(rhs, col);
+		auto c = linear_combine(*this, SWIZZLE(b, 0, 0, 0, 0), SWIZZLE(b, 1, 1, 1, 1), SWIZZLE(b, 2, 2, 2, 2), SWIZZLE(b, 3, 3, 3, 3));
+		_mm_store_ps(r.m + col * 4, c);
+	}
+	return r;
+#else
+	return mat4_mul_scalar(*this, rhs);
+#endif
+}
+
+Vec4<f32> Mat4::operator*(const Vec4<f32>& rhs) const {
+#ifdef GAME_SIMD_SSE
+	alignas(16) f32 r[4];
+	_mm_store_ps(r, linear_combine(*this, _mm_set1_ps(rhs.x), _mm_set1_ps(rhs.y), _mm_set1_ps(rhs.z), _mm_set1_ps(rhs.w)));
+	return {r[0], r[1], r[2], r[3]};
+#else
+	return {
+		m[0] * rhs.x + m[4] * rhs.y + m[8] * rhs.z + m[12] * rhs.w,
+		m[1] * rhs.x + m[5] * rhs.y + m[9] * rhs.z + m[13] * rhs.w,
+		m[2] * rhs.x + m[6] * rhs.y + m[10] * rhs.z + m[14] * rhs.w,
+		m[3] * rhs.x + m[7] * rhs.y + m[11] * rhs.z + m[15] * rhs.w
+	};
+#endif
+}
+
+Vec3<f32> Mat4::transform_point(const Vec3<f32>& p) const {
+	Vec3<f32> r;
+	transform_points(*this, &p, &r, 1);
+	return r;
+}
+
+Mat4 Mat4::inverse() const {
+#ifdef GAME_SIMD_SSE
+	// block inversion with 2x2 sub matrices, the transpose of an inverse is the inverse of the transpose
+	// so this works on the columns just as well as it would on rows
+	auto c0 = load_col(*this, 0);
+	auto c1 = load_col(*this, 1);
+	auto c2 = load_col(*this, 2);
+	auto c3 = load_col(*this, 3);
+
+	auto a = _mm_movelh_ps(c0, c1);
+	auto b = _mm_movehl_ps(c1, c0);
+	auto c = _mm_movelh_ps(c2, c3);
+	auto d = _mm_movehl_ps(c3, c2);
+
+	// determinants of a, b, c and d
+	auto det_sub = _mm_sub_ps(
+		_mm_mul_ps(SHUFFLE(c0, c2, 0, 2, 0, 2), SHUFFLE(c1, c3, 1, 3, 1, 3)),
+		_mm_mul_ps(SHUFFLE(c0, c2, 1, 3, 1, 3), SHUFFLE(c1, c3, 0, 2, 0, 2)));
+	auto det_a = SWIZZLE(det_sub, 0, 0, 0, 0);
+	auto det_b = SWIZZLE(det_sub, 1, 1, 1, 1);
+	auto det_c = SWIZZLE(det_sub, 2, 2, 2, 2);
+	auto det_d = SWIZZLE(det_sub, 3, 3, 3, 3);
+
+	auto d_c = mat2_adj_mul(d, c);
+	auto a_b = mat2_adj_mul(a, b);
+	auto x = _mm_sub_ps(_mm_mul_ps(det_d, a), mat2_mul(b, d_c));
+	auto w = _mm_sub_ps(_mm_mul_ps(det_a, d), mat2_mul(c, a_b));
+	auto y = _mm_sub_ps(_mm_mul_ps(det_b, c), mat2_mul_adj(d, a_b));
+	auto z = _mm_sub_ps(_mm_mul_ps(det_c, b), mat2_mul_adj(a, d_c));
+
+	// det = |a||d| + |b||c| - tr((a#b)(d#c))
+	auto tr = _mm_mul_ps(a_b, SWIZZLE(d_c, 0, 2, 1, 3));
+	tr = _mm_add_ps(tr, _mm_movehl_ps(tr, tr));
+	tr = _mm_add_ps(tr, SWIZZLE(tr, 1, 0, 0, 0));
+	tr = SWIZZLE(tr, 0, 0, 0, 0);
+	auto det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+
+	auto inv_det = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), det);
+	x = _mm_mul_ps(x, inv_det);
+	y = _mm_mul_ps(y, inv_det);
+	z = _mm_mul_ps(z, inv_det);
+	w = _mm_mul_ps(w, inv_det);
+
+	Mat4 r;
+	_mm_store_ps(r.m, SHUFFLE(x, y, 3, 1, 3, 1));
+	_mm_store_ps(r.m + 4, SHUFFLE(x, y, 2, 0, 2, 0));
+	_mm_store_ps(r.m + 8, SHUFFLE(z, w, 3, 1, 3, 1));
+	_mm_store_ps(r.m + 12, SHUFFLE(z, w, 2, 0, 2, 0));
+	return r;
+#else
+	return mat4_inverse_scalar(*this);
+#endif
+}
+
+Mat4 Mat4::transposed() const {
+	Mat4 r;
+	for (usize col = 0; col < 4; ++col) {
+		for (usize row = 0; row < 4; ++row) {
+			r.m[row * 4 + col] = m[col * 4 + row];
+		}
+	}
+	return r;
+}
+
+Mat4 mat4_mul_scalar(const Mat4& a, const Mat4& b) {
+	Mat4 r;
+	for (usize col = 0; col < 4; ++col) {
+		for (usize row = 0; row < 4; ++row) {
+			f32 sum = 0;
+			for (usize k = 0; k < 4; ++k) {
+				sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+			}
+			r.m[col * 4 + row] = sum;
+		}
+	}
+	return r;
+}
+
+Mat4 mat4_inverse_scalar(const Mat4& mat) {
+	const auto& m = mat.m;
+	Mat4 r;
+	auto& inv = r.m;
+
+	inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+	inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+	inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+	inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+	inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+	inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+	inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+	inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+	inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+	inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+	inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+	inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+	f32 inv_det = 1.0f / (m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12]);
+	for (auto& e : inv) {
+		e *= inv_det;
+	}
+	return r;
+}
+
+void transform_points(const Mat4& m, const Vec3<f32>* points, Vec3<f32>* out, usize count) {
+#ifdef GAME_SIMD_SSE
+	for (usize i = 0; i < count; ++i) {
+		auto p = points[i];
+		auto r = linear_combine(m, _mm_set1_ps(p.x), _mm_set1_ps(p.y), _mm_set1_ps(p.z), _mm_set1_ps(1));
+		_mm_storel_pi(as<__m64*>(as<void*>(&out[i].x)), r);
+		_mm_store_ss(&out[i].z, _mm_movehl_ps(r, r));
+	}
+#else
+	transform_points_scalar(m, points, out, count);
+#endif
+}
+
+void transform_points_scalar(const Mat4& m, const Vec3<f32>* points, Vec3<f32>* out, usize count) {
+	for (usize i = 0; i < count; ++i) {
+		auto p = points[i];
+		out[i] = {
+			m.m[0] * p.x + m.m[4] * p.y + m.m[8] * p.z + m.m[12],
+			m.m[1] * p.x + m.m[5] * p.y + m.m[9] * p.z + m.m[13],
+			m.m[2] * p.x + m.m[6] * p.y + m.m[10] * p.z + m.m[14]
+		};
+	}
+}
+
+void compose_trs(const Vec3<f32>* positions, const Quat* rotations, const Vec3<f32>* scales, Mat4* out, usize count) {
+	usize i = 0;
+
+#if defined(GAME_SIMD_AVX)
+	for (; i + 8 <= count; i += 8) {
+		__m128 lo[10], hi[10];
+		load_vec3x4(positions + i, lo[0], lo[1], lo[2]);
+		load_vec3x4(positions + i + 4, hi[0], hi[1], hi[2]);
+		load_quatx4(rotations + i, lo[3], lo[4], lo[5], lo[6]);
+		load_quatx4(rotations + i + 4, hi[3], hi[4], hi[5], hi[6]);
+		load_vec3x4(scales + i, lo[7], lo[8], lo[9]);
+		load_vec3x4(scales + i + 4, hi[7], hi[8], hi[9]);
+
+		__m256 v[10];
+		for (usize j = 0; j < 10; ++j) {
+			v[j] = _mm256_set_m128(hi[j], lo[j]);
+		}
+		auto [px, py, pz, x, y, z, w, sx, sy, sz] = v;
+
+		const auto one = _mm256_set1_ps(1);
+		const auto two = _mm256_set1_ps(2);
+		auto xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		auto xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		auto wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		auto diag = [&](__m256 a, __m256 b, __m256 s) {
+			return _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(a, b))), s);
+		};
+		auto sum = [&](__m256 a, __m256 b, __m256 s) {
+			return _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(a, b)), s);
+		};
+		auto diff = [&](__m256 a, __m256 b, __m256 s) {
+			return _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(a, b)), s);
+		};
+
+		__m256 e[12] {
+			diag(yy, zz, sx), sum(xy, wz, sx), diff(xz, wy, sx),
+			diff(xy, wz, sy), diag(xx, zz, sy), sum(yz, wx, sy),
+			sum(xz, wy, sz), diff(yz, wx, sz), diag(xx, yy, sz),
+			px, py, pz
+		};
+
+		__m128 e_lo[12], e_hi[12];
+		for (usize j = 0; j < 12; ++j) {
+			e_lo[j] = _mm256_castps256_ps128(e[j]);
+			e_hi[j] = _mm256_extractf128_ps(e[j], 1);
+		}
+		store_affine4(out + i, e_lo);
+		store_affine4(out + i + 4, e_hi);
+	}
+#endif
+
+#if defined(GAME_SIMD_SSE)
+	for (; i + 4 <= count; i += 4) {
+		__m128 px, py, pz, x, y, z, w, sx, sy, sz;
+		load_vec3x4(positions + i, px, py, pz);
+		load_quatx4(rotations + i, x, y, z, w);
+		load_vec3x4(scales + i, sx, sy, sz);
+
+		const auto one = _mm_set1_ps(1);
+		const auto two = _mm_set1_ps(2);
+		auto xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		auto xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		auto wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		auto diag = [&](__m128 a, __m128 b, __m128 s) {
+			return _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(a, b))), s);
+		};
+		auto sum = [&](__m128 a, __m128 b, __m128 s) {
+			return _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(a, b)), s);
+		};
+		auto diff = [&](__m128 a, __m128 b, __m128 s) {
+			return _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(a, b)), s);
+		};
+
+		const __m128 e[12] {
+			diag(yy, zz, sx), sum(xy, wz, sx), diff(xz, wy, sx),
+			diff(xy, wz, sy), diag(xx, zz, sy), sum(yz, wx, sy),
+			sum(xz, wy, sz), diff(yz, wx, sz), diag(xx, yy, sz),
+			px, py, pz
+		};
+		store_affine4(out + i, e);
+	}
+#endif
+
+	compose_trs_scalar(positions + i, rotations + i, scales + i, out + i, count - i);
+}
+
+void compose_trs_scalar(const Vec3<f32>* positions, const Quat* rotations, const Vec3<f32>* scales, Mat4* out, usize count) {
+	for (usize i = 0; i < count; ++i) {
+		out[i] = Mat4::trs(positions[i], rotations[i], scales[i]);
+	}
+}
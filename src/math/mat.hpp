@@ -0,0 +1,67 @@
+#pragma once
+#include "types.hpp"
+#include "vec.hpp"
+#include "quat.hpp"
+
+/// Column major 4x4 matrix, m[col * 4 + row], matching the glsl memory layout.
+struct alignas(16) Mat4 {
+	f32 m[16];
+
+	[[nodiscard]] static constexpr Mat4 identity() {
+		return {{
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1
+		}};
+	}
+
+	[[nodiscard]] static constexpr Mat4 translation(const Vec3<f32>& t) {
+		return {{
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			t.x, t.y, t.z, 1
+		}};
+	}
+
+	[[nodiscard]] static constexpr Mat4 scaling(const Vec3<f32>& s) {
+		return {{
+			s.x, 0, 0, 0,
+			0, s.y, 0, 0,
+			0, 0, s.z, 0,
+			0, 0, 0, 1
+		}};
+	}
+
+	/// Right handed perspective projection for vulkan clip space (y down, depth 0 to 1), fov_y is in radians.
+	[[nodiscard]] static Mat4 perspective(f32 fov_y, f32 aspect, f32 z_near, f32 z_far);
+	/// Right handed view matrix looking from eye towards target.
+	[[nodiscard]] static Mat4 look_at(const Vec3<f32>& eye, const Vec3<f32>& target, const Vec3<f32>& up);
+
+	/// translation * rotation * scale
+	[[nodiscard]] static Mat4 trs(const Vec3<f32>& position, const Quat& rotation, const Vec3<f32>& scale);
+
+	[[nodiscard]] constexpr f32 operator()(usize row, usize col) const {
+		return m[col * 4 + row];
+	}
+
+	Mat4 operator*(const Mat4& rhs) const;
+	Vec4<f32> operator*(const Vec4<f32>& rhs) const;
+	[[nodiscard]] Vec3<f32> transform_point(const Vec3<f32>& p) const;
+	[[nodiscard]] Mat4 inverse() const;
+	[[nodiscard]] Mat4 transposed() const;
+};
+
+// Kernels select the widest instruction set enabled at compile time,
+// the _scalar variants are the reference fallback and are always available.
+
+Mat4 mat4_mul_scalar(const Mat4& a, const Mat4& b);
+Mat4 mat4_inverse_scalar(const Mat4& m);
+
+void transform_points(const Mat4& m, const Vec3<f32>* points, Vec3<f32>* out, usize count);
+void transform_points_scalar(const Mat4& m, const Vec3<f32>* points, Vec3<f32>* out, usize count);
+
+/// Composes out[i] = trs(positions[i], rotations[i], scales[i]), rotations have to be normalized.
+void compose_trs(const Vec3<f32>* positions, const Quat* rotations, const Vec3<f32>* scales, Mat4* out, usize count);
+void compose_trs_scalar(const Vec3<f32>* positions, const Quat* rotations, const Vec3<f32>* scales, Mat4* out, usize count);
\ No newline at end of file
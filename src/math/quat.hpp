@@ -0,0 +1,71 @@
+#pragma once
+#include "types.hpp"
+#include "vec.hpp"
+
+struct Quat {
+	f32 x, y, z, w;
+
+	[[nodiscard]] static constexpr Quat identity() {
+		return {0, 0, 0, 1};
+	}
+
+	/// angles are in radians, applied around x first, then y, then z
+	[[nodiscard]] static Quat from_euler(const Vec3<f32>& euler) {
+		f32 cx = std::cos(euler.x * 0.5f), sx = std::sin(euler.x * 0.5f);
+		f32 cy = std::cos(euler.y * 0.5f), sy = std::sin(euler.y * 0.5f);
+		f32 cz = std::cos(euler.z * 0.5f), sz = std::sin(euler.z * 0.5f);
+		return {
+			sx * cy * cz - cx * sy * sz,
+			cx * sy * cz + sx * cy * sz,
+			cx * cy * sz - sx * sy * cz,
+			cx * cy * cz + sx * sy * sz
+		};
+	}
+
+	[[nodiscard]] static Quat from_axis_angle(const Vec3<f32>& axis, f32 angle) {
+		auto s = std::sin(angle * 0.5f);
+		auto n = axis.normalized();
+		return {n.x * s, n.y * s, n.z * s, std::cos(angle * 0.5f)};
+	}
+
+	[[nodiscard]] constexpr f32 dot(const Quat& rhs) const {
+		return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+	}
+
+	[[nodiscard]] constexpr Quat conjugate() const {
+		return {-x, -y, -z, w};
+	}
+
+	[[nodiscard]] Quat normalized() const {
+		auto inv = 1.0f / std::sqrt(dot(*this));
+		return {x * inv, y * inv, z * inv, w * inv};
+	}
+
+	constexpr Quat operator*(const Quat& rhs) const {
+		return {
+			w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y,
+			w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x,
+			w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w,
+			w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z
+		};
+	}
+
+	[[nodiscard]] constexpr Vec3<f32> rotate(const Vec3<f32>& v) const {
+		// v + 2w(q x v) + 2q x (q x v)
+		Vec3<f32> q {x, y, z};
+		auto t = q.cross(v) * 2.0f;
+		return v + t * w + q.cross(t);
+	}
+
+	/// normalized linear interpolation along the shortest path
+	[[nodiscard]] static Quat nlerp(const Quat& a, const Quat& b, f32 t) {
+		f32 sign = a.dot(b) < 0 ? -1.0f : 1.0f;
+		Quat r {
+			a.x + (b.x * sign - a.x) * t,
+			a.y + (b.y * sign - a.y) * t,
+			a.z + (b.z * sign - a.z) * t,
+			a.w + (b.w * sign - a.w) * t
+		};
+		return r.normalized();
+	}
+};
\ No newline at end of file
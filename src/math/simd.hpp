@@ -0,0 +1,10 @@
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GAME_SIMD_SSE 1
+#include <immintrin.h>
+#endif
+
+#if defined(GAME_SIMD_SSE) && defined(__AVX__)
+#define GAME_SIMD_AVX 1
+#endif
\ No newline at end of file
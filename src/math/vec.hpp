@@ -5,6 +5,14 @@ template<typename T>
 struct Vec3 {
 	T x, y, z;
 
+	[[nodiscard]] constexpr auto dot(const Vec3& rhs) const {
+		return x * rhs.x + y * rhs.y + z * rhs.z;
+	}
+
+	[[nodiscard]] constexpr Vec3 cross(const Vec3& rhs) const {
+		return {y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x};
+	}
+
 	[[nodiscard]] constexpr auto sqr_magnitude() const {
 		return x * x + y * y + z * z;
 	}
@@ -48,4 +56,45 @@ struct Vec3 {
 	constexpr Vec3 operator/(T rhs) const {
 		return {x / rhs, y / rhs, z / rhs};
 	}
+};
+
+template<typename T>
+struct Vec4 {
+	T x, y, z, w;
+
+	[[nodiscard]] constexpr auto dot(const Vec4& rhs) const {
+		return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+	}
+
+	[[nodiscard]] constexpr auto sqr_magnitude() const {
+		return dot(*this);
+	}
+
+	[[nodiscard]] constexpr auto magnitude() const {
+		return std::sqrt(sqr_magnitude());
+	}
+
+	[[nodiscard]] constexpr Vec3<T> xyz() const {
+		return {x, y, z};
+	}
+
+	constexpr Vec4 operator-(const Vec4& rhs) const {
+		return {x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w};
+	}
+
+	constexpr Vec4 operator+(const Vec4& rhs) const {
+		return {x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w};
+	}
+
+	constexpr Vec4 operator*(const Vec4& rhs) const {
+		return {x * rhs.x, y * rhs.y, z * rhs.z, w * rhs.w};
+	}
+
+	constexpr Vec4 operator*(T rhs) const {
+		return {x * rhs, y * rhs, z * rhs, w * rhs};
+	}
+
+	constexpr Vec4 operator/(T rhs) const {
+		return {x / rhs, y / rhs, z / rhs, w / rhs};
+	}
 };
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include "tlsf.hpp"
+#include <algorithm>
+#include <bit>
+
+Tlsf::Tlsf(u64 size) : size {size} {
+	for (auto& fl : heads) {
+		for (auto& head : fl) {
+			head = NONE;
+		}
+	}
+
+	blocks.push_back({
+		.offset = 0,
+		.size = size,
+		.prev_phys = NONE,
+		.next_phys = NONE,
+		.prev_free = NONE,
+		.next_free = NONE,
+		.free = true
+	});
+	insert_free(0);
+}
+
+std::optional<Tlsf::Allocation> Tlsf::alloc(u64 alloc_size, u64 alignment) {
+	alloc_size = (std::max(alloc_size, ALIGN) + ALIGN - 1) & ~(ALIGN - 1);
+	alignment = std::max(alignment, ALIGN);
+
+	// over allocating by the alignment guarantees an aligned offset inside any block that is found
+	u64 search_size = alloc_size + (alignment > ALIGN ? alignment - ALIGN : 0);
+	auto node = find_free(search_size);
+	if (node == NONE) {
+		return std::nullopt;
+	}
+	remove_free(node);
+
+	auto block_offset = blocks[node].offset;
+	auto aligned_offset = (block_offset + alignment - 1) & ~(alignment - 1);
+	if (aligned_offset != block_offset) {
+		// the padding stays behind as its own free block
+		split(node, aligned_offset - block_offset);
+		auto padding = node;
+		node = blocks[node].next_phys;
+		insert_free(padding);
+	}
+
+	if (blocks[node].size - alloc_size >= ALIGN) {
+		split(node, alloc_size);
+		insert_free(blocks[node].next_phys);
+	}
+
+	blocks[node].free = false;
+	used_size += blocks[node].size;
+	++allocations;
+
+	return Allocation {
+		.offset = blocks[node].offset,
+		.size = blocks[node].size,
+		.node = node
+	};
+}
+
+void Tlsf::free(u32 node) {
+	auto& block = blocks[node];
+	block.free = true;
+	used_size -= block.size;
+	--allocations;
+
+	auto next = block.next_phys;
+	if (next != NONE && blocks[next].free) {
+		remove_free(next);
+		merge_next(node);
+	}
+
+	auto prev = blocks[node].prev_phys;
+	if (prev != NONE && blocks[prev].free) {
+		remove_free(prev);
+		merge_next(prev);
+		node = prev;
+	}
+
+	insert_free(node);
+}
+
+u64 Tlsf::largest_free_block() const {
+	if (!fl_bitmap) {
+		return 0;
+	}
+	u32 fl = 63 - std::countl_zero(fl_bitmap);
+	u32 sl = 31 - std::countl_zero(sl_bitmap[fl]);
+
+	u64 largest = 0;
+	for (auto node = heads[fl][sl]; node != NONE; node = blocks[node].next_free) {
+		largest = std::max(largest, blocks[node].size);
+	}
+	return largest;
+}
+
+void Tlsf::mapping(u64 size, u32& fl, u32& sl) {
+	if (size < SMALL_SIZE) {
+		fl = 0;
+		sl = as<u32>(size / (SMALL_SIZE / SL_COUNT));
+	}
+	else {
+		u32 log2 = 63 - std::countl_zero(size);
+		sl = as<u32>(size >> (log2 - SL_LOG2)) ^ SL_COUNT;
+		fl = std::min(log2 - FL_SHIFT + 1, FL_COUNT - 1);
+	}
+}
+
+u32 Tlsf::find_free(u64 size) {
+	// round up to the next list so that any block in it is big enough
+	auto search_size = size;
+	if (search_size >= SMALL_SIZE) {
+		u32 log2 = 63 - std::countl_zero(search_size);
+		search_size += (u64 {1} << (log2 - SL_LOG2)) - 1;
+	}
+
+	u32 fl, sl;
+	mapping(search_size, fl, sl);
+
+	u32 sl_map = sl < SL_COUNT ? sl_bitmap[fl] & (~0U << sl) : 0;
+	if (!sl_map) {
+		u64 fl_map = fl + 1 < 64 ? fl_bitmap & (~u64 {0} << (fl + 1)) : 0;
+		if (!fl_map) {
+			return NONE;
+		}
+		fl = std::countr_zero(fl_map);
+		sl_map = sl_bitmap[fl];
+	}
+	sl = std::countr_zero(sl_map);
+
+	auto node = heads[fl][sl];
+	// the last list can contain blocks smaller than the request, compared against the request itself since
+	// the blocks of any other list are all big enough but can be smaller than the rounded up size
+	while (node != NONE && blocks[node].size < size) {
+		node = blocks[node].next_free;
+	}
+	return node;
+}
+
+void Tlsf::insert_free(u32 node) {
+	u32 fl, sl;
+	mapping(blocks[node].size, fl, sl);
+
+	auto& block = blocks[node];
+	block.free = true;
+	block.prev_free = NONE;
+	block.next_free = heads[fl][sl];
+	if (block.next_free != NONE) {
+		blocks[block.next_free].prev_free = node;
+	}
+	heads[fl][sl] = node;
+
+	fl_bitmap |= u64 {1} << fl;
+	sl_bitmap[fl] |= 1U << sl;
+}
+
+void Tlsf::remove_free(u32 node) {
+	u32 fl, sl;
+	mapping(blocks[node].size, fl, sl);
+
+	auto& block = blocks[node];
+	if (block.prev_free != NONE) {
+		blocks[block.prev_free].next_free = block.next_free;
+	}
+	else {
+		heads[fl][sl] = block.next_free;
+	}
+	if (block.next_free != NONE) {
+		blocks[block.next_free].prev_free = block.prev_free;
+	}
+	block.prev_free = NONE;
+	block.next_free = NONE;
+	block.free = false;
+
+	if (heads[fl][sl] == NONE) {
+		sl_bitmap[fl] &= ~(1U << sl);
+		if (!sl_bitmap[fl]) {
+			fl_bitmap &= ~(u64 {1} << fl);
+		}
+	}
+}
+
+u32 Tlsf::new_node() {
+	if (!unused_nodes.empty()) {
+		auto node = unused_nodes.back();
+		unused_nodes.pop_back();
+		return node;
+	}
+	blocks.emplace_back();
+	return as<u32>(blocks.size() - 1);
+}
+
+void Tlsf::split(u32 node, u64 first_size) {
+	auto rest = new_node();
+	auto& block = blocks[node];
+
+	blocks[rest] = {
+		.offset = block.offset + first_size,
+		.size = block.size - first_size,
+		.prev_phys = node,
+		.next_phys = block.next_phys,
+		.prev_free = NONE,
+		.next_free = NONE,
+		.free = false
+	};
+	if (block.next_phys != NONE) {
+		blocks[block.next_phys].prev_phys = rest;
+	}
+	block.size = first_size;
+	block.next_phys = rest;
+}
+
+void Tlsf::merge_next(u32 node) {
+	auto next = blocks[node].next_phys;
+	auto& block = blocks[node];
+
+	block.size += blocks[next].size;
+	block.next_phys = blocks[next].next_phys;
+	if (block.next_phys != NONE) {
+		blocks[block.next_phys].prev_phys = node;
+	}
+	unused_nodes.push_back(next);
+}
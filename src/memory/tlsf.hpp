@@ -0,0 +1,88 @@
+#pragma once
+#include "types.hpp"
+#include <optional>
+#include <vector>
+
+/// Two level segregated fit allocator over an abstract range of offsets.
+/// It never touches the memory it manages, which makes it usable for gpu heaps and buffers.
+class Tlsf {
+public:
+	struct Allocation {
+		u64 offset;
+		u64 size;
+		u32 node;
+	};
+
+	Tlsf() = default;
+	explicit Tlsf(u64 size);
+
+	std::optional<Allocation> alloc(u64 size, u64 alignment = ALIGN);
+	void free(u32 node);
+
+	[[nodiscard]] u64 capacity() const {
+		return size;
+	}
+	[[nodiscard]] u64 used() const {
+		return used_size;
+	}
+	[[nodiscard]] u32 allocation_count() const {
+		return allocations;
+	}
+	[[nodiscard]] u64 largest_free_block() const;
+
+	/// Calls fn for every live allocation in offset order.
+	template<typename F>
+	void for_each_allocation(F&& fn) const {
+		if (blocks.empty()) {
+			return;
+		}
+		// the block at offset 0 always keeps the first node
+		for (u32 node = 0; node != NONE; node = blocks[node].next_phys) {
+			if (!blocks[node].free) {
+				fn(Allocation {
+					.offset = blocks[node].offset,
+					.size = blocks[node].size,
+					.node = node
+				});
+			}
+		}
+	}
+
+	constexpr static u64 ALIGN = 16;
+private:
+	constexpr static u32 SL_LOG2 = 5;
+	constexpr static u32 SL_COUNT = 1 << SL_LOG2;
+	constexpr static u32 ALIGN_LOG2 = 4;
+	constexpr static u32 FL_SHIFT = SL_LOG2 + ALIGN_LOG2;
+	constexpr static u64 SMALL_SIZE = u64 {1} << FL_SHIFT;
+	constexpr static u32 FL_MAX = 48;
+	constexpr static u32 FL_COUNT = FL_MAX - FL_SHIFT + 1;
+	constexpr static u32 NONE = UINT32_MAX;
+
+	struct Block {
+		u64 offset;
+		u64 size;
+		u32 prev_phys;
+		u32 next_phys;
+		u32 prev_free;
+		u32 next_free;
+		bool free;
+	};
+
+	static void mapping(u64 size, u32& fl, u32& sl);
+	u32 find_free(u64 size);
+	void insert_free(u32 node);
+	void remove_free(u32 node);
+	u32 new_node();
+	void split(u32 node, u64 size);
+	void merge_next(u32 node);
+
+	u64 size {};
+	u64 used_size {};
+	u32 allocations {};
+	std::vector<Block> blocks {};
+	std::vector<u32> unused_nodes {};
+	u64 fl_bitmap {};
+	u32 sl_bitmap[FL_COUNT] {};
+	u32 heads[FL_COUNT][SL_COUNT] {};
+};
\ No newline at end of file
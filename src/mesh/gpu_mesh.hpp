@@ -1,5 +1,47 @@
 #pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "platform/vulkan/vulkan_geometry_arena.hpp"
+#include "platform/vulkan/vulkan_bindless.hpp"
+#include "math/mat.hpp"
+#include "mesh/mesh.hpp"
+
+/// Per instance vertex data of instanced draws, read by mesh_instanced.vert.
+struct InstanceData {
+	Mat4 model;
+	Vec4<f32> dequantize_offset;
+	Vec4<f32> dequantize_scale;
+	/// texture from load_texture
+	u32 texture;
+};
 
 class GpuMesh {
+public:
+	/// ranges in the renderer's geometry arena, the lods' index offsets are relative to indices.first
+	VulkanGeometryArena::Range vertices {};
+	VulkanGeometryArena::Range indices {};
+	MeshLod lods[MAX_MESH_LODS] {};
+	u32 lod_count {};
+	vk::IndexType index_type {vk::IndexType::eUint32};
+	/// the quantized unorm positions are mapped back into these bounds
+	Aabb bounds {};
+	/// transfer timeline value which is signaled once the mesh data is on the gpu
+	u64 upload_value {};
+	/// base color texture from load_texture, drawn untextured without one
+	u32 texture {VulkanBindless::NONE};
+
+	/// Maps the quantized positions into mesh space.
+	[[nodiscard]] Mat4 dequantize() const {
+		return Mat4::translation(bounds.min) * Mat4::scaling(bounds.max - bounds.min);
+	}
 
+	[[nodiscard]] InstanceData instance(const Mat4& model) const {
+		auto scale = bounds.max - bounds.min;
+		return {
+			.model = model,
+			.dequantize_offset {bounds.min.x, bounds.min.y, bounds.min.z, 0},
+			.dequantize_scale {scale.x, scale.y, scale.z, 0},
+			.texture = texture
+		};
+	}
 };
\ No newline at end of file
@@ -1 +1,217 @@
 #include "mesh.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+/// f32 to f16 with round to nearest, out of range values become infinity
+static u16 to_half(f32 value) {
+	auto bits = std::bit_cast<u32>(value);
+	u32 sign = bits >> 16 & 0x8000;
+	auto exponent = as<i32>(bits >> 23 & 0xFF) - 127 + 15;
+	u32 mantissa = bits & 0x7FFFFF;
+
+	if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+		return as<u16>(sign | 0x7E00);
+	}
+	if (exponent >= 31) {
+		return as<u16>(sign | 0x7C00);
+	}
+	if (exponent <= 0) {
+		if (exponent < -10) {
+			return as<u16>(sign);
+		}
+		// denormal, the implicit leading bit becomes explicit
+		mantissa |= 0x800000;
+		auto shift = as<u32>(14 - exponent);
+		u32 half = mantissa >> shift;
+		half += mantissa >> (shift - 1) & 1;
+		return as<u16>(sign | half);
+	}
+
+	// a carry out of the mantissa correctly bumps the exponent
+	u32 half = sign | as<u32>(exponent) << 10 | mantissa >> 13;
+	half += mantissa >> 12 & 1;
+	return as<u16>(half);
+}
+
+static i16 to_snorm16(f32 value) {
+	return as<i16>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767));
+}
+
+/// Projects the unit normal onto an octahedron which is unfolded into a square, two components
+/// with an error spread evenly over the sphere. mesh.vert decodes it.
+static void encode_octahedral(Vec3<f32> n, i16 out[2]) {
+	auto sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (sum == 0) {
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+	n = n / sum;
+
+	auto x = n.x;
+	auto y = n.y;
+	// the lower half is folded over the diagonals
+	if (n.z < 0) {
+		x = (1 - std::abs(n.y)) * (n.x >= 0 ? 1.0f : -1.0f);
+		y = (1 - std::abs(n.x)) * (n.y >= 0 ? 1.0f : -1.0f);
+	}
+	out[0] = to_snorm16(x);
+	out[1] = to_snorm16(y);
+}
+
+static void build_meshlets(const Mesh& mesh, PackedMesh& packed) {
+	constexpr u8 NONE = 0xFF;
+	std::vector<u8> local(mesh.vertices.size(), NONE);
+
+	Meshlet meshlet {};
+	auto finish = [&]() {
+		if (!meshlet.triangle_count) {
+			return;
+		}
+
+		Aabb aabb {
+			.min {std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max()},
+			.max {std::numeric_limits<f32>::lowest(), std::numeric_limits<f32>::lowest(), std::numeric_limits<f32>::lowest()}
+		};
+		for (u32 i = 0; i < meshlet.vertex_count; ++i) {
+			const auto& p = mesh.vertices[packed.meshlet_vertices[meshlet.vertex_offset + i]].position;
+			aabb.min = {std::min(aabb.min.x, p.x), std::min(aabb.min.y, p.y), std::min(aabb.min.z, p.z)};
+			aabb.max = {std::max(aabb.max.x, p.x), std::max(aabb.max.y, p.y), std::max(aabb.max.z, p.z)};
+		}
+		meshlet.center = (aabb.min + aabb.max) * 0.5f;
+		for (u32 i = 0; i < meshlet.vertex_count; ++i) {
+			auto vertex = packed.meshlet_vertices[meshlet.vertex_offset + i];
+			meshlet.radius = std::max(meshlet.radius, (mesh.vertices[vertex].position - meshlet.center).magnitude());
+			local[vertex] = NONE;
+		}
+
+		packed.meshlets.push_back(meshlet);
+		meshlet = {
+			.vertex_offset = as<u32>(packed.meshlet_vertices.size()),
+			.triangle_offset = as<u32>(packed.meshlet_triangles.size() / 3)
+		};
+	};
+
+	// greedy in index order, the index order is already optimized for locality by the time meshlets are built
+	for (usize i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		const u32 triangle[] {mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]};
+
+		u32 new_vertices = 0;
+		for (auto vertex : triangle) {
+			new_vertices += local[vertex] == NONE;
+		}
+		if (meshlet.vertex_count + new_vertices > Meshlet::MAX_VERTICES || meshlet.triangle_count == Meshlet::MAX_TRIANGLES) {
+			finish();
+		}
+
+		for (auto vertex : triangle) {
+			if (local[vertex] == NONE) {
+				local[vertex] = as<u8>(meshlet.vertex_count++);
+				packed.meshlet_vertices.push_back(vertex);
+			}
+			packed.meshlet_triangles.push_back(local[vertex]);
+		}
+		++meshlet.triangle_count;
+	}
+	finish();
+}
+
+Mesh Mesh::cube() {
+	const Vec3<f32> normals[] {
+		{1, 0, 0}, {-1, 0, 0},
+		{0, 1, 0}, {0, -1, 0},
+		{0, 0, 1}, {0, 0, -1}
+	};
+
+	Mesh mesh {};
+	for (const auto& n : normals) {
+		// two axes spanning the face, ordered so the face winds counter clockwise seen from outside
+		Vec3<f32> s {n.y, n.z, n.x};
+		auto t = n.cross(s);
+
+		auto base = as<u32>(mesh.vertices.size());
+		const f32 corners[4][2] {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+		for (const auto& c : corners) {
+			mesh.vertices.push_back({
+				.position = (n + s * c[0] + t * c[1]) * 0.5f,
+				.normal = n,
+				.u = c[0] * 0.5f + 0.5f,
+				.v = c[1] * 0.5f + 0.5f
+			});
+		}
+		for (u32 i : {0, 1, 2, 0, 2, 3}) {
+			mesh.indices.push_back(base + i);
+		}
+	}
+	return mesh;
+}
+
+Aabb Mesh::bounds() const {
+	if (vertices.empty()) {
+		return {};
+	}
+
+	Aabb aabb {vertices[0].position, vertices[0].position};
+	for (const auto& vertex : vertices) {
+		const auto& p = vertex.position;
+		aabb.min = {std::min(aabb.min.x, p.x), std::min(aabb.min.y, p.y), std::min(aabb.min.z, p.z)};
+		aabb.max = {std::max(aabb.max.x, p.x), std::max(aabb.max.y, p.y), std::max(aabb.max.z, p.z)};
+	}
+	return aabb;
+}
+
+PackedMesh PackedMesh::pack(const Mesh& mesh, bool with_meshlets) {
+	PackedMesh packed {};
+	packed.bounds = mesh.bounds();
+
+	// flat axes get a scale of 0, every vertex sits at the minimum there
+	auto extent = packed.bounds.max - packed.bounds.min;
+	Vec3<f32> scale {
+		extent.x > 0 ? 65535 / extent.x : 0,
+		extent.y > 0 ? 65535 / extent.y : 0,
+		extent.z > 0 ? 65535 / extent.z : 0
+	};
+
+	packed.vertices.reserve(mesh.vertices.size());
+	for (const auto& vertex : mesh.vertices) {
+		auto p = (vertex.position - packed.bounds.min) * scale;
+		PackedVertex packed_vertex {
+			.position {as<u16>(std::lround(p.x)), as<u16>(std::lround(p.y)), as<u16>(std::lround(p.z)), 0},
+			.uv {to_half(vertex.u), to_half(vertex.v)}
+		};
+		encode_octahedral(vertex.normal, packed_vertex.normal);
+		packed.vertices.push_back(packed_vertex);
+	}
+
+	// 16 bit indices halve the index fetch bandwidth whenever every vertex is reachable with them
+	packed.index_size = mesh.vertices.size() <= 0x10000 ? 2 : 4;
+	packed.add_lod(mesh.indices, 0);
+
+	if (with_meshlets) {
+		build_meshlets(mesh, packed);
+	}
+	return packed;
+}
+
+void PackedMesh::add_lod(std::span<const u32> lod_indices, f32 error) {
+	auto offset = indices.size();
+	lods.push_back({
+		.index_offset = as<u32>(offset / index_size),
+		.index_count = as<u32>(lod_indices.size()),
+		.error = error
+	});
+
+	indices.resize(offset + lod_indices.size() * index_size);
+	if (index_size == 2) {
+		for (usize i = 0; i < lod_indices.size(); ++i) {
+			auto index = as<u16>(lod_indices[i]);
+			memcpy(indices.data() + offset + i * 2, &index, 2);
+		}
+	}
+	else {
+		memcpy(indices.data() + offset, lod_indices.data(), lod_indices.size() * 4);
+	}
+}
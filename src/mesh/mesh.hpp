@@ -1,5 +1,108 @@
 #pragma once
+#include <span>
+#include <vector>
+#include "types.hpp"
+#include "math/vec.hpp"
+
+struct Vertex {
+	Vec3<f32> position;
+	Vec3<f32> normal;
+	f32 u, v;
+};
+
+/// Vertex layout on the gpu. Positions are 16 bit unorm within the mesh bounds and mapped back by
+/// the draw's matrix, normals are 16 bit snorm octahedral and uvs are half floats.
+struct PackedVertex {
+	u16 position[4];
+	i16 normal[2];
+	u16 uv[2];
+};
+static_assert(sizeof(PackedVertex) == 16);
+
+struct Aabb {
+	Vec3<f32> min;
+	Vec3<f32> max;
+};
+
+/// Group of up to MAX_VERTICES vertices and MAX_TRIANGLES triangles. Its triangles index into its own
+/// range of meshlet_vertices with 8 bit local indices, which in turn index the mesh's vertices.
+struct Meshlet {
+	u32 vertex_offset;
+	u32 triangle_offset;
+	u32 vertex_count;
+	u32 triangle_count;
+	/// bounding sphere in mesh space
+	Vec3<f32> center;
+	f32 radius;
+
+	constexpr static u32 MAX_VERTICES = 64;
+	constexpr static u32 MAX_TRIANGLES = 124;
+};
+
+constexpr u32 MAX_MESH_LODS = 8;
+
+/// Range of the index buffer drawing one level of detail. Level 0 is the full mesh,
+/// every level indexes the same vertices.
+struct MeshLod {
+	u32 index_offset;
+	u32 index_count;
+	/// simplification error in mesh units, 0 for the full mesh
+	f32 error;
+	u32 padding;
+};
+
+/// Packed mesh data that doesn't own its memory, either a PackedMesh or a memory mapped MeshFile.
+struct MeshView {
+	std::span<const PackedVertex> vertices;
+	/// u16 indices if index_size is 2, u32 otherwise, the lods are stored one after another
+	std::span<const u8> indices;
+	u32 index_size;
+	std::span<const MeshLod> lods;
+	Aabb bounds;
+	std::span<const Meshlet> meshlets;
+	std::span<const u32> meshlet_vertices;
+	/// three local vertex indices per triangle, meshlets only cover lod 0
+	std::span<const u8> meshlet_triangles;
+};
 
 class Mesh {
+public:
+	/// Unit cube centered on the origin with per face normals.
+	static Mesh cube();
+
+	[[nodiscard]] Aabb bounds() const;
+
+	std::vector<Vertex> vertices;
+	std::vector<u32> indices;
+};
+
+/// Mesh quantized into the gpu vertex layout.
+class PackedMesh {
+public:
+	/// Packs the mesh as lod 0. Meshlets are only built if with_meshlets is set, the renderer doesn't use them yet.
+	static PackedMesh pack(const Mesh& mesh, bool with_meshlets = false);
+	/// Appends a level of detail indexing the packed vertices.
+	void add_lod(std::span<const u32> lod_indices, f32 error);
+
+	[[nodiscard]] MeshView view() const {
+		return {
+			.vertices = vertices,
+			.indices = indices,
+			.index_size = index_size,
+			.lods = lods,
+			.bounds = bounds,
+			.meshlets = meshlets,
+			.meshlet_vertices = meshlet_vertices,
+			.meshlet_triangles = meshlet_triangles
+		};
+	}
 
+	std::vector<PackedVertex> vertices;
+	std::vector<u8> indices;
+	u32 index_size {};
+	std::vector<MeshLod> lods;
+	Aabb bounds {};
+	std::vector<Meshlet> meshlets;
+	std::vector<u32> meshlet_vertices;
+	std::vector<u8> meshlet_triangles;
 };
\ No newline at end of file
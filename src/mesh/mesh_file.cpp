@@ -0,0 +1,159 @@
+#include "mesh_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+static u64 align_up(u64 value, u64 alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void write_mesh_file(const std::string& path, const MeshView& mesh) {
+	MeshFileHeader header {
+		.magic = MESH_FILE_MAGIC,
+		.version = MESH_FILE_VERSION,
+		.index_size = mesh.index_size,
+		.bounds = mesh.bounds
+	};
+
+	struct Stream {
+		const void* data;
+		usize size;
+	};
+	const Stream streams[] {
+		{mesh.vertices.data(), mesh.vertices.size_bytes()},
+		{mesh.indices.data(), mesh.indices.size_bytes()},
+		{mesh.lods.data(), mesh.lods.size_bytes()},
+		{mesh.meshlets.data(), mesh.meshlets.size_bytes()},
+		{mesh.meshlet_vertices.data(), mesh.meshlet_vertices.size_bytes()},
+		{mesh.meshlet_triangles.data(), mesh.meshlet_triangles.size_bytes()}
+	};
+	MeshFileRange* ranges[] {
+		&header.vertices,
+		&header.indices,
+		&header.lods,
+		&header.meshlets,
+		&header.meshlet_vertices,
+		&header.meshlet_triangles
+	};
+
+	u64 offset = align_up(sizeof(MeshFileHeader), MESH_FILE_ALIGN);
+	for (usize i = 0; i < std::size(streams); ++i) {
+		*ranges[i] = {offset, streams[i].size};
+		offset = align_up(offset + streams[i].size, MESH_FILE_ALIGN);
+	}
+
+	std::ofstream file {path, std::ios::binary | std::ios::trunc};
+	if (!file) {
+		throw std::runtime_error("mesh: failed to create '" + path + "'");
+	}
+
+	const char zeros[MESH_FILE_ALIGN] {};
+	file.write(cast<const char*>(&header), sizeof(header));
+	u64 written = sizeof(header);
+	for (usize i = 0; i < std::size(streams); ++i) {
+		file.write(zeros, as<std::streamsize>(ranges[i]->offset - written));
+		file.write(cast<const char*>(streams[i].data), as<std::streamsize>(streams[i].size));
+		written = ranges[i]->offset + streams[i].size;
+	}
+
+	if (!file) {
+		throw std::runtime_error("mesh: failed to write '" + path + "'");
+	}
+}
+
+MeshFile::MeshFile(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("mesh: failed to open '" + path + "'");
+	}
+
+	struct stat info {};
+	if (fstat(fd, &info) != 0 || as<usize>(info.st_size) < sizeof(MeshFileHeader)) {
+		close(fd);
+		throw std::runtime_error("mesh: '" + path + "' is too small to be a mesh file");
+	}
+
+	size = as<usize>(info.st_size);
+	auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		throw std::runtime_error("mesh: failed to map '" + path + "'");
+	}
+	data = as<const u8*>(mapping);
+	// the whole file is read right away by the upload
+	madvise(mapping, size, MADV_WILLNEED);
+
+	MeshFileHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	auto valid_range = [&](const MeshFileRange& range, usize element_size) {
+		return range.offset % MESH_FILE_ALIGN == 0 && range.offset <= size && range.size <= size - range.offset
+			&& range.size % element_size == 0;
+	};
+
+	bool valid = header.magic == MESH_FILE_MAGIC && header.version == MESH_FILE_VERSION
+		&& (header.index_size == 2 || header.index_size == 4)
+		&& valid_range(header.vertices, sizeof(PackedVertex))
+		&& valid_range(header.indices, header.index_size)
+		&& valid_range(header.lods, sizeof(MeshLod))
+		&& valid_range(header.meshlets, sizeof(Meshlet))
+		&& valid_range(header.meshlet_vertices, sizeof(u32))
+		&& valid_range(header.meshlet_triangles, 3);
+
+	if (valid) {
+		auto lods = stream<MeshLod>(header.lods);
+		auto index_count = header.indices.size / header.index_size;
+		valid = !lods.empty() && lods.size() <= MAX_MESH_LODS;
+		for (const auto& lod : lods) {
+			valid &= as<u64>(lod.index_offset) + lod.index_count <= index_count;
+		}
+	}
+
+	if (!valid) {
+		munmap(mapping, size);
+		data = nullptr;
+		throw std::runtime_error("mesh: '" + path + "' is not a valid mesh file");
+	}
+}
+
+MeshFile::~MeshFile() {
+	if (data) {
+		munmap(const_cast<u8*>(data), size);
+	}
+}
+
+MeshFile::MeshFile(MeshFile&& other) noexcept
+	: data {std::exchange(other.data, nullptr)}, size {std::exchange(other.size, 0)} {}
+
+MeshFile& MeshFile::operator=(MeshFile&& other) noexcept {
+	if (this != &other) {
+		if (data) {
+			munmap(const_cast<u8*>(data), size);
+		}
+		data = std::exchange(other.data, nullptr);
+		size = std::exchange(other.size, 0);
+	}
+	return *this;
+}
+
+MeshView MeshFile::view() const {
+	MeshFileHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	return {
+		.vertices = stream<PackedVertex>(header.vertices),
+		.indices = stream<u8>(header.indices),
+		.index_size = header.index_size,
+		.lods = stream<MeshLod>(header.lods),
+		.bounds = header.bounds,
+		.meshlets = stream<Meshlet>(header.meshlets),
+		.meshlet_vertices = stream<u32>(header.meshlet_vertices),
+		.meshlet_triangles = stream<u8>(header.meshlet_triangles)
+	};
+}
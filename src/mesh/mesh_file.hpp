@@ -0,0 +1,57 @@
+#pragma once
+#include "types.hpp"
+#include "mesh.hpp"
+#include <string>
+
+/// Byte range of one stream inside a mesh file.
+struct MeshFileRange {
+	u64 offset;
+	u64 size;
+};
+
+/// Mesh files start with this header followed by the streams, every stream starts at a multiple of
+/// MESH_FILE_ALIGN so they can be used straight from the mapping. Everything is little endian.
+struct MeshFileHeader {
+	u32 magic;
+	u32 version;
+	u32 index_size;
+	u32 padding;
+	Aabb bounds;
+	MeshFileRange vertices;
+	MeshFileRange indices;
+	MeshFileRange lods;
+	MeshFileRange meshlets;
+	MeshFileRange meshlet_vertices;
+	MeshFileRange meshlet_triangles;
+};
+
+constexpr u32 MESH_FILE_MAGIC = 0x48534D47;
+constexpr u32 MESH_FILE_VERSION = 2;
+constexpr u64 MESH_FILE_ALIGN = 64;
+
+/// Writes a mesh file, throws on failure.
+void write_mesh_file(const std::string& path, const MeshView& mesh);
+
+/// Read only memory mapping of a mesh file. The views point into the mapping,
+/// uploading them copies straight from the page cache into the staging buffer.
+class MeshFile {
+public:
+	/// Throws if the file can't be mapped or isn't a valid mesh file.
+	explicit MeshFile(const std::string& path);
+	~MeshFile();
+	MeshFile(MeshFile&& other) noexcept;
+	MeshFile& operator=(MeshFile&& other) noexcept;
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	/// Valid as long as the file is.
+	[[nodiscard]] MeshView view() const;
+private:
+	template<typename T>
+	std::span<const T> stream(const MeshFileRange& range) const {
+		return {cast<const T*>(data + range.offset), range.size / sizeof(T)};
+	}
+
+	const u8* data {};
+	usize size {};
+};
\ No newline at end of file
@@ -0,0 +1,450 @@
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+constexpr u32 FORSYTH_CACHE_SIZE = 32;
+/// cache used to decide where overdraw clusters may be cut, matches analyze_vertex_cache's default
+constexpr u32 CLUSTER_CACHE_SIZE = 16;
+
+static f32 forsyth_vertex_score(i32 cache_position, u32 live_triangles) {
+	if (!live_triangles) {
+		return -1;
+	}
+
+	f32 score = 0;
+	if (cache_position >= 0) {
+		// the last triangle's vertices get a fixed score so the next triangle doesn't simply reuse its edge
+		if (cache_position < 3) {
+			score = 0.75f;
+		}
+		else {
+			score = std::pow(1 - as<f32>(cache_position - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+	}
+	// vertices with few triangles left are finished off first so they don't linger
+	return score + 2 * std::pow(as<f32>(live_triangles), -0.5f);
+}
+
+VertexCacheStats analyze_vertex_cache(std::span<const u32> indices, u32 vertex_count, u32 cache_size) {
+	if (indices.empty()) {
+		return {};
+	}
+
+	// a vertex is in the fifo if fewer than cache_size misses happened since it was loaded
+	std::vector<u32> timestamps(vertex_count, 0);
+	u32 time = cache_size + 1;
+	u32 misses = 0;
+	u32 referenced = 0;
+	for (auto index : indices) {
+		if (!timestamps[index]) {
+			++referenced;
+		}
+		if (time - timestamps[index] > cache_size) {
+			timestamps[index] = time++;
+			++misses;
+		}
+	}
+
+	return {
+		.acmr = as<f32>(misses) / as<f32>(indices.size() / 3),
+		.atvr = as<f32>(misses) / as<f32>(referenced)
+	};
+}
+
+void optimize_vertex_cache(std::span<u32> indices, u32 vertex_count) {
+	auto triangle_count = indices.size() / 3;
+	if (!triangle_count) {
+		return;
+	}
+
+	// live triangles of every vertex, emitted ones are swapped out of the vertex's range
+	std::vector<u32> live(vertex_count, 0);
+	for (auto index : indices) {
+		++live[index];
+	}
+	std::vector<u32> offsets(vertex_count + 1, 0);
+	std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+	std::vector<u32> adjacency(indices.size());
+	{
+		std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+		for (usize i = 0; i < indices.size(); ++i) {
+			adjacency[fill[indices[i]]++] = as<u32>(i / 3);
+		}
+	}
+
+	std::vector<i32> cache_position(vertex_count, -1);
+	std::vector<f32> vertex_scores(vertex_count);
+	for (u32 v = 0; v < vertex_count; ++v) {
+		vertex_scores[v] = forsyth_vertex_score(-1, live[v]);
+	}
+
+	std::vector<f32> triangle_scores(triangle_count);
+	std::vector<bool> emitted(triangle_count, false);
+	usize best = 0;
+	for (usize t = 0; t < triangle_count; ++t) {
+		triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+		if (triangle_scores[t] > triangle_scores[best]) {
+			best = t;
+		}
+	}
+
+	std::vector<u32> result;
+	result.reserve(indices.size());
+	u32 cache[FORSYTH_CACHE_SIZE + 3];
+	u32 cache_count = 0;
+	usize next_unemitted = 0;
+
+	while (result.size() < indices.size()) {
+		if (best == SIZE_MAX) {
+			// nothing in the cache has triangles left, continue with the next one in input order
+			while (emitted[next_unemitted]) {
+				++next_unemitted;
+			}
+			best = next_unemitted;
+		}
+
+		const u32 triangle[] {indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2]};
+		emitted[best] = true;
+		result.insert(result.end(), triangle, triangle + 3);
+
+		u32 new_cache[FORSYTH_CACHE_SIZE + 3];
+		u32 new_count = 0;
+		for (auto v : triangle) {
+			if (std::find(new_cache, new_cache + new_count, v) != new_cache + new_count) {
+				continue;
+			}
+			new_cache[new_count++] = v;
+
+			auto begin = adjacency.begin() + offsets[v];
+			auto end = begin + live[v];
+			auto it = std::find(begin, end, as<u32>(best));
+			std::iter_swap(it, end - 1);
+			--live[v];
+		}
+		for (u32 i = 0; i < cache_count; ++i) {
+			auto v = cache[i];
+			if (std::find(new_cache, new_cache + new_count, v) == new_cache + new_count) {
+				new_cache[new_count++] = v;
+			}
+		}
+
+		for (u32 i = 0; i < new_count; ++i) {
+			auto v = new_cache[i];
+			cache_position[v] = i < FORSYTH_CACHE_SIZE ? as<i32>(i) : -1;
+			vertex_scores[v] = forsyth_vertex_score(cache_position[v], live[v]);
+		}
+		cache_count = std::min(new_count, FORSYTH_CACHE_SIZE);
+		std::copy(new_cache, new_cache + cache_count, cache);
+
+		// only triangles touching the cache changed score, the best of them is emitted next
+		best = SIZE_MAX;
+		f32 best_score = -1;
+		for (u32 i = 0; i < new_count; ++i) {
+			auto v = new_cache[i];
+			for (u32 j = 0; j < live[v]; ++j) {
+				auto t = adjacency[offsets[v] + j];
+				auto score = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+				triangle_scores[t] = score;
+				if (score > best_score) {
+					best_score = score;
+					best = t;
+				}
+			}
+		}
+	}
+
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void optimize_overdraw(std::span<u32> indices, std::span<const Vertex> vertices, f32 threshold) {
+	auto triangle_count = indices.size() / 3;
+	if (!triangle_count) {
+		return;
+	}
+	auto mesh_acmr = analyze_vertex_cache(indices, as<u32>(vertices.size()), CLUSTER_CACHE_SIZE).acmr;
+
+	// every cluster is simulated starting with a cold cache, which is how it'll be drawn once reordered
+	std::vector<u32> cluster_starts;
+	std::vector<u32> timestamps(vertices.size(), 0);
+	u32 time = CLUSTER_CACHE_SIZE + 1;
+	u32 cluster_misses = 0;
+	u32 cluster_triangles = 0;
+	for (u32 t = 0; t < triangle_count; ++t) {
+		u32 misses = 0;
+		for (u32 i = 0; i < 3; ++i) {
+			auto index = indices[t * 3 + i];
+			if (time - timestamps[index] > CLUSTER_CACHE_SIZE) {
+				timestamps[index] = time++;
+				++misses;
+			}
+		}
+
+		bool hard_boundary = misses == 3;
+		bool soft_boundary = cluster_triangles && as<f32>(cluster_misses) <= threshold * mesh_acmr * as<f32>(cluster_triangles);
+		if (!t || hard_boundary || soft_boundary) {
+			cluster_starts.push_back(t);
+			if (t) {
+				// restart cold, this triangle is the first of a new cluster
+				time += CLUSTER_CACHE_SIZE + 1;
+				misses = 0;
+				for (u32 i = 0; i < 3; ++i) {
+					timestamps[indices[t * 3 + i]] = time++;
+					++misses;
+				}
+			}
+			cluster_misses = 0;
+			cluster_triangles = 0;
+		}
+		cluster_misses += misses;
+		++cluster_triangles;
+	}
+	cluster_starts.push_back(as<u32>(triangle_count));
+
+	Vec3<f32> mesh_centroid {};
+	f32 mesh_area = 0;
+	struct Cluster {
+		Vec3<f32> centroid;
+		Vec3<f32> normal;
+		f32 key;
+	};
+	std::vector<Cluster> clusters(cluster_starts.size() - 1);
+	for (usize i = 0; i < clusters.size(); ++i) {
+		auto& cluster = clusters[i];
+		cluster = {};
+		f32 area = 0;
+		for (auto t = cluster_starts[i]; t < cluster_starts[i + 1]; ++t) {
+			const auto& a = vertices[indices[t * 3]].position;
+			const auto& b = vertices[indices[t * 3 + 1]].position;
+			const auto& c = vertices[indices[t * 3 + 2]].position;
+			// the cross product's length is twice the area, which is enough for weighting
+			auto normal = (b - a).cross(c - a);
+			auto weight = normal.magnitude();
+			cluster.centroid = cluster.centroid + (a + b + c) * (weight / 3);
+			cluster.normal = cluster.normal + normal;
+			area += weight;
+		}
+		mesh_centroid = mesh_centroid + cluster.centroid;
+		mesh_area += area;
+		if (area > 0) {
+			cluster.centroid = cluster.centroid / area;
+		}
+	}
+	if (mesh_area > 0) {
+		mesh_centroid = mesh_centroid / mesh_area;
+	}
+
+	// clusters far out and facing away from the center are most likely to occlude others, so they're drawn first
+	for (auto& cluster : clusters) {
+		auto length = cluster.normal.magnitude();
+		cluster.key = length > 0 ? (cluster.centroid - mesh_centroid).dot(cluster.normal / length) : 0;
+	}
+
+	std::vector<u32> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+		return clusters[a].key > clusters[b].key;
+	});
+
+	std::vector<u32> result;
+	result.reserve(indices.size());
+	for (auto c : order) {
+		result.insert(result.end(), indices.begin() + cluster_starts[c] * 3, indices.begin() + cluster_starts[c + 1] * 3);
+	}
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void optimize_vertex_fetch(Mesh& mesh) {
+	std::vector<u32> remap(mesh.vertices.size(), UINT32_MAX);
+	std::vector<Vertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+	for (auto& index : mesh.indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = as<u32>(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.vertices = std::move(vertices);
+}
+
+/// Sum of squared distances to a set of planes, a symmetric 4x4 matrix.
+struct Quadric {
+	f64 a00, a01, a02, a03;
+	f64 a11, a12, a13;
+	f64 a22, a23;
+	f64 a33;
+
+	void add_plane(const Vec3<f64>& n, f64 d, f64 weight) {
+		a00 += weight * n.x * n.x;
+		a01 += weight * n.x * n.y;
+		a02 += weight * n.x * n.z;
+		a03 += weight * n.x * d;
+		a11 += weight * n.y * n.y;
+		a12 += weight * n.y * n.z;
+		a13 += weight * n.y * d;
+		a22 += weight * n.z * n.z;
+		a23 += weight * n.z * d;
+		a33 += weight * d * d;
+	}
+
+	Quadric& operator+=(const Quadric& rhs) {
+		a00 += rhs.a00;
+		a01 += rhs.a01;
+		a02 += rhs.a02;
+		a03 += rhs.a03;
+		a11 += rhs.a11;
+		a12 += rhs.a12;
+		a13 += rhs.a13;
+		a22 += rhs.a22;
+		a23 += rhs.a23;
+		a33 += rhs.a33;
+		return *this;
+	}
+
+	[[nodiscard]] f64 error(const Vec3<f32>& p) const {
+		f64 x = p.x;
+		f64 y = p.y;
+		f64 z = p.z;
+		return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+			+ a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+			+ a22 * z * z + 2 * a23 * z
+			+ a33;
+	}
+};
+
+/// Merges all vertices within a grid cell into the one with the least error against the cell's planes
+/// (Lindstrom's clustering with the representative restricted to existing vertices). Returns the error,
+/// the largest distance a vertex moved.
+static f32 simplify_clustered(const Mesh& mesh, const std::vector<Quadric>& quadrics, u32 grid, std::vector<u32>& out) {
+	auto bounds = mesh.bounds();
+	auto extent = bounds.max - bounds.min;
+	auto cell_size = std::max({extent.x, extent.y, extent.z}) / as<f32>(grid);
+	if (cell_size <= 0) {
+		out = mesh.indices;
+		return 0;
+	}
+
+	std::unordered_map<u64, u32> cell_ids;
+	std::vector<u32> vertex_cells(mesh.vertices.size());
+	for (usize v = 0; v < mesh.vertices.size(); ++v) {
+		auto cell = (mesh.vertices[v].position - bounds.min) / cell_size;
+		auto x = std::min(as<u64>(cell.x), as<u64>(grid - 1));
+		auto y = std::min(as<u64>(cell.y), as<u64>(grid - 1));
+		auto z = std::min(as<u64>(cell.z), as<u64>(grid - 1));
+		auto [it, inserted] = cell_ids.try_emplace(x | y << 21 | z << 42, as<u32>(cell_ids.size()));
+		vertex_cells[v] = it->second;
+	}
+
+	std::vector<Quadric> cell_quadrics(cell_ids.size(), Quadric {});
+	for (usize v = 0; v < mesh.vertices.size(); ++v) {
+		cell_quadrics[vertex_cells[v]] += quadrics[v];
+	}
+
+	std::vector<u32> representatives(cell_ids.size(), UINT32_MAX);
+	std::vector<f64> representative_errors(cell_ids.size(), 0);
+	for (usize v = 0; v < mesh.vertices.size(); ++v) {
+		auto cell = vertex_cells[v];
+		auto error = cell_quadrics[cell].error(mesh.vertices[v].position);
+		if (representatives[cell] == UINT32_MAX || error < representative_errors[cell]) {
+			representatives[cell] = as<u32>(v);
+			representative_errors[cell] = error;
+		}
+	}
+
+	f32 max_distance = 0;
+	for (usize v = 0; v < mesh.vertices.size(); ++v) {
+		const auto& representative = mesh.vertices[representatives[vertex_cells[v]]].position;
+		max_distance = std::max(max_distance, (mesh.vertices[v].position - representative).magnitude());
+	}
+
+	out.clear();
+	for (usize i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		auto a = representatives[vertex_cells[mesh.indices[i]]];
+		auto b = representatives[vertex_cells[mesh.indices[i + 1]]];
+		auto c = representatives[vertex_cells[mesh.indices[i + 2]]];
+		// triangles within one cell collapse
+		if (a != b && b != c && a != c) {
+			out.push_back(a);
+			out.push_back(b);
+			out.push_back(c);
+		}
+	}
+	return max_distance;
+}
+
+std::vector<LodIndices> build_lods(const Mesh& mesh, u32 lod_count, f32 ratio, u32 min_triangles) {
+	std::vector<LodIndices> lods;
+	auto triangle_count = mesh.indices.size() / 3;
+	if (!triangle_count) {
+		return lods;
+	}
+
+	std::vector<Quadric> quadrics(mesh.vertices.size(), Quadric {});
+	for (usize i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		const auto& a = mesh.vertices[mesh.indices[i]].position;
+		const auto& b = mesh.vertices[mesh.indices[i + 1]].position;
+		const auto& c = mesh.vertices[mesh.indices[i + 2]].position;
+		auto cross = (b - a).cross(c - a);
+		f64 length = cross.magnitude();
+		if (length == 0) {
+			continue;
+		}
+		Vec3<f64> n {cross.x / length, cross.y / length, cross.z / length};
+		auto d = -(n.x * a.x + n.y * a.y + n.z * a.z);
+		// area weighted so large faces keep their shape over slivers
+		for (usize j = 0; j < 3; ++j) {
+			quadrics[mesh.indices[i + j]].add_plane(n, d, length * 0.5);
+		}
+	}
+
+	// every level is simplified from the full mesh so errors don't accumulate
+	auto previous_triangles = triangle_count;
+	u32 previous_grid = 1024;
+	std::vector<u32> candidate;
+	for (u32 level = 0; level < lod_count; ++level) {
+		auto target = as<usize>(as<f32>(previous_triangles) * ratio);
+		if (target < min_triangles) {
+			break;
+		}
+
+		// the triangle count grows with the grid resolution, find the finest grid within the target
+		LodIndices best {};
+		u32 low = 1;
+		u32 high = previous_grid;
+		while (low <= high) {
+			auto grid = low + (high - low) / 2;
+			auto error = simplify_clustered(mesh, quadrics, grid, candidate);
+			if (candidate.size() / 3 <= target) {
+				best.indices = candidate;
+				best.error = error;
+				previous_grid = grid;
+				low = grid + 1;
+			}
+			else {
+				high = grid - 1;
+			}
+		}
+
+		auto triangles = best.indices.size() / 3;
+		if (triangles < min_triangles || as<f32>(triangles) > as<f32>(previous_triangles) * 0.9f) {
+			break;
+		}
+		previous_triangles = triangles;
+		lods.push_back(std::move(best));
+	}
+	return lods;
+}
+
+std::vector<LodIndices> optimize_mesh(Mesh& mesh, u32 lod_count) {
+	optimize_vertex_cache(mesh.indices, as<u32>(mesh.vertices.size()));
+	optimize_overdraw(mesh.indices, mesh.vertices);
+	optimize_vertex_fetch(mesh);
+
+	auto lods = build_lods(mesh, lod_count);
+	for (auto& lod : lods) {
+		optimize_vertex_cache(lod.indices, as<u32>(mesh.vertices.size()));
+	}
+	return lods;
+}
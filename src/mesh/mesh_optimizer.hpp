@@ -0,0 +1,42 @@
+#pragma once
+#include "types.hpp"
+#include "mesh.hpp"
+#include <span>
+#include <vector>
+
+/// Offline mesh processing. The passes are meant to run in this order: vertex cache, overdraw,
+/// vertex fetch, then lods are built from the result, optimize_mesh does all of them.
+
+struct VertexCacheStats {
+	/// average cache miss ratio, transformed vertices per triangle, 0.5 at best and 3 at worst
+	f32 acmr;
+	/// average transform to vertex ratio, 1 means every vertex is transformed exactly once
+	f32 atvr;
+};
+
+/// Simulates a fifo post transform cache of cache_size entries.
+VertexCacheStats analyze_vertex_cache(std::span<const u32> indices, u32 vertex_count, u32 cache_size = 16);
+
+/// Reorders triangles so consecutive triangles share vertices, Tom Forsyth's linear speed algorithm.
+void optimize_vertex_cache(std::span<u32> indices, u32 vertex_count);
+/// Reorders clusters of triangles so outward facing ones are drawn first and occlude the rest (Sander et al.).
+/// Clusters are cut where the cache misses completely anyway and wherever a cluster starting with a cold cache
+/// stays within threshold times the mesh's acmr, so the vertex cache optimization is mostly kept.
+void optimize_overdraw(std::span<u32> indices, std::span<const Vertex> vertices, f32 threshold = 1.05f);
+/// Reorders vertices in the order the indices first reference them and drops unreferenced ones.
+void optimize_vertex_fetch(Mesh& mesh);
+
+struct LodIndices {
+	std::vector<u32> indices;
+	/// simplification error in mesh units
+	f32 error;
+};
+
+/// Up to lod_count simplified index buffers for the vertices of mesh, not counting the full mesh itself.
+/// Every level has about ratio times the triangles of the previous one.
+/// Uses vertex clustering which only ever picks existing vertices, so every lod shares the mesh's vertex buffer.
+/// Stops early once a level has less than min_triangles triangles or simplification stops making progress.
+std::vector<LodIndices> build_lods(const Mesh& mesh, u32 lod_count, f32 ratio = 0.5f, u32 min_triangles = 64);
+
+/// Runs every pass on mesh and returns its lods, the lod index buffers are vertex cache optimized as well.
+std::vector<LodIndices> optimize_mesh(Mesh& mesh, u32 lod_count);
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "obj_loader.hpp"
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+struct Cursor {
+	const char* ptr;
+	const char* end;
+
+	void skip_spaces() {
+		while (ptr < end && (*ptr == ' ' || *ptr == '\t')) {
+			++ptr;
+		}
+	}
+
+	void skip_line() {
+		while (ptr < end && *ptr != '\n') {
+			++ptr;
+		}
+		if (ptr < end) {
+			++ptr;
+		}
+	}
+
+	[[nodiscard]] bool at_line_end() const {
+		return ptr == end || *ptr == '\n' || *ptr == '\r' || *ptr == '#';
+	}
+
+	f32 parse_float() {
+		skip_spaces();
+		f32 value {};
+		auto result = std::from_chars(ptr, end, value);
+		if (result.ec != std::errc {}) {
+			throw std::runtime_error("obj: expected a number");
+		}
+		ptr = result.ptr;
+		return value;
+	}
+
+	i64 parse_int() {
+		i64 value {};
+		auto result = std::from_chars(ptr, end, value);
+		if (result.ec != std::errc {}) {
+			throw std::runtime_error("obj: expected an index");
+		}
+		ptr = result.ptr;
+		return value;
+	}
+};
+
+struct Corner {
+	u32 position;
+	u32 uv;
+	u32 normal;
+
+	bool operator==(const Corner&) const = default;
+};
+
+struct CornerHash {
+	usize operator()(const Corner& corner) const {
+		return (as<usize>(corner.position) * 73856093) ^ (as<usize>(corner.uv) * 19349663) ^ (as<usize>(corner.normal) * 83492791);
+	}
+};
+
+constexpr u32 MISSING = UINT32_MAX;
+
+/// obj indices are one based, negative ones count back from the latest element
+static u32 resolve(i64 index, usize count) {
+	auto resolved = index < 0 ? as<i64>(count) + index : index - 1;
+	if (resolved < 0 || resolved >= as<i64>(count)) {
+		throw std::runtime_error("obj: index out of range");
+	}
+	return as<u32>(resolved);
+}
+
+Mesh load_obj(const std::string& path) {
+	std::ifstream file {path, std::ios::binary | std::ios::ate};
+	if (!file) {
+		throw std::runtime_error("obj: failed to open '" + path + "'");
+	}
+	std::string text(as<usize>(file.tellg()), '\0');
+	file.seekg(0);
+	file.read(text.data(), as<std::streamsize>(text.size()));
+
+	std::vector<Vec3<f32>> positions;
+	std::vector<Vec3<f32>> normals;
+	std::vector<std::pair<f32, f32>> uvs;
+
+	Mesh mesh {};
+	std::unordered_map<Corner, u32, CornerHash> corner_to_vertex;
+	bool needs_normals = false;
+	std::vector<u32> polygon;
+
+	Cursor cursor {text.data(), text.data() + text.size()};
+	while (cursor.ptr < cursor.end) {
+		cursor.skip_spaces();
+		std::string_view rest {cursor.ptr, as<usize>(cursor.end - cursor.ptr)};
+
+		if (rest.starts_with("v ")) {
+			++cursor.ptr;
+			auto x = cursor.parse_float();
+			auto y = cursor.parse_float();
+			auto z = cursor.parse_float();
+			positions.push_back({x, y, z});
+		}
+		else if (rest.starts_with("vn ")) {
+			cursor.ptr += 2;
+			auto x = cursor.parse_float();
+			auto y = cursor.parse_float();
+			auto z = cursor.parse_float();
+			normals.push_back({x, y, z});
+		}
+		else if (rest.starts_with("vt ")) {
+			cursor.ptr += 2;
+			auto u = cursor.parse_float();
+			auto v = cursor.parse_float();
+			uvs.emplace_back(u, v);
+		}
+		else if (rest.starts_with("f ")) {
+			++cursor.ptr;
+			polygon.clear();
+			while (true) {
+				cursor.skip_spaces();
+				if (cursor.at_line_end()) {
+					break;
+				}
+
+				Corner corner {resolve(cursor.parse_int(), positions.size()), MISSING, MISSING};
+				if (cursor.ptr < cursor.end && *cursor.ptr == '/') {
+					++cursor.ptr;
+					if (cursor.ptr < cursor.end && *cursor.ptr != '/') {
+						corner.uv = resolve(cursor.parse_int(), uvs.size());
+					}
+					if (cursor.ptr < cursor.end && *cursor.ptr == '/') {
+						++cursor.ptr;
+						corner.normal = resolve(cursor.parse_int(), normals.size());
+					}
+				}
+
+				auto [it, inserted] = corner_to_vertex.try_emplace(corner, as<u32>(mesh.vertices.size()));
+				if (inserted) {
+					auto uv = corner.uv == MISSING ? std::pair<f32, f32> {} : uvs[corner.uv];
+					mesh.vertices.push_back({
+						.position = positions[corner.position],
+						.normal = corner.normal == MISSING ? Vec3<f32> {} : normals[corner.normal],
+						// obj has v pointing up, vulkan images start at the top
+						.u = uv.first,
+						.v = 1 - uv.second
+					});
+					needs_normals |= corner.normal == MISSING;
+				}
+				polygon.push_back(it->second);
+			}
+
+			for (usize i = 2; i < polygon.size(); ++i) {
+				mesh.indices.push_back(polygon[0]);
+				mesh.indices.push_back(polygon[i - 1]);
+				mesh.indices.push_back(polygon[i]);
+			}
+		}
+		cursor.skip_line();
+	}
+
+	if (mesh.indices.empty()) {
+		throw std::runtime_error("obj: '" + path + "' has no faces");
+	}
+
+	if (needs_normals) {
+		// area weighted face normals accumulated into the vertices that have none
+		std::vector<Vec3<f32>> generated(mesh.vertices.size(), Vec3<f32> {});
+		for (usize i = 0; i < mesh.indices.size(); i += 3) {
+			const auto& a = mesh.vertices[mesh.indices[i]].position;
+			const auto& b = mesh.vertices[mesh.indices[i + 1]].position;
+			const auto& c = mesh.vertices[mesh.indices[i + 2]].position;
+			auto normal = (b - a).cross(c - a);
+			for (usize j = 0; j < 3; ++j) {
+				generated[mesh.indices[i + j]] = generated[mesh.indices[i + j]] + normal;
+			}
+		}
+		for (usize i = 0; i < mesh.vertices.size(); ++i) {
+			auto& vertex = mesh.vertices[i];
+			if (vertex.normal.sqr_magnitude() == 0 && generated[i].sqr_magnitude() > 0) {
+				vertex.normal = generated[i].normalized();
+			}
+		}
+	}
+
+	return mesh;
+}
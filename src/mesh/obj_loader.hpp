@@ -0,0 +1,7 @@
+#pragma once
+#include "mesh.hpp"
+#include <string>
+
+/// Loads a Wavefront OBJ file, every object and group is merged into one mesh. Polygons are triangulated
+/// as fans and missing normals are generated from the faces. Throws on failure.
+Mesh load_obj(const std::string& path);
\ No newline at end of file
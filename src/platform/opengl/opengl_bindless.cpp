@@ -0,0 +1,75 @@
+#include "opengl_bindless.hpp"
+#include <stdexcept>
+
+/// entries in the handle table, same as VulkanBindless's texture array
+constexpr u32 MAX_TEXTURES = 16384;
+
+void OpenGlBindless::init(const OpenGlFunctions* new_gl, u32 new_frame_count) {
+	gl = new_gl;
+	frame_count = new_frame_count;
+	handles.resize(MAX_TEXTURES);
+
+	// only entries no pending frame reads are written, so writing through the coherent mapping needs no fence
+	constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	constexpr auto size = as<GLsizeiptr>(MAX_TEXTURES * sizeof(GLuint64));
+	gl->CreateBuffers(1, &buffer);
+	gl->NamedBufferStorage(buffer, size, nullptr, flags);
+	mapped = cast<GLuint64*>(gl->MapNamedBufferRange(buffer, 0, size, flags));
+	if (!mapped) {
+		throw std::runtime_error("opengl: failed to map the bindless texture table");
+	}
+}
+
+void OpenGlBindless::destroy() {
+	release_retired(true);
+	gl->DeleteBuffers(1, &buffer);
+}
+
+u32 OpenGlBindless::add_texture(GLuint texture) {
+	u32 handle;
+	if (!free.empty()) {
+		handle = free.back();
+		free.pop_back();
+	}
+	else if (next == MAX_TEXTURES) {
+		throw std::runtime_error("opengl: bindless texture table is full");
+	}
+	else {
+		handle = next++;
+	}
+
+	handles[handle] = gl->GetTextureHandleARB(texture);
+	gl->MakeTextureHandleResidentARB(handles[handle]);
+	mapped[handle] = handles[handle];
+	return handle;
+}
+
+void OpenGlBindless::remove(u32 handle, std::function<void()> release) {
+	retired.push_back({
+		.handle = handle,
+		.release = std::move(release),
+		.frame_number = frame_number
+	});
+}
+
+void OpenGlBindless::begin_frame(u64 new_frame_number) {
+	frame_number = new_frame_number;
+	release_retired(false);
+}
+
+void OpenGlBindless::bind() const {
+	gl->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+}
+
+void OpenGlBindless::release_retired(bool all) {
+	// same rule as VulkanBindless, the renderer waits on a slot's fence frame_count frames after the frame
+	while (!retired.empty() && (all || frame_number - retired.front().frame_number >= frame_count)) {
+		auto& entry = retired.front();
+		gl->MakeTextureHandleNonResidentARB(handles[entry.handle]);
+		if (entry.release) {
+			entry.release();
+		}
+		free.push_back(entry.handle);
+		retired.pop_front();
+	}
+}
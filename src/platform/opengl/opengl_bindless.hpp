@@ -0,0 +1,48 @@
+#pragma once
+#include "types.hpp"
+#include "opengl_functions.hpp"
+#include <deque>
+#include <functional>
+#include <vector>
+
+/// Bindless texture table for GL_ARB_bindless_texture. Handles index a shader storage buffer of resident
+/// texture handles, read by mesh.frag like VulkanBindless's texture array, so GpuMesh::texture means the same
+/// on both backends. Removed handles are reused once every frame that could read them has finished.
+class OpenGlBindless {
+public:
+	/// same value as VulkanBindless::NONE, the shaders check for it
+	constexpr static u32 NONE = UINT32_MAX;
+
+	/// The extension has to be supported.
+	void init(const OpenGlFunctions* gl, u32 frame_count);
+	void destroy();
+
+	/// The texture's sampler state is baked into the handle and can't change afterwards.
+	u32 add_texture(GLuint texture);
+	/// release runs once no frame can read the handle, e.g. for deleting the texture.
+	void remove(u32 handle, std::function<void()> release = {});
+
+	void begin_frame(u64 frame_number);
+	/// Binds the table to shader storage binding 0.
+	void bind() const;
+private:
+	void release_retired(bool all);
+
+	struct Retired {
+		u32 handle;
+		std::function<void()> release;
+		u64 frame_number;
+	};
+
+	const OpenGlFunctions* gl {};
+	u32 frame_count {};
+	u64 frame_number {};
+	GLuint buffer {};
+	/// coherent, new entries are visible to the next draw
+	GLuint64* mapped {};
+	/// the resident handle of every entry, made non resident when the entry is released
+	std::vector<GLuint64> handles {};
+	std::vector<u32> free {};
+	u32 next {};
+	std::deque<Retired> retired {};
+};
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "opengl_functions.hpp"
+#include <SDL.h>
+#include <stdexcept>
+
+template<typename T>
+static bool load_function(T& fn, const char* name) {
+	fn = cast<T>(SDL_GL_GetProcAddress(name));
+	return fn != nullptr;
+}
+
+void OpenGlFunctions::load() {
+#define OPENGL_LOAD_FUNCTION(type, name) \
+	if (!load_function(name, "gl" #name)) { \
+		throw std::runtime_error("opengl: missing function gl" #name); \
+	}
+	OPENGL_FUNCTIONS(OPENGL_LOAD_FUNCTION)
+#undef OPENGL_LOAD_FUNCTION
+
+	// drivers may export the functions without supporting the extension, so the extension string decides
+	bindless_texture = SDL_GL_ExtensionSupported("GL_ARB_bindless_texture");
+	if (bindless_texture) {
+#define OPENGL_LOAD_OPTIONAL_FUNCTION(type, name) bindless_texture &= load_function(name, "gl" #name);
+		OPENGL_BINDLESS_FUNCTIONS(OPENGL_LOAD_OPTIONAL_FUNCTION)
+#undef OPENGL_LOAD_OPTIONAL_FUNCTION
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "types.hpp"
+#include <SDL_opengl.h>
+
+// The library only has to export gl 1.1, everything else is loaded from the context, so every function
+// the renderer calls goes through this table. 1.x functions have no pointer typedefs in SDL's glext.
+#define OPENGL_FUNCTIONS(X) \
+	X(decltype(&glGetString), GetString) \
+	X(decltype(&glGetIntegerv), GetIntegerv) \
+	X(decltype(&glEnable), Enable) \
+	X(decltype(&glDisable), Disable) \
+	X(decltype(&glViewport), Viewport) \
+	X(decltype(&glDepthFunc), DepthFunc) \
+	X(decltype(&glFrontFace), FrontFace) \
+	X(decltype(&glFlush), Flush) \
+	X(decltype(&glDeleteTextures), DeleteTextures) \
+	X(PFNGLCLIPCONTROLPROC, ClipControl) \
+	X(PFNGLDEBUGMESSAGECALLBACKPROC, DebugMessageCallback) \
+	X(PFNGLCREATEBUFFERSPROC, CreateBuffers) \
+	X(PFNGLNAMEDBUFFERSTORAGEPROC, NamedBufferStorage) \
+	X(PFNGLNAMEDBUFFERSUBDATAPROC, NamedBufferSubData) \
+	X(PFNGLMAPNAMEDBUFFERRANGEPROC, MapNamedBufferRange) \
+	X(PFNGLDELETEBUFFERSPROC, DeleteBuffers) \
+	X(PFNGLBINDBUFFERPROC, BindBuffer) \
+	X(PFNGLBINDBUFFERBASEPROC, BindBufferBase) \
+	X(PFNGLCREATEVERTEXARRAYSPROC, CreateVertexArrays) \
+	X(PFNGLDELETEVERTEXARRAYSPROC, DeleteVertexArrays) \
+	X(PFNGLBINDVERTEXARRAYPROC, BindVertexArray) \
+	X(PFNGLVERTEXARRAYVERTEXBUFFERPROC, VertexArrayVertexBuffer) \
+	X(PFNGLVERTEXARRAYELEMENTBUFFERPROC, VertexArrayElementBuffer) \
+	X(PFNGLVERTEXARRAYBINDINGDIVISORPROC, VertexArrayBindingDivisor) \
+	X(PFNGLENABLEVERTEXARRAYATTRIBPROC, EnableVertexArrayAttrib) \
+	X(PFNGLVERTEXARRAYATTRIBFORMATPROC, VertexArrayAttribFormat) \
+	X(PFNGLVERTEXARRAYATTRIBIFORMATPROC, VertexArrayAttribIFormat) \
+	X(PFNGLVERTEXARRAYATTRIBBINDINGPROC, VertexArrayAttribBinding) \
+	X(PFNGLCREATESHADERPROC, CreateShader) \
+	X(PFNGLSHADERSOURCEPROC, ShaderSource) \
+	X(PFNGLCOMPILESHADERPROC, CompileShader) \
+	X(PFNGLGETSHADERIVPROC, GetShaderiv) \
+	X(PFNGLGETSHADERINFOLOGPROC, GetShaderInfoLog) \
+	X(PFNGLDELETESHADERPROC, DeleteShader) \
+	X(PFNGLCREATEPROGRAMPROC, CreateProgram) \
+	X(PFNGLATTACHSHADERPROC, AttachShader) \
+	X(PFNGLLINKPROGRAMPROC, LinkProgram) \
+	X(PFNGLGETPROGRAMIVPROC, GetProgramiv) \
+	X(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog) \
+	X(PFNGLDELETEPROGRAMPROC, DeleteProgram) \
+	X(PFNGLUSEPROGRAMPROC, UseProgram) \
+	X(PFNGLPROGRAMUNIFORMMATRIX4FVPROC, ProgramUniformMatrix4fv) \
+	X(PFNGLCREATEFRAMEBUFFERSPROC, CreateFramebuffers) \
+	X(PFNGLDELETEFRAMEBUFFERSPROC, DeleteFramebuffers) \
+	X(PFNGLNAMEDFRAMEBUFFERTEXTUREPROC, NamedFramebufferTexture) \
+	X(PFNGLCHECKNAMEDFRAMEBUFFERSTATUSPROC, CheckNamedFramebufferStatus) \
+	X(PFNGLBINDFRAMEBUFFERPROC, BindFramebuffer) \
+	X(PFNGLCLEARNAMEDFRAMEBUFFERFVPROC, ClearNamedFramebufferfv) \
+	X(PFNGLCREATETEXTURESPROC, CreateTextures) \
+	X(PFNGLTEXTURESTORAGE2DPROC, TextureStorage2D) \
+	X(PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC, CompressedTextureSubImage2D) \
+	X(PFNGLTEXTUREPARAMETERIPROC, TextureParameteri) \
+	X(PFNGLCREATEQUERIESPROC, CreateQueries) \
+	X(PFNGLDELETEQUERIESPROC, DeleteQueries) \
+	X(PFNGLBEGINQUERYPROC, BeginQuery) \
+	X(PFNGLENDQUERYPROC, EndQuery) \
+	X(PFNGLGETQUERYOBJECTIVPROC, GetQueryObjectiv) \
+	X(PFNGLGETQUERYOBJECTUI64VPROC, GetQueryObjectui64v) \
+	X(PFNGLFENCESYNCPROC, FenceSync) \
+	X(PFNGLCLIENTWAITSYNCPROC, ClientWaitSync) \
+	X(PFNGLDELETESYNCPROC, DeleteSync) \
+	X(PFNGLMULTIDRAWELEMENTSINDIRECTPROC, MultiDrawElementsIndirect)
+
+/// GL_ARB_bindless_texture, loaded only when the extension is there
+#define OPENGL_BINDLESS_FUNCTIONS(X) \
+	X(PFNGLGETTEXTUREHANDLEARBPROC, GetTextureHandleARB) \
+	X(PFNGLMAKETEXTUREHANDLERESIDENTARBPROC, MakeTextureHandleResidentARB) \
+	X(PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC, MakeTextureHandleNonResidentARB)
+
+/// Function table of the current context, called like gl.CreateBuffers(1, &buffer).
+struct OpenGlFunctions {
+#define OPENGL_FUNCTION_MEMBER(type, name) type name {};
+	OPENGL_FUNCTIONS(OPENGL_FUNCTION_MEMBER)
+	OPENGL_BINDLESS_FUNCTIONS(OPENGL_FUNCTION_MEMBER)
+#undef OPENGL_FUNCTION_MEMBER
+	bool bindless_texture {};
+
+	/// A context has to be current. Throws if a core function is missing.
+	void load();
+};
\ No newline at end of file
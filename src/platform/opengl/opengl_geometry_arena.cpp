@@ -0,0 +1,52 @@
+#include "opengl_geometry_arena.hpp"
+
+void OpenGlGeometryArena::init(const OpenGlFunctions* new_gl, u64 vertex_bytes, u64 index_bytes) {
+	gl = new_gl;
+
+	// immutable storage lets the driver place it in vram for good, sub data uploads go through its staging
+	gl->CreateBuffers(1, &vertex_buffer);
+	gl->NamedBufferStorage(vertex_buffer, as<GLsizeiptr>(vertex_bytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	gl->CreateBuffers(1, &index_buffer);
+	gl->NamedBufferStorage(index_buffer, as<GLsizeiptr>(index_bytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	vertex_tlsf = Tlsf {vertex_bytes};
+	index_tlsf = Tlsf {index_bytes};
+}
+
+void OpenGlGeometryArena::destroy() {
+	gl->DeleteBuffers(1, &vertex_buffer);
+	gl->DeleteBuffers(1, &index_buffer);
+}
+
+std::optional<OpenGlGeometryArena::Range> OpenGlGeometryArena::alloc_vertices(u32 count, u32 vertex_size) {
+	// the base vertex counts whole vertices, so ranges start on a multiple of the vertex size
+	auto allocation = vertex_tlsf.alloc(as<u64>(count) * vertex_size, vertex_size);
+	if (!allocation) {
+		return std::nullopt;
+	}
+	return Range {as<u32>(allocation->offset / vertex_size), allocation->node};
+}
+
+std::optional<OpenGlGeometryArena::Range> OpenGlGeometryArena::alloc_indices(u32 count, u32 index_size) {
+	auto allocation = index_tlsf.alloc(as<u64>(count) * index_size);
+	if (!allocation) {
+		return std::nullopt;
+	}
+	return Range {as<u32>(allocation->offset / index_size), allocation->node};
+}
+
+void OpenGlGeometryArena::free_vertices(const Range& range) {
+	vertex_tlsf.free(range.node);
+}
+
+void OpenGlGeometryArena::free_indices(const Range& range) {
+	index_tlsf.free(range.node);
+}
+
+void OpenGlGeometryArena::upload_vertices(const Range& range, const void* data, u64 size, u32 vertex_size) {
+	gl->NamedBufferSubData(vertex_buffer, as<GLintptr>(range.first) * vertex_size, as<GLsizeiptr>(size), data);
+}
+
+void OpenGlGeometryArena::upload_indices(const Range& range, const void* data, u64 size, u32 index_size) {
+	gl->NamedBufferSubData(index_buffer, as<GLintptr>(range.first) * index_size, as<GLsizeiptr>(size), data);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "types.hpp"
+#include "opengl_functions.hpp"
+#include "platform/vulkan/vulkan_geometry_arena.hpp"
+#include "memory/tlsf.hpp"
+#include <optional>
+
+/// Same scheme as VulkanGeometryArena: every mesh is sub-allocated from one immutable vertex and one index
+/// buffer, so the multi draw indirect calls never rebind them. Ranges go into the same GpuMesh fields.
+class OpenGlGeometryArena {
+public:
+	using Range = VulkanGeometryArena::Range;
+
+	void init(const OpenGlFunctions* gl, u64 vertex_bytes, u64 index_bytes);
+	void destroy();
+
+	/// Return nothing when the arena is full.
+	std::optional<Range> alloc_vertices(u32 count, u32 vertex_size);
+	std::optional<Range> alloc_indices(u32 count, u32 index_size);
+	void free_vertices(const Range& range);
+	void free_indices(const Range& range);
+
+	/// The driver orders the copy after earlier draws, the range only has to be unused by the current frame.
+	void upload_vertices(const Range& range, const void* data, u64 size, u32 vertex_size);
+	void upload_indices(const Range& range, const void* data, u64 size, u32 index_size);
+
+	GLuint vertex_buffer {};
+	GLuint index_buffer {};
+private:
+	const OpenGlFunctions* gl {};
+	Tlsf vertex_tlsf {};
+	Tlsf index_tlsf {};
+};
\ No newline at end of file
@@ -1,21 +1,577 @@
 #include "opengl_renderer.hpp"
+#include "logger.hpp"
+#include "window.hpp"
+#include "mesh/mesh.hpp"
+#include "texture/texture_file.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
 
-OpenGlRenderer::OpenGlRenderer() {
+/// explicit uniform location in mesh.vert
+constexpr GLint VIEW_PROJECTION_LOCATION = 0;
 
+struct VertexAttribute {
+	GLuint binding;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	/// read as an integer instead of being converted to float
+	bool integer;
+	GLuint offset;
+};
+
+/// indexed by location, same vertex input as the vulkan mesh pipelines, a mat4 input takes one location per column
+static const VertexAttribute VERTEX_ATTRIBUTES[] {
+	{0, 4, GL_UNSIGNED_SHORT, GL_TRUE, false, offsetof(PackedVertex, position)},
+	{0, 2, GL_SHORT, GL_TRUE, false, offsetof(PackedVertex, normal)},
+	{0, 2, GL_HALF_FLOAT, GL_FALSE, false, offsetof(PackedVertex, uv)},
+	{1, 4, GL_FLOAT, GL_FALSE, false, offsetof(InstanceData, model)},
+	{1, 4, GL_FLOAT, GL_FALSE, false, offsetof(InstanceData, model) + 4 * sizeof(f32)},
+	{1, 4, GL_FLOAT, GL_FALSE, false, offsetof(InstanceData, model) + 8 * sizeof(f32)},
+	{1, 4, GL_FLOAT, GL_FALSE, false, offsetof(InstanceData, model) + 12 * sizeof(f32)},
+	{1, 3, GL_FLOAT, GL_FALSE, false, offsetof(InstanceData, dequantize_offset)},
+	{1, 3, GL_FLOAT, GL_FALSE, false, offsetof(InstanceData, dequantize_scale)},
+	{1, 1, GL_UNSIGNED_INT, GL_FALSE, true, offsetof(InstanceData, texture)}
+};
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void APIENTRY debug_callback(
+		GLenum,
+		GLenum type,
+		GLuint,
+		GLenum severity,
+		GLsizei length,
+		const GLchar* message,
+		const void* user) {
+	if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) {
+		return;
+	}
+	auto logger = as<Logger*>(const_cast<void*>(user));
+	auto level = type == GL_DEBUG_TYPE_ERROR ? LogLevel::Error : LogLevel::Warn;
+	logger->log("opengl", std::string_view {message, length < 0 ? strlen(message) : as<usize>(length)}, level);
+}
+
+/// defines are inserted after the #version line
+static GLuint compile_shader(const OpenGlFunctions& gl, GLenum stage, const std::string& path, std::string_view defines) {
+	std::ifstream file {path};
+	if (!file) {
+		throw std::runtime_error("opengl: failed to open shader '" + path + "'");
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	auto source = stream.str();
+	auto version_end = source.find('\n') + 1;
+	source.insert(version_end, defines);
+
+	auto shader = gl.CreateShader(stage);
+	auto data = source.c_str();
+	gl.ShaderSource(shader, 1, &data, nullptr);
+	gl.CompileShader(shader);
+
+	GLint status = GL_FALSE;
+	gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status) {
+		GLint log_size = 0;
+		gl.GetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
+		std::string log(as<usize>(std::max(log_size, 1)), '\0');
+		gl.GetShaderInfoLog(shader, log_size, nullptr, log.data());
+		gl.DeleteShader(shader);
+		throw std::runtime_error("opengl: failed to compile '" + path + "': " + log.c_str());
+	}
+	return shader;
+}
+
+OpenGlRenderer::OpenGlRenderer(Window* window, Logger* logger, JobSystem&, const RendererSettings& settings)
+	: window {window}, logger {logger}, settings {settings}, width {window->width}, height {window->height} {
+	sdl_window = window->inner;
+	init();
+}
+
+OpenGlRenderer::OpenGlRenderer(u32 width, u32 height, Logger* logger, JobSystem&, const RendererSettings& settings)
+	: window {nullptr}, logger {logger}, settings {settings}, width {width}, height {height} {
+	if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
+		throw std::runtime_error(std::string {"opengl: failed to init sdl video: "} + SDL_GetError());
+	}
+	sdl_window = SDL_CreateWindow("game", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (!sdl_window) {
+		SDL_QuitSubSystem(SDL_INIT_VIDEO);
+		throw std::runtime_error(std::string {"opengl: failed to create a hidden window: "} + SDL_GetError());
+	}
+	init();
+}
+
+void OpenGlRenderer::init() {
+	PROFILE_ZONE("OpenGlRenderer::init");
+	logger->log("opengl", headless() ? "init begin (headless)" : "init begin");
+	auto start = std::chrono::steady_clock::now();
+
+	if (!settings.frames_in_flight) {
+		throw std::runtime_error("opengl: frames in flight has to be at least 1");
+	}
+	if (settings.gpu_culling) {
+		logger->log("opengl", "gpu culling isn't supported, it's turned off", LogLevel::Warn);
+		settings.gpu_culling = false;
+	}
+
+	create_context();
+
+	// same clip space as vulkan, y points down and depth goes from 0 to 1, so projections work unchanged.
+	// Facing is still decided in gl's y up window space, where the pipelines' counter clockwise is clockwise
+	gl.ClipControl(GL_UPPER_LEFT, GL_ZERO_TO_ONE);
+	gl.FrontFace(GL_CW);
+	gl.Enable(GL_CULL_FACE);
+	gl.Enable(GL_DEPTH_TEST);
+	gl.DepthFunc(GL_LESS);
+	// the vulkan color targets are srgb too
+	gl.Enable(GL_FRAMEBUFFER_SRGB);
+
+	geometry.init(&gl, VERTEX_ARENA_SIZE, INDEX_ARENA_SIZE);
+	stream.init(&gl, settings.frames_in_flight, STREAM_REGION_SIZE);
+	if (gl.bindless_texture) {
+		bindless.init(&gl, settings.frames_in_flight);
+		bindless.bind();
+	}
+	else {
+		logger->log("opengl", "bindless textures are not supported, meshes are drawn untextured", LogLevel::Warn);
+	}
+
+	if (headless()) {
+		create_offscreen_framebuffer();
+	}
+	create_vertex_array();
+	create_program();
+
+	frames.resize(settings.frames_in_flight);
+	for (auto& frame : frames) {
+		gl.CreateQueries(GL_TIME_ELAPSED, 1, &frame.time_query);
+	}
+
+	logger->info("opengl", "renderer init done in {}ms: {} on {}",
+		ms_since(start), cast<const char*>(gl.GetString(GL_VERSION)), cast<const char*>(gl.GetString(GL_RENDERER)));
 }
 
-void OpenGlRenderer::render(const GpuMesh& mesh, const Transform& transform) {
+void OpenGlRenderer::create_context() {
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+#ifndef NDEBUG
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+#endif
+
+	// everything used is core in 4.5, mesa's llvmpipe which runs without a gpu doesn't expose 4.6
+	for (int minor : {6, 5}) {
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minor);
+		context = SDL_GL_CreateContext(sdl_window);
+		if (context) {
+			break;
+		}
+	}
+	if (!context) {
+		throw std::runtime_error(std::string {"opengl: failed to create a 4.5 core context: "} + SDL_GetError());
+	}
+	gl.load();
+
+	gl.Enable(GL_DEBUG_OUTPUT);
+	gl.DebugMessageCallback(debug_callback, logger);
+
+	if (headless()) {
+		return;
+	}
+	// there's no mailbox in gl, it falls back to fifo like an unsupported vulkan present mode
+	int interval = 1;
+	if (settings.present_mode == PresentMode::Immediate) {
+		interval = 0;
+	}
+	else if (settings.present_mode == PresentMode::FifoRelaxed) {
+		interval = -1;
+	}
+	if (SDL_GL_SetSwapInterval(interval) != 0) {
+		logger->warn("opengl", "swap interval {} is not supported, using vsync", interval);
+		SDL_GL_SetSwapInterval(1);
+	}
+	update_drawable_size();
+}
+
+void OpenGlRenderer::create_offscreen_framebuffer() {
+	gl.CreateTextures(GL_TEXTURE_2D, 1, &offscreen_color);
+	gl.TextureStorage2D(offscreen_color, 1, GL_SRGB8_ALPHA8, as<GLsizei>(width), as<GLsizei>(height));
+	gl.CreateTextures(GL_TEXTURE_2D, 1, &offscreen_depth);
+	gl.TextureStorage2D(offscreen_depth, 1, GL_DEPTH_COMPONENT32F, as<GLsizei>(width), as<GLsizei>(height));
+
+	gl.CreateFramebuffers(1, &framebuffer);
+	gl.NamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, offscreen_color, 0);
+	gl.NamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, offscreen_depth, 0);
+	if (gl.CheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("opengl: offscreen framebuffer is incomplete");
+	}
+	gl.BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void OpenGlRenderer::create_vertex_array() {
+	gl.CreateVertexArrays(1, &vertex_array);
+	gl.VertexArrayVertexBuffer(vertex_array, 0, geometry.vertex_buffer, 0, sizeof(PackedVertex));
+	gl.VertexArrayElementBuffer(vertex_array, geometry.index_buffer);
+	// the instance buffer is bound per frame since it's in the frame's stream region
+	gl.VertexArrayBindingDivisor(vertex_array, 1, 1);
+
+	for (GLuint location = 0; location < sizeof(VERTEX_ATTRIBUTES) / sizeof(*VERTEX_ATTRIBUTES); ++location) {
+		const auto& attribute = VERTEX_ATTRIBUTES[location];
+		gl.EnableVertexArrayAttrib(vertex_array, location);
+		if (attribute.integer) {
+			gl.VertexArrayAttribIFormat(vertex_array, location, attribute.size, attribute.type, attribute.offset);
+		}
+		else {
+			gl.VertexArrayAttribFormat(
+				vertex_array, location, attribute.size, attribute.type, attribute.normalized, attribute.offset);
+		}
+		gl.VertexArrayAttribBinding(vertex_array, location, attribute.binding);
+	}
+}
+
+void OpenGlRenderer::create_program() {
+	PROFILE_ZONE("create program");
+	std::string_view defines = gl.bindless_texture ? "#define BINDLESS 1\n" : "";
+	auto vert = compile_shader(gl, GL_VERTEX_SHADER, GAME_GL_SHADER_DIR "/mesh.vert", defines);
+	GLuint frag;
+	try {
+		frag = compile_shader(gl, GL_FRAGMENT_SHADER, GAME_GL_SHADER_DIR "/mesh.frag", defines);
+	}
+	catch (...) {
+		gl.DeleteShader(vert);
+		throw;
+	}
+
+	program = gl.CreateProgram();
+	gl.AttachShader(program, vert);
+	gl.AttachShader(program, frag);
+	gl.LinkProgram(program);
+	// the program keeps what it needs, deleted shaders are freed once it's deleted
+	gl.DeleteShader(vert);
+	gl.DeleteShader(frag);
+
+	GLint status = GL_FALSE;
+	gl.GetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status) {
+		GLint log_size = 0;
+		gl.GetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
+		std::string log(as<usize>(std::max(log_size, 1)), '\0');
+		gl.GetProgramInfoLog(program, log_size, nullptr, log.data());
+		throw std::runtime_error(std::string {"opengl: failed to link the mesh program: "} + log.c_str());
+	}
+}
+
+void OpenGlRenderer::update_drawable_size() {
+	// differs from the window size on high dpi displays
+	int drawable_width;
+	int drawable_height;
+	SDL_GL_GetDrawableSize(sdl_window, &drawable_width, &drawable_height);
+	width = as<u32>(std::max(drawable_width, 0));
+	height = as<u32>(std::max(drawable_height, 0));
+	needs_resize = false;
+}
+
+GpuMesh OpenGlRenderer::upload_mesh(const MeshView& mesh) {
+	if (mesh.vertices.empty() || mesh.indices.empty()) {
+		throw std::runtime_error("opengl: tried to upload an empty mesh");
+	}
+
+	GpuMesh gpu_mesh {};
+	if (mesh.lods.empty() || mesh.lods.size() > MAX_MESH_LODS) {
+		throw std::runtime_error("opengl: mesh has an invalid number of lods");
+	}
+	gpu_mesh.lod_count = as<u32>(mesh.lods.size());
+	std::copy(mesh.lods.begin(), mesh.lods.end(), gpu_mesh.lods);
+	gpu_mesh.index_type = mesh.index_size == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	gpu_mesh.bounds = mesh.bounds;
+
+	auto vertices = geometry.alloc_vertices(as<u32>(mesh.vertices.size()), sizeof(PackedVertex));
+	auto indices = geometry.alloc_indices(as<u32>(mesh.indices.size() / mesh.index_size), mesh.index_size);
+	if (!vertices || !indices) {
+		if (vertices) {
+			geometry.free_vertices(*vertices);
+		}
+		if (indices) {
+			geometry.free_indices(*indices);
+		}
+		throw std::runtime_error("opengl: geometry arena is full");
+	}
+	gpu_mesh.vertices = *vertices;
+	gpu_mesh.indices = *indices;
+
+	geometry.upload_vertices(gpu_mesh.vertices, mesh.vertices.data(), mesh.vertices.size_bytes(), sizeof(PackedVertex));
+	geometry.upload_indices(gpu_mesh.indices, mesh.indices.data(), mesh.indices.size_bytes(), mesh.index_size);
+	return gpu_mesh;
+}
 
+void OpenGlRenderer::destroy_mesh(GpuMesh& mesh) {
+	// freeing right away would be safe, but reusing a range the gpu still reads makes the driver stall or copy
+	frame().mesh_destroy_queue.push_back(mesh);
+	mesh = {};
+}
+
+void OpenGlRenderer::free_mesh(GpuMesh& mesh) {
+	geometry.free_vertices(mesh.vertices);
+	geometry.free_indices(mesh.indices);
+}
+
+u32 OpenGlRenderer::load_texture(const std::string& path) {
+	if (!gl.bindless_texture) {
+		logger->warn("opengl", "texture '{}' is not loaded, bindless textures are not supported", path);
+		return OpenGlBindless::NONE;
+	}
+
+	GLuint texture {};
+	try {
+		TextureFile file {path};
+		auto format = file.format() == TextureFormat::Bc7Srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RG_RGTC2;
+		gl.CreateTextures(GL_TEXTURE_2D, 1, &texture);
+		gl.TextureStorage2D(texture, as<GLsizei>(file.mip_count()), format, as<GLsizei>(file.width()), as<GLsizei>(file.height()));
+		for (u32 mip = 0; mip < file.mip_count(); ++mip) {
+			auto data = file.mip(mip);
+			gl.CompressedTextureSubImage2D(
+				texture,
+				as<GLint>(mip),
+				0,
+				0,
+				as<GLsizei>(mip_dimension(file.width(), mip)),
+				as<GLsizei>(mip_dimension(file.height(), mip)),
+				format,
+				as<GLsizei>(data.size()),
+				data.data());
+		}
+		// the sampler state is baked into the bindless handle, matching the vulkan default sampler
+		gl.TextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		gl.TextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		auto handle = bindless.add_texture(texture);
+		if (handle >= textures.size()) {
+			textures.resize(handle + 1);
+		}
+		textures[handle] = texture;
+		return handle;
+	}
+	catch (const std::exception& e) {
+		if (texture) {
+			gl.DeleteTextures(1, &texture);
+		}
+		logger->log("opengl", e.what(), LogLevel::Warn);
+		return OpenGlBindless::NONE;
+	}
+}
+
+void OpenGlRenderer::destroy_texture(u32 texture) {
+	if (texture >= textures.size() || !textures[texture]) {
+		return;
+	}
+	bindless.remove(texture, [this, name = textures[texture]] {
+		gl.DeleteTextures(1, &name);
+	});
+	textures[texture] = 0;
+}
+
+void OpenGlRenderer::submit(std::span<const DrawCommand> draws) {
+	if (!frame_active) {
+		return;
+	}
+	queued_draws.insert(queued_draws.end(), draws.begin(), draws.end());
+}
+
+void OpenGlRenderer::render_parallel(JobSystem&, std::span<const DrawCommand> draws) {
+	submit(draws);
+}
+
+void OpenGlRenderer::flush_draws() {
+	if (queued_draws.empty()) {
+		return;
+	}
+	PROFILE_ZONE("OpenGlRenderer::flush_draws");
+
+	// one allocation for both, a second one could move the frame to a new buffer. There's at most a batch per draw
+	auto commands_offset = (queued_draws.size() * sizeof(InstanceData) + alignof(InstanceData) - 1)
+		/ alignof(InstanceData) * alignof(InstanceData);
+	auto range = stream.alloc(commands_offset + queued_draws.size() * sizeof(DrawBatch), alignof(InstanceData));
+	batcher.build(queued_draws, cast<InstanceData*>(range.mapped));
+	auto batches = batcher.batches();
+	memcpy(range.mapped + commands_offset, batches.data(), batches.size_bytes());
+
+	gl.UseProgram(program);
+	gl.ProgramUniformMatrix4fv(program, VIEW_PROJECTION_LOCATION, 1, GL_FALSE, view_projection.m);
+	gl.BindVertexArray(vertex_array);
+	gl.VertexArrayVertexBuffer(vertex_array, 1, range.buffer, as<GLintptr>(range.offset), sizeof(InstanceData));
+	gl.BindBuffer(GL_DRAW_INDIRECT_BUFFER, range.buffer);
+
+	// batches are sorted by index type, so there's one run per type and one indirect call per run
+	for (const auto& run : batcher.runs()) {
+		auto offset = range.offset + commands_offset + run.first_batch * sizeof(DrawBatch);
+		gl.MultiDrawElementsIndirect(
+			GL_TRIANGLES,
+			run.wide_indices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT,
+			cast<const void*>(as<usize>(offset)),
+			as<GLsizei>(run.batch_count),
+			sizeof(DrawBatch));
+	}
+
+	queued_draws.clear();
+}
+
+u32 OpenGlRenderer::add_object(const GpuMesh&, const Mat4&) {
+	throw std::runtime_error("opengl: gpu culling is not supported");
+}
+
+void OpenGlRenderer::update_object(u32, const Mat4&) {
+	throw std::runtime_error("opengl: gpu culling is not supported");
+}
+
+void OpenGlRenderer::remove_object(u32) {
+	throw std::runtime_error("opengl: gpu culling is not supported");
+}
+
+void OpenGlRenderer::set_view_projection(const Mat4& new_view_projection) {
+	view_projection = new_view_projection;
 }
 
 void OpenGlRenderer::set_clear_color(f32 r, f32 g, f32 b, f32 a) {
+	clear_color[0] = r;
+	clear_color[1] = g;
+	clear_color[2] = b;
+	clear_color[3] = a;
+}
+
+void OpenGlRenderer::wait_for_frame() {
+	auto& f = frame();
+	if (f.fence) {
+		PROFILE_ZONE("wait for frame fence");
+		// the flush bit makes sure the fence reaches the gpu, otherwise the wait could block forever
+		auto result = gl.ClientWaitSync(f.fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+		if (result == GL_WAIT_FAILED || result == GL_TIMEOUT_EXPIRED) {
+			logger->log("opengl", "failed to wait for frame fence", LogLevel::Warn);
+		}
+		gl.DeleteSync(f.fence);
+		f.fence = {};
+	}
+	if (f.input_time) {
+		input_latency = ms_since(*f.input_time);
+		f.input_time.reset();
+	}
 
+	if (f.query_pending) {
+		// reading it before it's available would stall, it's dropped instead
+		GLint available = GL_FALSE;
+		gl.GetQueryObjectiv(f.time_query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 ns = 0;
+			gl.GetQueryObjectui64v(f.time_query, GL_QUERY_RESULT, &ns);
+			last_gpu_time = as<f64>(ns) / 1e6;
+		}
+		f.query_pending = false;
+	}
 }
 
 void OpenGlRenderer::begin(bool clear) {
+	PROFILE_ZONE("OpenGlRenderer::begin");
+
+	frame_active = false;
+	wait_for_frame();
+
+	for (auto& mesh : frame().mesh_destroy_queue) {
+		free_mesh(mesh);
+	}
+	frame().mesh_destroy_queue.clear();
+	if (gl.bindless_texture) {
+		bindless.begin_frame(frame_number);
+	}
+	stream.begin_frame(current_frame);
+
+	if (!headless()) {
+		if (SDL_GetWindowFlags(sdl_window) & SDL_WINDOW_MINIMIZED) {
+			return;
+		}
+		if (needs_resize) {
+			update_drawable_size();
+		}
+		if (!width || !height) {
+			return;
+		}
+	}
+	frame_active = true;
 
+	gl.Viewport(0, 0, as<GLsizei>(width), as<GLsizei>(height));
+	if (clear) {
+		gl.ClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, clear_color);
+	}
+	constexpr f32 depth = 1;
+	gl.ClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &depth);
+	gl.BeginQuery(GL_TIME_ELAPSED, frame().time_query);
+}
+
+void OpenGlRenderer::resize() {
+	needs_resize = true;
 }
 
 void OpenGlRenderer::finish() {
+	PROFILE_ZONE("OpenGlRenderer::finish");
+
+	if (!frame_active) {
+		return;
+	}
+
+	flush_draws();
+
+	gl.EndQuery(GL_TIME_ELAPSED);
+	frame().query_pending = true;
+	// the slot's stream region is written again once this is signaled
+	frame().fence = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	if (!headless()) {
+		PROFILE_ZONE("swap");
+		SDL_GL_SwapWindow(sdl_window);
+	}
+	else {
+		// nothing else makes the driver submit a headless frame
+		gl.Flush();
+	}
+
+	++frame_number;
+	current_frame = (current_frame + 1) % frames.size();
+}
+
+OpenGlRenderer::~OpenGlRenderer() {
+	for (auto& frame : frames) {
+		if (frame.fence) {
+			gl.DeleteSync(frame.fence);
+		}
+		gl.DeleteQueries(1, &frame.time_query);
+		for (auto& mesh : frame.mesh_destroy_queue) {
+			free_mesh(mesh);
+		}
+	}
+
+	gl.DeleteProgram(program);
+	gl.DeleteVertexArrays(1, &vertex_array);
+	if (gl.bindless_texture) {
+		for (u32 texture = 0; texture < textures.size(); ++texture) {
+			destroy_texture(texture);
+		}
+		bindless.destroy();
+	}
+	stream.destroy();
+	geometry.destroy();
+	if (headless()) {
+		gl.DeleteFramebuffers(1, &framebuffer);
+		gl.DeleteTextures(1, &offscreen_color);
+		gl.DeleteTextures(1, &offscreen_depth);
+	}
 
+	SDL_GL_DeleteContext(context);
+	if (headless()) {
+		SDL_DestroyWindow(sdl_window);
+		SDL_QuitSubSystem(SDL_INIT_VIDEO);
+	}
 }
@@ -1,15 +1,153 @@
 #pragma once
 #include "types.hpp"
+#include "opengl_functions.hpp"
+#include "opengl_geometry_arena.hpp"
+#include "opengl_stream_buffer.hpp"
+#include "opengl_bindless.hpp"
+#include "mesh/gpu_mesh.hpp"
+#include "math/mat.hpp"
+#include "components/transform.hpp"
+#include "draw_command.hpp"
+#include "draw_batcher.hpp"
+#include "renderer_settings.hpp"
+#include <SDL.h>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
 
-class GpuMesh;
-struct Transform;
+struct MeshView;
+class JobSystem;
+class Logger;
+class Window;
 
+/// Fallback for machines without vulkan, drawing the same batched stream as VulkanRenderer with
+/// glMultiDrawElementsIndirect. Needs gl 4.5 for direct state access and clip control, 4.6 is preferred.
 class OpenGlRenderer {
 public:
-	OpenGlRenderer();
+	OpenGlRenderer(Window* window, Logger* logger, JobSystem& jobs, const RendererSettings& settings);
+	/// Headless renderer drawing into an offscreen framebuffer, the context lives on a hidden window.
+	OpenGlRenderer(u32 width, u32 height, Logger* logger, JobSystem& jobs, const RendererSettings& settings);
+	~OpenGlRenderer();
+	OpenGlRenderer(const OpenGlRenderer&) = delete;
+	OpenGlRenderer& operator=(const OpenGlRenderer&) = delete;
 
-	void render(const GpuMesh& mesh, const Transform& transform);
+	GpuMesh upload_mesh(const MeshView& mesh);
+	void destroy_mesh(GpuMesh& mesh);
+	/// Uploads every level right away, there's no streaming. Needs bindless textures, no texture is returned without.
+	u32 load_texture(const std::string& path);
+	void destroy_texture(u32 texture);
+	/// Queues a single draw, same as submitting it. The mesh has to stay alive until finish.
+	void render(const GpuMesh& mesh, const Transform& transform) {
+		if (frame_active) {
+			queued_draws.push_back({.model = transform.matrix(), .mesh = &mesh});
+		}
+	}
+	/// Queues draws for the current frame, they're batched into instanced draws at finish.
+	void submit(std::span<const DrawCommand> draws);
+	/// A context can't record from several threads, the draws are queued like submit.
+	void render_parallel(JobSystem& jobs, std::span<const DrawCommand> draws);
+	/// Gpu culling isn't implemented for opengl, these throw.
+	u32 add_object(const GpuMesh& mesh, const Mat4& model);
+	void update_object(u32 object, const Mat4& model);
+	void remove_object(u32 object);
+	void set_view_projection(const Mat4& view_projection);
 	void set_clear_color(f32 r, f32 g, f32 b, f32 a);
+	/// Waits on the frame slot's fence. The frame is skipped while the window is minimized.
 	void begin(bool clear);
 	void finish();
+	/// The drawable size is read again at the start of the next frame.
+	void resize();
+	/// The current frame is the first to react to input read at time. There's no way to tell when a swap
+	/// reached the screen, the latency ends when the gpu has finished the frame.
+	void mark_input(std::chrono::steady_clock::time_point time) {
+		if (frame_active && (!frame().input_time || time < *frame().input_time)) {
+			frame().input_time = time;
+		}
+	}
+	/// Milliseconds of the latest measured input latency, 0 if nothing was measured since the last call.
+	f64 take_input_latency() {
+		return std::exchange(input_latency, 0);
+	}
+
+	/// Gpu time in milliseconds of the most recently completed frame.
+	[[nodiscard]] f64 gpu_frame_time() const {
+		return last_gpu_time;
+	}
+private:
+	void init();
+	void create_context();
+	void create_offscreen_framebuffer();
+	void create_vertex_array();
+	void create_program();
+	void update_drawable_size();
+	void wait_for_frame();
+	void free_mesh(GpuMesh& mesh);
+	void flush_draws();
+	[[nodiscard]] bool headless() const {
+		return !window;
+	}
+	struct Frame;
+	Frame& frame() {
+		return frames[current_frame];
+	}
+
+	Window* window;
+	Logger* logger;
+	RendererSettings settings;
+
+	/// the window's, or a hidden one holding the context when headless
+	SDL_Window* sdl_window {};
+	SDL_GLContext context {};
+	OpenGlFunctions gl {};
+
+	u32 width;
+	u32 height;
+	bool needs_resize {};
+
+	constexpr static u64 VERTEX_ARENA_SIZE = 128 * 1024 * 1024;
+	constexpr static u64 INDEX_ARENA_SIZE = 64 * 1024 * 1024;
+	/// per frame slot, grows if a frame needs more
+	constexpr static u64 STREAM_REGION_SIZE = 4 * 1024 * 1024;
+
+	/// 0 draws into the window
+	GLuint framebuffer {};
+	GLuint offscreen_color {};
+	GLuint offscreen_depth {};
+
+	OpenGlGeometryArena geometry {};
+	OpenGlStreamBuffer stream {};
+	OpenGlBindless bindless {};
+	/// texture of every bindless handle from load_texture, 0 once destroyed
+	std::vector<GLuint> textures {};
+	GLuint vertex_array {};
+	GLuint program {};
+
+	struct Frame {
+		/// signaled once the gpu is done with the slot's stream region
+		GLsync fence {};
+		GLuint time_query {};
+		bool query_pending {};
+		/// meshes destroyed while the slot was current, freed once its fence is waited on again
+		std::vector<GpuMesh> mesh_destroy_queue {};
+		/// from mark_input, measured once the fence is waited on again
+		std::optional<std::chrono::steady_clock::time_point> input_time {};
+	};
+	std::vector<Frame> frames {};
+	u32 current_frame {};
+	/// frames submitted so far
+	u64 frame_number {};
+	/// false while the frame is skipped
+	bool frame_active {};
+	f64 last_gpu_time {};
+	f64 input_latency {};
+
+	/// draws submitted for the current frame
+	std::vector<DrawCommand> queued_draws {};
+	DrawBatcher batcher {};
+
+	Mat4 view_projection {Mat4::identity()};
+	f32 clear_color[4] {};
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "opengl_stream_buffer.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+/// regions are sized in steps of this so a slowly rising amount of frame data doesn't reallocate every time
+constexpr u64 REGION_GRANULARITY = 64 * 1024;
+
+void OpenGlStreamBuffer::init(const OpenGlFunctions* new_gl, u32 new_slot_count, u64 region_size) {
+	gl = new_gl;
+	slot_count = new_slot_count;
+	create(region_size);
+}
+
+void OpenGlStreamBuffer::destroy() {
+	// deleting a mapped buffer unmaps it
+	gl->DeleteBuffers(1, &buffer);
+	buffer = 0;
+	mapped = nullptr;
+}
+
+void OpenGlStreamBuffer::create(u64 region_size) {
+	size = (region_size + REGION_GRANULARITY - 1) / REGION_GRANULARITY * REGION_GRANULARITY;
+	auto total = as<GLsizeiptr>(size * slot_count);
+
+	// coherent writes are visible to every command issued after them, no flushes or barriers are needed
+	constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	gl->CreateBuffers(1, &buffer);
+	gl->NamedBufferStorage(buffer, total, nullptr, flags);
+	mapped = cast<u8*>(gl->MapNamedBufferRange(buffer, 0, total, flags));
+	if (!mapped) {
+		throw std::runtime_error("opengl: failed to map the stream buffer");
+	}
+}
+
+void OpenGlStreamBuffer::begin_frame(u32 new_slot) {
+	slot = new_slot;
+	offset = 0;
+}
+
+OpenGlStreamBuffer::Range OpenGlStreamBuffer::alloc(u64 alloc_size, u64 alignment) {
+	auto start = (offset + alignment - 1) / alignment * alignment;
+	if (start + alloc_size > size) {
+		// no region of the new buffer is in use yet, so the frame continues in it without waiting.
+		// Commands already issued keep the old buffer alive
+		PROFILE_ZONE("OpenGlStreamBuffer::grow");
+		destroy();
+		create(std::max(alloc_size, size * 2));
+		start = 0;
+	}
+	offset = start + alloc_size;
+
+	auto region_start = as<u64>(slot) * size;
+	return {
+		.buffer = buffer,
+		.offset = region_start + start,
+		.mapped = mapped + region_start + start
+	};
+}
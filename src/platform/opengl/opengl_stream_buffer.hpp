@@ -0,0 +1,39 @@
+#pragma once
+#include "types.hpp"
+#include "opengl_functions.hpp"
+
+/// Persistently mapped coherent buffer with one region per frame slot, for instance data and indirect commands
+/// written once per frame. The renderer's fence for a slot has to be waited on before begin_frame reuses
+/// its region. A frame outgrowing its region replaces the buffer with a larger one instead of waiting, the
+/// driver keeps the old one alive until the frames reading it are done.
+class OpenGlStreamBuffer {
+public:
+	struct Range {
+		GLuint buffer;
+		u64 offset;
+		/// already offset, write combined memory, only write it front to back and never read it
+		u8* mapped;
+	};
+
+	void init(const OpenGlFunctions* gl, u32 slot_count, u64 region_size);
+	void destroy();
+
+	void begin_frame(u32 slot);
+	/// The returned range's buffer can differ from earlier ones in the same frame, it has to be bound again.
+	Range alloc(u64 size, u64 alignment);
+
+	[[nodiscard]] u64 region_size() const {
+		return size;
+	}
+private:
+	void create(u64 region_size);
+
+	const OpenGlFunctions* gl {};
+	GLuint buffer {};
+	u8* mapped {};
+	u32 slot_count {};
+	u64 size {};
+	u32 slot {};
+	/// relative to the slot's region
+	u64 offset {};
+};
\ No newline at end of file
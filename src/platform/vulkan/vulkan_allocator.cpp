@@ -0,0 +1,239 @@
+#include "vulkan_allocator.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <bit>
+#include <string>
+
+void VulkanAllocator::init(vk::Device p_device, vk::PhysicalDevice phys_device) {
+	device = p_device;
+	memory_properties = phys_device.getMemoryProperties();
+	max_allocation_count = phys_device.getProperties().limits.maxMemoryAllocationCount;
+
+	pools.resize(memory_properties.memoryTypeCount * 2);
+	for (u32 i = 0; i < memory_properties.memoryTypeCount; ++i) {
+		auto heap_size = memory_properties.memoryHeaps[memory_properties.memoryTypes[i].heapIndex].size;
+		// small heaps (e.g. the 256mb host visible device local heap) get proportionally smaller blocks
+		auto block_size = std::min(MAX_BLOCK_SIZE, std::bit_floor(heap_size / 8));
+		pools[i * 2].block_size = block_size;
+		pools[i * 2 + 1].block_size = block_size;
+	}
+
+	dedicated_bytes.resize(memory_properties.memoryHeapCount);
+	dedicated_count.resize(memory_properties.memoryHeapCount);
+}
+
+void VulkanAllocator::destroy() {
+	for (auto& p : pools) {
+		for (auto& block : p.blocks) {
+			if (block.memory) {
+				device.free(block.memory);
+			}
+		}
+		p.blocks.clear();
+		p.free_slots.clear();
+	}
+	driver_allocation_count = 0;
+}
+
+VulkanAllocation VulkanAllocator::alloc(
+		const vk::MemoryRequirements& requirements,
+		vk::MemoryPropertyFlags required,
+		ResourceKind kind,
+		vk::MemoryPropertyFlags preferred) {
+	auto memory_type = find_memory_type(requirements.memoryTypeBits, required, preferred);
+	auto& p = pool(memory_type, kind);
+
+	if (requirements.size > p.block_size / 2) {
+		VulkanAllocation allocation {
+			.size = requirements.size,
+			.memory_type = memory_type,
+			.kind = kind,
+			.dedicated = true
+		};
+		allocation.memory = allocate_memory(memory_type, requirements.size, allocation.mapped);
+
+		auto heap = memory_properties.memoryTypes[memory_type].heapIndex;
+		dedicated_bytes[heap] += requirements.size;
+		++dedicated_count[heap];
+		return allocation;
+	}
+
+	return alloc_from_pool(memory_type, kind, requirements);
+}
+
+void VulkanAllocator::free(VulkanAllocation& allocation) {
+	if (!allocation) {
+		return;
+	}
+
+	if (allocation.dedicated) {
+		device.free(allocation.memory);
+		--driver_allocation_count;
+
+		auto heap = memory_properties.memoryTypes[allocation.memory_type].heapIndex;
+		dedicated_bytes[heap] -= allocation.size;
+		--dedicated_count[heap];
+		allocation = {};
+		return;
+	}
+
+	auto& p = pool(allocation.memory_type, allocation.kind);
+	auto& block = p.blocks[allocation.block];
+	block.tlsf.free(allocation.node);
+
+	if (block.tlsf.allocation_count() == 0) {
+		// one empty block is kept around so alloc/free patterns at the edge don't thrash the driver
+		auto empty_blocks = std::count_if(p.blocks.begin(), p.blocks.end(), [](const Block& b) {
+			return b.memory && b.tlsf.allocation_count() == 0;
+		});
+		if (empty_blocks > 1) {
+			release_block(p, allocation.block);
+		}
+	}
+
+	allocation = {};
+}
+
+VulkanAllocation VulkanAllocator::alloc_buffer(vk::Buffer buffer, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) {
+	auto allocation = alloc(device.getBufferMemoryRequirements(buffer), required, ResourceKind::Linear, preferred);
+	device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+VulkanAllocation VulkanAllocator::alloc_image(vk::Image image, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) {
+	auto allocation = alloc(device.getImageMemoryRequirements(image), required, ResourceKind::Optimal, preferred);
+	device.bindImageMemory(image, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+std::vector<HeapStats> VulkanAllocator::heap_stats() const {
+	std::vector<HeapStats> stats(memory_properties.memoryHeapCount);
+
+	for (u32 pool_index = 0; pool_index < pools.size(); ++pool_index) {
+		auto heap = memory_properties.memoryTypes[pool_index / 2].heapIndex;
+		for (const auto& block : pools[pool_index].blocks) {
+			if (!block.memory) {
+				continue;
+			}
+			stats[heap].block_bytes += block.tlsf.capacity();
+			stats[heap].used_bytes += block.tlsf.used();
+			stats[heap].allocation_count += block.tlsf.allocation_count();
+			++stats[heap].block_count;
+		}
+	}
+
+	for (u32 heap = 0; heap < memory_properties.memoryHeapCount; ++heap) {
+		stats[heap].block_bytes += dedicated_bytes[heap];
+		stats[heap].used_bytes += dedicated_bytes[heap];
+		stats[heap].allocation_count += dedicated_count[heap];
+		stats[heap].block_count += dedicated_count[heap];
+	}
+
+	return stats;
+}
+
+void VulkanAllocator::log_stats(Logger* logger) const {
+	auto stats = heap_stats();
+	for (usize i = 0; i < stats.size(); ++i) {
+		const auto& heap = stats[i];
+		logger->info("vulkan", "heap {}: {}kb used of {}kb in {} blocks, {} allocations",
+			i, heap.used_bytes / 1024, heap.block_bytes / 1024, heap.block_count, heap.allocation_count);
+	}
+}
+
+u32 VulkanAllocator::find_memory_type(u32 type_bits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) const {
+	auto find = [&](vk::MemoryPropertyFlags flags) {
+		for (u32 i = 0; i < memory_properties.memoryTypeCount; ++i) {
+			if (type_bits & 1 << i && (memory_properties.memoryTypes[i].propertyFlags & flags) == flags) {
+				return i;
+			}
+		}
+		return UINT32_MAX;
+	};
+
+	auto type = find(required | preferred);
+	if (type == UINT32_MAX) {
+		type = find(required);
+	}
+	if (type == UINT32_MAX) {
+		throw std::runtime_error("vulkan: no suitable memory type was found");
+	}
+	return type;
+}
+
+VulkanAllocator::Pool& VulkanAllocator::pool(u32 memory_type, ResourceKind kind) {
+	return pools[memory_type * 2 + as<u32>(kind)];
+}
+
+vk::DeviceMemory VulkanAllocator::allocate_memory(u32 memory_type, vk::DeviceSize size, u8*& mapped) {
+	if (driver_allocation_count >= max_allocation_count) {
+		throw std::runtime_error("vulkan: device memory allocation count limit reached");
+	}
+
+	vk::MemoryAllocateInfo alloc_info {
+		.allocationSize = size,
+		.memoryTypeIndex = memory_type
+	};
+	auto memory = device.allocateMemory(alloc_info);
+	++driver_allocation_count;
+
+	mapped = nullptr;
+	if (memory_properties.memoryTypes[memory_type].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+		mapped = as<u8*>(device.mapMemory(memory, 0, VK_WHOLE_SIZE));
+	}
+	return memory;
+}
+
+VulkanAllocation VulkanAllocator::alloc_from_pool(u32 memory_type, ResourceKind kind, const vk::MemoryRequirements& requirements) {
+	auto& p = pool(memory_type, kind);
+
+	auto make_allocation = [&](u32 block_index, const Tlsf::Allocation& a) {
+		const auto& block = p.blocks[block_index];
+		return VulkanAllocation {
+			.memory = block.memory,
+			.offset = a.offset,
+			.size = a.size,
+			.mapped = block.mapped ? block.mapped + a.offset : nullptr,
+			.memory_type = memory_type,
+			.block = block_index,
+			.node = a.node,
+			.kind = kind
+		};
+	};
+
+	for (u32 i = 0; i < p.blocks.size(); ++i) {
+		if (!p.blocks[i].memory) {
+			continue;
+		}
+		if (auto a = p.blocks[i].tlsf.alloc(requirements.size, requirements.alignment)) {
+			return make_allocation(i, *a);
+		}
+	}
+
+	u32 index;
+	if (!p.free_slots.empty()) {
+		index = p.free_slots.back();
+		p.free_slots.pop_back();
+	}
+	else {
+		index = as<u32>(p.blocks.size());
+		p.blocks.emplace_back();
+	}
+
+	auto& block = p.blocks[index];
+	block.memory = allocate_memory(memory_type, p.block_size, block.mapped);
+	block.tlsf = Tlsf {p.block_size};
+
+	auto a = block.tlsf.alloc(requirements.size, requirements.alignment);
+	return make_allocation(index, *a);
+}
+
+void VulkanAllocator::release_block(Pool& p, u32 index) {
+	auto& block = p.blocks[index];
+	device.free(block.memory);
+	--driver_allocation_count;
+	block.memory = nullptr;
+	block.mapped = nullptr;
+	block.tlsf = {};
+	p.free_slots.push_back(index);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "memory/tlsf.hpp"
+#include <vector>
+
+class Logger;
+
+enum class ResourceKind : u8 {
+	/// buffers and linear images
+	Linear,
+	/// optimally tiled images, kept in separate blocks so buffer image granularity never matters
+	Optimal
+};
+
+struct VulkanAllocation {
+	vk::DeviceMemory memory;
+	vk::DeviceSize offset {};
+	vk::DeviceSize size {};
+	/// null if the memory is not host visible
+	u8* mapped {};
+	u32 memory_type {};
+	u32 block {};
+	u32 node {};
+	ResourceKind kind {};
+	bool dedicated {};
+
+	[[nodiscard]] explicit operator bool() const {
+		return as<bool>(memory);
+	}
+};
+
+struct HeapStats {
+	/// device memory allocated from the driver
+	vk::DeviceSize block_bytes;
+	/// memory handed out to resources
+	vk::DeviceSize used_bytes;
+	u32 block_count;
+	u32 allocation_count;
+};
+
+/// Sub-allocates buffers and images from large device memory blocks per memory type,
+/// every block is managed by a tlsf allocator.
+class VulkanAllocator {
+public:
+	void init(vk::Device device, vk::PhysicalDevice phys_device);
+	void destroy();
+
+	VulkanAllocation alloc(
+			const vk::MemoryRequirements& requirements,
+			vk::MemoryPropertyFlags required,
+			ResourceKind kind,
+			vk::MemoryPropertyFlags preferred = {});
+	void free(VulkanAllocation& allocation);
+
+	VulkanAllocation alloc_buffer(vk::Buffer buffer, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {});
+	VulkanAllocation alloc_image(vk::Image image, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {});
+
+	[[nodiscard]] std::vector<HeapStats> heap_stats() const;
+	void log_stats(Logger* logger) const;
+private:
+	struct Block {
+		vk::DeviceMemory memory;
+		u8* mapped;
+		Tlsf tlsf;
+	};
+
+	struct Pool {
+		std::vector<Block> blocks {};
+		std::vector<u32> free_slots {};
+		vk::DeviceSize block_size {};
+	};
+
+	u32 find_memory_type(u32 type_bits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) const;
+	Pool& pool(u32 memory_type, ResourceKind kind);
+	vk::DeviceMemory allocate_memory(u32 memory_type, vk::DeviceSize size, u8*& mapped);
+	VulkanAllocation alloc_from_pool(u32 memory_type, ResourceKind kind, const vk::MemoryRequirements& requirements);
+	void release_block(Pool& pool, u32 index);
+
+	constexpr static vk::DeviceSize MAX_BLOCK_SIZE = 256 * 1024 * 1024;
+
+	vk::Device device;
+	vk::PhysicalDeviceMemoryProperties memory_properties {};
+	u32 max_allocation_count {};
+	u32 driver_allocation_count {};
+	/// indexed by memory_type * 2 + kind
+	std::vector<Pool> pools {};
+	std::vector<vk::DeviceSize> dedicated_bytes {};
+	std::vector<u32> dedicated_count {};
+};
\ No newline at end of file
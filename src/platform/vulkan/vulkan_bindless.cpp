@@ -0,0 +1,176 @@
+#include "vulkan_bindless.hpp"
+#include <algorithm>
+
+/// upper bounds of the arrays, lowered to the device's update after bind limits
+constexpr u32 MAX_TEXTURES = 16384;
+constexpr u32 MAX_SAMPLERS = 64;
+constexpr u32 MAX_BUFFERS = 4096;
+
+static const vk::DescriptorType DESCRIPTOR_TYPES[] {
+	vk::DescriptorType::eSampledImage,
+	vk::DescriptorType::eSampler,
+	vk::DescriptorType::eStorageBuffer
+};
+
+void VulkanBindless::init(vk::Device new_device, vk::PhysicalDevice phys_device, u32 new_frame_count) {
+	device = new_device;
+	frame_count = new_frame_count;
+
+	auto props = phys_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>()
+		.get<vk::PhysicalDeviceVulkan12Properties>();
+	heaps[KIND_TEXTURE].capacity = std::min({
+		MAX_TEXTURES,
+		props.maxDescriptorSetUpdateAfterBindSampledImages,
+		props.maxPerStageDescriptorUpdateAfterBindSampledImages});
+	heaps[KIND_SAMPLER].capacity = std::min({
+		MAX_SAMPLERS,
+		props.maxDescriptorSetUpdateAfterBindSamplers,
+		props.maxPerStageDescriptorUpdateAfterBindSamplers});
+	heaps[KIND_BUFFER].capacity = std::min({
+		MAX_BUFFERS,
+		props.maxDescriptorSetUpdateAfterBindStorageBuffers,
+		props.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+	// unused entries are never written, and entries no pending frame reads may be rewritten while the set is bound
+	constexpr auto binding_flags = vk::DescriptorBindingFlagBits::eUpdateAfterBind
+		| vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending
+		| vk::DescriptorBindingFlagBits::ePartiallyBound;
+	const vk::DescriptorBindingFlags flags[KIND_COUNT] {binding_flags, binding_flags, binding_flags};
+	constexpr auto stages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment
+		| vk::ShaderStageFlagBits::eCompute;
+
+	vk::DescriptorSetLayoutBinding bindings[KIND_COUNT];
+	vk::DescriptorPoolSize pool_sizes[KIND_COUNT];
+	for (u32 kind = 0; kind < KIND_COUNT; ++kind) {
+		bindings[kind] = {
+			.binding = kind,
+			.descriptorType = DESCRIPTOR_TYPES[kind],
+			.descriptorCount = heaps[kind].capacity,
+			.stageFlags = stages
+		};
+		pool_sizes[kind] = {
+			.type = DESCRIPTOR_TYPES[kind],
+			.descriptorCount = heaps[kind].capacity
+		};
+	}
+
+	vk::DescriptorSetLayoutBindingFlagsCreateInfo flags_info {
+		.bindingCount = KIND_COUNT,
+		.pBindingFlags = flags
+	};
+	layout = device.createDescriptorSetLayout({
+		.pNext = &flags_info,
+		.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+		.bindingCount = KIND_COUNT,
+		.pBindings = bindings
+	});
+
+	pool = device.createDescriptorPool({
+		.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+		.maxSets = 1,
+		.poolSizeCount = KIND_COUNT,
+		.pPoolSizes = pool_sizes
+	});
+	set = device.allocateDescriptorSets({
+		.descriptorPool = pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layout
+	})[0];
+}
+
+void VulkanBindless::destroy() {
+	release_retired(true);
+	device.destroy(pool);
+	device.destroy(layout);
+}
+
+u32 VulkanBindless::alloc(Kind kind) {
+	auto& heap = heaps[kind];
+	if (!heap.free.empty()) {
+		auto handle = heap.free.back();
+		heap.free.pop_back();
+		return handle;
+	}
+	if (heap.next == heap.capacity) {
+		throw std::runtime_error("vulkan: bindless descriptor heap is full");
+	}
+	return heap.next++;
+}
+
+u32 VulkanBindless::add_texture(vk::ImageView view) {
+	auto handle = alloc(KIND_TEXTURE);
+	const vk::DescriptorImageInfo info {
+		.imageView = view,
+		.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+	};
+	device.updateDescriptorSets(vk::WriteDescriptorSet {
+		.dstSet = set,
+		.dstBinding = KIND_TEXTURE,
+		.dstArrayElement = handle,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eSampledImage,
+		.pImageInfo = &info
+	}, {});
+	return handle;
+}
+
+u32 VulkanBindless::add_sampler(vk::Sampler sampler) {
+	auto handle = alloc(KIND_SAMPLER);
+	const vk::DescriptorImageInfo info {
+		.sampler = sampler
+	};
+	device.updateDescriptorSets(vk::WriteDescriptorSet {
+		.dstSet = set,
+		.dstBinding = KIND_SAMPLER,
+		.dstArrayElement = handle,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eSampler,
+		.pImageInfo = &info
+	}, {});
+	return handle;
+}
+
+u32 VulkanBindless::add_buffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size) {
+	auto handle = alloc(KIND_BUFFER);
+	const vk::DescriptorBufferInfo info {
+		.buffer = buffer,
+		.offset = offset,
+		.range = size
+	};
+	device.updateDescriptorSets(vk::WriteDescriptorSet {
+		.dstSet = set,
+		.dstBinding = KIND_BUFFER,
+		.dstArrayElement = handle,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eStorageBuffer,
+		.pBufferInfo = &info
+	}, {});
+	return handle;
+}
+
+void VulkanBindless::remove(Kind kind, u32 handle, std::function<void()> release) {
+	retired.push_back({
+		.kind = kind,
+		.handle = handle,
+		.release = std::move(release),
+		.frame_number = frame_number
+	});
+}
+
+void VulkanBindless::begin_frame(u64 new_frame_number) {
+	frame_number = new_frame_number;
+	release_retired(false);
+}
+
+void VulkanBindless::release_retired(bool all) {
+	// same rule as retired swapchains, a slot's fence is waited on frame_count frames after its submit.
+	// The stale descriptor is left in place, partially bound arrays allow it as long as nothing reads it
+	while (!retired.empty() && (all || frame_number - retired.front().frame_number >= frame_count)) {
+		auto& entry = retired.front();
+		if (entry.release) {
+			entry.release();
+		}
+		heaps[entry.kind].free.push_back(entry.handle);
+		retired.pop_front();
+	}
+}
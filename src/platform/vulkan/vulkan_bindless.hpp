@@ -0,0 +1,77 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include <deque>
+#include <functional>
+#include <vector>
+
+/// One descriptor set holding every texture, sampler and storage buffer, bound once per command buffer.
+/// Shaders index its arrays with handles passed in push constants or instance data, so draws never
+/// allocate, update or bind descriptor sets. Handles stay valid until removed and a removed handle is
+/// only reused once every frame that could still read it has finished.
+class VulkanBindless {
+public:
+	/// the arrays of the set, also its binding numbers
+	enum Kind : u32 {
+		KIND_TEXTURE,
+		KIND_SAMPLER,
+		KIND_BUFFER,
+		KIND_COUNT
+	};
+
+	/// never handed out, shaders treat it as no resource
+	constexpr static u32 NONE = UINT32_MAX;
+
+	void init(vk::Device device, vk::PhysicalDevice phys_device, u32 frame_count);
+	/// Releases everything still waiting for removal, the device has to be idle.
+	void destroy();
+
+	/// The image has to be in shader read only layout whenever a frame using the handle executes.
+	u32 add_texture(vk::ImageView view);
+	u32 add_sampler(vk::Sampler sampler);
+	u32 add_buffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+	/// The handle's descriptor may still be read by frames in flight, release is called once they have
+	/// finished and should destroy the resource.
+	void remove(Kind kind, u32 handle, std::function<void()> release = {});
+
+	/// Call after waiting for the frame slot's fence, frame_number counts the submitted frames.
+	void begin_frame(u64 frame_number);
+
+	void bind(vk::CommandBuffer cmd, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout) const {
+		cmd.bindDescriptorSets(bind_point, layout, 0, set, {});
+	}
+
+	/// Set 0 of every pipeline layout using the heap.
+	[[nodiscard]] vk::DescriptorSetLayout set_layout() const {
+		return layout;
+	}
+	[[nodiscard]] u32 used(Kind kind) const {
+		return as<u32>(heaps[kind].next - heaps[kind].free.size());
+	}
+private:
+	struct Heap {
+		u32 capacity {};
+		/// handles below next were handed out at some point
+		u32 next {};
+		std::vector<u32> free {};
+	};
+
+	struct Retired {
+		Kind kind;
+		u32 handle;
+		std::function<void()> release;
+		u64 frame_number;
+	};
+
+	u32 alloc(Kind kind);
+	void release_retired(bool all);
+
+	vk::Device device;
+	vk::DescriptorSetLayout layout;
+	vk::DescriptorPool pool;
+	vk::DescriptorSet set;
+	Heap heaps[KIND_COUNT] {};
+	std::deque<Retired> retired {};
+	u32 frame_count {};
+	u64 frame_number {};
+};
\ No newline at end of file
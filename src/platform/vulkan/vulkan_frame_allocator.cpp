@@ -0,0 +1,85 @@
+#include "vulkan_frame_allocator.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+
+/// blocks are sized in steps of this so a slowly rising amount of frame data doesn't reallocate every time
+constexpr vk::DeviceSize BLOCK_GRANULARITY = 64 * 1024;
+
+void VulkanFrameAllocator::init(
+		vk::Device new_device,
+		vk::PhysicalDevice phys_device,
+		VulkanAllocator* new_allocator,
+		vk::DeviceSize size) {
+	device = new_device;
+	allocator = new_allocator;
+	uniform_alignment = phys_device.getProperties().limits.minUniformBufferOffsetAlignment;
+	add_block(size);
+}
+
+void VulkanFrameAllocator::destroy() {
+	destroy_blocks();
+}
+
+void VulkanFrameAllocator::add_block(vk::DeviceSize size) {
+	size = (size + BLOCK_GRANULARITY - 1) / BLOCK_GRANULARITY * BLOCK_GRANULARITY;
+	Block block {.size = size};
+	block.buffer = device.createBuffer({
+		.size = size,
+		.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer
+			| vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eUniformBuffer
+			| vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+		.sharingMode = vk::SharingMode::eExclusive
+	});
+	// device local host visible memory (resizable bar) saves the gpu from reading it over pcie every draw
+	block.allocation = allocator->alloc_buffer(
+		block.buffer,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		vk::MemoryPropertyFlagBits::eDeviceLocal);
+	blocks.push_back(block);
+}
+
+void VulkanFrameAllocator::destroy_blocks() {
+	for (auto& block : blocks) {
+		device.destroy(block.buffer);
+		allocator->free(block.allocation);
+	}
+	blocks.clear();
+}
+
+vk::DeviceSize VulkanFrameAllocator::capacity() const {
+	vk::DeviceSize total = 0;
+	for (const auto& block : blocks) {
+		total += block.size;
+	}
+	return total;
+}
+
+void VulkanFrameAllocator::reset() {
+	// the frame overflowed, one block fitting all of it keeps the next frames on the fast path
+	if (blocks.size() > 1) {
+		PROFILE_ZONE("VulkanFrameAllocator::grow");
+		auto size = capacity();
+		destroy_blocks();
+		add_block(size);
+	}
+	offset = 0;
+	used_before = 0;
+}
+
+VulkanFrameAllocator::Range VulkanFrameAllocator::alloc(vk::DeviceSize size, vk::DeviceSize alignment) {
+	auto start = (offset + alignment - 1) / alignment * alignment;
+	if (start + size > blocks.back().size) {
+		// earlier ranges may still be written this frame, so the full block stays and a new one follows it
+		used_before += offset;
+		add_block(std::max(size, blocks.back().size * 2));
+		start = 0;
+	}
+	offset = start + size;
+
+	const auto& block = blocks.back();
+	return {
+		.buffer = block.buffer,
+		.offset = start,
+		.mapped = block.allocation.mapped + start
+	};
+}
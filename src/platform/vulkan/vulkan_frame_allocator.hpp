@@ -0,0 +1,53 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "vulkan_allocator.hpp"
+#include <vector>
+
+/// Bump allocator over persistently mapped host visible buffers, one per frame slot, for data written once
+/// per frame such as uniforms, instance data, indirect commands and upload staging. Freeing is resetting
+/// the offset after the slot's fence was waited on. Running out chains another buffer instead of waiting,
+/// the next reset replaces the chain with one buffer large enough for the whole frame.
+class VulkanFrameAllocator {
+public:
+	struct Range {
+		vk::Buffer buffer;
+		vk::DeviceSize offset;
+		/// already offset, write combined memory, only write it front to back and never read it
+		u8* mapped;
+	};
+
+	void init(vk::Device device, vk::PhysicalDevice phys_device, VulkanAllocator* allocator, vk::DeviceSize size);
+	void destroy();
+
+	/// The gpu has to be done with everything allocated since the last reset.
+	void reset();
+	Range alloc(vk::DeviceSize size, vk::DeviceSize alignment);
+	Range alloc_uniform(vk::DeviceSize size) {
+		return alloc(size, uniform_alignment);
+	}
+
+	/// Bytes allocated since the last reset.
+	[[nodiscard]] vk::DeviceSize used() const {
+		return used_before + offset;
+	}
+	[[nodiscard]] vk::DeviceSize capacity() const;
+private:
+	struct Block {
+		vk::Buffer buffer;
+		VulkanAllocation allocation;
+		vk::DeviceSize size;
+	};
+
+	void add_block(vk::DeviceSize size);
+	void destroy_blocks();
+
+	vk::Device device;
+	VulkanAllocator* allocator {};
+	vk::DeviceSize uniform_alignment {};
+	/// only the last block is allocated from, earlier ones are full
+	std::vector<Block> blocks {};
+	vk::DeviceSize offset {};
+	/// bytes used in the full blocks
+	vk::DeviceSize used_before {};
+};
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "vulkan_geometry_arena.hpp"
+
+void VulkanGeometryArena::init(vk::Device new_device, VulkanAllocator* new_allocator, vk::DeviceSize vertex_bytes, vk::DeviceSize index_bytes) {
+	device = new_device;
+	allocator = new_allocator;
+
+	vk::BufferCreateInfo buffer_info {
+		.size = vertex_bytes,
+		.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		.sharingMode = vk::SharingMode::eExclusive
+	};
+	vertex_buffer = device.createBuffer(buffer_info);
+
+	buffer_info.size = index_bytes;
+	buffer_info.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	index_buffer = device.createBuffer(buffer_info);
+
+	vertex_allocation = allocator->alloc_buffer(vertex_buffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	index_allocation = allocator->alloc_buffer(index_buffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	vertex_tlsf = Tlsf {vertex_bytes};
+	index_tlsf = Tlsf {index_bytes};
+}
+
+void VulkanGeometryArena::destroy() {
+	device.destroy(vertex_buffer);
+	device.destroy(index_buffer);
+	allocator->free(vertex_allocation);
+	allocator->free(index_allocation);
+}
+
+std::optional<VulkanGeometryArena::Range> VulkanGeometryArena::alloc_vertices(u32 count, u32 vertex_size) {
+	// vertex offsets count whole vertices, so ranges start on a multiple of the vertex size
+	auto allocation = vertex_tlsf.alloc(as<u64>(count) * vertex_size, vertex_size);
+	if (!allocation) {
+		return std::nullopt;
+	}
+	return Range {as<u32>(allocation->offset / vertex_size), allocation->node};
+}
+
+std::optional<VulkanGeometryArena::Range> VulkanGeometryArena::alloc_indices(u32 count, u32 index_size) {
+	auto allocation = index_tlsf.alloc(as<u64>(count) * index_size);
+	if (!allocation) {
+		return std::nullopt;
+	}
+	return Range {as<u32>(allocation->offset / index_size), allocation->node};
+}
+
+void VulkanGeometryArena::free_vertices(const Range& range) {
+	vertex_tlsf.free(range.node);
+}
+
+void VulkanGeometryArena::free_indices(const Range& range) {
+	index_tlsf.free(range.node);
+}
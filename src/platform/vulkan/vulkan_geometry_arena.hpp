@@ -0,0 +1,42 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "vulkan_allocator.hpp"
+#include "memory/tlsf.hpp"
+#include <optional>
+
+/// Vertices and indices of every mesh sub-allocated from one vertex and one index buffer, so draws of
+/// different meshes need no rebinding and can share a multi draw indirect call. 16 and 32 bit indices
+/// live in the same buffer, which is bound once per index type.
+class VulkanGeometryArena {
+public:
+	struct Range {
+		/// in elements, usable directly as vertex offset or first index
+		u32 first;
+		u32 node;
+	};
+
+	void init(vk::Device device, VulkanAllocator* allocator, vk::DeviceSize vertex_bytes, vk::DeviceSize index_bytes);
+	void destroy();
+
+	/// Return nothing when the arena is full.
+	std::optional<Range> alloc_vertices(u32 count, u32 vertex_size);
+	std::optional<Range> alloc_indices(u32 count, u32 index_size);
+	void free_vertices(const Range& range);
+	void free_indices(const Range& range);
+
+	/// Byte offset of a range for uploads.
+	[[nodiscard]] static vk::DeviceSize byte_offset(const Range& range, u32 element_size) {
+		return as<vk::DeviceSize>(range.first) * element_size;
+	}
+
+	vk::Buffer vertex_buffer;
+	vk::Buffer index_buffer;
+private:
+	vk::Device device;
+	VulkanAllocator* allocator {};
+	VulkanAllocation vertex_allocation;
+	VulkanAllocation index_allocation;
+	Tlsf vertex_tlsf {};
+	Tlsf index_tlsf {};
+};
\ No newline at end of file
@@ -0,0 +1,435 @@
+#include "vulkan_gpu_culling.hpp"
+#include "vulkan_shader.hpp"
+#include "culling/frustum.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+constexpr u32 CULL_GROUP_SIZE = 64;
+constexpr u32 PYRAMID_GROUP_SIZE = 8;
+
+struct PyramidPushConstants {
+	i32 source_width;
+	i32 source_height;
+	i32 width;
+	i32 height;
+};
+
+void VulkanGpuCulling::init(vk::Device new_device, VulkanAllocator* new_allocator, u32 max_objects) {
+	device = new_device;
+	allocator = new_allocator;
+	capacity = max_objects;
+
+	object_storage = create_buffer(
+		as<vk::DeviceSize>(capacity) * sizeof(GpuObject),
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eDeviceLocal);
+	instance_storage = create_buffer(
+		as<vk::DeviceSize>(capacity) * sizeof(InstanceData),
+		vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eDeviceLocal);
+	command_storage = create_buffer(
+		2 * as<vk::DeviceSize>(capacity) * sizeof(vk::DrawIndexedIndirectCommand),
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal);
+	count_storage = create_buffer(
+		2 * sizeof(u32),
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer
+			| vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	sampler = device.createSampler({
+		.magFilter = vk::Filter::eNearest,
+		.minFilter = vk::Filter::eNearest,
+		.mipmapMode = vk::SamplerMipmapMode::eNearest,
+		.addressModeU = vk::SamplerAddressMode::eClampToEdge,
+		.addressModeV = vk::SamplerAddressMode::eClampToEdge,
+		.addressModeW = vk::SamplerAddressMode::eClampToEdge,
+		.maxLod = VK_LOD_CLAMP_NONE
+	});
+
+	// descriptors are pushed with the commands, so no pools or sets have to be kept per frame
+	const vk::DescriptorSetLayoutBinding cull_bindings[] {
+		{0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+		{1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+		{2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+		{3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute},
+		{4, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute}
+	};
+	cull_set_layout = device.createDescriptorSetLayout({
+		.flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR,
+		.bindingCount = sizeof(cull_bindings) / sizeof(*cull_bindings),
+		.pBindings = cull_bindings
+	});
+	cull_layout = device.createPipelineLayout({
+		.setLayoutCount = 1,
+		.pSetLayouts = &cull_set_layout
+	});
+
+	const vk::DescriptorSetLayoutBinding pyramid_bindings[] {
+		{0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute},
+		{1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute}
+	};
+	pyramid_set_layout = device.createDescriptorSetLayout({
+		.flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR,
+		.bindingCount = sizeof(pyramid_bindings) / sizeof(*pyramid_bindings),
+		.pBindings = pyramid_bindings
+	});
+	vk::PushConstantRange push_constant_range {
+		.stageFlags = vk::ShaderStageFlagBits::eCompute,
+		.offset = 0,
+		.size = sizeof(PyramidPushConstants)
+	};
+	pyramid_layout = device.createPipelineLayout({
+		.setLayoutCount = 1,
+		.pSetLayouts = &pyramid_set_layout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &push_constant_range
+	});
+}
+
+static vk::Pipeline create_compute_pipeline(
+		vk::Device device,
+		vk::PipelineCache cache,
+		vk::PipelineLayout layout,
+		const char* path) {
+	auto module = load_shader_module(device, path);
+	auto result = device.createComputePipeline(cache, {
+		.stage {
+			.stage = vk::ShaderStageFlagBits::eCompute,
+			.module = module,
+			.pName = "main"
+		},
+		.layout = layout
+	});
+	device.destroy(module);
+	if (result.result != vk::Result::eSuccess) {
+		throw std::runtime_error(std::string {"vulkan: failed to create compute pipeline for '"} + path + "'");
+	}
+	return result.value;
+}
+
+void VulkanGpuCulling::create_pipelines(vk::PipelineCache cache) {
+	PROFILE_ZONE("gpu culling pipelines");
+	cull_pipeline = create_compute_pipeline(device, cache, cull_layout, GAME_SHADER_DIR "/cull.comp.spv");
+	pyramid_pipeline = create_compute_pipeline(device, cache, pyramid_layout, GAME_SHADER_DIR "/depth_pyramid.comp.spv");
+}
+
+void VulkanGpuCulling::destroy() {
+	destroy_buffer(object_storage);
+	destroy_buffer(instance_storage);
+	destroy_buffer(command_storage);
+	destroy_buffer(count_storage);
+
+	device.destroy(sampler);
+	device.destroy(cull_pipeline);
+	device.destroy(cull_layout);
+	device.destroy(cull_set_layout);
+	device.destroy(pyramid_pipeline);
+	device.destroy(pyramid_layout);
+	device.destroy(pyramid_set_layout);
+}
+
+VulkanGpuCulling::Buffer VulkanGpuCulling::create_buffer(
+		vk::DeviceSize size,
+		vk::BufferUsageFlags usage,
+		vk::MemoryPropertyFlags required) {
+	Buffer buffer {};
+	buffer.buffer = device.createBuffer({
+		.size = size,
+		.usage = usage,
+		.sharingMode = vk::SharingMode::eExclusive
+	});
+	buffer.allocation = allocator->alloc_buffer(buffer.buffer, required);
+	return buffer;
+}
+
+void VulkanGpuCulling::destroy_buffer(Buffer& buffer) {
+	if (buffer.buffer) {
+		device.destroy(buffer.buffer);
+		allocator->free(buffer.allocation);
+	}
+	buffer = {};
+}
+
+u32 VulkanGpuCulling::add(const GpuMesh& mesh, const Mat4& model) {
+	u32 object;
+	if (!free_objects.empty()) {
+		object = free_objects.back();
+		free_objects.pop_back();
+	}
+	else {
+		if (objects.size() == capacity) {
+			throw std::runtime_error("vulkan: too many gpu culled objects");
+		}
+		object = as<u32>(objects.size());
+		objects.emplace_back();
+		instances.emplace_back();
+		mesh_bounds.emplace_back();
+		is_dirty.push_back(false);
+	}
+
+	// lod selection isn't done yet, the full mesh is always drawn
+	const auto& lod = mesh.lods[0];
+	objects[object].index_count = lod.index_count;
+	objects[object].first_index = mesh.indices.first + lod.index_offset;
+	objects[object].vertex_offset = as<i32>(mesh.vertices.first);
+	objects[object].wide_indices = mesh.index_type == vk::IndexType::eUint32;
+	mesh_bounds[object] = mesh.bounds;
+	// the dequantize part of the instance data comes from the mesh and stays the same on updates
+	instances[object] = mesh.instance(model);
+	update(object, model);
+	return object;
+}
+
+void VulkanGpuCulling::update(u32 object, const Mat4& model) {
+	auto bounds = transform_aabb(mesh_bounds[object], model);
+	auto center = (bounds.min + bounds.max) * 0.5f;
+	auto extent = (bounds.max - bounds.min) * 0.5f;
+	objects[object].center = {center.x, center.y, center.z, 0};
+	objects[object].extent = {extent.x, extent.y, extent.z, 0};
+	instances[object].model = model;
+
+	if (!is_dirty[object]) {
+		is_dirty[object] = true;
+		dirty.push_back(object);
+	}
+}
+
+void VulkanGpuCulling::remove(u32 object) {
+	// the slot stays in the buffer without indices, which the cull shader skips
+	objects[object].index_count = 0;
+	free_objects.push_back(object);
+	if (!is_dirty[object]) {
+		is_dirty[object] = true;
+		dirty.push_back(object);
+	}
+}
+
+vk::DeviceSize VulkanGpuCulling::upload_size() const {
+	return dirty.size() * (sizeof(GpuObject) + sizeof(InstanceData));
+}
+
+void VulkanGpuCulling::record_uploads(vk::CommandBuffer cmd, const VulkanFrameAllocator::Range& staging) {
+	if (dirty.empty()) {
+		return;
+	}
+	PROFILE_ZONE("VulkanGpuCulling::record_uploads");
+
+	// runs of neighbouring objects become one copy, the staging memory is written front to back
+	std::sort(dirty.begin(), dirty.end());
+	std::vector<vk::BufferCopy> object_copies;
+	std::vector<vk::BufferCopy> instance_copies;
+	auto instance_base = dirty.size() * sizeof(GpuObject);
+	for (usize i = 0; i < dirty.size(); ++i) {
+		auto object = dirty[i];
+		memcpy(staging.mapped + i * sizeof(GpuObject), &objects[object], sizeof(GpuObject));
+		is_dirty[object] = false;
+
+		if (i && dirty[i - 1] + 1 == object) {
+			object_copies.back().size += sizeof(GpuObject);
+			continue;
+		}
+		object_copies.push_back({
+			.srcOffset = staging.offset + i * sizeof(GpuObject),
+			.dstOffset = object * sizeof(GpuObject),
+			.size = sizeof(GpuObject)
+		});
+	}
+	for (usize i = 0; i < dirty.size(); ++i) {
+		auto object = dirty[i];
+		memcpy(staging.mapped + instance_base + i * sizeof(InstanceData), &instances[object], sizeof(InstanceData));
+
+		if (i && dirty[i - 1] + 1 == object) {
+			instance_copies.back().size += sizeof(InstanceData);
+			continue;
+		}
+		instance_copies.push_back({
+			.srcOffset = staging.offset + instance_base + i * sizeof(InstanceData),
+			.dstOffset = object * sizeof(InstanceData),
+			.size = sizeof(InstanceData)
+		});
+	}
+	dirty.clear();
+
+	cmd.copyBuffer(staging.buffer, object_storage.buffer, object_copies);
+	cmd.copyBuffer(staging.buffer, instance_storage.buffer, instance_copies);
+}
+
+void VulkanGpuCulling::record_clear_counts(vk::CommandBuffer cmd) const {
+	cmd.fillBuffer(count_storage.buffer, 0, 2 * sizeof(u32), 0);
+}
+
+void VulkanGpuCulling::record_cull(
+		vk::CommandBuffer cmd,
+		VulkanFrameAllocator& frame_allocator,
+		const Frustum& frustum,
+		const VulkanDepthPyramid& pyramid,
+		bool occlusion,
+		const Mat4& pyramid_view_projection) const {
+	CullParams params {
+		.pyramid_view_projection = pyramid_view_projection,
+		.pyramid_size {
+			as<f32>(pyramid.extent.width),
+			as<f32>(pyramid.extent.height),
+			as<f32>(pyramid.mip_views.size()),
+			0
+		},
+		.object_count = as<u32>(objects.size()),
+		.command_capacity = capacity,
+		.occlusion = occlusion
+	};
+	for (u32 i = 0; i < Frustum::PLANE_COUNT; ++i) {
+		params.planes[i] = {frustum.x[i], frustum.y[i], frustum.z[i], frustum.w[i]};
+	}
+	auto params_range = frame_allocator.alloc_uniform(sizeof(params));
+	memcpy(params_range.mapped, &params, sizeof(params));
+
+	const vk::DescriptorBufferInfo buffer_infos[] {
+		{params_range.buffer, params_range.offset, sizeof(CullParams)},
+		{object_storage.buffer, 0, VK_WHOLE_SIZE},
+		{command_storage.buffer, 0, VK_WHOLE_SIZE},
+		{count_storage.buffer, 0, VK_WHOLE_SIZE}
+	};
+	const vk::DescriptorImageInfo pyramid_info {
+		.sampler = sampler,
+		.imageView = pyramid.view,
+		.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+	};
+	const vk::WriteDescriptorSet writes[] {
+		{.dstBinding = 0, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eUniformBuffer, .pBufferInfo = &buffer_infos[0]},
+		{.dstBinding = 1, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eStorageBuffer, .pBufferInfo = &buffer_infos[1]},
+		{.dstBinding = 2, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eStorageBuffer, .pBufferInfo = &buffer_infos[2]},
+		{.dstBinding = 3, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eStorageBuffer, .pBufferInfo = &buffer_infos[3]},
+		{.dstBinding = 4, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eCombinedImageSampler, .pImageInfo = &pyramid_info}
+	};
+
+	cmd.bindPipeline(vk::PipelineBindPoint::eCompute, cull_pipeline);
+	cmd.pushDescriptorSetKHR(vk::PipelineBindPoint::eCompute, cull_layout, 0, writes);
+	cmd.dispatch((as<u32>(objects.size()) + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void VulkanGpuCulling::record_draws(vk::CommandBuffer cmd, vk::Buffer index_buffer) const {
+	constexpr vk::IndexType INDEX_TYPES[] {vk::IndexType::eUint16, vk::IndexType::eUint32};
+	for (u32 i = 0; i < 2; ++i) {
+		cmd.bindIndexBuffer(index_buffer, 0, INDEX_TYPES[i]);
+		cmd.drawIndexedIndirectCount(
+			command_storage.buffer,
+			i * as<vk::DeviceSize>(capacity) * sizeof(vk::DrawIndexedIndirectCommand),
+			count_storage.buffer,
+			i * sizeof(u32),
+			capacity,
+			sizeof(vk::DrawIndexedIndirectCommand));
+	}
+}
+
+VulkanDepthPyramid VulkanGpuCulling::create_pyramid(vk::Extent2D extent) {
+	VulkanDepthPyramid pyramid {.extent = extent};
+	// every mip halves rounding down down to 1x1
+	auto mip_count = as<u32>(std::bit_width(std::max(extent.width, extent.height)));
+
+	pyramid.image = device.createImage({
+		.imageType = vk::ImageType::e2D,
+		.format = vk::Format::eR32Sfloat,
+		.extent {extent.width, extent.height, 1},
+		.mipLevels = mip_count,
+		.arrayLayers = 1,
+		.samples = vk::SampleCountFlagBits::e1,
+		.tiling = vk::ImageTiling::eOptimal,
+		.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+		.sharingMode = vk::SharingMode::eExclusive,
+		.initialLayout = vk::ImageLayout::eUndefined
+	});
+	pyramid.allocation = allocator->alloc_image(pyramid.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	vk::ImageViewCreateInfo view_info {
+		.image = pyramid.image,
+		.viewType = vk::ImageViewType::e2D,
+		.format = vk::Format::eR32Sfloat,
+		.subresourceRange {
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = mip_count,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	pyramid.view = device.createImageView(view_info);
+
+	view_info.subresourceRange.levelCount = 1;
+	for (u32 i = 0; i < mip_count; ++i) {
+		view_info.subresourceRange.baseMipLevel = i;
+		pyramid.mip_views.push_back(device.createImageView(view_info));
+	}
+	return pyramid;
+}
+
+void VulkanGpuCulling::destroy_pyramid(VulkanDepthPyramid& pyramid) {
+	if (!pyramid.image) {
+		return;
+	}
+	for (auto view : pyramid.mip_views) {
+		device.destroy(view);
+	}
+	device.destroy(pyramid.view);
+	device.destroy(pyramid.image);
+	allocator->free(pyramid.allocation);
+	pyramid = {};
+}
+
+void VulkanGpuCulling::record_pyramid(vk::CommandBuffer cmd, vk::ImageView depth_view, const VulkanDepthPyramid& pyramid) const {
+	cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pyramid_pipeline);
+
+	// every mip reads the one before it, the first one the depth buffer. The graph synchronizes the pyramid
+	// as a whole, the mips are only synchronized with each other here
+	const vk::MemoryBarrier mip_barrier {
+		.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+		.dstAccessMask = vk::AccessFlagBits::eShaderRead
+	};
+	auto source_extent = pyramid.extent;
+	for (u32 i = 0; i < pyramid.mip_views.size(); ++i) {
+		vk::Extent2D mip_extent {
+			std::max(pyramid.extent.width >> i, 1u),
+			std::max(pyramid.extent.height >> i, 1u)
+		};
+
+		const vk::DescriptorImageInfo source_info {
+			.sampler = sampler,
+			.imageView = i ? pyramid.mip_views[i - 1] : depth_view,
+			.imageLayout = i ? vk::ImageLayout::eGeneral : vk::ImageLayout::eShaderReadOnlyOptimal
+		};
+		const vk::DescriptorImageInfo destination_info {
+			.imageView = pyramid.mip_views[i],
+			.imageLayout = vk::ImageLayout::eGeneral
+		};
+		const vk::WriteDescriptorSet writes[] {
+			{.dstBinding = 0, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eCombinedImageSampler, .pImageInfo = &source_info},
+			{.dstBinding = 1, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eStorageImage, .pImageInfo = &destination_info}
+		};
+		cmd.pushDescriptorSetKHR(vk::PipelineBindPoint::eCompute, pyramid_layout, 0, writes);
+
+		PyramidPushConstants constants {
+			.source_width = as<i32>(source_extent.width),
+			.source_height = as<i32>(source_extent.height),
+			.width = as<i32>(mip_extent.width),
+			.height = as<i32>(mip_extent.height)
+		};
+		cmd.pushConstants(pyramid_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+		cmd.dispatch(
+			(mip_extent.width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+			(mip_extent.height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+			1);
+
+		if (i + 1 < pyramid.mip_views.size()) {
+			cmd.pipelineBarrier(
+				vk::PipelineStageFlagBits::eComputeShader,
+				vk::PipelineStageFlagBits::eComputeShader,
+				{},
+				{mip_barrier},
+				{},
+				{});
+		}
+		source_extent = mip_extent;
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "vulkan_allocator.hpp"
+#include "vulkan_frame_allocator.hpp"
+#include "mesh/gpu_mesh.hpp"
+#include "math/mat.hpp"
+#include <vector>
+
+struct Frustum;
+
+/// Mip chain of the depth buffer where every texel holds the farthest depth of the texels it covers,
+/// so one texel fetch tells whether anything behind a depth can be visible in that area.
+struct VulkanDepthPyramid {
+	vk::Image image;
+	VulkanAllocation allocation;
+	/// one per mip for writing it
+	std::vector<vk::ImageView> mip_views {};
+	/// every mip, for sampling
+	vk::ImageView view;
+	vk::Extent2D extent {};
+};
+
+/// Objects whose bounds, draw parameters and instance data live in gpu buffers. Every frame a compute pass
+/// culls them against the frustum and last frame's depth pyramid and writes compacted indirect draws with
+/// a draw count, so the cpu does no per object work for objects that don't change.
+/// Nothing is synchronized here, the record functions are render graph passes using the exposed buffers.
+class VulkanGpuCulling {
+public:
+	void init(vk::Device device, VulkanAllocator* allocator, u32 max_objects);
+	void create_pipelines(vk::PipelineCache cache);
+	void destroy();
+
+	/// Objects reference the mesh's arena ranges, they have to be removed before the mesh is destroyed.
+	u32 add(const GpuMesh& mesh, const Mat4& model);
+	void update(u32 object, const Mat4& model);
+	void remove(u32 object);
+	[[nodiscard]] bool empty() const {
+		return objects.size() == free_objects.size();
+	}
+
+	/// Staging bytes needed by the next record_uploads.
+	[[nodiscard]] vk::DeviceSize upload_size() const;
+	/// Copies the objects changed since the last call through staging of upload_size bytes into the object
+	/// and instance buffers.
+	void record_uploads(vk::CommandBuffer cmd, const VulkanFrameAllocator::Range& staging);
+	/// Resets the draw counts, has to come before every cull.
+	void record_clear_counts(vk::CommandBuffer cmd) const;
+	/// Writes the draws of the visible objects. Occlusion is only tested if the pyramid holds a previous
+	/// frame's depth, its view projection is the one that frame was rendered with.
+	/// The pyramid is sampled in shader read only layout, the params come from the frame's allocator.
+	void record_cull(
+			vk::CommandBuffer cmd,
+			VulkanFrameAllocator& frame_allocator,
+			const Frustum& frustum,
+			const VulkanDepthPyramid& pyramid,
+			bool occlusion,
+			const Mat4& pyramid_view_projection) const;
+	/// Draws the culled objects, rendering has to be begun with the instanced mesh pipeline and vertex buffer bound.
+	void record_draws(vk::CommandBuffer cmd, vk::Buffer index_buffer) const;
+
+	VulkanDepthPyramid create_pyramid(vk::Extent2D extent);
+	void destroy_pyramid(VulkanDepthPyramid& pyramid);
+	/// Reduces the depth buffer, in shader read only layout, into the pyramid which has to be in general layout.
+	void record_pyramid(vk::CommandBuffer cmd, vk::ImageView depth_view, const VulkanDepthPyramid& pyramid) const;
+
+	[[nodiscard]] vk::Buffer object_buffer() const {
+		return object_storage.buffer;
+	}
+	/// Per instance data indexed by object, bound as the instanced vertex buffer.
+	[[nodiscard]] vk::Buffer instance_buffer() const {
+		return instance_storage.buffer;
+	}
+	[[nodiscard]] vk::Buffer command_buffer() const {
+		return command_storage.buffer;
+	}
+	[[nodiscard]] vk::Buffer count_buffer() const {
+		return count_storage.buffer;
+	}
+private:
+	/// matches Object in cull.comp
+	struct GpuObject {
+		Vec4<f32> center;
+		Vec4<f32> extent;
+		u32 index_count;
+		u32 first_index;
+		i32 vertex_offset;
+		u32 wide_indices;
+	};
+
+	/// matches Params in cull.comp
+	struct CullParams {
+		Vec4<f32> planes[6];
+		Mat4 pyramid_view_projection;
+		Vec4<f32> pyramid_size;
+		u32 object_count;
+		u32 command_capacity;
+		u32 occlusion;
+		u32 padding;
+	};
+
+	struct Buffer {
+		vk::Buffer buffer;
+		VulkanAllocation allocation;
+	};
+
+	Buffer create_buffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags required);
+	void destroy_buffer(Buffer& buffer);
+
+	vk::Device device;
+	VulkanAllocator* allocator {};
+	u32 capacity {};
+
+	std::vector<GpuObject> objects {};
+	std::vector<InstanceData> instances {};
+	/// mesh space bounds, transformed again whenever the model matrix changes
+	std::vector<Aabb> mesh_bounds {};
+	std::vector<u32> free_objects {};
+	/// objects changed since the last upload, each at most once
+	std::vector<u32> dirty {};
+	std::vector<bool> is_dirty {};
+
+	Buffer object_storage {};
+	Buffer instance_storage {};
+	/// capacity commands per index type, 16 bit first
+	Buffer command_storage {};
+	/// draw count per index type
+	Buffer count_storage {};
+
+	vk::Sampler sampler;
+	vk::DescriptorSetLayout cull_set_layout;
+	vk::PipelineLayout cull_layout;
+	vk::Pipeline cull_pipeline;
+	vk::DescriptorSetLayout pyramid_set_layout;
+	vk::PipelineLayout pyramid_layout;
+	vk::Pipeline pyramid_pipeline;
+};
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "vulkan_pipeline_cache.hpp"
+#include "logger.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+constexpr u32 CACHE_MAGIC = 0x50434B56;
+constexpr u32 CACHE_VERSION = 1;
+
+/// fnv-1a, only guards against truncated or corrupted files, drivers are known to crash on bad cache data
+static u64 hash_bytes(const u8* data, usize size) {
+	u64 hash = 0xCBF29CE484222325;
+	for (usize i = 0; i < size; ++i) {
+		hash = (hash ^ data[i]) * 0x100000001B3;
+	}
+	return hash;
+}
+
+VulkanPipelineCache::Header VulkanPipelineCache::make_header() const {
+	Header header {
+		.magic = CACHE_MAGIC,
+		.version = CACHE_VERSION,
+		.vendor_id = properties.vendorID,
+		.device_id = properties.deviceID,
+		.driver_version = properties.driverVersion
+	};
+	memcpy(header.uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+	return header;
+}
+
+void VulkanPipelineCache::init(vk::Device new_device, vk::PhysicalDevice phys_device, std::string new_path, Logger* new_logger) {
+	device = new_device;
+	properties = phys_device.getProperties();
+	path = std::move(new_path);
+	logger = new_logger;
+
+	std::vector<u8> data;
+	if (!path.empty()) {
+		std::ifstream file {path, std::ios::binary};
+		Header header {};
+		if (file.read(cast<char*>(&header), sizeof(header))) {
+			auto expected = make_header();
+			if (header.magic != expected.magic || header.version != expected.version
+				|| header.vendor_id != expected.vendor_id || header.device_id != expected.device_id
+				|| header.driver_version != expected.driver_version
+				|| memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) != 0) {
+				logger->info("vulkan", "pipeline cache '{}' is from another device or driver, starting cold", path);
+			}
+			else {
+				// the size is checked against the file before allocating, a corrupted header could ask for anything
+				std::error_code error;
+				auto file_size = std::filesystem::file_size(path, error);
+				bool valid = !error && header.data_size == file_size - sizeof(header);
+				if (valid) {
+					data.resize(header.data_size);
+					valid = file.read(cast<char*>(data.data()), as<std::streamsize>(data.size()))
+						&& hash_bytes(data.data(), data.size()) == header.data_hash;
+				}
+				if (!valid) {
+					logger->warn("vulkan", "pipeline cache '{}' is corrupted, starting cold", path);
+					data.clear();
+				}
+			}
+		}
+	}
+
+	cache = device.createPipelineCache({
+		.initialDataSize = data.size(),
+		.pInitialData = data.data()
+	});
+	loaded = data.size();
+}
+
+void VulkanPipelineCache::destroy() {
+	if (!path.empty()) {
+		auto data = device.getPipelineCacheData(cache);
+		auto header = make_header();
+		header.data_size = data.size();
+		header.data_hash = hash_bytes(data.data(), data.size());
+
+		// written next to the old file and renamed over it so a crash never leaves a partial cache behind
+		auto tmp_path = path + ".tmp";
+		bool written;
+		{
+			std::ofstream file {tmp_path, std::ios::binary | std::ios::trunc};
+			file.write(cast<const char*>(&header), sizeof(header));
+			file.write(cast<const char*>(data.data()), as<std::streamsize>(data.size()));
+			written = file.good();
+		}
+
+		std::error_code error;
+		if (written) {
+			std::filesystem::rename(tmp_path, path, error);
+		}
+		if (!written || error) {
+			logger->warn("vulkan", "failed to write pipeline cache '{}'", path);
+		}
+	}
+
+	device.destroy(cache);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include <string>
+
+class Logger;
+
+/// Pipeline cache persisted to a file between runs. The file is only loaded if it was written on the same
+/// device with the same driver version, anything else starts with an empty cache that replaces it on destroy.
+class VulkanPipelineCache {
+public:
+	/// An empty path keeps the cache in memory only.
+	void init(vk::Device device, vk::PhysicalDevice phys_device, std::string path, Logger* logger);
+	/// Writes the cache back to its file and destroys it, pipelines created with it have to be destroyed first.
+	void destroy();
+
+	[[nodiscard]] vk::PipelineCache get() const {
+		return cache;
+	}
+	/// Bytes loaded from the file, 0 on a cold start.
+	[[nodiscard]] usize loaded_size() const {
+		return loaded;
+	}
+private:
+	struct Header {
+		u32 magic;
+		u32 version;
+		u32 vendor_id;
+		u32 device_id;
+		u32 driver_version;
+		u8 uuid[VK_UUID_SIZE];
+		u64 data_size;
+		u64 data_hash;
+	};
+
+	[[nodiscard]] Header make_header() const;
+
+	vk::Device device;
+	vk::PhysicalDeviceProperties properties;
+	vk::PipelineCache cache;
+	std::string path {};
+	Logger* logger {};
+	usize loaded {};
+};
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "vulkan_profiler.hpp"
+#include "logger.hpp"
+
+void VulkanGpuProfiler::init(vk::Device new_device, vk::PhysicalDevice phys_device, u32 queue_family, u32 frame_count, Logger* logger) {
+	device = new_device;
+	frames.resize(frame_count);
+	results.resize(MAX_ZONES * 2);
+
+	if (!phys_device.getQueueFamilyProperties()[queue_family].timestampValidBits) {
+		logger->log("vulkan", "queue doesn't support timestamps, gpu zones are unavailable", LogLevel::Warn);
+		return;
+	}
+
+	period = phys_device.getProperties().limits.timestampPeriod;
+	pool = device.createQueryPool({
+		.queryType = vk::QueryType::eTimestamp,
+		.queryCount = MAX_ZONES * 2 * frame_count
+	});
+
+	if constexpr (PROFILER_ENABLED) {
+		track = profile_create_buffer("gpu");
+	}
+}
+
+void VulkanGpuProfiler::destroy() {
+	device.destroy(pool);
+}
+
+void VulkanGpuProfiler::begin_frame(vk::CommandBuffer cmd, u32 frame) {
+	current = frame;
+	if (!pool) {
+		return;
+	}
+
+	if (frames[frame].pending) {
+		read_back(frame);
+	}
+	frames[frame].zones.clear();
+
+	cmd.resetQueryPool(pool, frame * MAX_ZONES * 2, MAX_ZONES * 2);
+	// zone 0 always spans the whole frame
+	begin_zone(cmd, "frame");
+}
+
+void VulkanGpuProfiler::end_frame(vk::CommandBuffer cmd) {
+	if (pool) {
+		end_zone(cmd, 0);
+	}
+}
+
+void VulkanGpuProfiler::submitted() {
+	auto& frame = frames[current];
+	frame.submit_time = profile_now();
+	frame.pending = pool && !frame.zones.empty();
+}
+
+u32 VulkanGpuProfiler::begin_zone(vk::CommandBuffer cmd, const char* name) {
+	auto& zones = frames[current].zones;
+	if (!pool || zones.size() == MAX_ZONES) {
+		return INVALID_ZONE;
+	}
+
+	auto zone = as<u32>(zones.size());
+	zones.push_back({name});
+	cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, pool, (current * MAX_ZONES + zone) * 2);
+	return zone;
+}
+
+void VulkanGpuProfiler::end_zone(vk::CommandBuffer cmd, u32 zone) {
+	if (zone == INVALID_ZONE) {
+		return;
+	}
+	cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, pool, (current * MAX_ZONES + zone) * 2 + 1);
+}
+
+void VulkanGpuProfiler::read_back(u32 frame) {
+	auto& data = frames[frame];
+	data.pending = false;
+
+	auto query_count = as<u32>(data.zones.size() * 2);
+	auto result = device.getQueryPoolResults(
+		pool,
+		frame * MAX_ZONES * 2,
+		query_count,
+		query_count * sizeof(u64),
+		results.data(),
+		sizeof(u64),
+		vk::QueryResultFlagBits::e64);
+	if (result != vk::Result::eSuccess) {
+		return;
+	}
+
+	auto to_ns = [&](u64 ticks) {
+		return as<u64>(as<f64>(ticks) * period);
+	};
+
+	frame_ms = as<f64>(to_ns(results[1] - results[0])) / 1000000.0;
+
+	if (track) {
+		// gpu and cpu clocks aren't calibrated, the frame is placed as if it started at its submit
+		auto frame_start = results[0];
+		for (usize i = 0; i < data.zones.size(); ++i) {
+			track->push({
+				.name = data.zones[i].name,
+				.start = data.submit_time + to_ns(results[i * 2] - frame_start),
+				.end = data.submit_time + to_ns(results[i * 2 + 1] - frame_start)
+			});
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "profiler/profiler.hpp"
+#include <vector>
+
+class Logger;
+
+/// Gpu zones measured with timestamp queries. Every frame slot owns a range of queries which is read back
+/// the next time the slot begins, after its fence was waited on, so results arrive with a frame of latency.
+/// Zones may only be recorded into the primary command buffer of the current frame.
+class VulkanGpuProfiler {
+public:
+	void init(vk::Device device, vk::PhysicalDevice phys_device, u32 queue_family, u32 frame_count, Logger* logger);
+	void destroy();
+
+	/// Reads back the slot's previous frame and begins the frame zone, the slot's fence has to be signaled.
+	void begin_frame(vk::CommandBuffer cmd, u32 frame);
+	/// Ends the frame zone, call before ending the command buffer.
+	void end_frame(vk::CommandBuffer cmd);
+	/// Call right after submitting, gpu zones are placed on the trace relative to this time.
+	void submitted();
+
+	/// Returns a zone index to pass to end_zone, zones past MAX_ZONES or without timestamp support are ignored.
+	u32 begin_zone(vk::CommandBuffer cmd, const char* name);
+	void end_zone(vk::CommandBuffer cmd, u32 zone);
+
+	/// Milliseconds of the most recently read back frame, 0 without timestamp support.
+	[[nodiscard]] f64 frame_time() const {
+		return frame_ms;
+	}
+
+	constexpr static u32 MAX_ZONES = 64;
+	constexpr static u32 INVALID_ZONE = UINT32_MAX;
+private:
+	struct Zone {
+		const char* name;
+	};
+
+	struct Frame {
+		std::vector<Zone> zones {};
+		u64 submit_time {};
+		bool pending {};
+	};
+
+	void read_back(u32 frame);
+
+	vk::Device device;
+	vk::QueryPool pool;
+	f64 period {};
+	std::vector<Frame> frames {};
+	std::vector<u64> results {};
+	u32 current {};
+	f64 frame_ms {};
+	ProfileBuffer* track {};
+};
+
+class VulkanGpuZone {
+public:
+	VulkanGpuZone(VulkanGpuProfiler& profiler, vk::CommandBuffer cmd, const char* name)
+		: profiler {profiler}, cmd {cmd}, zone {profiler.begin_zone(cmd, name)} {}
+	~VulkanGpuZone() {
+		profiler.end_zone(cmd, zone);
+	}
+	VulkanGpuZone(const VulkanGpuZone&) = delete;
+	VulkanGpuZone& operator=(const VulkanGpuZone&) = delete;
+private:
+	VulkanGpuProfiler& profiler;
+	vk::CommandBuffer cmd;
+	u32 zone;
+};
+
+#ifdef GAME_PROFILER
+#define PROFILE_GPU_ZONE(profiler, cmd, name) VulkanGpuZone PROFILE_CONCAT(gpu_zone_, __LINE__) {profiler, cmd, name}
+#else
+#define PROFILE_GPU_ZONE(profiler, cmd, name) ((void) 0)
+#endif
\ No newline at end of file
@@ -0,0 +1,554 @@
+#include "vulkan_render_graph.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+#include <numeric>
+
+struct UsageInfo {
+	vk::PipelineStageFlags stages;
+	vk::AccessFlags access;
+	/// ignored for buffers
+	vk::ImageLayout layout;
+	vk::ImageUsageFlags image_usage;
+	bool write;
+};
+
+/// indexed by RenderGraphUsage
+static const UsageInfo USAGES[] {
+	{
+		vk::PipelineStageFlagBits::eColorAttachmentOutput,
+		vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+		vk::ImageLayout::eColorAttachmentOptimal,
+		vk::ImageUsageFlagBits::eColorAttachment,
+		true
+	},
+	{
+		vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+		vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+		vk::ImageLayout::eDepthAttachmentOptimal,
+		vk::ImageUsageFlagBits::eDepthStencilAttachment,
+		true
+	},
+	{
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::AccessFlagBits::eShaderRead,
+		vk::ImageLayout::eShaderReadOnlyOptimal,
+		vk::ImageUsageFlagBits::eSampled,
+		false
+	},
+	{
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::AccessFlagBits::eShaderRead,
+		vk::ImageLayout::eGeneral,
+		vk::ImageUsageFlagBits::eStorage,
+		false
+	},
+	{
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+		vk::ImageLayout::eGeneral,
+		vk::ImageUsageFlagBits::eStorage,
+		true
+	},
+	{
+		vk::PipelineStageFlagBits::eVertexInput,
+		vk::AccessFlagBits::eVertexAttributeRead,
+		vk::ImageLayout::eUndefined,
+		{},
+		false
+	},
+	{
+		vk::PipelineStageFlagBits::eDrawIndirect,
+		vk::AccessFlagBits::eIndirectCommandRead,
+		vk::ImageLayout::eUndefined,
+		{},
+		false
+	},
+	{
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::AccessFlagBits::eTransferRead,
+		vk::ImageLayout::eTransferSrcOptimal,
+		vk::ImageUsageFlagBits::eTransferSrc,
+		false
+	},
+	{
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::AccessFlagBits::eTransferWrite,
+		vk::ImageLayout::eTransferDstOptimal,
+		vk::ImageUsageFlagBits::eTransferDst,
+		true
+	}
+};
+
+/// only writes have to be made available, reads never conflict with each other
+static const vk::AccessFlags WRITE_ACCESS = vk::AccessFlagBits::eColorAttachmentWrite
+	| vk::AccessFlagBits::eDepthStencilAttachmentWrite
+	| vk::AccessFlagBits::eShaderWrite
+	| vk::AccessFlagBits::eTransferWrite;
+
+template<typename T>
+static u64 handle_key(T handle) {
+	return cast<u64>(static_cast<typename T::CType>(handle));
+}
+
+void VulkanRenderGraph::init(vk::Device new_device, VulkanAllocator* new_allocator, u32 new_frame_count) {
+	device = new_device;
+	allocator = new_allocator;
+	frame_count = new_frame_count;
+}
+
+void VulkanRenderGraph::destroy() {
+	destroy_transients(transients, slots);
+	for (auto& r : retired) {
+		destroy_transients(r.transients, r.slots);
+	}
+	retired.clear();
+	transient_keys.clear();
+}
+
+void VulkanRenderGraph::destroy_transients(std::vector<Transient>& list, std::vector<Slot>& slot_list) {
+	for (auto& transient : list) {
+		device.destroy(transient.view);
+		device.destroy(transient.image);
+	}
+	for (auto& slot : slot_list) {
+		allocator->free(slot.allocation);
+	}
+	list.clear();
+	slot_list.clear();
+}
+
+bool VulkanRenderGraph::is_write(RenderGraphUsage usage) {
+	return USAGES[as<u32>(usage)].write;
+}
+
+RenderGraphResource VulkanRenderGraph::add_resource(const Resource& resource) {
+	resources.push_back(resource);
+	return {as<u32>(resources.size() - 1)};
+}
+
+RenderGraphResource VulkanRenderGraph::create_image(
+		const char* name,
+		vk::Format format,
+		vk::Extent2D extent,
+		vk::ImageAspectFlags aspect) {
+	return add_resource({
+		.name = name,
+		.desc {
+			.format = format,
+			.extent = extent,
+			.aspect = aspect
+		}
+	});
+}
+
+RenderGraphResource VulkanRenderGraph::import_image(
+		vk::Image image,
+		vk::ImageView view,
+		vk::ImageAspectFlags aspect,
+		std::optional<VulkanAccess> initial,
+		vk::ImageLayout final_layout) {
+	Resource resource {
+		.name = "imported image",
+		.image = image,
+		.view = view,
+		.desc {.aspect = aspect},
+		.imported = true,
+		.persistent = !initial,
+		.final_layout = final_layout
+	};
+	if (initial) {
+		resource.state = {
+			.write_stages = initial->stages,
+			.write_access = initial->access,
+			.layout = initial->layout
+		};
+	}
+	else if (auto it = remembered.find(handle_key(image)); it != remembered.end()) {
+		resource.state = it->second;
+	}
+	return add_resource(resource);
+}
+
+RenderGraphResource VulkanRenderGraph::import_buffer(vk::Buffer buffer) {
+	Resource resource {
+		.name = "imported buffer",
+		.buffer = buffer,
+		.imported = true,
+		.persistent = true
+	};
+	if (auto it = remembered.find(handle_key(buffer)); it != remembered.end()) {
+		resource.state = it->second;
+	}
+	return add_resource(resource);
+}
+
+void VulkanRenderGraph::forget(vk::Image image) {
+	remembered.erase(handle_key(image));
+}
+
+void VulkanRenderGraph::forget(vk::Buffer buffer) {
+	remembered.erase(handle_key(buffer));
+}
+
+void VulkanRenderGraph::add_pass(
+		const char* name,
+		std::initializer_list<RenderGraphUse> pass_uses,
+		std::function<void(vk::CommandBuffer)> record) {
+	passes.push_back({
+		.name = name,
+		.first_use = as<u32>(uses.size()),
+		.use_count = as<u32>(pass_uses.size()),
+		.record = std::move(record)
+	});
+	uses.insert(uses.end(), pass_uses.begin(), pass_uses.end());
+}
+
+void VulkanRenderGraph::cull_passes() {
+	// a pass writing a resource is assumed to overwrite it, so only readers keep its writers alive
+	for (auto& pass : passes) {
+		pass.refs = 0;
+		pass.culled = false;
+		for (u32 i = pass.first_use; i < pass.first_use + pass.use_count; ++i) {
+			if (is_write(uses[i].usage)) {
+				++pass.refs;
+			}
+			else {
+				++resources[uses[i].resource.index].readers;
+			}
+		}
+	}
+
+	// imported resources are read after the frame, passes without writes are kept for their side effects
+	std::vector<u32> unused;
+	for (u32 i = 0; i < resources.size(); ++i) {
+		if (!resources[i].imported && !resources[i].readers) {
+			unused.push_back(i);
+		}
+	}
+
+	while (!unused.empty()) {
+		auto resource = unused.back();
+		unused.pop_back();
+		for (auto& pass : passes) {
+			if (pass.culled) {
+				continue;
+			}
+			for (u32 i = pass.first_use; i < pass.first_use + pass.use_count; ++i) {
+				if (uses[i].resource.index != resource || !is_write(uses[i].usage) || --pass.refs) {
+					continue;
+				}
+				pass.culled = true;
+				for (u32 j = pass.first_use; j < pass.first_use + pass.use_count; ++j) {
+					auto& read = resources[uses[j].resource.index];
+					if (!is_write(uses[j].usage) && !--read.readers && !read.imported) {
+						unused.push_back(uses[j].resource.index);
+					}
+				}
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::place_transients() {
+	for (u32 p = 0; p < passes.size(); ++p) {
+		if (passes[p].culled) {
+			continue;
+		}
+		for (u32 i = passes[p].first_use; i < passes[p].first_use + passes[p].use_count; ++i) {
+			auto& resource = resources[uses[i].resource.index];
+			if (resource.first_pass == UINT32_MAX) {
+				resource.first_pass = p;
+			}
+			resource.last_pass = p;
+			resource.desc.usage |= USAGES[as<u32>(uses[i].usage)].image_usage;
+		}
+	}
+
+	std::vector<TransientKey> keys;
+	std::vector<u32> owners;
+	for (u32 i = 0; i < resources.size(); ++i) {
+		auto& resource = resources[i];
+		if (resource.imported || resource.first_pass == UINT32_MAX) {
+			continue;
+		}
+		resource.transient = as<u32>(keys.size());
+		keys.push_back({resource.desc, resource.first_pass, resource.last_pass});
+		owners.push_back(i);
+	}
+
+	// frames usually have the same shape as the last one, then the images and their placement are kept
+	if (keys != transient_keys) {
+		PROFILE_ZONE("place transients");
+		if (!transients.empty()) {
+			retired.push_back({std::move(transients), std::move(slots), execution_count});
+			transients.clear();
+			slots.clear();
+		}
+		transient_keys = keys;
+
+		std::vector<vk::MemoryRequirements> requirements;
+		for (const auto& key : keys) {
+			auto image = device.createImage({
+				.imageType = vk::ImageType::e2D,
+				.format = key.desc.format,
+				.extent {key.desc.extent.width, key.desc.extent.height, 1},
+				.mipLevels = 1,
+				.arrayLayers = 1,
+				.samples = vk::SampleCountFlagBits::e1,
+				.tiling = vk::ImageTiling::eOptimal,
+				.usage = key.desc.usage,
+				.sharingMode = vk::SharingMode::eExclusive,
+				.initialLayout = vk::ImageLayout::eUndefined
+			});
+			transients.push_back({.image = image});
+			requirements.push_back(device.getImageMemoryRequirements(image));
+		}
+
+		// largest first, every image goes into the first slot whose images are dead during its lifetime
+		std::vector<u32> order(keys.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+			return requirements[a].size > requirements[b].size;
+		});
+
+		std::vector<vk::MemoryRequirements> slot_requirements;
+		std::vector<std::vector<u32>> slot_members;
+		for (auto index : order) {
+			const auto& key = keys[index];
+			const auto& req = requirements[index];
+			u32 slot = 0;
+			for (; slot < slot_members.size(); ++slot) {
+				if (!(slot_requirements[slot].memoryTypeBits & req.memoryTypeBits)) {
+					continue;
+				}
+				bool overlaps = std::any_of(slot_members[slot].begin(), slot_members[slot].end(), [&](u32 other) {
+					return keys[other].first_pass <= key.last_pass && key.first_pass <= keys[other].last_pass;
+				});
+				if (!overlaps) {
+					break;
+				}
+			}
+			if (slot == slot_members.size()) {
+				slot_requirements.push_back(req);
+				slot_members.emplace_back();
+			}
+			auto& merged = slot_requirements[slot];
+			merged.size = std::max(merged.size, req.size);
+			merged.alignment = std::max(merged.alignment, req.alignment);
+			merged.memoryTypeBits &= req.memoryTypeBits;
+			slot_members[slot].push_back(index);
+			transients[index].slot = slot;
+		}
+
+		transient_memory = 0;
+		for (const auto& req : slot_requirements) {
+			slots.push_back({
+				.allocation = allocator->alloc(req, vk::MemoryPropertyFlagBits::eDeviceLocal, ResourceKind::Optimal)
+			});
+			transient_memory += req.size;
+		}
+
+		for (u32 i = 0; i < transients.size(); ++i) {
+			auto& transient = transients[i];
+			const auto& allocation = slots[transient.slot].allocation;
+			device.bindImageMemory(transient.image, allocation.memory, allocation.offset);
+			transient.view = device.createImageView({
+				.image = transient.image,
+				.viewType = vk::ImageViewType::e2D,
+				.format = keys[i].desc.format,
+				.subresourceRange {
+					.aspectMask = keys[i].desc.aspect,
+					.baseMipLevel = 0,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1
+				}
+			});
+		}
+	}
+
+	for (u32 i = 0; i < owners.size(); ++i) {
+		resources[owners[i]].image = transients[i].image;
+		resources[owners[i]].view = transients[i].view;
+	}
+}
+
+void VulkanRenderGraph::access(
+		const Resource& resource,
+		State& state,
+		RenderGraphUsage usage,
+		vk::PipelineStageFlags& src_stages,
+		vk::PipelineStageFlags& dst_stages) {
+	const auto& info = USAGES[as<u32>(usage)];
+	auto layout = resource.image ? info.layout : vk::ImageLayout::eUndefined;
+	bool transition = resource.image && layout != state.layout;
+
+	vk::PipelineStageFlags stages;
+	vk::AccessFlags access;
+	if (info.write || transition) {
+		// writing after reads only has to wait for them, the write they read was made visible already
+		if (state.read_stages) {
+			stages = state.read_stages;
+		}
+		else {
+			stages = state.write_stages;
+			access = state.write_access;
+		}
+		if (!stages && !transition) {
+			state = {info.stages, info.access & WRITE_ACCESS, {}, {}, layout};
+			return;
+		}
+	}
+	else {
+		// reads that were made visible before don't need another barrier, neither do reads of unwritten data
+		if (!(info.stages & ~state.read_stages) && !(info.access & ~state.read_access)) {
+			return;
+		}
+		if (!state.write_stages) {
+			state.read_stages |= info.stages;
+			state.read_access |= info.access;
+			return;
+		}
+		stages = state.write_stages;
+		access = state.write_access;
+	}
+
+	src_stages |= stages ? stages : vk::PipelineStageFlags {vk::PipelineStageFlagBits::eTopOfPipe};
+	dst_stages |= info.stages;
+	if (resource.image) {
+		image_barriers.push_back({
+			.srcAccessMask = access,
+			.dstAccessMask = info.access,
+			.oldLayout = state.layout,
+			.newLayout = layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = resource.image,
+			.subresourceRange {
+				.aspectMask = resource.desc.aspect,
+				.baseMipLevel = 0,
+				.levelCount = VK_REMAINING_MIP_LEVELS,
+				.baseArrayLayer = 0,
+				.layerCount = VK_REMAINING_ARRAY_LAYERS
+			}
+		});
+	}
+	else {
+		buffer_barriers.push_back({
+			.srcAccessMask = access,
+			.dstAccessMask = info.access,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = resource.buffer,
+			.offset = 0,
+			.size = VK_WHOLE_SIZE
+		});
+	}
+
+	if (info.write) {
+		state = {info.stages, info.access & WRITE_ACCESS, {}, {}, layout};
+	}
+	else if (transition) {
+		// the transition is a write every later access has to come after
+		state = {info.stages, {}, info.stages, info.access, layout};
+	}
+	else {
+		state.read_stages |= info.stages;
+		state.read_access |= info.access;
+	}
+}
+
+void VulkanRenderGraph::execute(vk::CommandBuffer cmd) {
+	PROFILE_ZONE("VulkanRenderGraph::execute");
+	++execution_count;
+
+	// the last frame using retired images was execution - 1, its fence is waited frame_count frames later
+	while (!retired.empty() && execution_count + 1 >= retired.front().execution + frame_count) {
+		destroy_transients(retired.front().transients, retired.front().slots);
+		retired.pop_front();
+	}
+
+	for (auto& resource : resources) {
+		resource.readers = 0;
+		resource.first_pass = UINT32_MAX;
+		resource.transient = UINT32_MAX;
+	}
+	cull_passes();
+	place_transients();
+
+	last_culled = 0;
+	for (u32 p = 0; p < passes.size(); ++p) {
+		auto& pass = passes[p];
+		if (pass.culled) {
+			++last_culled;
+			continue;
+		}
+
+		vk::PipelineStageFlags src_stages;
+		vk::PipelineStageFlags dst_stages;
+		for (u32 i = pass.first_use; i < pass.first_use + pass.use_count; ++i) {
+			auto& resource = resources[uses[i].resource.index];
+			if (resource.imported) {
+				access(resource, resource.state, uses[i].usage, src_stages, dst_stages);
+				continue;
+			}
+			// a transient starts out undefined after whatever used its memory last, possibly in an earlier frame
+			auto& slot = slots[transients[resource.transient].slot];
+			if (p == resource.first_pass) {
+				resource.state = slot.state;
+				resource.state.layout = vk::ImageLayout::eUndefined;
+			}
+			access(resource, resource.state, uses[i].usage, src_stages, dst_stages);
+			slot.state = resource.state;
+		}
+
+		if (!buffer_barriers.empty() || !image_barriers.empty()) {
+			cmd.pipelineBarrier(src_stages, dst_stages, {}, {}, buffer_barriers, image_barriers);
+			buffer_barriers.clear();
+			image_barriers.clear();
+		}
+		pass.record(cmd);
+	}
+
+	// imported images are handed back in the layout their owner expects, e.g. for presenting
+	vk::PipelineStageFlags src_stages;
+	for (auto& resource : resources) {
+		if (!resource.imported || resource.final_layout == vk::ImageLayout::eUndefined
+			|| resource.final_layout == resource.state.layout) {
+			continue;
+		}
+		auto stages = resource.state.read_stages | resource.state.write_stages;
+		src_stages |= stages ? stages : vk::PipelineStageFlags {vk::PipelineStageFlagBits::eTopOfPipe};
+		image_barriers.push_back({
+			.srcAccessMask = resource.state.write_access,
+			.dstAccessMask = vk::AccessFlagBits::eNone,
+			.oldLayout = resource.state.layout,
+			.newLayout = resource.final_layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = resource.image,
+			.subresourceRange {
+				.aspectMask = resource.desc.aspect,
+				.baseMipLevel = 0,
+				.levelCount = VK_REMAINING_MIP_LEVELS,
+				.baseArrayLayer = 0,
+				.layerCount = VK_REMAINING_ARRAY_LAYERS
+			}
+		});
+		resource.state = {vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, resource.final_layout};
+	}
+	if (!image_barriers.empty()) {
+		cmd.pipelineBarrier(src_stages, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, image_barriers);
+		image_barriers.clear();
+	}
+
+	for (const auto& resource : resources) {
+		if (resource.persistent) {
+			remembered[resource.image ? handle_key(resource.image) : handle_key(resource.buffer)] = resource.state;
+		}
+	}
+
+	resources.clear();
+	passes.clear();
+	uses.clear();
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "vulkan_allocator.hpp"
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/// How a pass accesses a resource, decides the stages, access flags and image layout the graph synchronizes.
+enum class RenderGraphUsage : u8 {
+	ColorAttachment,
+	DepthAttachment,
+	/// sampled image in a compute shader
+	ComputeSampled,
+	/// storage buffer read in a compute shader
+	ComputeRead,
+	/// storage buffer or image written, and possibly read, in a compute shader
+	ComputeWrite,
+	VertexAttribute,
+	IndirectRead,
+	TransferRead,
+	TransferWrite
+};
+
+/// A point in the pipeline a resource was last accessed at, for resources coming from outside the graph.
+struct VulkanAccess {
+	vk::PipelineStageFlags stages;
+	vk::AccessFlags access;
+	vk::ImageLayout layout;
+};
+
+struct RenderGraphResource {
+	u32 index;
+};
+
+struct RenderGraphUse {
+	RenderGraphResource resource;
+	RenderGraphUsage usage;
+};
+
+/// Passes are added every frame in execution order along with the resources they use. Executing the graph
+/// culls passes whose results nobody reads, records the fewest barriers and layout transitions between
+/// the passes that do run, and places transient images whose lifetimes don't overlap in the same memory.
+/// Imported resources are kept alive outside the graph and count as read after the frame, the state they
+/// were left in is remembered for the next execution.
+class VulkanRenderGraph {
+public:
+	void init(vk::Device device, VulkanAllocator* allocator, u32 frame_count);
+	void destroy();
+
+	/// Image owned by the graph which only lives for one execution, its usage flags come from its uses.
+	RenderGraphResource create_image(const char* name, vk::Format format, vk::Extent2D extent, vk::ImageAspectFlags aspect);
+	/// initial overrides the remembered state, final_layout is transitioned to after the last pass if given.
+	RenderGraphResource import_image(
+			vk::Image image,
+			vk::ImageView view,
+			vk::ImageAspectFlags aspect,
+			std::optional<VulkanAccess> initial = std::nullopt,
+			vk::ImageLayout final_layout = vk::ImageLayout::eUndefined);
+	RenderGraphResource import_buffer(vk::Buffer buffer);
+	/// Drops the remembered state of a destroyed resource, a new one may get the same handle.
+	void forget(vk::Image image);
+	void forget(vk::Buffer buffer);
+
+	void add_pass(const char* name, std::initializer_list<RenderGraphUse> uses, std::function<void(vk::CommandBuffer)> record);
+
+	/// Records the passes with their barriers and clears the graph for the next frame.
+	void execute(vk::CommandBuffer cmd);
+
+	/// Only valid inside the record callback of a pass using the resource.
+	[[nodiscard]] vk::Image image(RenderGraphResource resource) const {
+		return resources[resource.index].image;
+	}
+	[[nodiscard]] vk::ImageView view(RenderGraphResource resource) const {
+		return resources[resource.index].view;
+	}
+
+	[[nodiscard]] u32 culled_pass_count() const {
+		return last_culled;
+	}
+	/// Device memory of the transient images, less than the sum of their sizes when some of them alias.
+	[[nodiscard]] vk::DeviceSize transient_bytes() const {
+		return transient_memory;
+	}
+private:
+	/// the synchronization state of a resource, reads are the ones made visible since the last write
+	struct State {
+		vk::PipelineStageFlags write_stages;
+		vk::AccessFlags write_access;
+		vk::PipelineStageFlags read_stages;
+		vk::AccessFlags read_access;
+		vk::ImageLayout layout;
+	};
+
+	struct ImageDesc {
+		vk::Format format;
+		vk::Extent2D extent;
+		vk::ImageAspectFlags aspect;
+		vk::ImageUsageFlags usage;
+
+		bool operator==(const ImageDesc&) const = default;
+	};
+
+	struct Resource {
+		const char* name;
+		vk::Image image;
+		vk::ImageView view;
+		vk::Buffer buffer;
+		ImageDesc desc;
+		bool imported;
+		/// uses the remembered state of the handle at the start
+		bool persistent;
+		State state;
+		vk::ImageLayout final_layout;
+		/// kept passes reading it, used for culling
+		u32 readers;
+		u32 first_pass;
+		u32 last_pass;
+		/// index into transients
+		u32 transient;
+	};
+
+	struct Pass {
+		const char* name;
+		u32 first_use;
+		u32 use_count;
+		std::function<void(vk::CommandBuffer)> record;
+		/// written resources somebody reads
+		u32 refs;
+		bool culled;
+	};
+
+	struct TransientKey {
+		ImageDesc desc;
+		u32 first_pass;
+		u32 last_pass;
+
+		bool operator==(const TransientKey&) const = default;
+	};
+
+	/// memory shared by transient images with disjoint lifetimes
+	struct Slot {
+		VulkanAllocation allocation;
+		/// last access of any image in the slot, the next image placed in it waits on it
+		State state;
+	};
+
+	struct Transient {
+		vk::Image image;
+		vk::ImageView view;
+		u32 slot;
+	};
+
+	struct Retired {
+		std::vector<Transient> transients;
+		std::vector<Slot> slots;
+		u64 execution;
+	};
+
+	RenderGraphResource add_resource(const Resource& resource);
+	void cull_passes();
+	void place_transients();
+	void destroy_transients(std::vector<Transient>& list, std::vector<Slot>& slot_list);
+	void access(
+			const Resource& resource,
+			State& state,
+			RenderGraphUsage usage,
+			vk::PipelineStageFlags& src_stages,
+			vk::PipelineStageFlags& dst_stages);
+	[[nodiscard]] static bool is_write(RenderGraphUsage usage);
+
+	vk::Device device;
+	VulkanAllocator* allocator {};
+	u32 frame_count {};
+
+	std::vector<Resource> resources {};
+	std::vector<Pass> passes {};
+	std::vector<RenderGraphUse> uses {};
+
+	/// the last state of imported resources, keyed by their handle
+	std::unordered_map<u64, State> remembered {};
+
+	/// transient images of the last execution, reused while the frames keep the same shape
+	std::vector<TransientKey> transient_keys {};
+	std::vector<Transient> transients {};
+	std::vector<Slot> slots {};
+	std::deque<Retired> retired {};
+	vk::DeviceSize transient_memory {};
+	u64 execution_count {};
+
+	/// barriers of the pass being recorded
+	std::vector<vk::BufferMemoryBarrier> buffer_barriers {};
+	std::vector<vk::ImageMemoryBarrier> image_barriers {};
+	u32 last_culled {};
+};
\ No newline at end of file
@@ -1,15 +1,131 @@
 #include "vulkan_renderer.hpp"
+#include "vulkan_shader.hpp"
 #include "logger.hpp"
 #include "window.hpp"
+#include "mesh/mesh.hpp"
+#include "components/transform.hpp"
+#include "culling/frustum.hpp"
+#include "jobs/job_system.hpp"
+#include "profiler/profiler.hpp"
 #include <SDL_vulkan.h>
 #include <unordered_set>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
-VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}, logger {logger} {
-	logger->log("vulkan", "init begin");
+/// The instanced materials only use view_projection from the front of the block. Normals only need the model
+/// matrix's first three columns, dropping the last one keeps the block within the guaranteed 128 bytes.
+struct MeshPushConstants {
+	Mat4 mvp;
+	f32 normal_matrix[3][4];
+	/// streamed texture id
+	u32 texture;
+	/// bindless handle of the texture streamer's table for the frame
+	u32 texture_table;
+};
+
+/// push constants of the instanced materials, at the front of MeshPushConstants' range
+struct InstancedPushConstants {
+	Mat4 view_projection;
+	u32 texture_table;
+};
+
+static_assert(sizeof(DrawBatch) == sizeof(vk::DrawIndexedIndirectCommand));
+
+/// draws recorded into one secondary command buffer by render_parallel
+constexpr u32 DRAW_BATCH_SIZE = 256;
+
+struct MaterialDesc {
+	const char* name;
+	const char* vertex_shader;
+	const char* fragment_shader;
+	vk::CullModeFlags cull_mode;
+	/// takes the model matrix from the instance buffer instead of push constants
+	bool instanced;
+};
+
+/// indexed by VulkanRenderer::Material, every pipeline is compiled at startup so none is created on first use
+static const MaterialDesc MATERIALS[] {
+	{"mesh", GAME_SHADER_DIR "/mesh.vert.spv", GAME_SHADER_DIR "/mesh.frag.spv", vk::CullModeFlagBits::eBack, false},
+	{"mesh_instanced", GAME_SHADER_DIR "/mesh_instanced.vert.spv", GAME_SHADER_DIR "/mesh.frag.spv", vk::CullModeFlagBits::eBack, true}
+};
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+VulkanRenderer::VulkanRenderer(Window* window, Logger* logger, JobSystem& jobs, const RendererSettings& settings)
+	: window {window}, logger {logger}, settings {settings}, extent {window->width, window->height} {
+	init(jobs);
+}
+
+VulkanRenderer::VulkanRenderer(u32 width, u32 height, Logger* logger, JobSystem& jobs, const RendererSettings& settings)
+	: window {nullptr}, logger {logger}, settings {settings}, extent {width, height} {
+	init(jobs);
+}
+
+void VulkanRenderer::init(JobSystem& jobs) {
+	PROFILE_ZONE("VulkanRenderer::init");
+	logger->log("vulkan", headless() ? "init begin (headless)" : "init begin");
+	auto start = std::chrono::steady_clock::now();
+
+	if (!settings.frames_in_flight) {
+		throw std::runtime_error("vulkan: frames in flight has to be at least 1");
+	}
+
+	create_instance();
+	pick_physical_device();
+	create_device();
+	auto device_ms = ms_since(start);
+
+	allocator.init(device, phys_device);
+	bindless.init(device, phys_device, settings.frames_in_flight);
+	default_sampler = device.createSampler({
+		.magFilter = vk::Filter::eLinear,
+		.minFilter = vk::Filter::eLinear,
+		.mipmapMode = vk::SamplerMipmapMode::eLinear,
+		.addressModeU = vk::SamplerAddressMode::eRepeat,
+		.addressModeV = vk::SamplerAddressMode::eRepeat,
+		.addressModeW = vk::SamplerAddressMode::eRepeat,
+		.maxLod = VK_LOD_CLAMP_NONE
+	});
+	// the shaders assume it's the first sampler
+	bindless.add_sampler(default_sampler);
+	render_graph.init(device, &allocator, settings.frames_in_flight);
+	uploader.init(device, &allocator, transfer_queue, transfer_family, graphics_family, STAGING_SIZE);
+	texture_streamer.init(device, phys_device, &allocator, &uploader, &bindless, &jobs, logger, settings, memory_budget);
+	geometry.init(device, &allocator, VERTEX_ARENA_SIZE, INDEX_ARENA_SIZE);
+	if (settings.gpu_culling) {
+		gpu_culling.init(device, &allocator, settings.max_gpu_objects);
+	}
+
+	if (headless()) {
+		create_offscreen_images();
+	}
+	else {
+		create_swapchain(phys_device.getSurfaceCapabilitiesKHR(surface));
+	}
+	create_frame_resources();
+
+	auto pipelines_start = std::chrono::steady_clock::now();
+	pipeline_cache.init(device, phys_device, settings.pipeline_cache_path, logger);
+	create_pipelines(jobs);
+	if (settings.gpu_culling) {
+		gpu_culling.create_pipelines(pipeline_cache.get());
+	}
+	auto pipelines_ms = ms_since(pipelines_start);
+
+	// compare a run after deleting the pipeline cache file against a normal one for cold and warm start times
+	logger->info("vulkan", "renderer init done in {}ms: device {}ms, pipelines {}ms ({} start, {} cache bytes)",
+		ms_since(start), device_ms, pipelines_ms, pipeline_cache.loaded_size() ? "warm" : "cold",
+		pipeline_cache.loaded_size());
+}
 
+void VulkanRenderer::create_instance() {
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr"));
 
 	vk::ApplicationInfo app_info {
@@ -20,15 +136,28 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 		.apiVersion = VK_API_VERSION_1_3
 	};
 
-	auto layer = "VK_LAYER_KHRONOS_validation";
-
-	u32 instance_ext_count;
-	if (SDL_Vulkan_GetInstanceExtensions(window->inner, &instance_ext_count, nullptr) == SDL_FALSE) {
-		throw std::runtime_error("vulkan: failed to get sdl instance extensions");
+	// validation is used when it's installed, machines running headless often don't have it
+	std::vector<const char*> layers;
+	const char* validation_layer = "VK_LAYER_KHRONOS_validation";
+	for (const auto& layer : vk::enumerateInstanceLayerProperties()) {
+		if (std::string_view {layer.layerName.data()} == validation_layer) {
+			layers.push_back(validation_layer);
+		}
+	}
+	if (layers.empty()) {
+		logger->log("vulkan", "validation layer is not available", LogLevel::Warn);
 	}
 
-	std::vector<const char*> instance_exts(instance_ext_count);
-	SDL_Vulkan_GetInstanceExtensions(window->inner, &instance_ext_count, instance_exts.data());
+	std::vector<const char*> instance_exts;
+	if (window) {
+		u32 instance_ext_count;
+		if (SDL_Vulkan_GetInstanceExtensions(window->inner, &instance_ext_count, nullptr) == SDL_FALSE) {
+			throw std::runtime_error("vulkan: failed to get sdl instance extensions");
+		}
+
+		instance_exts.resize(instance_ext_count);
+		SDL_Vulkan_GetInstanceExtensions(window->inner, &instance_ext_count, instance_exts.data());
+	}
 
 	std::unordered_set<std::string> available_exts;
 	for (auto ext : vk::enumerateInstanceExtensionProperties()) {
@@ -43,9 +172,9 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 
 	vk::InstanceCreateInfo instance_info {
 		.pApplicationInfo = &app_info,
-		.enabledLayerCount = 1,
-		.ppEnabledLayerNames = &layer,
-		.enabledExtensionCount = instance_ext_count,
+		.enabledLayerCount = as<u32>(layers.size()),
+		.ppEnabledLayerNames = layers.data(),
+		.enabledExtensionCount = as<u32>(instance_exts.size()),
 		.ppEnabledExtensionNames = instance_exts.data()
 	};
 
@@ -55,11 +184,13 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 
 	logger->log("vulkan", "instance successfully created");
 
-	if (SDL_Vulkan_CreateSurface(window->inner, instance, reinterpret_cast<VkSurfaceKHR*>(&surface)) == SDL_FALSE) {
+	if (window && SDL_Vulkan_CreateSurface(window->inner, instance, reinterpret_cast<VkSurfaceKHR*>(&surface)) == SDL_FALSE) {
 		instance.destroy();
 		throw std::runtime_error("vulkan: sdl surface creation failed");
 	}
+}
 
+void VulkanRenderer::pick_physical_device() {
 	auto physical_devices = instance.enumeratePhysicalDevices();
 
 	vk::PhysicalDevice best_physical_device;
@@ -68,7 +199,8 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 	usize best_score = 0;
 
 	for (auto phys_dev : physical_devices) {
-		usize score = 0;
+		// any device with the required queues is usable, software implementations included
+		usize score = 1;
 		auto properties = phys_dev.getProperties();
 		if (properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
 			score += 100000;
@@ -83,7 +215,7 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 
 		for (u32 i = 0; i < queue_families.size(); ++i) {
 			auto family = queue_families[i];
-			auto present_support = phys_dev.getSurfaceSupportKHR(i, surface);
+			auto present_support = !surface || phys_dev.getSurfaceSupportKHR(i, surface);
 			if (family.queueFlags & vk::QueueFlagBits::eGraphics && present_support) {
 				if (!is_best_graphics_family && i_transfer_family != i) {
 					is_best_graphics_family = true;
@@ -128,9 +260,11 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 	transfer_family = best_transfer_family;
 
 	auto phys_dev_name = best_physical_device.getProperties().deviceName;
-	logger->log("vulkan", std::string("using device '") + phys_dev_name.data() + '\'');
+	logger->info("vulkan", "using device '{}'", phys_dev_name.data());
+}
 
-	std::unordered_set<u32> queue_families {best_graphics_family, best_transfer_family};
+void VulkanRenderer::create_device() {
+	std::unordered_set<u32> queue_families {graphics_family, transfer_family};
 
 	std::vector<vk::DeviceQueueCreateInfo> queue_infos;
 	queue_infos.reserve(queue_families.size());
@@ -146,7 +280,10 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 		queue_infos.push_back(queue_info);
 	}
 
-	const char* extensions[] {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME};
+	std::vector<const char*> extensions {VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME};
+	if (!headless()) {
+		extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
 
 	std::unordered_set<std::string> available_device_exts;
 	for (auto ext : phys_device.enumerateDeviceExtensionProperties()) {
@@ -161,63 +298,178 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 		}
 	}
 
+	// every mesh material reads textures and the texture tables through the bindless set, which can't work without these
+	auto supported = phys_device.getFeatures();
+	auto supported12 = phys_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>()
+		.get<vk::PhysicalDeviceVulkan12Features>();
+	if (!supported.shaderStorageBufferArrayDynamicIndexing
+		|| !supported12.runtimeDescriptorArray || !supported12.descriptorBindingPartiallyBound
+		|| !supported12.descriptorBindingUpdateUnusedWhilePending
+		|| !supported12.descriptorBindingSampledImageUpdateAfterBind
+		|| !supported12.descriptorBindingStorageBufferUpdateAfterBind
+		|| !supported12.shaderSampledImageArrayNonUniformIndexing) {
+		instance.destroy(surface);
+		instance.destroy();
+		throw std::runtime_error("vulkan: descriptor indexing is not supported");
+	}
+
+	vk::PhysicalDeviceVulkan12Features vulkan12_features {
+		.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+		.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+		.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+		.descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+		.descriptorBindingPartiallyBound = VK_TRUE,
+		.runtimeDescriptorArray = VK_TRUE,
+		.timelineSemaphore = VK_TRUE
+	};
+
 	vk::PhysicalDeviceDynamicRenderingFeatures dynamic_rendering_feature {
+		.pNext = &vulkan12_features,
 		.dynamicRendering = VK_TRUE
 	};
 
+	// both are needed to issue every batch of a frame from one indirect call, without them it falls back to direct draws
+	multi_draw_indirect = supported.multiDrawIndirect && supported.drawIndirectFirstInstance;
+	if (!multi_draw_indirect) {
+		logger->log("vulkan", "multi draw indirect is not supported, batches are drawn directly", LogLevel::Warn);
+	}
+	// textures are only shipped bc compressed, meshes are drawn untextured without it
+	textures_supported = supported.textureCompressionBC;
+	if (!textures_supported) {
+		logger->log("vulkan", "bc texture compression is not supported, textures are disabled", LogLevel::Warn);
+	}
+	vk::PhysicalDeviceFeatures features {
+		.multiDrawIndirect = multi_draw_indirect,
+		.drawIndirectFirstInstance = multi_draw_indirect,
+		.textureCompressionBC = textures_supported,
+		.shaderStorageBufferArrayDynamicIndexing = VK_TRUE
+	};
+
+	// input latency is measured up to the present instead of the end of the frame's gpu work
+	vk::PhysicalDevicePresentIdFeaturesKHR present_id_features {};
+	vk::PhysicalDevicePresentWaitFeaturesKHR present_wait_features {.pNext = &present_id_features};
+	if (!headless()
+		&& available_device_exts.contains(VK_KHR_PRESENT_ID_EXTENSION_NAME)
+		&& available_device_exts.contains(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+		auto supported_present = phys_device.getFeatures2<
+			vk::PhysicalDeviceFeatures2,
+			vk::PhysicalDevicePresentIdFeaturesKHR,
+			vk::PhysicalDevicePresentWaitFeaturesKHR>();
+		present_wait = supported_present.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId
+			&& supported_present.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+	}
+	if (present_wait) {
+		extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		present_id_features.presentId = VK_TRUE;
+		present_wait_features.presentWait = VK_TRUE;
+		vulkan12_features.pNext = &present_wait_features;
+	}
+
+	// lets the texture budget follow the memory the device has left, otherwise it's a guess from the heap size
+	memory_budget = available_device_exts.contains(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memory_budget) {
+		extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
+	// the cull pass writes a draw count for the indirect draws and binds its buffers with push descriptors
+	if (settings.gpu_culling) {
+		if (multi_draw_indirect && supported12.drawIndirectCount
+			&& available_device_exts.contains(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+			extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+			vulkan12_features.drawIndirectCount = VK_TRUE;
+		}
+		else {
+			logger->log("vulkan", "gpu culling is not supported, it's disabled", LogLevel::Warn);
+			settings.gpu_culling = false;
+		}
+	}
+
 	vk::DeviceCreateInfo device_info {
 		.pNext = &dynamic_rendering_feature,
 		.queueCreateInfoCount = as<uint32_t>(queue_infos.size()),
 		.pQueueCreateInfos = queue_infos.data(),
-		.enabledExtensionCount = sizeof(extensions) / sizeof(*extensions),
-		.ppEnabledExtensionNames = extensions
+		.enabledExtensionCount = as<u32>(extensions.size()),
+		.ppEnabledExtensionNames = extensions.data(),
+		.pEnabledFeatures = &features
 	};
 
 	device = phys_device.createDevice(device_info);
 
+	VULKAN_HPP_DEFAULT_DISPATCHER.init(device);
+
 	graphics_queue = device.getQueue(graphics_family, 0);
 	transfer_queue = device.getQueue(transfer_family, 0);
+}
 
-	vk::SurfaceFormatKHR best_format {vk::Format::eUndefined};
-	vk::PresentModeKHR best_mode = vk::PresentModeKHR::eFifo;
-
-	auto supported_formats = phys_device.getSurfaceFormatsKHR(surface);
-	auto supported_modes = phys_device.getSurfacePresentModesKHR(surface);
-
-	for (const auto& f : supported_formats) {
-		if (f.format == vk::Format::eR8G8B8A8Srgb && f.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
-			best_format = f;
+vk::PresentModeKHR VulkanRenderer::choose_present_mode() const {
+	vk::PresentModeKHR wanted {};
+	switch (settings.present_mode) {
+		case PresentMode::Fifo:
+			wanted = vk::PresentModeKHR::eFifo;
+			break;
+		case PresentMode::FifoRelaxed:
+			wanted = vk::PresentModeKHR::eFifoRelaxed;
+			break;
+		case PresentMode::Mailbox:
+			wanted = vk::PresentModeKHR::eMailbox;
+			break;
+		case PresentMode::Immediate:
+			wanted = vk::PresentModeKHR::eImmediate;
 			break;
-		}
 	}
 
-	if (best_format.format == vk::Format::eUndefined) {
-		best_format = supported_formats[0];
+	for (auto m : phys_device.getSurfacePresentModesKHR(surface)) {
+		if (m == wanted) {
+			return m;
+		}
 	}
 
-	format = best_format;
+	// fifo is the only mode every surface supports
+	logger->warn("vulkan", "present mode {} is not supported, using fifo", vk::to_string(wanted));
+	return vk::PresentModeKHR::eFifo;
+}
 
-	for (auto m : supported_modes) {
-		if (m == vk::PresentModeKHR::eMailbox) {
-			best_mode = m;
-			break;
-		}
-	}
+void VulkanRenderer::create_swapchain(const vk::SurfaceCapabilitiesKHR& caps) {
+	if (format.format == vk::Format::eUndefined) {
+		vk::SurfaceFormatKHR best_format {vk::Format::eUndefined};
+		auto supported_formats = phys_device.getSurfaceFormatsKHR(surface);
 
-	mode = best_mode;
+		for (const auto& f : supported_formats) {
+			if (f.format == vk::Format::eR8G8B8A8Srgb && f.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+				best_format = f;
+				break;
+			}
+		}
 
-	auto caps = phys_device.getSurfaceCapabilitiesKHR(surface);
+		if (best_format.format == vk::Format::eUndefined) {
+			best_format = supported_formats[0];
+		}
 
-	u32 image_count = FRAME_COUNT;
-	if (image_count < caps.minImageCount) {
-		image_count = caps.minImageCount;
+		format = best_format;
 	}
+
+	mode = choose_present_mode();
+
+	// one more image than the driver needs lets the cpu acquire the next image without waiting on present
+	u32 image_count = std::max(settings.frames_in_flight, caps.minImageCount + 1);
 	if (caps.maxImageCount && image_count > caps.maxImageCount) {
 		image_count = caps.maxImageCount;
 	}
 
-	extent.width = std::clamp(extent.width, caps.minImageExtent.width, caps.maxImageExtent.width);
-	extent.height = std::clamp(extent.height, caps.minImageExtent.height, caps.maxImageExtent.height);
+	// UINT32_MAX means the surface takes its size from the swapchain
+	if (caps.currentExtent.width != UINT32_MAX) {
+		extent = caps.currentExtent;
+	}
+	else {
+		int width;
+		int height;
+		SDL_Vulkan_GetDrawableSize(window->inner, &width, &height);
+		extent.width = std::clamp(as<u32>(width), caps.minImageExtent.width, caps.maxImageExtent.width);
+		extent.height = std::clamp(as<u32>(height), caps.minImageExtent.height, caps.maxImageExtent.height);
+	}
+
+	auto old_swapchain = swapchain;
 
 	vk::SwapchainCreateInfoKHR swapchain_info {
 		.surface = surface,
@@ -228,12 +480,28 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 		.imageArrayLayers = 1,
 		.imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
 		.imageSharingMode = vk::SharingMode::eExclusive,
-		.preTransform = vk::SurfaceTransformFlagBitsKHR::eIdentity,
+		.preTransform = caps.currentTransform,
 		.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
 		.presentMode = mode,
-		.clipped = VK_TRUE
+		.clipped = VK_TRUE,
+		.oldSwapchain = old_swapchain
 	};
 
+	swapchain = device.createSwapchainKHR(swapchain_info);
+
+	// frames still in flight keep using the old swapchain's views and semaphores, so nothing waits here
+	if (old_swapchain) {
+		retired_swapchains.push_back({
+			.swapchain = old_swapchain,
+			.image_views = std::move(image_views),
+			.present_semaphores = std::move(present_semaphores),
+			.pyramid = depth_pyramid,
+			.frame_number = frame_number
+		});
+		image_views.clear();
+		present_semaphores.clear();
+	}
+
 	vk::ImageViewCreateInfo image_view_info {
 		.viewType = vk::ImageViewType::e2D,
 		.format = format.format,
@@ -246,287 +514,1122 @@ VulkanRenderer::VulkanRenderer(Window* window, Logger* logger) : window {window}
 		}
 	};
 
-	swapchain = device.createSwapchainKHR(swapchain_info);
 	images = device.getSwapchainImagesKHR(swapchain);
 	for (auto& image : images) {
 		image_view_info.image = image;
 		image_views.push_back(device.createImageView(image_view_info));
+		present_semaphores.push_back(device.createSemaphore({}));
 	}
+	final_layout = vk::ImageLayout::ePresentSrcKHR;
+	create_depth_pyramid();
+}
 
-	extent = {window->width, window->height};
+bool VulkanRenderer::recreate_swapchain() {
+	auto caps = phys_device.getSurfaceCapabilitiesKHR(surface);
+	// minimized windows have no area to render to
+	if (caps.currentExtent.width == 0 || caps.currentExtent.height == 0) {
+		return false;
+	}
+	// pending presents keep their swapchain, the retired one is still waited on until it's destroyed
+	create_swapchain(caps);
+	needs_recreate = false;
+	return true;
+}
 
+void VulkanRenderer::poll_presents() {
+	// waitForPresentKHR needs the swapchain externally synchronized with presentKHR, so it isn't left blocking
+	// on another thread. the completion is only seen here, which makes the latency an upper bound
+	while (!pending_presents.empty()) {
+		const auto& pending = pending_presents.front();
+		try {
+			// a zero timeout only checks, presents complete in order so the first pending one decides
+			if (device.waitForPresentKHR(pending.swapchain, pending.id, 0) == vk::Result::eTimeout) {
+				return;
+			}
+		}
+		catch (const vk::SystemError&) {
+			// an out of date swapchain never completes its presents
+			std::erase_if(pending_presents, [failed = pending.swapchain](const PendingPresent& present) {
+				return present.swapchain == failed;
+			});
+			continue;
+		}
+		input_latency = ms_since(pending.input_time);
+		pending_presents.pop_front();
+	}
+}
+
+void VulkanRenderer::destroy_retired_swapchains(bool all) {
+	// the fence of a slot is waited on frames.size() frames after the slot was submitted, so by then
+	// every frame that was recorded against the retired swapchain has completed
+	while (!retired_swapchains.empty()
+		&& (all || frame_number - retired_swapchains.front().frame_number >= frames.size())) {
+		auto& retired = retired_swapchains.front();
+		std::erase_if(pending_presents, [&](const PendingPresent& present) {
+			return present.swapchain == retired.swapchain;
+		});
+		for (auto view : retired.image_views) {
+			device.destroy(view);
+		}
+		for (auto semaphore : retired.present_semaphores) {
+			device.destroy(semaphore);
+		}
+		device.destroy(retired.swapchain);
+		destroy_depth_pyramid(retired.pyramid);
+		retired_swapchains.pop_front();
+	}
+}
+
+void VulkanRenderer::create_offscreen_images() {
+	// guaranteed to be supported as a color attachment, which the surface formats aren't
+	format = {vk::Format::eR8G8B8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear};
+
+	vk::ImageCreateInfo image_info {
+		.imageType = vk::ImageType::e2D,
+		.format = format.format,
+		.extent {extent.width, extent.height, 1},
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = vk::SampleCountFlagBits::e1,
+		.tiling = vk::ImageTiling::eOptimal,
+		.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+		.sharingMode = vk::SharingMode::eExclusive,
+		.initialLayout = vk::ImageLayout::eUndefined
+	};
+
+	vk::ImageViewCreateInfo image_view_info {
+		.viewType = vk::ImageViewType::e2D,
+		.format = format.format,
+		.subresourceRange {
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+
+	for (u32 i = 0; i < settings.frames_in_flight; ++i) {
+		auto image = device.createImage(image_info);
+		offscreen_allocations.push_back(allocator.alloc_image(image, vk::MemoryPropertyFlagBits::eDeviceLocal));
+		images.push_back(image);
+
+		image_view_info.image = image;
+		image_views.push_back(device.createImageView(image_view_info));
+	}
+	// left ready for a readback copy
+	final_layout = vk::ImageLayout::eTransferSrcOptimal;
+	create_depth_pyramid();
+}
+
+void VulkanRenderer::create_depth_pyramid() {
+	if (settings.gpu_culling) {
+		depth_pyramid = gpu_culling.create_pyramid(extent);
+	}
+	// a new pyramid has no depth in it yet
+	pyramid_valid = false;
+}
+
+void VulkanRenderer::destroy_depth_pyramid(VulkanDepthPyramid& pyramid) {
+	if (pyramid.image) {
+		render_graph.forget(pyramid.image);
+		gpu_culling.destroy_pyramid(pyramid);
+	}
+}
+
+void VulkanRenderer::create_frame_resources() {
 	vk::CommandPoolCreateInfo cmd_pool_info {
 		.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
 		.queueFamilyIndex = graphics_family
 	};
 	graphics_cmd_pool = device.createCommandPool(cmd_pool_info);
 
-	cmd_pool_info.queueFamilyIndex = transfer_family;
-	transfer_cmd_pool = device.createCommandPool(cmd_pool_info);
-
 	vk::CommandBufferAllocateInfo cmd_buffer_info {
 		.commandPool = graphics_cmd_pool,
 		.level = vk::CommandBufferLevel::ePrimary,
 		.commandBufferCount = 1
 	};
 
-	for (auto& cmd_buf : graphics_cmd_buffers) {
-		cmd_buf = device.allocateCommandBuffers(cmd_buffer_info)[0];
+	vk::FenceCreateInfo fence_info {
+		.flags = vk::FenceCreateFlagBits::eSignaled
+	};
+
+	frames.resize(settings.frames_in_flight);
+	for (auto& frame : frames) {
+		frame.cmd = device.allocateCommandBuffers(cmd_buffer_info)[0];
+		frame.image_acquired = device.createSemaphore({});
+		frame.submit_finished = device.createFence(fence_info);
+		frame.frame_allocator.init(device, phys_device, &allocator, FRAME_ALLOCATOR_SIZE);
 	}
 
-	cmd_buffer_info.commandPool = transfer_cmd_pool;
-	transfer_cmd_buffer = device.allocateCommandBuffers(cmd_buffer_info)[0];
+	gpu_profiler.init(device, phys_device, graphics_family, settings.frames_in_flight, logger);
+}
 
-	vk::SemaphoreCreateInfo semaphore_info {};
+GpuMesh VulkanRenderer::upload_mesh(const MeshView& mesh) {
+	if (mesh.vertices.empty() || mesh.indices.empty()) {
+		throw std::runtime_error("vulkan: tried to upload an empty mesh");
+	}
 
-	for (auto& semaphore : image_acquired_semaphores) {
-		semaphore = device.createSemaphore(semaphore_info);
+	GpuMesh gpu_mesh {};
+	if (mesh.lods.empty() || mesh.lods.size() > MAX_MESH_LODS) {
+		throw std::runtime_error("vulkan: mesh has an invalid number of lods");
+	}
+	gpu_mesh.lod_count = as<u32>(mesh.lods.size());
+	std::copy(mesh.lods.begin(), mesh.lods.end(), gpu_mesh.lods);
+	gpu_mesh.index_type = mesh.index_size == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	gpu_mesh.bounds = mesh.bounds;
+
+	auto vertices = geometry.alloc_vertices(as<u32>(mesh.vertices.size()), sizeof(PackedVertex));
+	auto indices = geometry.alloc_indices(as<u32>(mesh.indices.size() / mesh.index_size), mesh.index_size);
+	if (!vertices || !indices) {
+		if (vertices) {
+			geometry.free_vertices(*vertices);
+		}
+		if (indices) {
+			geometry.free_indices(*indices);
+		}
+		throw std::runtime_error("vulkan: geometry arena is full");
 	}
+	gpu_mesh.vertices = *vertices;
+	gpu_mesh.indices = *indices;
+
+	uploader.upload_buffer(
+		mesh.vertices.data(),
+		mesh.vertices.size_bytes(),
+		geometry.vertex_buffer,
+		VulkanGeometryArena::byte_offset(gpu_mesh.vertices, sizeof(PackedVertex)));
+	gpu_mesh.upload_value = uploader.upload_buffer(
+		mesh.indices.data(),
+		mesh.indices.size_bytes(),
+		geometry.index_buffer,
+		VulkanGeometryArena::byte_offset(gpu_mesh.indices, mesh.index_size));
+
+	return gpu_mesh;
+}
+
+void VulkanRenderer::destroy_mesh(GpuMesh& mesh) {
+	frame().mesh_destroy_queue.push_back(mesh);
+	mesh = {};
+}
 
-	for (auto& semaphore : render_finished_semaphores) {
-		semaphore = device.createSemaphore(semaphore_info);
+void VulkanRenderer::free_mesh(GpuMesh& mesh) {
+	if (uploader.completed_value() < mesh.upload_value) {
+		uploader.wait(mesh.upload_value);
 	}
+	geometry.free_vertices(mesh.vertices);
+	geometry.free_indices(mesh.indices);
+}
 
-	vk::FenceCreateInfo fence_info {
-		.flags = vk::FenceCreateFlagBits::eSignaled
+void VulkanRenderer::create_pipelines(JobSystem& jobs) {
+	PROFILE_ZONE("create pipelines");
+	static_assert(sizeof(MATERIALS) / sizeof(*MATERIALS) == MATERIAL_COUNT);
+
+	vk::PushConstantRange push_constant_range {
+		.stageFlags = vk::ShaderStageFlagBits::eVertex,
+		.offset = 0,
+		.size = sizeof(MeshPushConstants)
 	};
 
-	for (auto& fence : submit_finished_fences) {
-		fence = device.createFence(fence_info);
+	auto set_layout = bindless.set_layout();
+	mesh_pipeline_layout = device.createPipelineLayout({
+		.setLayoutCount = 1,
+		.pSetLayouts = &set_layout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &push_constant_range
+	});
+
+	// pipeline creation is thread safe including the cache, exceptions can't leave a job so they're rethrown here
+	std::string errors[MATERIAL_COUNT];
+	JobCounter counter;
+	jobs.parallel_for(MATERIAL_COUNT, 1, [&](u32 begin, u32 end) {
+		for (u32 i = begin; i < end; ++i) {
+			try {
+				pipelines[i] = create_pipeline(i);
+			}
+			catch (const std::exception& e) {
+				errors[i] = e.what();
+			}
+		}
+	}, counter);
+	jobs.wait(counter);
+
+	for (const auto& error : errors) {
+		if (!error.empty()) {
+			throw std::runtime_error(error);
+		}
 	}
+}
 
-	vk::ImageMemoryBarrier barrier {
-		.srcAccessMask = vk::AccessFlagBits::eNone,
-		.dstAccessMask = vk::AccessFlagBits::eNone,
-		.oldLayout = vk::ImageLayout::eUndefined,
-		.newLayout = vk::ImageLayout::ePresentSrcKHR,
-		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.subresourceRange {
-			.aspectMask = vk::ImageAspectFlagBits::eColor,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1
+vk::Pipeline VulkanRenderer::create_pipeline(u32 material) {
+	const auto& desc = MATERIALS[material];
+	PROFILE_ZONE(desc.name);
+
+	auto vert_module = load_shader_module(device, desc.vertex_shader);
+	vk::ShaderModule frag_module;
+	try {
+		frag_module = load_shader_module(device, desc.fragment_shader);
+	}
+	catch (...) {
+		device.destroy(vert_module);
+		throw;
+	}
+
+	const vk::PipelineShaderStageCreateInfo stages[] {
+		{
+			.stage = vk::ShaderStageFlagBits::eVertex,
+			.module = vert_module,
+			.pName = "main"
+		},
+		{
+			.stage = vk::ShaderStageFlagBits::eFragment,
+			.module = frag_module,
+			.pName = "main"
+		}
+	};
+
+	const vk::VertexInputBindingDescription bindings[] {
+		{
+			.binding = 0,
+			.stride = sizeof(PackedVertex),
+			.inputRate = vk::VertexInputRate::eVertex
+		},
+		{
+			.binding = 1,
+			.stride = sizeof(InstanceData),
+			.inputRate = vk::VertexInputRate::eInstance
 		}
 	};
 
-	vk::CommandBufferBeginInfo begin_info {
-		.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+	// a mat4 input takes one location per column
+	const vk::VertexInputAttributeDescription attributes[] {
+		{
+			.location = 0,
+			.binding = 0,
+			.format = vk::Format::eR16G16B16A16Unorm,
+			.offset = offsetof(PackedVertex, position)
+		},
+		{
+			.location = 1,
+			.binding = 0,
+			.format = vk::Format::eR16G16Snorm,
+			.offset = offsetof(PackedVertex, normal)
+		},
+		{
+			.location = 2,
+			.binding = 0,
+			.format = vk::Format::eR16G16Sfloat,
+			.offset = offsetof(PackedVertex, uv)
+		},
+		{
+			.location = 3,
+			.binding = 1,
+			.format = vk::Format::eR32G32B32A32Sfloat,
+			.offset = offsetof(InstanceData, model)
+		},
+		{
+			.location = 4,
+			.binding = 1,
+			.format = vk::Format::eR32G32B32A32Sfloat,
+			.offset = offsetof(InstanceData, model) + 4 * sizeof(f32)
+		},
+		{
+			.location = 5,
+			.binding = 1,
+			.format = vk::Format::eR32G32B32A32Sfloat,
+			.offset = offsetof(InstanceData, model) + 8 * sizeof(f32)
+		},
+		{
+			.location = 6,
+			.binding = 1,
+			.format = vk::Format::eR32G32B32A32Sfloat,
+			.offset = offsetof(InstanceData, model) + 12 * sizeof(f32)
+		},
+		{
+			.location = 7,
+			.binding = 1,
+			.format = vk::Format::eR32G32B32Sfloat,
+			.offset = offsetof(InstanceData, dequantize_offset)
+		},
+		{
+			.location = 8,
+			.binding = 1,
+			.format = vk::Format::eR32G32B32Sfloat,
+			.offset = offsetof(InstanceData, dequantize_scale)
+		},
+		{
+			.location = 9,
+			.binding = 1,
+			.format = vk::Format::eR32Uint,
+			.offset = offsetof(InstanceData, texture)
+		}
 	};
 
-	graphics_cmd_buffers[0].begin(begin_info);
+	// the per vertex attributes come first, non instanced materials only use those
+	vk::PipelineVertexInputStateCreateInfo vertex_input {
+		.vertexBindingDescriptionCount = desc.instanced ? 2u : 1u,
+		.pVertexBindingDescriptions = bindings,
+		.vertexAttributeDescriptionCount = desc.instanced ? as<u32>(sizeof(attributes) / sizeof(*attributes)) : 3u,
+		.pVertexAttributeDescriptions = attributes
+	};
 
-	for (auto& image : images) {
-		barrier.image = image;
+	vk::PipelineInputAssemblyStateCreateInfo input_assembly {
+		.topology = vk::PrimitiveTopology::eTriangleList
+	};
+
+	vk::PipelineViewportStateCreateInfo viewport_state {
+		.viewportCount = 1,
+		.scissorCount = 1
+	};
+
+	vk::PipelineRasterizationStateCreateInfo rasterization {
+		.polygonMode = vk::PolygonMode::eFill,
+		.cullMode = desc.cull_mode,
+		.frontFace = vk::FrontFace::eCounterClockwise,
+		.lineWidth = 1
+	};
+
+	vk::PipelineMultisampleStateCreateInfo multisample {
+		.rasterizationSamples = vk::SampleCountFlagBits::e1
+	};
+
+	vk::PipelineDepthStencilStateCreateInfo depth_stencil {
+		.depthTestEnable = VK_TRUE,
+		.depthWriteEnable = VK_TRUE,
+		.depthCompareOp = vk::CompareOp::eLess
+	};
+
+	vk::PipelineColorBlendAttachmentState blend_attachment {
+		.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+			| vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+	};
+
+	vk::PipelineColorBlendStateCreateInfo blend {
+		.attachmentCount = 1,
+		.pAttachments = &blend_attachment
+	};
+
+	const vk::DynamicState dynamic_states[] {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+	vk::PipelineDynamicStateCreateInfo dynamic_state {
+		.dynamicStateCount = sizeof(dynamic_states) / sizeof(*dynamic_states),
+		.pDynamicStates = dynamic_states
+	};
+
+	vk::PipelineRenderingCreateInfo rendering_info {
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &format.format,
+		.depthAttachmentFormat = DEPTH_FORMAT
+	};
+
+	vk::GraphicsPipelineCreateInfo pipeline_info {
+		.pNext = &rendering_info,
+		.stageCount = sizeof(stages) / sizeof(*stages),
+		.pStages = stages,
+		.pVertexInputState = &vertex_input,
+		.pInputAssemblyState = &input_assembly,
+		.pViewportState = &viewport_state,
+		.pRasterizationState = &rasterization,
+		.pMultisampleState = &multisample,
+		.pDepthStencilState = &depth_stencil,
+		.pColorBlendState = &blend,
+		.pDynamicState = &dynamic_state,
+		.layout = mesh_pipeline_layout
+	};
 
-		graphics_cmd_buffers[0].pipelineBarrier(
-				vk::PipelineStageFlagBits::eAllGraphics,
-				vk::PipelineStageFlagBits::eAllGraphics,
-				{},
-				{},
-				{},
-				{barrier}
-				);
+	auto result = device.createGraphicsPipeline(pipeline_cache.get(), pipeline_info);
+	device.destroy(vert_module);
+	device.destroy(frag_module);
+	if (result.result != vk::Result::eSuccess) {
+		throw std::runtime_error(std::string {"vulkan: failed to create "} + desc.name + " pipeline");
 	}
+	return result.value;
+}
 
-	graphics_cmd_buffers[0].end();
+void VulkanRenderer::create_thread_commands(u32 thread_count) {
+	vk::CommandPoolCreateInfo pool_info {
+		.flags = vk::CommandPoolCreateFlagBits::eTransient,
+		.queueFamilyIndex = graphics_family
+	};
 
-	vk::SubmitInfo submit_info {
-		.commandBufferCount = 1,
-		.pCommandBuffers = &graphics_cmd_buffers[0],
+	for (auto& frame : frames) {
+		while (frame.thread_commands.size() < thread_count) {
+			frame.thread_commands.push_back({.pool = device.createCommandPool(pool_info)});
+		}
+	}
+}
+
+vk::CommandBuffer VulkanRenderer::alloc_secondary(u32 thread_index) {
+	auto& commands = frame().thread_commands[thread_index];
+	// buffers stay allocated across frames, resetting the pool in begin makes them reusable
+	if (commands.used == commands.secondaries.size()) {
+		vk::CommandBufferAllocateInfo alloc_info {
+			.commandPool = commands.pool,
+			.level = vk::CommandBufferLevel::eSecondary,
+			.commandBufferCount = 1
+		};
+		commands.secondaries.push_back(device.allocateCommandBuffers(alloc_info)[0]);
+	}
+	return commands.secondaries[commands.used++];
+}
+
+void VulkanRenderer::begin_rendering(vk::RenderingFlags flags) {
+	vk::RenderingAttachmentInfo color_attachment_info {
+		.imageView = image_views[image_index],
+		.imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+		// only the first rendering of the frame clears, later ones continue on top of it
+		.loadOp = rendered ? vk::AttachmentLoadOp::eLoad
+			: clear_frame ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eDontCare,
+		.storeOp = vk::AttachmentStoreOp::eStore,
+	};
+	color_attachment_info.clearValue.color = clear_color;
+
+	// depth left from an earlier frame means nothing, so it's cleared even if the color isn't
+	vk::RenderingAttachmentInfo depth_attachment_info {
+		.imageView = depth_view,
+		.imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+		.loadOp = rendered ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear,
+		.storeOp = vk::AttachmentStoreOp::eStore,
 	};
+	depth_attachment_info.clearValue.depthStencil = vk::ClearDepthStencilValue {1, 0};
 
-	graphics_queue.submit({submit_info});
+	const vk::RenderingInfo render_info {
+		.flags = flags,
+		.renderArea {.extent = extent},
+		.layerCount = 1,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &color_attachment_info,
+		.pDepthAttachment = &depth_attachment_info
+	};
 
-	graphics_queue.waitIdle();
+	frame().cmd.beginRendering(render_info);
+	rendering = true;
+	rendered = true;
+}
 
-	logger->log("vulkan", "renderer init done");
+void VulkanRenderer::end_rendering() {
+	if (rendering) {
+		frame().cmd.endRendering();
+		rendering = false;
+	}
 }
 
-void VulkanRenderer::render(const GpuMesh& mesh, const Transform& transform) {
+void VulkanRenderer::bind_pipeline(vk::CommandBuffer cmd, u32 material) const {
+	cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines[material]);
+	cmd.setViewport(0, vk::Viewport {
+		.width = as<f32>(extent.width),
+		.height = as<f32>(extent.height),
+		.maxDepth = 1
+	});
+	cmd.setScissor(0, vk::Rect2D {.extent = extent});
+	cmd.bindVertexBuffers(0, geometry.vertex_buffer, vk::DeviceSize {0});
+}
 
+void VulkanRenderer::record_draw(vk::CommandBuffer cmd, const GpuMesh& mesh, const Mat4& model) const {
+	MeshPushConstants constants {
+		// only the position needs dequantizing, the normals keep using the model matrix
+		.mvp = view_projection * model * mesh.dequantize(),
+		.texture = mesh.texture,
+		.texture_table = texture_streamer.table()
+	};
+	for (u32 col = 0; col < 3; ++col) {
+		memcpy(constants.normal_matrix[col], &model.m[col * 4], sizeof(constants.normal_matrix[col]));
+	}
+	cmd.pushConstants(mesh_pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(constants), &constants);
+	// 16 and 32 bit indices share the arena buffer, so it's bound with the type of every draw
+	cmd.bindIndexBuffer(geometry.index_buffer, 0, mesh.index_type);
+	// lod selection isn't done yet, the full mesh is always drawn
+	const auto& lod = mesh.lods[0];
+	cmd.drawIndexed(lod.index_count, 1, mesh.indices.first + lod.index_offset, as<i32>(mesh.vertices.first), 0);
 }
 
-void VulkanRenderer::set_clear_color(f32 r, f32 g, f32 b, f32 a) {
-	clear_color = vk::ClearColorValue {{{r, g, b, a}}};
+void VulkanRenderer::submit(std::span<const DrawCommand> draws) {
+	if (!frame_active) {
+		return;
+	}
+	queued_draws.insert(queued_draws.end(), draws.begin(), draws.end());
+	for (const auto& draw : draws) {
+		drawn_upload_value = std::max(drawn_upload_value, draw.mesh->upload_value);
+	}
+}
+
+void VulkanRenderer::flush_draws() {
+	if (queued_draws.empty()) {
+		return;
+	}
+	PROFILE_ZONE("VulkanRenderer::flush_draws");
+	request_textures(queued_draws);
+
+	auto& f = frame();
+	auto instance_range = f.frame_allocator.alloc(queued_draws.size() * sizeof(InstanceData), alignof(InstanceData));
+	batcher.build(queued_draws, cast<InstanceData*>(instance_range.mapped));
+	auto batches = batcher.batches();
+
+	VulkanFrameAllocator::Range indirect_range {};
+	if (multi_draw_indirect) {
+		indirect_range = f.frame_allocator.alloc(batches.size_bytes(), alignof(DrawBatch));
+		memcpy(indirect_range.mapped, batches.data(), batches.size_bytes());
+	}
+
+	auto cmd = f.cmd;
+	if (!rendering) {
+		begin_rendering({});
+	}
+	PROFILE_GPU_ZONE(gpu_profiler, cmd, "draw batches");
+
+	bind_pipeline(cmd, MATERIAL_MESH_INSTANCED);
+	InstancedPushConstants constants {
+		.view_projection = view_projection,
+		.texture_table = texture_streamer.table()
+	};
+	cmd.pushConstants(mesh_pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(constants), &constants);
+	cmd.bindVertexBuffers(1, instance_range.buffer, instance_range.offset);
+
+	// batches are sorted by index type, so there's one run per type and one indirect call per run
+	for (const auto& run : batcher.runs()) {
+		cmd.bindIndexBuffer(geometry.index_buffer, 0, run.wide_indices ? vk::IndexType::eUint32 : vk::IndexType::eUint16);
+		if (multi_draw_indirect) {
+			cmd.drawIndexedIndirect(
+				indirect_range.buffer,
+				indirect_range.offset + run.first_batch * sizeof(DrawBatch),
+				run.batch_count,
+				sizeof(DrawBatch));
+		}
+		else {
+			for (u32 i = run.first_batch; i < run.first_batch + run.batch_count; ++i) {
+				const auto& b = batches[i];
+				cmd.drawIndexed(b.index_count, b.instance_count, b.first_index, b.vertex_offset, b.first_instance);
+			}
+		}
+	}
+
+	queued_draws.clear();
+}
+
+f32 VulkanRenderer::screen_size(const Mat4& model, const Aabb& bounds) const {
+	// bounding sphere of the box, its radius grows with the model's largest scale
+	auto center = (bounds.min + bounds.max) * 0.5f;
+	auto world = model * Vec4<f32> {center.x, center.y, center.z, 1};
+	f32 sqr_scale = 0;
+	for (u32 col = 0; col < 3; ++col) {
+		sqr_scale = std::max(sqr_scale, Vec3<f32> {model.m[col * 4], model.m[col * 4 + 1], model.m[col * 4 + 2]}.sqr_magnitude());
+	}
+	auto radius = (bounds.max - bounds.min).magnitude() * 0.5f * std::sqrt(sqr_scale);
+
+	// w is the distance along the view direction
+	auto w = view_projection.m[3] * world.x + view_projection.m[7] * world.y + view_projection.m[11] * world.z + view_projection.m[15];
+	if (w < -radius) {
+		return 0;
+	}
+	if (w <= radius) {
+		return INFINITY;
+	}
+	// the second row of a perspective times a rigid view is the vertical focal length times a unit vector
+	auto focal = Vec3<f32> {view_projection.m[1], view_projection.m[5], view_projection.m[9]}.magnitude();
+	return 2 * radius * focal * as<f32>(extent.height) / 2 / w;
+}
+
+void VulkanRenderer::request_textures(std::span<const DrawCommand> draws) {
+	for (const auto& draw : draws) {
+		if (draw.mesh->texture != VulkanBindless::NONE) {
+			texture_streamer.request(draw.mesh->texture, screen_size(draw.model, draw.mesh->bounds));
+		}
+	}
+}
+
+void VulkanRenderer::request_object_textures() {
+	if (object_textures.empty()) {
+		return;
+	}
+	// every object is visited within a few frames, well before the streamer stops counting its last request
+	auto count = std::min(as<u32>(object_textures.size()), OBJECT_TEXTURE_REQUESTS);
+	for (u32 i = 0; i < count; ++i) {
+		object_texture_cursor = (object_texture_cursor + 1) % as<u32>(object_textures.size());
+		const auto& object = object_textures[object_texture_cursor];
+		if (object.texture != VulkanBindless::NONE) {
+			texture_streamer.request(object.texture, screen_size(object.model, object.bounds));
+		}
+	}
+}
+
+u32 VulkanRenderer::load_texture(const std::string& path) {
+	if (!textures_supported) {
+		logger->warn("vulkan", "texture '{}' is not loaded, the device can't sample it", path);
+		return VulkanBindless::NONE;
+	}
+	return texture_streamer.load(path);
 }
 
-#include <iostream>
+void VulkanRenderer::destroy_texture(u32 texture) {
+	if (texture != VulkanBindless::NONE) {
+		texture_streamer.destroy_texture(texture);
+	}
+}
+
+u32 VulkanRenderer::add_object(const GpuMesh& mesh, const Mat4& model) {
+	if (!settings.gpu_culling) {
+		throw std::runtime_error("vulkan: gpu culling is disabled");
+	}
+	auto object = gpu_culling.add(mesh, model);
+	drawn_upload_value = std::max(drawn_upload_value, mesh.upload_value);
+	if (object >= object_textures.size()) {
+		object_textures.resize(object + 1);
+	}
+	object_textures[object] = {.model = model, .bounds = mesh.bounds, .texture = mesh.texture};
+	return object;
+}
 
-namespace chrono = std::chrono;
+void VulkanRenderer::update_object(u32 object, const Mat4& model) {
+	gpu_culling.update(object, model);
+	object_textures[object].model = model;
+}
+
+void VulkanRenderer::remove_object(u32 object) {
+	gpu_culling.remove(object);
+	object_textures[object].texture = VulkanBindless::NONE;
+}
+
+VulkanRenderer::CullingResources VulkanRenderer::add_gpu_culling_passes(RenderGraphResource pyramid) {
+	auto objects = render_graph.import_buffer(gpu_culling.object_buffer());
+	auto instances = render_graph.import_buffer(gpu_culling.instance_buffer());
+	auto commands = render_graph.import_buffer(gpu_culling.command_buffer());
+	auto counts = render_graph.import_buffer(gpu_culling.count_buffer());
+
+	if (auto size = gpu_culling.upload_size()) {
+		auto staging = frame().frame_allocator.alloc(size, alignof(InstanceData));
+		render_graph.add_pass("object uploads", {
+			{objects, RenderGraphUsage::TransferWrite},
+			{instances, RenderGraphUsage::TransferWrite}
+		}, [this, staging](vk::CommandBuffer cmd) {
+			gpu_culling.record_uploads(cmd, staging);
+		});
+	}
+
+	render_graph.add_pass("clear draw counts", {{counts, RenderGraphUsage::TransferWrite}}, [this](vk::CommandBuffer cmd) {
+		gpu_culling.record_clear_counts(cmd);
+	});
+
+	render_graph.add_pass("gpu culling", {
+		{objects, RenderGraphUsage::ComputeRead},
+		{pyramid, RenderGraphUsage::ComputeSampled},
+		{commands, RenderGraphUsage::ComputeWrite},
+		{counts, RenderGraphUsage::ComputeWrite}
+	}, [this](vk::CommandBuffer cmd) {
+		PROFILE_GPU_ZONE(gpu_profiler, cmd, "gpu culling");
+		gpu_culling.record_cull(
+			cmd,
+			frame().frame_allocator,
+			Frustum::from_view_projection(view_projection),
+			depth_pyramid,
+			pyramid_valid,
+			pyramid_view_projection);
+	});
+
+	return {instances, commands, counts};
+}
+
+void VulkanRenderer::draw_gpu_objects() {
+	auto cmd = frame().cmd;
+	if (!rendering) {
+		begin_rendering({});
+	}
+	PROFILE_GPU_ZONE(gpu_profiler, cmd, "gpu culled draws");
+
+	bind_pipeline(cmd, MATERIAL_MESH_INSTANCED);
+	InstancedPushConstants constants {
+		.view_projection = view_projection,
+		.texture_table = texture_streamer.table()
+	};
+	cmd.pushConstants(mesh_pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(constants), &constants);
+	// the draws' first instance is the object, which indexes its instance data
+	cmd.bindVertexBuffers(1, gpu_culling.instance_buffer(), vk::DeviceSize {0});
+	gpu_culling.record_draws(cmd, geometry.index_buffer);
+}
+
+void VulkanRenderer::record_main_pass(vk::CommandBuffer cmd) {
+	// the one bind of the frame's primary buffer, every mesh material shares the layout
+	bindless.bind(cmd, vk::PipelineBindPoint::eGraphics, mesh_pipeline_layout);
+	// secondaries can only be executed inside a rendering begun for them, inline draws get their own
+	if (!recorded_secondaries.empty()) {
+		PROFILE_GPU_ZONE(gpu_profiler, cmd, "render_parallel");
+		begin_rendering(vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+		cmd.executeCommands(recorded_secondaries);
+		end_rendering();
+		recorded_secondaries.clear();
+	}
+	if (settings.gpu_culling && !gpu_culling.empty()) {
+		draw_gpu_objects();
+	}
+	flush_draws();
+	// depth is always written, the pyramid reads it even if nothing was drawn
+	if (!rendered) {
+		begin_rendering({});
+	}
+	end_rendering();
+}
+
+void VulkanRenderer::render_parallel(JobSystem& jobs, std::span<const DrawCommand> draws) {
+	if (!frame_active || draws.empty()) {
+		return;
+	}
+	if (jobs.thread_index() == UINT32_MAX) {
+		throw std::runtime_error("vulkan: render_parallel has to be called from a job system thread");
+	}
+	if (frame().thread_commands.size() < jobs.thread_count()) {
+		create_thread_commands(jobs.thread_count());
+	}
+
+	auto batch_count = (draws.size() + DRAW_BATCH_SIZE - 1) / DRAW_BATCH_SIZE;
+	auto first_batch = recorded_secondaries.size();
+	recorded_secondaries.resize(first_batch + batch_count);
+
+	vk::CommandBufferInheritanceRenderingInfo rendering_inheritance {
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &format.format,
+		.depthAttachmentFormat = DEPTH_FORMAT,
+		.rasterizationSamples = vk::SampleCountFlagBits::e1
+	};
+	vk::CommandBufferInheritanceInfo inheritance {
+		.pNext = &rendering_inheritance
+	};
+	const vk::CommandBufferBeginInfo begin_info {
+		.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+		.pInheritanceInfo = &inheritance
+	};
+
+	JobCounter counter;
+	PROFILE_ZONE("VulkanRenderer::render_parallel");
+	request_textures(draws);
+	for (const auto& draw : draws) {
+		drawn_upload_value = std::max(drawn_upload_value, draw.mesh->upload_value);
+	}
+
+	jobs.parallel_for(as<u32>(draws.size()), DRAW_BATCH_SIZE, [&](u32 begin, u32 end) {
+		PROFILE_ZONE("record draws");
+		auto cmd = alloc_secondary(jobs.thread_index());
+		cmd.begin(begin_info);
+		// secondaries inherit no bound state from the primary
+		bindless.bind(cmd, vk::PipelineBindPoint::eGraphics, mesh_pipeline_layout);
+		bind_pipeline(cmd, MATERIAL_MESH);
+		for (u32 i = begin; i < end; ++i) {
+			record_draw(cmd, *draws[i].mesh, draws[i].model);
+		}
+		cmd.end();
+		// executed in batch order no matter which thread recorded it
+		recorded_secondaries[first_batch + begin / DRAW_BATCH_SIZE] = cmd;
+	}, counter);
+	jobs.wait(counter);
+}
+
+void VulkanRenderer::set_view_projection(const Mat4& new_view_projection) {
+	view_projection = new_view_projection;
+}
+
+void VulkanRenderer::set_clear_color(f32 r, f32 g, f32 b, f32 a) {
+	clear_color = vk::ClearColorValue {{{r, g, b, a}}};
+}
 
 void VulkanRenderer::begin(bool clear) {
+	PROFILE_ZONE("VulkanRenderer::begin");
+
 	vk::CommandBufferBeginInfo cmd_begin_info {
 			.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
 	};
 
-	if (device.waitForFences({submit_finished_fences[current_frame]}, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
-		logger->log("vulkan", "failed to wait for submit fence", LogLevel::Warn);
+	frame_active = false;
+
+	{
+		PROFILE_ZONE("wait for frame fence");
+		if (device.waitForFences({frame().submit_finished}, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+			logger->log("vulkan", "failed to wait for submit fence", LogLevel::Warn);
+		}
 	}
-	print_time_between_fn("waitForFences");
 
-	device.resetFences({submit_finished_fences[current_frame]});
-	print_time_between_fn("resetFences");
+	// without present wait the latency of a marked frame ends with its gpu work
+	if (frame().input_time) {
+		input_latency = ms_since(*frame().input_time);
+		frame().input_time.reset();
+	}
+	poll_presents();
 
-	auto res = device.acquireNextImageKHR(swapchain, UINT64_MAX, image_acquired_semaphores[current_frame]);
-	if (res.result == vk::Result::eErrorOutOfDateKHR || res.result == vk::Result::eSuboptimalKHR) {
-		//logger->log("vulkan", "using suboptimal or out of date swapchain", LogLevel::Warn);
+	for (auto& mesh : frame().mesh_destroy_queue) {
+		free_mesh(mesh);
 	}
-	print_time_between_fn("acquireNextImageKHR");
-	image_index = res.value;
+	frame().mesh_destroy_queue.clear();
+	bindless.begin_frame(frame_number);
+	frame().frame_allocator.reset();
 
-	vk::RenderingAttachmentInfo color_attachment_info {
-			.imageView = image_views[image_index],
-			.imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-			.loadOp = vk::AttachmentLoadOp::eClear,
-			.storeOp = vk::AttachmentStoreOp::eStore,
-	};
-	if (clear) {
-		color_attachment_info.clearValue.color = clear_color;
+	for (auto& commands : frame().thread_commands) {
+		device.resetCommandPool(commands.pool);
+		commands.used = 0;
 	}
+	destroy_retired_swapchains(false);
 
-	const vk::RenderingInfo render_info {
-			.renderArea {.extent = extent},
-			.layerCount = 1,
-			.colorAttachmentCount = 1,
-			.pColorAttachments = &color_attachment_info
-	};
+	if (headless()) {
+		image_index = current_frame;
+	}
+	else if (!acquire_image()) {
+		return;
+	}
 
+	// only reset once it's certain the frame is submitted, a skipped frame would leave it unsignaled
+	device.resetFences({frame().submit_finished});
+	frame_active = true;
+	clear_frame = clear;
+	rendered = false;
 
-	graphics_cmd_buffers[current_frame].reset();
-	print_time_between_fn("cmd_buf_reset");
+	frame().cmd.reset();
+	frame().cmd.begin(cmd_begin_info);
 
-	graphics_cmd_buffers[current_frame].begin(cmd_begin_info);
-	print_time_between_fn("cmd_buf_begin");
+	gpu_profiler.begin_frame(frame().cmd, current_frame);
 
-	/*const vk::ImageMemoryBarrier image_start_barrier {
-		.srcAccessMask = vk::AccessFlagBits::e
-		.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
-		.oldLayout = vk::ImageLayout::eUndefined,
-		.newLayout = vk::ImageLayout::eColorAttachmentOptimal,
-		.image = images[image_index],
-		.subresourceRange {
-				.aspectMask = vk::ImageAspectFlagBits::eColor,
-				.baseMipLevel = 0,
-				.levelCount = 1,
-				.baseArrayLayer = 0,
-				.layerCount = 1
+	// copies are only queued until flushed, meshes uploaded since the last finish have to go out before
+	// they can be acquired by this frame
+	uploader.flush();
+	upload_wait_value = uploader.acquire(frame().cmd);
+	// after the acquire, textures whose uploads it waits for are swapped into this frame's table
+	texture_streamer.update(frame_number, current_frame);
+	request_object_textures();
+}
+
+bool VulkanRenderer::acquire_image() {
+	PROFILE_ZONE("acquire image");
+	// a swapchain recreated because of an out of date error can already be out of date again if the window
+	// is still being resized, the frame is skipped rather than retrying indefinitely
+	for (u32 attempt = 0; attempt < 2; ++attempt) {
+		if (needs_recreate && !recreate_swapchain()) {
+			return false;
 		}
-	};
 
-	graphics_cmd_buffers[current_frame].pipelineBarrier(
-			vk::PipelineStageFlagBits::eTopOfPipe,
-			vk::PipelineStageFlagBits::eColorAttachmentOutput,
-			{},
-			{},
-			{},
-			{image_start_barrier}
-	);
-	print_time_between_fn("pipelineBarrier (start)");*/
+		try {
+			auto res = device.acquireNextImageKHR(swapchain, UINT64_MAX, frame().image_acquired);
+			// still presentable, it's replaced after this frame
+			if (res.result == vk::Result::eSuboptimalKHR) {
+				needs_recreate = true;
+			}
+			image_index = res.value;
+			return true;
+		}
+		catch (const vk::OutOfDateKHRError&) {
+			needs_recreate = true;
+		}
+	}
+	return false;
+}
 
-	//graphics_cmd_buffers[current_frame].beginRendering(render_info);
-	//print_time_between_fn("beginRendering");
+void VulkanRenderer::resize() {
+	needs_recreate = true;
 }
 
 void VulkanRenderer::finish() {
-	//graphics_cmd_buffers[current_frame].endRendering();
-	//print_time_between_fn("endRendering");
-
-	const vk::ImageMemoryBarrier image_barrier {
-		.srcAccessMask = vk::AccessFlagBits::eNone,
-		.dstAccessMask = vk::AccessFlagBits::eNone,
-		.oldLayout = vk::ImageLayout::eUndefined,
-		.newLayout = vk::ImageLayout::ePresentSrcKHR,
-		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.image = images[image_index],
-		.subresourceRange {
-			.aspectMask = vk::ImageAspectFlagBits::eColor,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1
-		}
+	PROFILE_ZONE("VulkanRenderer::finish");
+
+	if (!frame_active) {
+		// uploads still go out while the window is minimized
+		uploader.flush();
+		return;
+	}
+
+	// a mesh uploaded after begin and drawn by this frame is acquired before any pass reads it
+	if (drawn_upload_value > uploader.acquired_value()) {
+		uploader.flush();
+		upload_wait_value = std::max(upload_wait_value, uploader.acquire(frame().cmd));
+	}
+
+	// the swapchain image's previous contents are discarded, its first use waits on the acquire semaphore
+	auto color = render_graph.import_image(
+		images[image_index],
+		image_views[image_index],
+		vk::ImageAspectFlagBits::eColor,
+		VulkanAccess {vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, vk::ImageLayout::eUndefined},
+		final_layout);
+	auto depth = render_graph.create_image("depth", DEPTH_FORMAT, extent, vk::ImageAspectFlagBits::eDepth);
+	auto record_main = [&](vk::CommandBuffer cmd) {
+		depth_view = render_graph.view(depth);
+		record_main_pass(cmd);
 	};
 
-	/*graphics_cmd_buffers[current_frame].pipelineBarrier(
-			vk::PipelineStageFlagBits::eColorAttachmentOutput,
-			vk::PipelineStageFlagBits::eBottomOfPipe,
-			{},
-			{},
-			{},
-			{image_barrier});
-	print_time_between_fn("pipelineBarrier (end)");*/
+	if (!settings.gpu_culling) {
+		render_graph.add_pass("main", {
+			{color, RenderGraphUsage::ColorAttachment},
+			{depth, RenderGraphUsage::DepthAttachment}
+		}, record_main);
+	}
+	else {
+		auto pyramid = render_graph.import_image(depth_pyramid.image, depth_pyramid.view, vk::ImageAspectFlagBits::eColor);
+		if (gpu_culling.empty()) {
+			render_graph.add_pass("main", {
+				{color, RenderGraphUsage::ColorAttachment},
+				{depth, RenderGraphUsage::DepthAttachment}
+			}, record_main);
+		}
+		else {
+			auto culling = add_gpu_culling_passes(pyramid);
+			render_graph.add_pass("main", {
+				{color, RenderGraphUsage::ColorAttachment},
+				{depth, RenderGraphUsage::DepthAttachment},
+				{culling.instances, RenderGraphUsage::VertexAttribute},
+				{culling.commands, RenderGraphUsage::IndirectRead},
+				{culling.counts, RenderGraphUsage::IndirectRead}
+			}, record_main);
+		}
 
-	graphics_cmd_buffers[current_frame].end();
-	print_time_between_fn("cmd_buf_end");
+		// next frame's occlusion test uses this frame's depth
+		render_graph.add_pass("depth pyramid", {
+			{depth, RenderGraphUsage::ComputeSampled},
+			{pyramid, RenderGraphUsage::ComputeWrite}
+		}, [&](vk::CommandBuffer cmd) {
+			PROFILE_GPU_ZONE(gpu_profiler, cmd, "depth pyramid");
+			gpu_culling.record_pyramid(cmd, render_graph.view(depth), depth_pyramid);
+		});
+	}
 
-	vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	render_graph.execute(frame().cmd);
+	if (settings.gpu_culling) {
+		pyramid_view_projection = view_projection;
+		pyramid_valid = true;
+	}
 
-	vk::SubmitInfo submit_info {
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &image_acquired_semaphores[current_frame],
-		.pWaitDstStageMask = &wait_stage,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &graphics_cmd_buffers[current_frame],
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &render_finished_semaphores[current_frame]
-	};
+	gpu_profiler.end_frame(frame().cmd);
+	frame().cmd.end();
+
+	vk::Semaphore wait_semaphores[2];
+	vk::PipelineStageFlags wait_stages[2];
+	u64 wait_values[2];
+	u32 wait_count = 0;
+	if (!headless()) {
+		wait_semaphores[wait_count] = frame().image_acquired;
+		wait_stages[wait_count] = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+		// the value for the binary image semaphore is ignored
+		wait_values[wait_count++] = 0;
+	}
+	if (upload_wait_value) {
+		wait_semaphores[wait_count] = uploader.timeline;
+		wait_stages[wait_count] = VulkanUploader::CONSUMER_STAGES;
+		wait_values[wait_count++] = upload_wait_value;
+	}
 
-	graphics_queue.submit(submit_info, submit_finished_fences[current_frame]);
-	print_time_between_fn("submit");
+	vk::TimelineSemaphoreSubmitInfo timeline_info {
+		.waitSemaphoreValueCount = wait_count,
+		.pWaitSemaphoreValues = wait_values
+	};
 
-	vk::PresentInfoKHR present_info {
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &render_finished_semaphores[current_frame],
-		.swapchainCount = 1,
-		.pSwapchains = &swapchain,
-		.pImageIndices = &image_index
+	vk::SubmitInfo submit_info {
+		.pNext = &timeline_info,
+		.waitSemaphoreCount = wait_count,
+		.pWaitSemaphores = wait_semaphores,
+		.pWaitDstStageMask = wait_stages,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &frame().cmd,
+		.signalSemaphoreCount = headless() ? 0u : 1u,
+		.pSignalSemaphores = headless() ? nullptr : &present_semaphores[image_index]
 	};
 
-	if (graphics_queue.presentKHR(present_info) != vk::Result::eSuccess) {
-		logger->log("vulkan", "failed to present image", LogLevel::Warn);
+	{
+		PROFILE_ZONE("submit");
+		graphics_queue.submit(submit_info, frame().submit_finished);
+	}
+	gpu_profiler.submitted();
+
+	if (!headless()) {
+		PROFILE_ZONE("present");
+		vk::PresentIdKHR present_ids {
+			.swapchainCount = 1,
+			.pPresentIds = &present_id
+		};
+		if (present_wait) {
+			++present_id;
+			if (frame().input_time) {
+				pending_presents.push_back({present_id, swapchain, *frame().input_time});
+				frame().input_time.reset();
+			}
+		}
+		vk::PresentInfoKHR present_info {
+			.pNext = present_wait ? &present_ids : nullptr,
+			.waitSemaphoreCount = 1,
+			.pWaitSemaphores = &present_semaphores[image_index],
+			.swapchainCount = 1,
+			.pSwapchains = &swapchain,
+			.pImageIndices = &image_index
+		};
+
+		try {
+			if (graphics_queue.presentKHR(present_info) == vk::Result::eSuboptimalKHR) {
+				needs_recreate = true;
+			}
+		}
+		catch (const vk::OutOfDateKHRError&) {
+			needs_recreate = true;
+		}
+		poll_presents();
 	}
 
-	print_time_between_fn("presentKHR");
+	{
+		PROFILE_ZONE("flush uploads");
+		// submitting after the graphics work lets the copies overlap with this frame on the gpu
+		uploader.flush();
+	}
 
-	current_frame = (current_frame + 1) % FRAME_COUNT;
+	++frame_number;
+	current_frame = (current_frame + 1) % frames.size();
 }
 
 VulkanRenderer::~VulkanRenderer() {
 	device.waitIdle();
 
-	for (auto& semaphore : image_acquired_semaphores) {
-		device.destroy(semaphore);
+	for (auto& frame : frames) {
+		for (auto& mesh : frame.mesh_destroy_queue) {
+			free_mesh(mesh);
+		}
+		frame.frame_allocator.destroy();
+	}
+	uploader.destroy();
+	texture_streamer.destroy();
+	geometry.destroy();
+	destroy_depth_pyramid(depth_pyramid);
+	if (settings.gpu_culling) {
+		gpu_culling.destroy();
 	}
+	logger->info("vulkan", "render graph: {} transient bytes, {} passes culled in the last frame",
+		render_graph.transient_bytes(), render_graph.culled_pass_count());
+	render_graph.destroy();
 
-	for (auto& semaphore : render_finished_semaphores) {
+	for (auto& view : image_views) {
+		device.destroy(view);
+	}
+	for (auto& semaphore : present_semaphores) {
 		device.destroy(semaphore);
 	}
+	destroy_retired_swapchains(true);
+	if (headless()) {
+		for (usize i = 0; i < images.size(); ++i) {
+			device.destroy(images[i]);
+			allocator.free(offscreen_allocations[i]);
+		}
+	}
 
-	for (auto& fence : submit_finished_fences) {
-		device.destroy(fence);
+	// frees the texture images still waiting for removal, which needs the allocator
+	bindless.destroy();
+	allocator.log_stats(logger);
+	allocator.destroy();
+
+	gpu_profiler.destroy();
+
+	for (auto& frame : frames) {
+		device.destroy(frame.image_acquired);
+		device.destroy(frame.submit_finished);
+		for (auto& commands : frame.thread_commands) {
+			device.destroy(commands.pool);
+		}
 	}
+	for (auto pipeline : pipelines) {
+		device.destroy(pipeline);
+	}
+	device.destroy(mesh_pipeline_layout);
+	device.destroy(default_sampler);
+	pipeline_cache.destroy();
 
 	device.destroy(graphics_cmd_pool);
-	device.destroy(transfer_cmd_pool);
-	for (auto& view : image_views) {
-		device.destroy(view);
-	}
 	device.destroy(swapchain);
 	device.destroy();
 	instance.destroy(surface);
 	instance.destroy();
 }
-
-void VulkanRenderer::print_time_between_fn(std::string_view fn) {
-	auto now = chrono::high_resolution_clock::now();
-	auto diff = chrono::duration_cast<chrono::milliseconds>(now - last_fn_end);
-	last_fn_end = now;
-	if (diff.count() > 0) {
-		logger->log("vulkan", std::string("time between ")
-		+ last_fn_name + " and " + fn.data() + " is " + std::to_string(diff.count()) + "ms");
-	}
-	last_fn_name = fn;
-}
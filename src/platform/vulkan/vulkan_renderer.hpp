@@ -1,29 +1,143 @@
 #pragma once
 #include "types.hpp"
 #include "vulkan.hpp"
+#include "vulkan_allocator.hpp"
+#include "vulkan_frame_allocator.hpp"
+#include "vulkan_uploader.hpp"
+#include "vulkan_profiler.hpp"
+#include "vulkan_pipeline_cache.hpp"
+#include "vulkan_geometry_arena.hpp"
+#include "vulkan_gpu_culling.hpp"
+#include "vulkan_render_graph.hpp"
+#include "vulkan_bindless.hpp"
+#include "vulkan_texture_streamer.hpp"
+#include "mesh/gpu_mesh.hpp"
+#include "math/mat.hpp"
+#include "components/transform.hpp"
+#include "draw_command.hpp"
+#include "draw_batcher.hpp"
+#include "renderer_settings.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <span>
+#include <utility>
 
-class GpuMesh;
-struct Transform;
+class Mesh;
+struct MeshView;
+class JobSystem;
 class Logger;
 class Window;
-#include <chrono>
 
 class VulkanRenderer {
 public:
-	VulkanRenderer(Window* window, Logger* logger);
+	/// Pipelines are compiled on the job system's workers, so it has to be called from a job system thread.
+	VulkanRenderer(Window* window, Logger* logger, JobSystem& jobs, const RendererSettings& settings);
+	/// Headless renderer drawing into offscreen images, doesn't need a window, surface or swapchain.
+	VulkanRenderer(u32 width, u32 height, Logger* logger, JobSystem& jobs, const RendererSettings& settings);
 	~VulkanRenderer();
 
-	void render(const GpuMesh& mesh, const Transform& transform);
+	GpuMesh upload_mesh(const MeshView& mesh);
+	void destroy_mesh(GpuMesh& mesh);
+	/// Streamed texture id, its levels are uploaded over the following frames as draws need them.
+	u32 load_texture(const std::string& path);
+	void destroy_texture(u32 texture);
+	/// Queues a single draw, same as submitting it. The mesh has to stay alive until finish.
+	/// Inline since it's called per draw, with a fixed render backend it compiles down to the push_back.
+	void render(const GpuMesh& mesh, const Transform& transform) {
+		if (frame_active) {
+			queued_draws.push_back({.model = transform.matrix(), .mesh = &mesh});
+			drawn_upload_value = std::max(drawn_upload_value, mesh.upload_value);
+		}
+	}
+	/// Queues draws for the current frame. At finish they are sorted by material and mesh, draws of the same
+	/// mesh become one instanced draw and all of them are issued with a few indirect draw calls.
+	void submit(std::span<const DrawCommand> draws);
+	/// Records the draws into secondary command buffers on the job system's workers, they're executed
+	/// from the frame's primary buffer at finish. Has to be called from a job system thread between begin and finish.
+	void render_parallel(JobSystem& jobs, std::span<const DrawCommand> draws);
+	/// Adds an object which is drawn every frame until it's removed, culled on the gpu.
+	/// Only available with gpu culling, the mesh has to outlive the object.
+	u32 add_object(const GpuMesh& mesh, const Mat4& model);
+	void update_object(u32 object, const Mat4& model);
+	void remove_object(u32 object);
+	void set_view_projection(const Mat4& view_projection);
 	void set_clear_color(f32 r, f32 g, f32 b, f32 a);
+	/// The frame is skipped, turning rendering calls up to finish into no-ops, while the window is minimized.
 	void begin(bool clear);
 	void finish();
+	/// The swapchain is recreated at the start of the next frame.
+	void resize();
+	/// The current frame is the first to react to input read at time. With VK_KHR_present_wait the latency
+	/// ends when the frame is presented, otherwise when the gpu has finished it.
+	void mark_input(std::chrono::steady_clock::time_point time) {
+		if (frame_active && (!frame().input_time || time < *frame().input_time)) {
+			frame().input_time = time;
+		}
+	}
+	/// Milliseconds of the latest measured input latency, 0 if nothing was measured since the last call.
+	/// It's an upper bound, completed presents are only noticed at the next begin or finish, which can add up to
+	/// a frame plus the time the frame limiter sleeps.
+	f64 take_input_latency() {
+		return std::exchange(input_latency, 0);
+	}
+
+	/// Gpu time in milliseconds of the most recently completed frame, 0 if the queue doesn't support timestamps.
+	[[nodiscard]] f64 gpu_frame_time() const {
+		return gpu_profiler.frame_time();
+	}
 private:
-	void print_time_between_fn(std::string_view fn);
-	std::string last_fn_name {};
-	std::chrono::high_resolution_clock::time_point last_fn_end {};
+	void init(JobSystem& jobs);
+	void create_instance();
+	void pick_physical_device();
+	void create_device();
+	void create_swapchain(const vk::SurfaceCapabilitiesKHR& caps);
+	bool recreate_swapchain();
+	bool acquire_image();
+	void destroy_retired_swapchains(bool all);
+	/// measures the latency of marked frames whose present has completed
+	void poll_presents();
+	[[nodiscard]] vk::PresentModeKHR choose_present_mode() const;
+	void create_offscreen_images();
+	void create_frame_resources();
+	void create_depth_pyramid();
+	void destroy_depth_pyramid(VulkanDepthPyramid& pyramid);
+	[[nodiscard]] bool headless() const {
+		return !window;
+	}
+	struct Frame;
+	Frame& frame() {
+		return frames[current_frame];
+	}
+
+	void free_mesh(GpuMesh& mesh);
+	void create_pipelines(JobSystem& jobs);
+	vk::Pipeline create_pipeline(u32 material);
+	void create_thread_commands(u32 thread_count);
+	vk::CommandBuffer alloc_secondary(u32 thread_index);
+	void begin_rendering(vk::RenderingFlags flags);
+	void end_rendering();
+	void bind_pipeline(vk::CommandBuffer cmd, u32 material) const;
+	void record_draw(vk::CommandBuffer cmd, const GpuMesh& mesh, const Mat4& model) const;
+	void flush_draws();
+	/// tells the streamer how large the draws' textures end up on screen
+	void request_textures(std::span<const DrawCommand> draws);
+	void request_object_textures();
+	[[nodiscard]] f32 screen_size(const Mat4& model, const Aabb& bounds) const;
+	void draw_gpu_objects();
+	/// the gpu culling buffers the main pass draws from
+	struct CullingResources {
+		RenderGraphResource instances;
+		RenderGraphResource commands;
+		RenderGraphResource counts;
+	};
+	CullingResources add_gpu_culling_passes(RenderGraphResource pyramid);
+	void record_main_pass(vk::CommandBuffer cmd);
 
 	Window* window;
 	Logger* logger;
+	RendererSettings settings;
 
 	vk::DynamicLoader dl {};
 	vk::Instance instance;
@@ -34,25 +148,143 @@ private:
 	u32 graphics_family;
 	vk::Queue transfer_queue;
 	u32 transfer_family;
+	/// VK_EXT_memory_budget is enabled, the texture budget follows what the device reports as free
+	bool memory_budget {};
+	/// bc compressed formats can be sampled, load_texture returns no texture otherwise
+	bool textures_supported {};
 
 	vk::Extent2D extent;
 
-	constexpr static usize FRAME_COUNT = 2;
+	constexpr static vk::DeviceSize STAGING_SIZE = 64 * 1024 * 1024;
+	constexpr static vk::DeviceSize VERTEX_ARENA_SIZE = 128 * 1024 * 1024;
+	constexpr static vk::DeviceSize INDEX_ARENA_SIZE = 64 * 1024 * 1024;
+	/// per frame slot, grows if a frame needs more
+	constexpr static vk::DeviceSize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024;
 
 	vk::SwapchainKHR swapchain;
 	u32 current_frame {};
 	u32 image_index {};
 	std::vector<vk::Image> images {};
 	std::vector<vk::ImageView> image_views {};
-	vk::CommandPool graphics_cmd_pool;
-	vk::CommandBuffer graphics_cmd_buffers[FRAME_COUNT] {};
-	vk::CommandPool transfer_cmd_pool;
-	vk::CommandBuffer transfer_cmd_buffer;
+	/// one per swapchain image, a frame slot's semaphore could still be in use by an earlier present of another image
+	std::vector<vk::Semaphore> present_semaphores {};
 	vk::SurfaceFormatKHR format;
 	vk::PresentModeKHR mode;
-	vk::Semaphore image_acquired_semaphores[FRAME_COUNT] {};
-	vk::Semaphore render_finished_semaphores[FRAME_COUNT] {};
-	vk::Fence submit_finished_fences[FRAME_COUNT] {};
+	bool needs_recreate {};
+	/// false while the frame is skipped
+	bool frame_active {};
+	/// frames submitted so far
+	u64 frame_number {};
+
+	/// VK_KHR_present_id and VK_KHR_present_wait are enabled, every present gets the next id
+	bool present_wait {};
+	u64 present_id {};
+	/// presents of frames marked with input, oldest first
+	struct PendingPresent {
+		u64 id;
+		/// the swapchain the frame was presented to, it may have been replaced since
+		vk::SwapchainKHR swapchain;
+		std::chrono::steady_clock::time_point input_time;
+	};
+	std::deque<PendingPresent> pending_presents {};
+	f64 input_latency {};
+
+	VulkanRenderGraph render_graph {};
+	/// transient render graph image, view of the current frame's
+	vk::ImageView depth_view;
+	constexpr static vk::Format DEPTH_FORMAT = vk::Format::eD32Sfloat;
+
+	/// swapchains replaced by a recreation, destroyed once every frame that could have used them has finished
+	struct RetiredSwapchain {
+		vk::SwapchainKHR swapchain;
+		std::vector<vk::ImageView> image_views;
+		std::vector<vk::Semaphore> present_semaphores;
+		VulkanDepthPyramid pyramid;
+		u64 frame_number;
+	};
+	std::deque<RetiredSwapchain> retired_swapchains {};
+
+	/// layout the image is left in at the end of the frame
+	vk::ImageLayout final_layout {};
+	std::vector<VulkanAllocation> offscreen_allocations {};
+
+	VulkanGpuProfiler gpu_profiler {};
+
+	VulkanAllocator allocator {};
+	VulkanUploader uploader {};
+	u64 upload_wait_value {};
+	/// highest upload value of a mesh drawn so far, a frame drawing one that isn't acquired yet acquires it at finish
+	u64 drawn_upload_value {};
+	VulkanGeometryArena geometry {};
+	/// drawIndexedIndirect with a draw count above 1 and a first instance, otherwise batches are drawn directly
+	bool multi_draw_indirect {};
+
+	VulkanGpuCulling gpu_culling {};
+	/// only created with gpu culling, sized like the swapchain
+	VulkanDepthPyramid depth_pyramid {};
+	/// the pyramid holds the depth of the last rendered frame, drawn with pyramid_view_projection
+	bool pyramid_valid {};
+	Mat4 pyramid_view_projection {Mat4::identity()};
+
+	VulkanPipelineCache pipeline_cache {};
+
+	enum Material : u32 {
+		MATERIAL_MESH,
+		MATERIAL_MESH_INSTANCED,
+		MATERIAL_COUNT
+	};
+
+	VulkanBindless bindless {};
+	/// bindless sampler handle 0, textures are sampled with it
+	vk::Sampler default_sampler;
+	VulkanTextureStreamer texture_streamer {};
+
+	/// bounds and texture of every gpu object, the streamer needs their screen sizes like those of submitted draws
+	struct ObjectTexture {
+		Mat4 model;
+		Aabb bounds;
+		u32 texture {VulkanBindless::NONE};
+	};
+	std::vector<ObjectTexture> object_textures {};
+	/// objects whose textures are requested each frame, a window moving round robin over all of them
+	constexpr static u32 OBJECT_TEXTURE_REQUESTS = 1024;
+	u32 object_texture_cursor {};
+
+	/// shared by every mesh material so the bindless set stays bound across pipeline switches
+	vk::PipelineLayout mesh_pipeline_layout;
+	vk::Pipeline pipelines[MATERIAL_COUNT] {};
+
+	/// command pools can't be used from several threads, so every worker gets its own pool per frame
+	struct ThreadCommands {
+		vk::CommandPool pool;
+		std::vector<vk::CommandBuffer> secondaries {};
+		u32 used {};
+	};
+
+	struct Frame {
+		vk::CommandBuffer cmd;
+		vk::Semaphore image_acquired;
+		vk::Fence submit_finished;
+		/// meshes destroyed while the slot was current, freed once its fence is waited on again
+		std::vector<GpuMesh> mesh_destroy_queue {};
+		std::vector<ThreadCommands> thread_commands {};
+		/// instance data, indirect commands, uniforms and staging written for the frame
+		VulkanFrameAllocator frame_allocator {};
+		/// from mark_input, measured when the slot's fence is waited on again unless the present is waited for
+		std::optional<std::chrono::steady_clock::time_point> input_time {};
+	};
+	vk::CommandPool graphics_cmd_pool;
+	std::vector<Frame> frames {};
+	/// recorded by render_parallel, executed in the frame's main pass
+	std::vector<vk::CommandBuffer> recorded_secondaries {};
+	/// draws submitted for the current frame
+	std::vector<DrawCommand> queued_draws {};
+	DrawBatcher batcher {};
+
+	bool clear_frame {};
+	bool rendering {};
+	bool rendered {};
 
+	Mat4 view_projection {Mat4::identity()};
 	vk::ClearColorValue clear_color {};
 };
\ No newline at end of file
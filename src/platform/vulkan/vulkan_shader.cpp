@@ -0,0 +1,20 @@
+#include "vulkan_shader.hpp"
+#include "types.hpp"
+#include <fstream>
+#include <vector>
+
+vk::ShaderModule load_shader_module(vk::Device device, const std::string& path) {
+	std::ifstream file {path, std::ios::binary | std::ios::ate};
+	if (!file) {
+		throw std::runtime_error("vulkan: failed to open shader '" + path + "'");
+	}
+	auto size = as<usize>(file.tellg());
+	std::vector<u32> code(size / sizeof(u32));
+	file.seekg(0);
+	file.read(cast<char*>(code.data()), as<std::streamsize>(code.size() * sizeof(u32)));
+
+	return device.createShaderModule({
+		.codeSize = code.size() * sizeof(u32),
+		.pCode = code.data()
+	});
+}
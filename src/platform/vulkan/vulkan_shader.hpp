@@ -0,0 +1,6 @@
+#pragma once
+#include "vulkan.hpp"
+#include <string>
+
+/// Creates a shader module from a compiled spir-v file.
+vk::ShaderModule load_shader_module(vk::Device device, const std::string& path);
\ No newline at end of file
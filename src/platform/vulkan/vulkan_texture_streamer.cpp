@@ -0,0 +1,439 @@
+#include "vulkan_texture_streamer.hpp"
+#include "vulkan_uploader.hpp"
+#include "logger.hpp"
+#include "profiler/profiler.hpp"
+#include <cmath>
+#include <cstring>
+
+/// texture ids, entries in every table
+constexpr u32 MAX_TEXTURES = 16384;
+/// every texture starts with the levels up to this size, small enough to load without asking the budget
+constexpr u32 INITIAL_SIZE = 64;
+/// textures no draw asked for in this many frames are evicted first and stop streaming in.
+/// Longer than it takes VulkanRenderer to request the textures of every gpu object once
+constexpr u64 REQUEST_TIMEOUT = 120;
+/// the budget query goes to the kernel on some drivers, so it isn't made every frame
+constexpr u64 BUDGET_INTERVAL = 16;
+/// memory VK_EXT_memory_budget reports as free which is left for everything else, out of 16
+constexpr u64 BUDGET_HEADROOM = 2;
+
+static vk::Format vulkan_format(TextureFormat format) {
+	switch (format) {
+		case TextureFormat::Bc7Srgb:
+			return vk::Format::eBc7SrgbBlock;
+		case TextureFormat::Bc5Unorm:
+			return vk::Format::eBc5UnormBlock;
+	}
+	return vk::Format::eUndefined;
+}
+
+/// finest level of the tail every texture starts out with
+static u32 initial_mip(const TextureFile& file) {
+	u32 mip = 0;
+	while (mip + 1 < file.mip_count()
+		&& std::max(mip_dimension(file.width(), mip), mip_dimension(file.height(), mip)) > INITIAL_SIZE) {
+		++mip;
+	}
+	return mip;
+}
+
+/// bytes of the levels from first_mip down
+static u64 tail_size(const TextureFile& file, u32 first_mip) {
+	u64 size = 0;
+	for (u32 mip = first_mip; mip < file.mip_count(); ++mip) {
+		size += texture_mip_size(file.width(), file.height(), mip);
+	}
+	return size;
+}
+
+void VulkanTextureStreamer::Read::run() {
+	PROFILE_ZONE("read texture");
+	try {
+		if (!file) {
+			file.emplace(path);
+		}
+		if (first_mip == UINT32_MAX) {
+			first_mip = initial_mip(*file);
+		}
+
+		data.resize(tail_size(*file, first_mip));
+		auto dst = data.data();
+		for (u32 mip = first_mip; mip < file->mip_count(); ++mip) {
+			auto level = file->mip(mip);
+			memcpy(dst, level.data(), level.size());
+			dst += level.size();
+		}
+	}
+	catch (const std::exception& e) {
+		error = e.what();
+	}
+}
+
+void VulkanTextureStreamer::init(
+		vk::Device new_device,
+		vk::PhysicalDevice new_phys_device,
+		VulkanAllocator* new_allocator,
+		VulkanUploader* new_uploader,
+		VulkanBindless* new_bindless,
+		JobSystem* new_jobs,
+		Logger* new_logger,
+		const RendererSettings& settings,
+		bool new_memory_budget) {
+	device = new_device;
+	phys_device = new_phys_device;
+	allocator = new_allocator;
+	uploader = new_uploader;
+	bindless = new_bindless;
+	jobs = new_jobs;
+	logger = new_logger;
+	settings_budget = settings.texture_budget;
+	upload_per_frame = settings.texture_upload_per_frame;
+	memory_budget = new_memory_budget;
+
+	auto memory_properties = phys_device.getMemoryProperties();
+	for (u32 i = 0; i < memory_properties.memoryHeapCount; ++i) {
+		const auto& h = memory_properties.memoryHeaps[i];
+		if (h.flags & vk::MemoryHeapFlagBits::eDeviceLocal && h.size > heap_size) {
+			heap = i;
+			heap_size = h.size;
+		}
+	}
+	// without the extension half of the heap is assumed to be free for textures
+	budget = std::min(settings_budget, heap_size / 2);
+
+	// the buffers are read by every draw, device local host visible memory keeps those reads fast where there is some
+	const vk::DeviceSize table_size = MAX_TEXTURES * sizeof(u32);
+	tables.resize(settings.frames_in_flight);
+	for (auto& table : tables) {
+		table.buffer = device.createBuffer({
+			.size = table_size,
+			.usage = vk::BufferUsageFlagBits::eStorageBuffer,
+			.sharingMode = vk::SharingMode::eExclusive
+		});
+		table.allocation = allocator->alloc_buffer(
+			table.buffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+		// every byte 0xff makes every entry VulkanBindless::NONE
+		memset(table.allocation.mapped, 0xff, table_size);
+		table.handle = bindless->add_buffer(table.buffer);
+	}
+}
+
+void VulkanTextureStreamer::destroy() {
+	for (auto& texture : textures) {
+		if (texture.read) {
+			jobs->wait(texture.read->counter);
+		}
+		for (auto image : {&texture.resident, &texture.pending}) {
+			if (image->image) {
+				device.destroy(image->view);
+				device.destroy(image->image);
+				allocator->free(image->allocation);
+			}
+		}
+	}
+	textures.clear();
+
+	for (auto& table : tables) {
+		device.destroy(table.buffer);
+		allocator->free(table.allocation);
+	}
+}
+
+u32 VulkanTextureStreamer::load(const std::string& path) {
+	u32 id;
+	if (!free_ids.empty()) {
+		id = free_ids.back();
+		free_ids.pop_back();
+	}
+	else if (textures.size() == MAX_TEXTURES) {
+		throw std::runtime_error("vulkan: too many textures");
+	}
+	else {
+		id = as<u32>(textures.size());
+		textures.emplace_back();
+		entries.push_back(VulkanBindless::NONE);
+	}
+
+	auto& texture = textures[id];
+	texture.used = true;
+	texture.path = path;
+	start_read(id, UINT32_MAX);
+	return id;
+}
+
+void VulkanTextureStreamer::destroy_texture(u32 id) {
+	if (id >= textures.size() || !textures[id].used) {
+		return;
+	}
+	textures[id].destroyed = true;
+	entries[id] = VulkanBindless::NONE;
+	++entries_version;
+}
+
+void VulkanTextureStreamer::start_read(u32 id, u32 first_mip) {
+	auto& texture = textures[id];
+	texture.read = std::make_unique<Read>();
+	auto& read = *texture.read;
+	read.path = texture.path;
+	read.file = std::move(texture.file);
+	texture.file.reset();
+	read.first_mip = first_mip;
+	if (read.file) {
+		frame_upload_bytes += tail_size(*read.file, first_mip);
+	}
+
+	jobs->submit([read = &read] {
+		read->run();
+	}, &read.counter);
+}
+
+void VulkanTextureStreamer::finish_read(u32 id) {
+	auto& texture = textures[id];
+	auto read = std::move(texture.read);
+	texture.file = std::move(read->file);
+	if (!read->error.empty()) {
+		logger->log("vulkan", read->error, LogLevel::Warn);
+		texture.failed = true;
+		return;
+	}
+	if (texture.destroyed) {
+		return;
+	}
+
+	const auto& file = *texture.file;
+	auto first_mip = read->first_mip;
+	auto mip_count = file.mip_count() - first_mip;
+	auto format = vulkan_format(file.format());
+
+	Image image {.first_mip = first_mip};
+	image.image = device.createImage({
+		.imageType = vk::ImageType::e2D,
+		.format = format,
+		.extent {mip_dimension(file.width(), first_mip), mip_dimension(file.height(), first_mip), 1},
+		.mipLevels = mip_count,
+		.arrayLayers = 1,
+		.samples = vk::SampleCountFlagBits::e1,
+		.tiling = vk::ImageTiling::eOptimal,
+		.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+		.sharingMode = vk::SharingMode::eExclusive,
+		.initialLayout = vk::ImageLayout::eUndefined
+	});
+	image.allocation = allocator->alloc_image(image.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	image.view = device.createImageView({
+		.image = image.image,
+		.viewType = vk::ImageViewType::e2D,
+		.format = format,
+		.subresourceRange {
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = mip_count,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	});
+	texture_bytes += image.allocation.size;
+
+	uploader->begin_image(image.image, mip_count);
+	auto src = read->data.data();
+	for (u32 mip = first_mip; mip < file.mip_count(); ++mip) {
+		vk::Extent2D extent {mip_dimension(file.width(), mip), mip_dimension(file.height(), mip)};
+		uploader->upload_image(src, image.image, mip - first_mip, extent, TEXTURE_BLOCK_BYTES);
+		src += texture_mip_size(file.width(), file.height(), mip);
+	}
+	texture.pending_value = uploader->end_image(image.image, mip_count);
+	texture.pending = image;
+}
+
+void VulkanTextureStreamer::promote(u32 id) {
+	auto& texture = textures[id];
+	texture.pending.handle = bindless->add_texture(texture.pending.view);
+	retire(texture.resident);
+	texture.resident = texture.pending;
+	texture.pending = {};
+	if (!texture.destroyed) {
+		entries[id] = texture.resident.handle;
+		++entries_version;
+	}
+}
+
+void VulkanTextureStreamer::release(u32 id) {
+	retire(textures[id].resident);
+	textures[id] = {};
+	free_ids.push_back(id);
+}
+
+void VulkanTextureStreamer::retire(Image& image) {
+	if (!image.image) {
+		return;
+	}
+	// frames in flight may still sample it through their tables
+	bindless->remove(VulkanBindless::KIND_TEXTURE, image.handle, [this, image]() mutable {
+		device.destroy(image.view);
+		device.destroy(image.image);
+		texture_bytes -= image.allocation.size;
+		allocator->free(image.allocation);
+	});
+	image = {};
+}
+
+u64 VulkanTextureStreamer::committed_bytes(const Texture& texture) const {
+	if (texture.read) {
+		return texture.read->file ? tail_size(*texture.read->file, texture.read->first_mip) : 0;
+	}
+	if (texture.pending.image) {
+		return texture.pending.allocation.size;
+	}
+	return texture.resident.allocation.size;
+}
+
+void VulkanTextureStreamer::update(u64 new_frame_number, u32 frame_slot) {
+	PROFILE_ZONE("VulkanTextureStreamer::update");
+	frame_number = new_frame_number;
+	slot = frame_slot;
+	frame_upload_bytes = 0;
+
+	for (u32 id = 0; id < textures.size(); ++id) {
+		auto& texture = textures[id];
+		if (!texture.used) {
+			continue;
+		}
+
+		if (texture.read && texture.read->counter.done()) {
+			finish_read(id);
+		}
+		// the frame being recorded acquired the upload and waits for it, so its draws can sample the image
+		if (texture.pending.image && texture.pending_value <= uploader->acquired_value()) {
+			promote(id);
+		}
+		if (texture.destroyed && !texture.read && !texture.pending.image) {
+			release(id);
+			continue;
+		}
+
+		// the demand of the last frame, textures still being opened keep theirs until the size is known
+		if (texture.requested_size > 0 && texture.file) {
+			auto size = as<f32>(std::max(texture.file->width(), texture.file->height()));
+			u32 mip = 0;
+			if (texture.requested_size < size) {
+				mip = as<u32>(std::log2(size / std::max(texture.requested_size, 1.0f)));
+			}
+			texture.wanted_mip = std::min(mip, texture.file->mip_count() - 1);
+			texture.last_requested = frame_number;
+			texture.requested_size = 0;
+		}
+	}
+
+	if (frame_number % BUDGET_INTERVAL == 0) {
+		update_budget();
+	}
+	stream();
+
+	auto& table = tables[slot];
+	if (table.version != entries_version) {
+		memcpy(table.allocation.mapped, entries.data(), entries.size() * sizeof(u32));
+		table.version = entries_version;
+	}
+}
+
+void VulkanTextureStreamer::update_budget() {
+	if (!memory_budget) {
+		return;
+	}
+	auto properties = phys_device.getMemoryProperties2<
+		vk::PhysicalDeviceMemoryProperties2,
+		vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+	const auto& heap_budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+	// the usage includes the textures, so they may grow to what they hold plus what's left of the heap's budget
+	auto headroom = heap_budget.heapBudget[heap] * BUDGET_HEADROOM / 16;
+	auto usage = heap_budget.heapUsage[heap] + headroom;
+	auto available = heap_budget.heapBudget[heap] > usage ? heap_budget.heapBudget[heap] - usage : 0;
+	auto new_budget = std::min(settings_budget, texture_bytes + available);
+	if (new_budget < settings_budget && budget == settings_budget) {
+		logger->warn("vulkan", "device memory is short, the texture budget is lowered to {} MiB", new_budget / (1024 * 1024));
+	}
+	budget = new_budget;
+}
+
+void VulkanTextureStreamer::stream() {
+	u64 committed = 0;
+	candidates.clear();
+	for (u32 id = 0; id < textures.size(); ++id) {
+		const auto& texture = textures[id];
+		if (!texture.used) {
+			continue;
+		}
+		committed += committed_bytes(texture);
+		// one change at a time per texture, each one starts from the resident image
+		if (!texture.destroyed && !texture.failed && !texture.read && !texture.pending.image && texture.resident.image) {
+			candidates.push_back(id);
+		}
+	}
+
+	auto within_upload_budget = [&](u64 size) {
+		// one read always goes, levels bigger than the per frame budget would otherwise never stream in
+		return frame_upload_bytes == 0 || frame_upload_bytes + size <= upload_per_frame;
+	};
+
+	if (committed > budget) {
+		// the textures that went unrequested the longest lose a level first, then the ones with the most
+		// detail beyond what the screen needs
+		std::sort(candidates.begin(), candidates.end(), [&](u32 a, u32 b) {
+			const auto& ta = textures[a];
+			const auto& tb = textures[b];
+			if (ta.last_requested != tb.last_requested) {
+				return ta.last_requested < tb.last_requested;
+			}
+			return as<i64>(ta.wanted_mip) - ta.resident.first_mip > as<i64>(tb.wanted_mip) - tb.resident.first_mip;
+		});
+
+		for (auto id : candidates) {
+			if (committed <= budget) {
+				break;
+			}
+			auto& texture = textures[id];
+			const auto& file = *texture.file;
+			// the initial levels are never evicted, they cost next to nothing and keep the texture visible
+			auto first_mip = texture.resident.first_mip;
+			if (first_mip >= initial_mip(file)) {
+				continue;
+			}
+			auto size = tail_size(file, first_mip + 1);
+			if (!within_upload_budget(size)) {
+				break;
+			}
+			committed = committed - texture.resident.allocation.size + size;
+			start_read(id, first_mip + 1);
+		}
+		return;
+	}
+
+	// the textures furthest from the detail they're drawn at go first
+	std::erase_if(candidates, [&](u32 id) {
+		const auto& texture = textures[id];
+		return texture.resident.first_mip <= texture.wanted_mip || frame_number - texture.last_requested > REQUEST_TIMEOUT;
+	});
+	std::sort(candidates.begin(), candidates.end(), [&](u32 a, u32 b) {
+		const auto& ta = textures[a];
+		const auto& tb = textures[b];
+		return ta.resident.first_mip - ta.wanted_mip > tb.resident.first_mip - tb.wanted_mip;
+	});
+
+	for (auto id : candidates) {
+		auto& texture = textures[id];
+		const auto& file = *texture.file;
+		auto first_mip = texture.resident.first_mip - 1;
+		// the next level roughly adds its own size, a smaller texture further down may still fit
+		if (committed + texture_mip_size(file.width(), file.height(), first_mip) > budget) {
+			continue;
+		}
+		auto size = tail_size(file, first_mip);
+		if (!within_upload_budget(size)) {
+			break;
+		}
+		committed += texture_mip_size(file.width(), file.height(), first_mip);
+		start_read(id, first_mip);
+	}
+}
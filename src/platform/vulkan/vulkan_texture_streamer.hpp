@@ -0,0 +1,157 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "vulkan_allocator.hpp"
+#include "vulkan_bindless.hpp"
+#include "texture/texture_file.hpp"
+#include "jobs/job_system.hpp"
+#include "renderer_settings.hpp"
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class VulkanUploader;
+class Logger;
+
+/// Block compressed textures whose mip levels are streamed in and out of device memory. Files are read on the
+/// job system, uploads go through the uploader's transfer queue, and the levels kept resident follow the screen
+/// size draws request within a memory budget. A texture is one image holding its finest resident level and
+/// everything below, changing the resident levels uploads a new image which replaces the old one once the
+/// graphics queue has acquired it. Shaders see stable texture ids, a per frame table in a bindless storage
+/// buffer maps them to the bindless handle of the texture's current image.
+class VulkanTextureStreamer {
+public:
+	/// memory_budget tells whether VK_EXT_memory_budget is enabled, without it the budget is a guess from the heap size.
+	void init(
+			vk::Device device,
+			vk::PhysicalDevice phys_device,
+			VulkanAllocator* allocator,
+			VulkanUploader* uploader,
+			VulkanBindless* bindless,
+			JobSystem* jobs,
+			Logger* logger,
+			const RendererSettings& settings,
+			bool memory_budget);
+	/// The device has to be idle, images waiting in the bindless heap for removal are freed by it.
+	void destroy();
+
+	/// Starts reading the file on the job system and returns the texture's id right away. The id maps to no
+	/// texture until the coarsest levels are uploaded, a file that fails to load is logged and stays that way.
+	u32 load(const std::string& path);
+	/// Draws must not use the id afterwards, it's reused once its reads and uploads are done.
+	void destroy_texture(u32 texture);
+	/// Asks for the texture to be sharp when drawn screen_size pixels across. Called for every draw using it,
+	/// the largest size of a frame counts.
+	void request(u32 texture, f32 screen_size) {
+		if (texture < textures.size()) {
+			textures[texture].requested_size = std::max(textures[texture].requested_size, screen_size);
+		}
+	}
+
+	/// Call once per frame after the uploader's acquire and before recording draws. Swaps in the images whose
+	/// uploads the frame acquired, starts reads and uploads within the budgets and writes the frame's table.
+	void update(u64 frame_number, u32 frame_slot);
+
+	/// Bindless storage buffer handle of the current frame's table, indexed by texture id.
+	[[nodiscard]] u32 table() const {
+		return tables[slot].handle;
+	}
+	/// Device memory held by texture images, including ones still being uploaded or waiting for removal.
+	[[nodiscard]] u64 resident_bytes() const {
+		return texture_bytes;
+	}
+private:
+	/// an image holding a texture's levels from first_mip down
+	struct Image {
+		vk::Image image;
+		vk::ImageView view;
+		VulkanAllocation allocation {};
+		u32 first_mip {};
+		u32 handle {VulkanBindless::NONE};
+	};
+
+	/// Copies levels out of the file on a worker, so the page faults of reading it never stall a frame.
+	/// The first read of a texture opens the file and picks the levels itself.
+	struct Read {
+		JobCounter counter {};
+		std::string path {};
+		/// moved in and out by the main thread, only touched by the job while it runs
+		std::optional<TextureFile> file {};
+		/// UINT32_MAX picks the levels every texture starts with
+		u32 first_mip {};
+		/// first_mip and every level below back to back
+		std::vector<u8> data {};
+		std::string error {};
+
+		void run();
+	};
+
+	struct Texture {
+		std::string path {};
+		/// empty while a read has it or if loading failed
+		std::optional<TextureFile> file {};
+		std::unique_ptr<Read> read {};
+		Image resident {};
+		/// uploaded, replaces resident once the graphics queue has acquired pending_value
+		Image pending {};
+		u64 pending_value {};
+		/// finest level the last frame requesting the texture needed
+		u32 wanted_mip {UINT32_MAX};
+		f32 requested_size {};
+		u64 last_requested {};
+		bool used {};
+		bool failed {};
+		/// released once its read and upload are done
+		bool destroyed {};
+	};
+
+	/// per frame slot, written when the slot's frame begins
+	struct Table {
+		vk::Buffer buffer;
+		VulkanAllocation allocation {};
+		u32 handle {VulkanBindless::NONE};
+		u64 version {};
+	};
+
+	void start_read(u32 texture, u32 first_mip);
+	void finish_read(u32 texture);
+	void promote(u32 texture);
+	void release(u32 texture);
+	void retire(Image& image);
+	void update_budget();
+	void stream();
+	/// bytes of the texture's image once its running read or upload has finished
+	[[nodiscard]] u64 committed_bytes(const Texture& texture) const;
+
+	vk::Device device;
+	vk::PhysicalDevice phys_device;
+	VulkanAllocator* allocator {};
+	VulkanUploader* uploader {};
+	VulkanBindless* bindless {};
+	JobSystem* jobs {};
+	Logger* logger {};
+
+	u64 settings_budget {};
+	u64 upload_per_frame {};
+	bool memory_budget {};
+	/// the largest device local heap, where the images end up
+	u32 heap {};
+	u64 heap_size {};
+	u64 budget {};
+	u64 texture_bytes {};
+	/// bytes read for uploads started this frame
+	u64 frame_upload_bytes {};
+
+	std::vector<Texture> textures {};
+	std::vector<u32> free_ids {};
+	/// bindless handle of every texture id, copied into the frame's table when it changed
+	std::vector<u32> entries {};
+	u64 entries_version {1};
+	std::vector<Table> tables {};
+	u32 slot {};
+	u64 frame_number {};
+	/// reused every update
+	std::vector<u32> candidates {};
+};
\ No newline at end of file
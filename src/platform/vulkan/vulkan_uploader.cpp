@@ -0,0 +1,388 @@
+#include "vulkan_uploader.hpp"
+#include "vulkan_utils.hpp"
+#include <algorithm>
+#include <cstring>
+
+static vk::ImageSubresourceRange color_mips(u32 mip_count) {
+	return {
+		.aspectMask = vk::ImageAspectFlagBits::eColor,
+		.baseMipLevel = 0,
+		.levelCount = mip_count,
+		.baseArrayLayer = 0,
+		.layerCount = 1
+	};
+}
+
+void VulkanUploader::init(
+		vk::Device p_device,
+		VulkanAllocator* p_allocator,
+		vk::Queue p_transfer_queue,
+		u32 p_transfer_family,
+		u32 p_graphics_family,
+		vk::DeviceSize p_staging_size) {
+	device = p_device;
+	allocator = p_allocator;
+	transfer_queue = p_transfer_queue;
+	transfer_family = p_transfer_family;
+	graphics_family = p_graphics_family;
+	staging_size = p_staging_size;
+
+	vk::BufferCreateInfo buffer_info {
+		.size = staging_size,
+		.usage = vk::BufferUsageFlagBits::eTransferSrc,
+		.sharingMode = vk::SharingMode::eExclusive
+	};
+	staging_buffer = device.createBuffer(buffer_info);
+
+	staging_allocation = allocator->alloc_buffer(
+			staging_buffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+	staging_ptr = staging_allocation.mapped;
+
+	vk::SemaphoreTypeCreateInfo type_info {
+		.semaphoreType = vk::SemaphoreType::eTimeline,
+		.initialValue = 0
+	};
+	vk::SemaphoreCreateInfo semaphore_info {
+		.pNext = &type_info
+	};
+	timeline = device.createSemaphore(semaphore_info);
+
+	vk::CommandPoolCreateInfo cmd_pool_info {
+		.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient,
+		.queueFamilyIndex = transfer_family
+	};
+	cmd_pool = device.createCommandPool(cmd_pool_info);
+}
+
+void VulkanUploader::destroy() {
+	flush();
+	wait(last_flushed_value);
+
+	device.destroy(cmd_pool);
+	device.destroy(timeline);
+	device.destroy(staging_buffer);
+	allocator->free(staging_allocation);
+}
+
+u64 VulkanUploader::upload_buffer(const void* data, vk::DeviceSize size, vk::Buffer dst, vk::DeviceSize dst_offset) {
+	// uploads bigger than a fraction of the ring are split so they never have to wait for the whole ring
+	const vk::DeviceSize max_chunk = staging_size / 4;
+
+	auto src = as<const u8*>(data);
+	while (size) {
+		auto chunk = std::min(size, max_chunk);
+		auto offset = alloc_staging(chunk);
+		memcpy(staging_ptr + offset, src, chunk);
+
+		pending.push_back({
+			.dst = dst,
+			.region {
+				.srcOffset = offset,
+				.dstOffset = dst_offset,
+				.size = chunk
+			}
+		});
+
+		src += chunk;
+		dst_offset += chunk;
+		size -= chunk;
+	}
+
+	return next_value;
+}
+
+void VulkanUploader::begin_image(vk::Image dst, u32 mip_count) {
+	pending_begins.push_back({dst, mip_count});
+}
+
+void VulkanUploader::upload_image(const void* data, vk::Image dst, u32 mip_level, vk::Extent2D extent, u32 block_bytes) {
+	const vk::DeviceSize max_chunk = staging_size / 4;
+	const u32 block_rows = (extent.height + 3) / 4;
+	const vk::DeviceSize row_size = as<vk::DeviceSize>((extent.width + 3) / 4) * block_bytes;
+	// copies of compressed images cover whole blocks, so chunks can only be cut between block rows
+	const u32 rows_per_chunk = std::max(as<u32>(max_chunk / row_size), 1u);
+
+	auto src = as<const u8*>(data);
+	for (u32 row = 0; row < block_rows; row += rows_per_chunk) {
+		auto rows = std::min(rows_per_chunk, block_rows - row);
+		auto size = rows * row_size;
+		auto offset = alloc_staging(size);
+		memcpy(staging_ptr + offset, src, size);
+
+		pending_images.push_back({
+			.dst = dst,
+			.region {
+				.bufferOffset = offset,
+				.imageSubresource {
+					.aspectMask = vk::ImageAspectFlagBits::eColor,
+					.mipLevel = mip_level,
+					.baseArrayLayer = 0,
+					.layerCount = 1
+				},
+				.imageOffset {0, as<i32>(row * 4), 0},
+				.imageExtent {extent.width, std::min(rows * 4, extent.height - row * 4), 1}
+			}
+		});
+
+		src += size;
+	}
+}
+
+u64 VulkanUploader::end_image(vk::Image dst, u32 mip_count) {
+	pending_ends.push_back({dst, mip_count});
+	return next_value;
+}
+
+void VulkanUploader::flush() {
+	if (pending.empty() && pending_images.empty() && pending_begins.empty() && pending_ends.empty()) {
+		return;
+	}
+
+	reclaim();
+
+	vk::CommandBuffer cmd;
+	if (free_cmd_buffers.empty()) {
+		vk::CommandBufferAllocateInfo cmd_buffer_info {
+			.commandPool = cmd_pool,
+			.level = vk::CommandBufferLevel::ePrimary,
+			.commandBufferCount = 1
+		};
+		cmd = device.allocateCommandBuffers(cmd_buffer_info)[0];
+	}
+	else {
+		cmd = free_cmd_buffers.back();
+		free_cmd_buffers.pop_back();
+	}
+
+	vk::CommandBufferBeginInfo begin_info {
+		.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+	};
+	cmd.begin(begin_info);
+
+	// the contents of new images don't matter, so they're transitioned from undefined without waiting on anything
+	if (!pending_begins.empty()) {
+		std::vector<vk::ImageMemoryBarrier> begin_barriers;
+		for (const auto& begin : pending_begins) {
+			begin_barriers.push_back({
+				.srcAccessMask = vk::AccessFlagBits::eNone,
+				.dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+				.oldLayout = vk::ImageLayout::eUndefined,
+				.newLayout = vk::ImageLayout::eTransferDstOptimal,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = begin.image,
+				.subresourceRange = color_mips(begin.mip_count)
+			});
+		}
+		cmd.pipelineBarrier(
+				vk::PipelineStageFlagBits::eTopOfPipe,
+				vk::PipelineStageFlagBits::eTransfer,
+				{},
+				{},
+				{},
+				begin_barriers);
+	}
+
+	std::stable_sort(pending.begin(), pending.end(), [](const PendingCopy& a, const PendingCopy& b) {
+		return as<VkBuffer>(a.dst) < as<VkBuffer>(b.dst);
+	});
+
+	const bool ownership_transfer = transfer_family != graphics_family;
+	std::vector<vk::BufferMemoryBarrier> release_barriers;
+	std::vector<vk::BufferCopy> regions;
+
+	for (usize i = 0; i < pending.size();) {
+		auto dst = pending[i].dst;
+		auto range_start = pending[i].region.dstOffset;
+		auto range_end = range_start;
+
+		regions.clear();
+		for (; i < pending.size() && pending[i].dst == dst; ++i) {
+			const auto& region = pending[i].region;
+			regions.push_back(region);
+			range_start = std::min(range_start, region.dstOffset);
+			range_end = std::max(range_end, region.dstOffset + region.size);
+		}
+
+		cmd.copyBuffer(staging_buffer, dst, regions);
+
+		if (ownership_transfer) {
+			vk::BufferMemoryBarrier barrier {
+				.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+				.dstAccessMask = vk::AccessFlagBits::eNone,
+				.srcQueueFamilyIndex = transfer_family,
+				.dstQueueFamilyIndex = graphics_family,
+				.buffer = dst,
+				.offset = range_start,
+				.size = range_end - range_start
+			};
+			release_barriers.push_back(barrier);
+
+			barrier.srcAccessMask = vk::AccessFlagBits::eNone;
+			barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+			pending_acquires.push_back(barrier);
+		}
+	}
+
+	std::stable_sort(pending_images.begin(), pending_images.end(), [](const PendingImageCopy& a, const PendingImageCopy& b) {
+		return as<VkImage>(a.dst) < as<VkImage>(b.dst);
+	});
+
+	std::vector<vk::BufferImageCopy> image_regions;
+	for (usize i = 0; i < pending_images.size();) {
+		auto dst = pending_images[i].dst;
+		image_regions.clear();
+		for (; i < pending_images.size() && pending_images[i].dst == dst; ++i) {
+			image_regions.push_back(pending_images[i].region);
+		}
+		cmd.copyBufferToImage(staging_buffer, dst, vk::ImageLayout::eTransferDstOptimal, image_regions);
+	}
+
+	// images are left ready for sampling, the layout transition is part of the release if the queues differ
+	std::vector<vk::ImageMemoryBarrier> image_release_barriers;
+	for (const auto& end : pending_ends) {
+		vk::ImageMemoryBarrier barrier {
+			.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+			.dstAccessMask = vk::AccessFlagBits::eNone,
+			.oldLayout = vk::ImageLayout::eTransferDstOptimal,
+			.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+			.srcQueueFamilyIndex = ownership_transfer ? transfer_family : VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = ownership_transfer ? graphics_family : VK_QUEUE_FAMILY_IGNORED,
+			.image = end.image,
+			.subresourceRange = color_mips(end.mip_count)
+		};
+		image_release_barriers.push_back(barrier);
+
+		if (ownership_transfer) {
+			barrier.srcAccessMask = vk::AccessFlagBits::eNone;
+			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+			pending_image_acquires.push_back(barrier);
+		}
+	}
+
+	if (!release_barriers.empty() || !image_release_barriers.empty()) {
+		cmd.pipelineBarrier(
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eBottomOfPipe,
+				{},
+				{},
+				release_barriers,
+				image_release_barriers);
+	}
+
+	cmd.end();
+
+	u64 value = next_value++;
+
+	vk::TimelineSemaphoreSubmitInfo timeline_info {
+		.signalSemaphoreValueCount = 1,
+		.pSignalSemaphoreValues = &value
+	};
+
+	vk::SubmitInfo submit_info {
+		.pNext = &timeline_info,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &cmd,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &timeline
+	};
+
+	transfer_queue.submit(submit_info);
+
+	in_flight.push_back({
+		.cmd = cmd,
+		.value = value,
+		.ring_end = ring_head
+	});
+	last_flushed_value = value;
+	pending.clear();
+	pending_images.clear();
+	pending_begins.clear();
+	pending_ends.clear();
+}
+
+u64 VulkanUploader::acquire(vk::CommandBuffer graphics_cmd) {
+	if (!pending_acquires.empty() || !pending_image_acquires.empty()) {
+		graphics_cmd.pipelineBarrier(
+				CONSUMER_STAGES,
+				CONSUMER_STAGES,
+				{},
+				{},
+				pending_acquires,
+				pending_image_acquires);
+		pending_acquires.clear();
+		pending_image_acquires.clear();
+	}
+
+	if (last_flushed_value == last_acquired_value) {
+		return 0;
+	}
+	last_acquired_value = last_flushed_value;
+	return last_acquired_value;
+}
+
+void VulkanUploader::wait(u64 value) {
+	if (value > last_flushed_value) {
+		flush();
+	}
+
+	vk::SemaphoreWaitInfo wait_info {
+		.semaphoreCount = 1,
+		.pSemaphores = &timeline,
+		.pValues = &value
+	};
+	if (device.waitSemaphores(wait_info, UINT64_MAX) != vk::Result::eSuccess) {
+		throw std::runtime_error("vulkan: failed to wait for upload timeline");
+	}
+}
+
+u64 VulkanUploader::completed_value() const {
+	return device.getSemaphoreCounterValue(timeline);
+}
+
+u64 VulkanUploader::alloc_staging(vk::DeviceSize size) {
+	size = align_up(size, 16);
+
+	while (true) {
+		u64 start = ring_head;
+		auto offset = start % staging_size;
+		// allocations never wrap, the remainder of the ring is skipped instead
+		if (offset + size > staging_size) {
+			start += staging_size - offset;
+		}
+
+		if (start + size - ring_tail <= staging_size) {
+			ring_head = start + size;
+			return start % staging_size;
+		}
+
+		reclaim();
+		if (ring_head == ring_tail) {
+			continue;
+		}
+
+		// the ring is held by copies that were never submitted
+		if (in_flight.empty()) {
+			flush();
+		}
+		wait(in_flight.front().value);
+		reclaim();
+	}
+}
+
+void VulkanUploader::reclaim() {
+	auto completed = completed_value();
+	while (!in_flight.empty() && in_flight.front().value <= completed) {
+		auto& batch = in_flight.front();
+		ring_tail = batch.ring_end;
+		batch.cmd.reset();
+		free_cmd_buffers.push_back(batch.cmd);
+		in_flight.pop_front();
+	}
+
+	if (in_flight.empty() && pending.empty() && pending_images.empty()) {
+		ring_head = 0;
+		ring_tail = 0;
+	}
+}
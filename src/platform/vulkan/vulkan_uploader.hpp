@@ -0,0 +1,105 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+#include "vulkan_allocator.hpp"
+#include <deque>
+#include <vector>
+
+/// Streams data into device local resources through a persistently mapped staging ring buffer
+/// on the dedicated transfer queue. Copies are batched per flush and signal a timeline semaphore,
+/// the graphics queue waits on that value and acquires ownership of the written ranges and images.
+class VulkanUploader {
+public:
+	void init(
+			vk::Device device,
+			VulkanAllocator* allocator,
+			vk::Queue transfer_queue,
+			u32 transfer_family,
+			u32 graphics_family,
+			vk::DeviceSize staging_size);
+	void destroy();
+
+	/// Queues a copy of size bytes from data into dst at dst_offset.
+	/// Returns the timeline value which is signaled once the copy has completed.
+	u64 upload_buffer(const void* data, vk::DeviceSize size, vk::Buffer dst, vk::DeviceSize dst_offset);
+	/// Starts filling a newly created image, its mip_count levels are moved out of undefined layout.
+	void begin_image(vk::Image dst, u32 mip_count);
+	/// Queues a copy of a tightly packed mip level of 4x4 compressed blocks, extent is the level's size in texels.
+	/// Levels bigger than a chunk are split at block rows.
+	void upload_image(const void* data, vk::Image dst, u32 mip_level, vk::Extent2D extent, u32 block_bytes);
+	/// Finishes the image's uploads. Returns the timeline value after which the image is in shader read only
+	/// layout, owned by the graphics queue once that value has been acquired.
+	u64 end_image(vk::Image dst, u32 mip_count);
+	/// Submits every queued copy as one batch on the transfer queue.
+	void flush();
+	/// Records the queue family acquire barriers for the batches flushed since the last call.
+	/// Returns the timeline value the graphics submit has to wait on, or 0 if there is nothing to wait for.
+	u64 acquire(vk::CommandBuffer graphics_cmd);
+	void wait(u64 value);
+	[[nodiscard]] u64 completed_value() const;
+	/// Highest value whose acquire barriers have been recorded, the graphics submit they went into waits for it.
+	[[nodiscard]] u64 acquired_value() const {
+		return last_acquired_value;
+	}
+
+	/// stages at which the graphics queue waits for uploaded data
+	constexpr static vk::PipelineStageFlags CONSUMER_STAGES =
+			vk::PipelineStageFlagBits::eVertexInput |
+			vk::PipelineStageFlagBits::eVertexShader |
+			vk::PipelineStageFlagBits::eFragmentShader |
+			vk::PipelineStageFlagBits::eDrawIndirect;
+
+	vk::Semaphore timeline;
+private:
+	struct PendingCopy {
+		vk::Buffer dst;
+		vk::BufferCopy region;
+	};
+
+	struct PendingImageCopy {
+		vk::Image dst;
+		vk::BufferImageCopy region;
+	};
+
+	/// mips of an image changing layout at the start or end of a batch
+	struct ImageTransition {
+		vk::Image image;
+		u32 mip_count;
+	};
+
+	struct Batch {
+		vk::CommandBuffer cmd;
+		u64 value;
+		u64 ring_end;
+	};
+
+	u64 alloc_staging(vk::DeviceSize size);
+	void reclaim();
+
+	vk::Device device;
+	VulkanAllocator* allocator {};
+	vk::Queue transfer_queue;
+	u32 transfer_family {};
+	u32 graphics_family {};
+
+	vk::Buffer staging_buffer;
+	VulkanAllocation staging_allocation;
+	u8* staging_ptr {};
+	vk::DeviceSize staging_size {};
+	/// monotonic ring positions, the offset in the buffer is pos % staging_size
+	u64 ring_head {};
+	u64 ring_tail {};
+
+	vk::CommandPool cmd_pool;
+	std::vector<vk::CommandBuffer> free_cmd_buffers {};
+	std::deque<Batch> in_flight {};
+	std::vector<PendingCopy> pending {};
+	std::vector<PendingImageCopy> pending_images {};
+	std::vector<ImageTransition> pending_begins {};
+	std::vector<ImageTransition> pending_ends {};
+	std::vector<vk::BufferMemoryBarrier> pending_acquires {};
+	std::vector<vk::ImageMemoryBarrier> pending_image_acquires {};
+	u64 next_value {1};
+	u64 last_flushed_value {};
+	u64 last_acquired_value {};
+};
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+#include "types.hpp"
+#include "vulkan.hpp"
+
+constexpr vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "profiler.hpp"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+static std::mutex registry_lock;
+static std::vector<std::unique_ptr<ProfileBuffer>> registry;
+
+ProfileBuffer* profile_create_buffer(const char* name) {
+	std::lock_guard guard {registry_lock};
+	auto buffer = std::make_unique<ProfileBuffer>();
+	buffer->name = name;
+	buffer->track = as<u32>(registry.size());
+	registry.push_back(std::move(buffer));
+	return registry.back().get();
+}
+
+ProfileBuffer& profile_thread_buffer() {
+	// owned by the registry so the events survive the thread
+	thread_local ProfileBuffer* buffer = profile_create_buffer("thread");
+	return *buffer;
+}
+
+void profile_set_thread_name(const char* name) {
+	profile_thread_buffer().name = name;
+}
+
+static void append_escaped(std::string& out, const char* str) {
+	for (; *str; ++str) {
+		if (*str == '"' || *str == '\\') {
+			out += '\\';
+		}
+		out += *str;
+	}
+}
+
+// trace timestamps are microseconds, three decimals keep the nanosecond resolution
+static void append_micros(std::string& out, u64 ns) {
+	auto frac = std::to_string(ns % 1000);
+	out += std::to_string(ns / 1000);
+	out += '.';
+	out.append(3 - frac.size(), '0');
+	out += frac;
+}
+
+bool profile_write_trace(std::string_view path) {
+	std::ofstream file {std::string {path}};
+	if (!file) {
+		return false;
+	}
+
+	std::lock_guard guard {registry_lock};
+
+	std::string out = "{\"traceEvents\":[\n";
+	bool first = true;
+	auto begin_event = [&]() {
+		if (!first) {
+			out += ",\n";
+		}
+		first = false;
+	};
+
+	for (const auto& buffer : registry) {
+		auto track = std::to_string(buffer->track);
+
+		begin_event();
+		out += R"({"name":"thread_name","ph":"M","pid":0,"tid":)";
+		out += track;
+		out += R"(,"args":{"name":")";
+		append_escaped(out, buffer->name);
+		out += "\"}}";
+
+		auto head = buffer->head.load(std::memory_order_acquire);
+		auto tail = head > ProfileBuffer::CAPACITY ? head - ProfileBuffer::CAPACITY : 0;
+		for (auto i = tail; i < head; ++i) {
+			const auto& event = buffer->events[i % ProfileBuffer::CAPACITY];
+			begin_event();
+			out += R"({"name":")";
+			append_escaped(out, event.name);
+			out += R"(","ph":"X","pid":0,"tid":)";
+			out += track;
+			out += ",\"ts\":";
+			append_micros(out, event.start);
+			out += ",\"dur\":";
+			append_micros(out, event.end - event.start);
+			out += '}';
+		}
+	}
+
+	out += "\n]}\n";
+	file << out;
+	return file.good();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "types.hpp"
+#include <atomic>
+#include <chrono>
+#include <string_view>
+
+#ifdef GAME_PROFILER
+constexpr bool PROFILER_ENABLED = true;
+#else
+constexpr bool PROFILER_ENABLED = false;
+#endif
+
+/// Nanoseconds on the steady clock, every zone shares this time base.
+[[nodiscard]] inline u64 profile_now() {
+	return as<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct ProfileEvent {
+	/// has to outlive the profiler, string literals are expected
+	const char* name;
+	u64 start;
+	u64 end;
+};
+
+/// Single producer ring of events, once it's full the oldest events are overwritten.
+class ProfileBuffer {
+public:
+	constexpr static u64 CAPACITY = 1 << 14;
+
+	void push(const ProfileEvent& event) {
+		auto index = head.load(std::memory_order_relaxed);
+		events[index % CAPACITY] = event;
+		head.store(index + 1, std::memory_order_release);
+	}
+
+	const char* name {};
+	u32 track {};
+	std::atomic<u64> head {};
+	ProfileEvent events[CAPACITY] {};
+};
+
+/// Creates a buffer shown as its own track in the trace, buffers live until the program exits.
+ProfileBuffer* profile_create_buffer(const char* name);
+/// The calling thread's buffer, created on first use.
+ProfileBuffer& profile_thread_buffer();
+void profile_set_thread_name(const char* name);
+/// Writes every recorded event as a chrome trace json file, which perfetto also opens.
+/// Zones shouldn't be recorded while this runs.
+bool profile_write_trace(std::string_view path);
+
+class ProfileZone {
+public:
+	explicit ProfileZone(const char* name) : name {name}, start {profile_now()} {}
+	~ProfileZone() {
+		profile_thread_buffer().push({name, start, profile_now()});
+	}
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+private:
+	const char* name;
+	u64 start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef GAME_PROFILER
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__) {name}
+#define PROFILE_THREAD(name) profile_set_thread_name(name)
+#else
+#define PROFILE_ZONE(name) ((void) 0)
+#define PROFILE_THREAD(name) ((void) 0)
+#endif
\ No newline at end of file
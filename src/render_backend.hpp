@@ -0,0 +1,291 @@
+#pragma once
+#include "types.hpp"
+#include "draw_command.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/gpu_mesh.hpp"
+#include "math/mat.hpp"
+#include <chrono>
+#include <concepts>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+
+struct Transform;
+class JobSystem;
+
+/// The calls the renderer makes on a graphics api backend.
+template<typename T>
+concept RenderBackend = requires(
+		T& backend,
+		const T& const_backend,
+		GpuMesh& mesh,
+		const MeshView& view,
+		const std::string& path,
+		const Transform& transform,
+		std::span<const DrawCommand> draws,
+		JobSystem& jobs,
+		const Mat4& matrix,
+		u32 object,
+		f32 color,
+		bool clear,
+		std::chrono::steady_clock::time_point time) {
+	{ backend.upload_mesh(view) } -> std::same_as<GpuMesh>;
+	backend.destroy_mesh(mesh);
+	{ backend.load_texture(path) } -> std::same_as<u32>;
+	backend.destroy_texture(object);
+	backend.render(mesh, transform);
+	backend.submit(draws);
+	backend.render_parallel(jobs, draws);
+	{ backend.add_object(mesh, matrix) } -> std::same_as<u32>;
+	backend.update_object(object, matrix);
+	backend.remove_object(object);
+	backend.set_view_projection(matrix);
+	backend.set_clear_color(color, color, color, color);
+	backend.begin(clear);
+	backend.finish();
+	backend.resize();
+	backend.mark_input(time);
+	{ backend.take_input_latency() } -> std::same_as<f64>;
+	{ const_backend.gpu_frame_time() } -> std::same_as<f64>;
+};
+
+/// Backend interface for picking the api at startup, only DynamicRenderBackend calls through it.
+class VirtualRenderBackend {
+public:
+	virtual ~VirtualRenderBackend() = default;
+
+	virtual GpuMesh upload_mesh(const MeshView& mesh) = 0;
+	virtual void destroy_mesh(GpuMesh& mesh) = 0;
+	virtual u32 load_texture(const std::string& path) = 0;
+	virtual void destroy_texture(u32 texture) = 0;
+	virtual void render(const GpuMesh& mesh, const Transform& transform) = 0;
+	virtual void submit(std::span<const DrawCommand> draws) = 0;
+	virtual void render_parallel(JobSystem& jobs, std::span<const DrawCommand> draws) = 0;
+	virtual u32 add_object(const GpuMesh& mesh, const Mat4& model) = 0;
+	virtual void update_object(u32 object, const Mat4& model) = 0;
+	virtual void remove_object(u32 object) = 0;
+	virtual void set_view_projection(const Mat4& view_projection) = 0;
+	virtual void set_clear_color(f32 r, f32 g, f32 b, f32 a) = 0;
+	virtual void begin(bool clear) = 0;
+	virtual void finish() = 0;
+	virtual void resize() = 0;
+	virtual void mark_input(std::chrono::steady_clock::time_point time) = 0;
+	virtual f64 take_input_latency() = 0;
+	[[nodiscard]] virtual f64 gpu_frame_time() const = 0;
+};
+
+template<RenderBackend Backend>
+class VirtualRenderBackendImpl final : public VirtualRenderBackend {
+public:
+	template<typename... Args>
+	explicit VirtualRenderBackendImpl(Args&&... args) : backend {std::forward<Args>(args)...} {}
+
+	GpuMesh upload_mesh(const MeshView& mesh) override {
+		return backend.upload_mesh(mesh);
+	}
+	void destroy_mesh(GpuMesh& mesh) override {
+		backend.destroy_mesh(mesh);
+	}
+	u32 load_texture(const std::string& path) override {
+		return backend.load_texture(path);
+	}
+	void destroy_texture(u32 texture) override {
+		backend.destroy_texture(texture);
+	}
+	void render(const GpuMesh& mesh, const Transform& transform) override {
+		backend.render(mesh, transform);
+	}
+	void submit(std::span<const DrawCommand> draws) override {
+		backend.submit(draws);
+	}
+	void render_parallel(JobSystem& jobs, std::span<const DrawCommand> draws) override {
+		backend.render_parallel(jobs, draws);
+	}
+	u32 add_object(const GpuMesh& mesh, const Mat4& model) override {
+		return backend.add_object(mesh, model);
+	}
+	void update_object(u32 object, const Mat4& model) override {
+		backend.update_object(object, model);
+	}
+	void remove_object(u32 object) override {
+		backend.remove_object(object);
+	}
+	void set_view_projection(const Mat4& view_projection) override {
+		backend.set_view_projection(view_projection);
+	}
+	void set_clear_color(f32 r, f32 g, f32 b, f32 a) override {
+		backend.set_clear_color(r, g, b, a);
+	}
+	void begin(bool clear) override {
+		backend.begin(clear);
+	}
+	void finish() override {
+		backend.finish();
+	}
+	void resize() override {
+		backend.resize();
+	}
+	void mark_input(std::chrono::steady_clock::time_point time) override {
+		backend.mark_input(time);
+	}
+	f64 take_input_latency() override {
+		return backend.take_input_latency();
+	}
+	[[nodiscard]] f64 gpu_frame_time() const override {
+		return backend.gpu_frame_time();
+	}
+private:
+	Backend backend;
+};
+
+/// A backend chosen at runtime, every call is one virtual call into it.
+class DynamicRenderBackend {
+public:
+	explicit DynamicRenderBackend(std::unique_ptr<VirtualRenderBackend> backend) : backend {std::move(backend)} {}
+
+	GpuMesh upload_mesh(const MeshView& mesh) {
+		return backend->upload_mesh(mesh);
+	}
+	void destroy_mesh(GpuMesh& mesh) {
+		backend->destroy_mesh(mesh);
+	}
+	u32 load_texture(const std::string& path) {
+		return backend->load_texture(path);
+	}
+	void destroy_texture(u32 texture) {
+		backend->destroy_texture(texture);
+	}
+	void render(const GpuMesh& mesh, const Transform& transform) {
+		backend->render(mesh, transform);
+	}
+	void submit(std::span<const DrawCommand> draws) {
+		backend->submit(draws);
+	}
+	void render_parallel(JobSystem& jobs, std::span<const DrawCommand> draws) {
+		backend->render_parallel(jobs, draws);
+	}
+	u32 add_object(const GpuMesh& mesh, const Mat4& model) {
+		return backend->add_object(mesh, model);
+	}
+	void update_object(u32 object, const Mat4& model) {
+		backend->update_object(object, model);
+	}
+	void remove_object(u32 object) {
+		backend->remove_object(object);
+	}
+	void set_view_projection(const Mat4& view_projection) {
+		backend->set_view_projection(view_projection);
+	}
+	void set_clear_color(f32 r, f32 g, f32 b, f32 a) {
+		backend->set_clear_color(r, g, b, a);
+	}
+	void begin(bool clear) {
+		backend->begin(clear);
+	}
+	void finish() {
+		backend->finish();
+	}
+	void resize() {
+		backend->resize();
+	}
+	void mark_input(std::chrono::steady_clock::time_point time) {
+		backend->mark_input(time);
+	}
+	f64 take_input_latency() {
+		return backend->take_input_latency();
+	}
+	[[nodiscard]] f64 gpu_frame_time() const {
+		return backend->gpu_frame_time();
+	}
+private:
+	std::unique_ptr<VirtualRenderBackend> backend;
+};
+
+/// The renderer front end over a backend known at compile time, every call forwards directly to it.
+template<RenderBackend Backend>
+class BasicRenderer {
+public:
+	/// The arguments are passed on to the backend's constructor.
+	template<typename... Args>
+	explicit BasicRenderer(Args&&... args) : backend {std::forward<Args>(args)...} {}
+	BasicRenderer(const BasicRenderer&) = delete;
+	BasicRenderer& operator=(const BasicRenderer&) = delete;
+
+	/// Packs the mesh into the gpu vertex layout and uploads it.
+	GpuMesh upload(const Mesh& mesh) {
+		auto packed = PackedMesh::pack(mesh);
+		return upload(packed.view());
+	}
+	/// Uploads already packed data, e.g. straight from a memory mapped MeshFile.
+	GpuMesh upload(const MeshView& mesh) {
+		return backend.upload_mesh(mesh);
+	}
+	void destroy(GpuMesh& mesh) {
+		backend.destroy_mesh(mesh);
+	}
+	/// Loads a file written by texture_convert, returns the value for GpuMesh::texture. The Vulkan backend
+	/// streams its mip levels in the background, the mesh is drawn untextured until the first ones are uploaded.
+	u32 load_texture(const std::string& path) {
+		return backend.load_texture(path);
+	}
+	/// Meshes must not be drawn with the texture afterwards.
+	void destroy_texture(u32 texture) {
+		backend.destroy_texture(texture);
+	}
+	void render(const GpuMesh& mesh, const Transform& transform) {
+		backend.render(mesh, transform);
+	}
+	/// Queues draws which are batched into instanced draws at finish, the meshes have to stay alive until then.
+	void submit(std::span<const DrawCommand> draws) {
+		backend.submit(draws);
+	}
+	void render_parallel(JobSystem& jobs, std::span<const DrawCommand> draws) {
+		backend.render_parallel(jobs, draws);
+	}
+	/// Persistent objects culled and drawn on the gpu every frame, requires RendererSettings::gpu_culling.
+	/// Returns a handle for updating and removing the object, the mesh has to outlive it.
+	u32 add_object(const GpuMesh& mesh, const Mat4& model) {
+		return backend.add_object(mesh, model);
+	}
+	void update_object(u32 object, const Mat4& model) {
+		backend.update_object(object, model);
+	}
+	void remove_object(u32 object) {
+		backend.remove_object(object);
+	}
+	void set_view_projection(const Mat4& view_projection) {
+		backend.set_view_projection(view_projection);
+	}
+	void set_clear_color(f32 r, f32 g, f32 b, f32 a) {
+		backend.set_clear_color(r, g, b, a);
+	}
+	void begin(bool clear) {
+		backend.begin(clear);
+	}
+	void finish() {
+		backend.finish();
+	}
+	/// Has to be called when the window size changes.
+	void resize() {
+		backend.resize();
+	}
+	/// The current frame is the first to show a reaction to input read at time, its latency is measured
+	/// once the frame has been presented. Call between begin and finish.
+	void mark_input(std::chrono::steady_clock::time_point time) {
+		backend.mark_input(time);
+	}
+	/// Milliseconds from the input to the present of the most recently completed marked frame, 0 if no
+	/// marked frame completed since the last call.
+	f64 take_input_latency() {
+		return backend.take_input_latency();
+	}
+	/// Gpu time in milliseconds of the most recently completed frame, 0 if it can't be measured.
+	[[nodiscard]] f64 gpu_frame_time() const {
+		return backend.gpu_frame_time();
+	}
+private:
+	Backend backend;
+};
+
+static_assert(RenderBackend<DynamicRenderBackend>);
\ No newline at end of file
@@ -1,16 +1,40 @@
 #include "renderer.hpp"
 #include "logger.hpp"
 
-Renderer::Renderer(Window* window, Platform platform, Logger* logger) : platform {platform} { // NOLINT(cppcoreguidelines-pro-type-member-init)
+#ifndef GAME_DYNAMIC_BACKEND
+static const char* platform_name(Platform platform) {
+	switch (platform) {
+		case Platform::Vulkan:
+			return "vulkan";
+		case Platform::OpenGL:
+			return "opengl";
+	}
+	return "unknown";
+}
+#endif
+
+/// args are passed on to the backend's constructor
+template<typename... Args>
+static std::unique_ptr<Renderer> create(Platform platform, Logger* logger, Args&&... args) {
 	try {
+#ifdef GAME_DYNAMIC_BACKEND
+		std::unique_ptr<VirtualRenderBackend> backend;
 		switch (platform) {
 			case Platform::Vulkan:
-				new (&vulkan_renderer) VulkanRenderer {window, logger};
+				backend = std::make_unique<VirtualRenderBackendImpl<VulkanRenderer>>(std::forward<Args>(args)...);
 				break;
 			case Platform::OpenGL:
-				opengl_renderer = OpenGlRenderer {};
+				backend = std::make_unique<VirtualRenderBackendImpl<OpenGlRenderer>>(std::forward<Args>(args)...);
 				break;
 		}
+		return std::make_unique<Renderer>(std::move(backend));
+#else
+		if (platform != DEFAULT_PLATFORM) {
+			throw std::runtime_error(std::string {"render: "} + platform_name(platform)
+				+ " isn't available, the backend is fixed to " + platform_name(DEFAULT_PLATFORM) + " at compile time");
+		}
+		return std::make_unique<Renderer>(std::forward<Args>(args)...);
+#endif
 	}
 	catch (const std::exception& e) {
 		logger->log("render", e.what(), LogLevel::Error);
@@ -18,57 +42,21 @@ Renderer::Renderer(Window* window, Platform platform, Logger* logger) : platform
 	}
 }
 
-void Renderer::render(const GpuMesh& mesh, const Transform& transform) {
-	switch (platform) {
-		case Platform::Vulkan:
-			vulkan_renderer.render(mesh, transform);
-			break;
-		case Platform::OpenGL:
-			opengl_renderer.render(mesh, transform);
-			break;
-	}
-}
-
-void Renderer::set_clear_color(f32 r, f32 g, f32 b, f32 a) {
-	switch (platform) {
-		case Platform::Vulkan:
-			vulkan_renderer.set_clear_color(r, g, b, a);
-			break;
-		case Platform::OpenGL:
-			opengl_renderer.set_clear_color(r, g, b, a);
-			break;
-	}
+std::unique_ptr<Renderer> create_renderer(
+		Window* window,
+		Platform platform,
+		Logger* logger,
+		JobSystem& jobs,
+		const RendererSettings& settings) {
+	return create(platform, logger, window, logger, jobs, settings);
 }
 
-void Renderer::begin(bool clear) {
-	switch (platform) {
-		case Platform::Vulkan:
-			vulkan_renderer.begin(clear);
-			break;
-		case Platform::OpenGL:
-			opengl_renderer.begin(clear);
-			break;
-	}
-}
-
-void Renderer::finish() {
-	switch (platform) {
-		case Platform::Vulkan:
-			vulkan_renderer.finish();
-			break;
-		case Platform::OpenGL:
-			opengl_renderer.finish();
-			break;
-	}
-}
-
-Renderer::~Renderer() {
-	switch (platform) {
-		case Platform::Vulkan:
-			vulkan_renderer.~VulkanRenderer();
-			break;
-		case Platform::OpenGL:
-			opengl_renderer.~OpenGlRenderer();
-			break;
-	}
+std::unique_ptr<Renderer> create_renderer(
+		u32 width,
+		u32 height,
+		Platform platform,
+		Logger* logger,
+		JobSystem& jobs,
+		const RendererSettings& settings) {
+	return create(platform, logger, width, height, logger, jobs, settings);
 }
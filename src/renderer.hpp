@@ -1,25 +1,38 @@
 #pragma once
 #include "window.hpp"
+#include "render_backend.hpp"
 #include "platform/vulkan/vulkan_renderer.hpp"
 #include "platform/opengl/opengl_renderer.hpp"
+#include <memory>
 
-class GpuMesh;
-struct Transform;
 class Logger;
+class JobSystem;
 
-class Renderer {
-public:
-	Renderer(Window* window, Platform platform, Logger* logger);
-	~Renderer();
-	void render(const GpuMesh& mesh, const Transform& transform);
-	void set_clear_color(f32 r, f32 g, f32 b, f32 a);
-	void begin(bool clear);
-	void finish();
-private:
-	Platform platform;
+// GAME_RENDER_BACKEND in cmake picks the backend. A fixed one is called directly and can be inlined,
+// the dynamic one is chosen by platform at startup and costs a virtual call per renderer call.
+#if defined(GAME_DYNAMIC_BACKEND)
+using Renderer = BasicRenderer<DynamicRenderBackend>;
+constexpr Platform DEFAULT_PLATFORM = Platform::Vulkan;
+#elif defined(GAME_OPENGL_BACKEND)
+using Renderer = BasicRenderer<OpenGlRenderer>;
+constexpr Platform DEFAULT_PLATFORM = Platform::OpenGL;
+#else
+using Renderer = BasicRenderer<VulkanRenderer>;
+constexpr Platform DEFAULT_PLATFORM = Platform::Vulkan;
+#endif
 
-	union {
-		VulkanRenderer vulkan_renderer;
-		OpenGlRenderer opengl_renderer;
-	};
-};
\ No newline at end of file
+/// Logs the error and exits if the backend can't be created, a build with a fixed backend only supports its platform.
+std::unique_ptr<Renderer> create_renderer(
+		Window* window,
+		Platform platform,
+		Logger* logger,
+		JobSystem& jobs,
+		const RendererSettings& settings = {});
+/// Renders offscreen without a window, meant for benchmarks and machines without a display.
+std::unique_ptr<Renderer> create_renderer(
+		u32 width,
+		u32 height,
+		Platform platform,
+		Logger* logger,
+		JobSystem& jobs,
+		const RendererSettings& settings = {});
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+#include "types.hpp"
+#include <string>
+
+enum class PresentMode {
+	/// vsync, never tears
+	Fifo,
+	/// vsync, but a late frame is shown right away and may tear
+	FifoRelaxed,
+	/// doesn't block, the newest frame is shown at the next vblank
+	Mailbox,
+	/// doesn't block and may tear, lowest latency
+	Immediate
+};
+
+struct RendererSettings {
+	/// frames the cpu may record ahead of the gpu
+	u32 frames_in_flight {2};
+	/// falls back to Fifo if the surface doesn't support it
+	PresentMode present_mode {PresentMode::Mailbox};
+	/// compiled pipelines are kept here between runs, empty disables it, deleting the file forces a cold start
+	std::string pipeline_cache_path {"pipeline_cache.bin"};
+	/// objects added with add_object are culled on the gpu against the frustum and the previous frame's depth,
+	/// it's turned off if the device lacks draw indirect count or push descriptors
+	bool gpu_culling {};
+	/// gpu buffers for this many objects are allocated up front
+	u32 max_gpu_objects {65536};
+	/// device memory streamed textures may use, lowered at runtime if the device reports less free memory
+	u64 texture_budget {512ull * 1024 * 1024};
+	/// texture bytes read and uploaded per frame, bounds the stutter of streaming in detail
+	u64 texture_upload_per_frame {8 * 1024 * 1024};
+};
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "simulation.hpp"
+#include "profiler/profiler.hpp"
+#include <algorithm>
+
+/// ticks the simulation may fall behind its schedule before the missed ones are dropped instead of caught up
+constexpr u32 MAX_CATCH_UP = 8;
+
+Simulation::Simulation(u32 tick_rate, TickFn tick)
+	: tick {std::move(tick)},
+	dt {1.0 / tick_rate},
+	period {std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds {1}) / tick_rate} {}
+
+Simulation::~Simulation() {
+	stop();
+}
+
+void Simulation::start() {
+	auto& initial = snapshots.write_slot();
+	initial.input_time = {};
+	initial.earlier_input_time = {};
+	tick(initial, 0);
+	initial.tick = 0;
+	initial.time = 0;
+	snapshots.publish();
+
+	epoch = std::chrono::steady_clock::now();
+	running.store(true, std::memory_order_relaxed);
+	thread = std::thread {[this] {
+		run();
+	}};
+}
+
+void Simulation::stop() {
+	running.store(false, std::memory_order_relaxed);
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void Simulation::run() {
+	PROFILE_THREAD("simulation");
+	auto next = epoch;
+	u64 index = 0;
+	// earliest input since the last snapshot the render thread is known to have taken, it only learns whether
+	// one was taken when publishing the next, so the input is repeated until then and the reader skips it
+	std::optional<std::chrono::steady_clock::time_point> unseen_input;
+	u64 unseen_input_tick = 0;
+	while (running.load(std::memory_order_relaxed)) {
+		next += period;
+		std::this_thread::sleep_until(next);
+
+		// a tick slower than the period is caught up by the following ones, after falling behind by more
+		// than a few the schedule skips ahead, which slows the game down rather than stalling it further
+		auto behind = std::chrono::steady_clock::now() - next;
+		if (behind > period * MAX_CATCH_UP) {
+			auto missed = behind / period;
+			next += period * missed;
+			dropped.fetch_add(as<u64>(missed), std::memory_order_relaxed);
+		}
+
+		PROFILE_ZONE("simulation tick");
+		auto& snapshot = snapshots.write_slot();
+		snapshot.input_time = {};
+		tick(snapshot, dt);
+		snapshot.tick = ++index;
+		snapshot.time = std::chrono::duration<f64>(next - epoch).count();
+		snapshot.earlier_input_time = unseen_input;
+		snapshot.earlier_input_tick = unseen_input_tick;
+		auto input_time = snapshot.input_time;
+		// the reader took the previous snapshot, everything before this one has been seen
+		if (!snapshots.publish()) {
+			unseen_input = {};
+		}
+		if (input_time && !unseen_input) {
+			unseen_input = input_time;
+			unseen_input_tick = index;
+		}
+	}
+}
+
+void Simulation::interpolate(std::vector<Transform>& transforms) {
+	PROFILE_ZONE("Simulation::interpolate");
+	// the taken slot goes back to the simulation on the next take, swapping keeps it without copying the transforms
+	if (auto latest = snapshots.take()) {
+		auto last_tick = current.tick;
+		std::swap(previous, current);
+		std::swap(current, *latest);
+		auto add_input = [&](std::optional<std::chrono::steady_clock::time_point> time) {
+			if (time && (!input_time || *time < *input_time)) {
+				input_time = time;
+			}
+		};
+		add_input(current.input_time);
+		if (current.earlier_input_tick > last_tick) {
+			add_input(current.earlier_input_time);
+		}
+	}
+
+	// objects added or removed since the previous tick have nothing to interpolate from
+	const auto& from = previous.transforms.size() == current.transforms.size() ? previous : current;
+	auto render_time = std::chrono::duration<f64>(std::chrono::steady_clock::now() - epoch).count() - dt;
+	f32 t = 1;
+	if (current.time > from.time) {
+		t = as<f32>(std::clamp((render_time - from.time) / (current.time - from.time), 0.0, 1.0));
+	}
+
+	transforms.resize(current.transforms.size());
+	for (usize i = 0; i < transforms.size(); ++i) {
+		const auto& a = from.transforms[i];
+		const auto& b = current.transforms[i];
+		transforms[i] = {
+			.position = a.position + (b.position - a.position) * t,
+			.rotation = Quat::nlerp(a.rotation, b.rotation, t),
+			.scale = a.scale + (b.scale - a.scale) * t
+		};
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "types.hpp"
+#include "triple_buffer.hpp"
+#include "components/transform.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// Game state of one tick, what the render thread sees of the simulation.
+struct SimulationSnapshot {
+	u64 tick {};
+	/// seconds since the simulation started at which the tick's state is shown
+	f64 time {};
+	std::vector<Transform> transforms {};
+	/// earliest input the tick reacted to, set by the tick
+	std::optional<std::chrono::steady_clock::time_point> input_time {};
+	/// earliest input of an older tick that may not have been seen, it's new to the render thread if
+	/// the snapshot it last took is older than earlier_input_tick
+	std::optional<std::chrono::steady_clock::time_point> earlier_input_time {};
+	u64 earlier_input_tick {};
+};
+
+/// Runs the game logic on its own thread at a fixed tick rate, independent of the frame rate. Every tick
+/// publishes a snapshot through a triple buffer and the render thread draws the state between the latest
+/// two, so a slow frame doesn't slow the simulation down and a fast display still sees smooth motion.
+class Simulation {
+public:
+	/// Advances the state owned by the function by dt seconds and writes every transform into the snapshot,
+	/// which still holds those of an older one. Called on the simulation thread, and once with a dt of 0
+	/// for the initial state on the thread calling start.
+	using TickFn = std::function<void(SimulationSnapshot& snapshot, f64 dt)>;
+
+	Simulation(u32 tick_rate, TickFn tick);
+	~Simulation();
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+
+	void start();
+	/// Waits for the running tick to finish, the state isn't changed afterwards.
+	void stop();
+
+	/// Transforms of the state at the current time, interpolated between the latest two snapshots. Drawn one
+	/// tick behind the simulation so there's a snapshot on either side. Call only from one thread.
+	void interpolate(std::vector<Transform>& transforms);
+
+	/// Earliest input time of the snapshots interpolate took since the last call. The frame drawn with them
+	/// is the first to show a reaction to that input.
+	std::optional<std::chrono::steady_clock::time_point> take_input_time() {
+		return std::exchange(input_time, std::nullopt);
+	}
+
+	/// Ticks of the newest snapshot the render thread has seen.
+	[[nodiscard]] u64 latest_tick() const {
+		return current.tick;
+	}
+	/// Ticks dropped because the simulation fell too far behind its schedule.
+	[[nodiscard]] u64 dropped_ticks() const {
+		return dropped.load(std::memory_order_relaxed);
+	}
+	[[nodiscard]] f64 tick_interval() const {
+		return dt;
+	}
+private:
+	void run();
+
+	TickFn tick;
+	f64 dt;
+	std::chrono::steady_clock::duration period;
+	std::chrono::steady_clock::time_point epoch {};
+	std::thread thread {};
+	std::atomic<bool> running {};
+	std::atomic<u64> dropped {};
+
+	TripleBuffer<SimulationSnapshot> snapshots {};
+	/// the render thread's copies of the latest two snapshots
+	SimulationSnapshot previous {};
+	SimulationSnapshot current {};
+	std::optional<std::chrono::steady_clock::time_point> input_time {};
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include "types.hpp"
+#include <atomic>
+
+/// Lock free handoff of whole values from one writer thread to one reader thread. The writer fills its own
+/// slot and publishes it, the reader takes the newest published one, neither ever waits for the other.
+/// A published value isn't touched by the writer again until the reader has taken a newer one, so the
+/// reader sees it unchanged for as long as it holds it. Values the reader never took are overwritten.
+template<typename T>
+class TripleBuffer {
+public:
+	/// The writer's slot, it keeps whatever the value held when it was handed back, so it has to be written in full.
+	T& write_slot() {
+		return slots[back];
+	}
+	/// Hands the writer's slot over and gives the writer the slot the reader last returned. Returns true if
+	/// that is the previously published value because the reader never took it, write_slot still holds it then.
+	bool publish() {
+		auto old = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+		back = old & INDEX;
+		return old & FRESH;
+	}
+
+	/// The newest published value if the reader hasn't taken it yet, null otherwise. The reader owns it
+	/// and may modify it until the next take, which hands it back to the writer.
+	T* take() {
+		if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+			return nullptr;
+		}
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return &slots[front];
+	}
+private:
+	/// set in middle while it holds a value the reader hasn't taken
+	constexpr static u32 FRESH = 4;
+	constexpr static u32 INDEX = 3;
+
+	T slots[3] {};
+	/// the writer's
+	u32 back {0};
+	/// the reader's
+	u32 front {1};
+	alignas(64) std::atomic<u32> middle {2};
+};
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "texture_compress.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/// the 16 texels of a block in row major order
+using Block = u8[16][4];
+
+/// interpolation weights of 4 bit bc7 indices, out of 64
+constexpr u32 BC7_WEIGHTS[16] {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/// Appends bits least significant first, bc blocks are one 128 bit little endian integer.
+struct BitWriter {
+	u8* out;
+	u32 pos {};
+
+	void put(u32 value, u32 bits) {
+		for (u32 i = 0; i < bits; ++i, ++pos) {
+			if (value >> i & 1) {
+				out[pos / 8] |= as<u8>(1 << pos % 8);
+			}
+		}
+	}
+};
+
+static u32 sqr_distance(const u8* a, const u8* b, u32 channels) {
+	u32 sum = 0;
+	for (u32 c = 0; c < channels; ++c) {
+		i32 d = as<i32>(a[c]) - as<i32>(b[c]);
+		sum += as<u32>(d * d);
+	}
+	return sum;
+}
+
+/// Mode 6 endpoints and indices of a block.
+struct Bc7Mode6 {
+	/// 7 bits per channel, the shared low bit of each endpoint is in p_bits
+	u8 quantized[2][4];
+	u8 p_bits[2];
+	u8 indices[16];
+	u32 error;
+};
+
+/// Quantizes both endpoints to 7 bits, picking the shared low bit that lands closest, and picks every
+/// texel's closest interpolated color.
+static Bc7Mode6 fit_bc7_mode6(const Block& texels, const f32 (&targets)[2][4]) {
+	Bc7Mode6 result {};
+	u8 endpoints[2][4];
+	for (u32 e = 0; e < 2; ++e) {
+		f32 best_error = INFINITY;
+		for (u8 p = 0; p < 2; ++p) {
+			u8 q[4];
+			f32 error = 0;
+			for (u32 c = 0; c < 4; ++c) {
+				f32 target = std::clamp(targets[e][c], 0.0f, 255.0f);
+				q[c] = as<u8>(std::clamp(std::lround((target - p) / 2), 0l, 127l));
+				f32 d = as<f32>(q[c] << 1 | p) - target;
+				error += d * d;
+			}
+			if (error < best_error) {
+				best_error = error;
+				memcpy(result.quantized[e], q, 4);
+				result.p_bits[e] = p;
+			}
+		}
+		for (u32 c = 0; c < 4; ++c) {
+			endpoints[e][c] = as<u8>(result.quantized[e][c] << 1 | result.p_bits[e]);
+		}
+	}
+
+	u8 palette[16][4];
+	for (u32 i = 0; i < 16; ++i) {
+		for (u32 c = 0; c < 4; ++c) {
+			palette[i][c] = as<u8>(((64 - BC7_WEIGHTS[i]) * endpoints[0][c] + BC7_WEIGHTS[i] * endpoints[1][c] + 32) >> 6);
+		}
+	}
+
+	for (u32 t = 0; t < 16; ++t) {
+		u32 best = UINT32_MAX;
+		for (u8 i = 0; i < 16; ++i) {
+			auto distance = sqr_distance(texels[t], palette[i], 4);
+			if (distance < best) {
+				best = distance;
+				result.indices[t] = i;
+			}
+		}
+		result.error += best;
+	}
+	return result;
+}
+
+/// Mode 6: one subset, 7 bit rgba endpoints with a shared low bit per endpoint and 4 bit indices.
+static void compress_bc7_block(const Block& texels, u8* out) {
+	f32 mean[4] {};
+	for (const auto& texel : texels) {
+		for (u32 c = 0; c < 4; ++c) {
+			mean[c] += texel[c];
+		}
+	}
+	for (auto& m : mean) {
+		m /= 16;
+	}
+
+	f32 cov[4][4] {};
+	for (const auto& texel : texels) {
+		f32 d[4];
+		for (u32 c = 0; c < 4; ++c) {
+			d[c] = texel[c] - mean[c];
+		}
+		for (u32 i = 0; i < 4; ++i) {
+			for (u32 j = 0; j < 4; ++j) {
+				cov[i][j] += d[i] * d[j];
+			}
+		}
+	}
+
+	// power iteration converges on the direction the colors vary the most along
+	f32 axis[4] {1, 1, 1, 1};
+	for (u32 iteration = 0; iteration < 8; ++iteration) {
+		f32 next[4] {};
+		for (u32 i = 0; i < 4; ++i) {
+			for (u32 j = 0; j < 4; ++j) {
+				next[i] += cov[i][j] * axis[j];
+			}
+		}
+		f32 length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+		// a flat block has no direction, any axis works
+		if (length < 1e-6f) {
+			break;
+		}
+		for (u32 i = 0; i < 4; ++i) {
+			axis[i] = next[i] / length;
+		}
+	}
+
+	f32 min_t = 0;
+	f32 max_t = 0;
+	for (const auto& texel : texels) {
+		f32 t = 0;
+		for (u32 c = 0; c < 4; ++c) {
+			t += (texel[c] - mean[c]) * axis[c];
+		}
+		min_t = std::min(min_t, t);
+		max_t = std::max(max_t, t);
+	}
+
+	f32 targets[2][4];
+	for (u32 c = 0; c < 4; ++c) {
+		targets[0][c] = mean[c] + axis[c] * min_t;
+		targets[1][c] = mean[c] + axis[c] * max_t;
+	}
+	auto best = fit_bc7_mode6(texels, targets);
+
+	// the extremes along the axis are rarely optimal, least squares endpoints for the chosen indices fit better
+	for (u32 iteration = 0; iteration < 2; ++iteration) {
+		f32 aa = 0;
+		f32 ab = 0;
+		f32 bb = 0;
+		f32 ax[4] {};
+		f32 bx[4] {};
+		for (u32 t = 0; t < 16; ++t) {
+			f32 b = as<f32>(BC7_WEIGHTS[best.indices[t]]) / 64;
+			f32 a = 1 - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (u32 c = 0; c < 4; ++c) {
+				ax[c] += a * texels[t][c];
+				bx[c] += b * texels[t][c];
+			}
+		}
+		f32 det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f) {
+			break;
+		}
+		for (u32 c = 0; c < 4; ++c) {
+			targets[0][c] = (bb * ax[c] - ab * bx[c]) / det;
+			targets[1][c] = (aa * bx[c] - ab * ax[c]) / det;
+		}
+		auto refined = fit_bc7_mode6(texels, targets);
+		if (refined.error >= best.error) {
+			break;
+		}
+		best = refined;
+	}
+
+	// the first index is stored without its top bit, which has to be zero, swapping the endpoints clears it
+	if (best.indices[0] & 8) {
+		std::swap(best.quantized[0], best.quantized[1]);
+		std::swap(best.p_bits[0], best.p_bits[1]);
+		for (auto& index : best.indices) {
+			index = as<u8>(15 - index);
+		}
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer {out};
+	writer.put(1 << 6, 7);
+	for (u32 c = 0; c < 4; ++c) {
+		writer.put(best.quantized[0][c], 7);
+		writer.put(best.quantized[1][c], 7);
+	}
+	writer.put(best.p_bits[0], 1);
+	writer.put(best.p_bits[1], 1);
+	writer.put(best.indices[0], 3);
+	for (u32 t = 1; t < 16; ++t) {
+		writer.put(best.indices[t], 4);
+	}
+}
+
+/// One channel as bc4: two 8 bit endpoints and 3 bit indices into the values interpolated between them.
+static void compress_bc4_channel(const Block& texels, u32 channel, u8* out) {
+	u8 low = 255;
+	u8 high = 0;
+	for (const auto& texel : texels) {
+		low = std::min(low, texel[channel]);
+		high = std::max(high, texel[channel]);
+	}
+
+	// with the first endpoint greater, all 8 values are interpolated instead of 6 plus 0 and 255
+	u8 palette[8] {high, low};
+	for (u32 i = 2; i < 8; ++i) {
+		palette[i] = as<u8>(((8 - i) * high + (i - 1) * low + 3) / 7);
+	}
+
+	u64 bits = 0;
+	for (u32 t = 0; t < 16; ++t) {
+		u64 best_index = 0;
+		u32 best = UINT32_MAX;
+		for (u32 i = 0; i < 8 && high != low; ++i) {
+			auto distance = sqr_distance(&texels[t][channel], &palette[i], 1);
+			if (distance < best) {
+				best = distance;
+				best_index = i;
+			}
+		}
+		bits |= best_index << (3 * t);
+	}
+
+	out[0] = high;
+	out[1] = low;
+	for (u32 i = 0; i < 6; ++i) {
+		out[2 + i] = as<u8>(bits >> (8 * i));
+	}
+}
+
+std::vector<u8> compress_image(TextureFormat format, std::span<const u8> rgba, u32 width, u32 height) {
+	u32 blocks_x = (width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+	u32 blocks_y = (height + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+	std::vector<u8> blocks(as<usize>(blocks_x) * blocks_y * TEXTURE_BLOCK_BYTES);
+
+	Block texels;
+	for (u32 by = 0; by < blocks_y; ++by) {
+		for (u32 bx = 0; bx < blocks_x; ++bx) {
+			for (u32 t = 0; t < 16; ++t) {
+				u32 x = std::min(bx * TEXTURE_BLOCK_SIZE + t % 4, width - 1);
+				u32 y = std::min(by * TEXTURE_BLOCK_SIZE + t / 4, height - 1);
+				memcpy(texels[t], &rgba[(as<usize>(y) * width + x) * 4], 4);
+			}
+
+			auto out = &blocks[(as<usize>(by) * blocks_x + bx) * TEXTURE_BLOCK_BYTES];
+			if (format == TextureFormat::Bc7Srgb) {
+				compress_bc7_block(texels, out);
+			}
+			else {
+				compress_bc4_channel(texels, 0, out);
+				compress_bc4_channel(texels, 1, out + 8);
+			}
+		}
+	}
+	return blocks;
+}
+
+static f32 srgb_to_linear(f32 value) {
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static f32 linear_to_srgb(f32 value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1 / 2.4f) - 0.055f;
+}
+
+std::vector<u8> downsample_image(std::span<const u8> rgba, u32 width, u32 height, bool srgb) {
+	u32 out_width = mip_dimension(width, 1);
+	u32 out_height = mip_dimension(height, 1);
+	std::vector<u8> out(as<usize>(out_width) * out_height * 4);
+
+	f32 to_linear[256];
+	for (u32 i = 0; i < 256; ++i) {
+		to_linear[i] = srgb ? srgb_to_linear(as<f32>(i) / 255) : as<f32>(i) / 255;
+	}
+
+	// odd sizes round down, so the last output row and column average three source texels instead of two,
+	// the same footprint as the depth pyramid. a size of 1 stays 1 and averages just that texel
+	auto footprint = [](u32 out_index, u32 out_size, u32 size) {
+		if (size == 1) {
+			return 1u;
+		}
+		return out_index == out_size - 1 && size % 2 ? 3u : 2u;
+	};
+
+	for (u32 y = 0; y < out_height; ++y) {
+		auto rows = footprint(y, out_height, height);
+		for (u32 x = 0; x < out_width; ++x) {
+			auto columns = footprint(x, out_width, width);
+			f32 sum[4] {};
+			for (u32 sy = 0; sy < rows; ++sy) {
+				for (u32 sx = 0; sx < columns; ++sx) {
+					auto src = &rgba[(as<usize>(y * 2 + sy) * width + x * 2 + sx) * 4];
+					for (u32 c = 0; c < 3; ++c) {
+						sum[c] += to_linear[src[c]];
+					}
+					sum[3] += as<f32>(src[3]) / 255;
+				}
+			}
+
+			auto dst = &out[(as<usize>(y) * out_width + x) * 4];
+			for (u32 c = 0; c < 4; ++c) {
+				f32 value = sum[c] / as<f32>(rows * columns);
+				if (srgb && c < 3) {
+					value = linear_to_srgb(value);
+				}
+				dst[c] = as<u8>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255));
+			}
+		}
+	}
+	return out;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "types.hpp"
+#include "texture_file.hpp"
+#include <span>
+#include <vector>
+
+/// Offline texture processing for the converter, the game only ever loads already compressed files.
+
+/// Compresses an image of rgba8 texels, rows top to bottom, into the blocks of a mip level.
+/// Bc7Srgb uses mode 6 with endpoints along the principal axis of every block, Bc5Unorm keeps red and green.
+/// Blocks past the right and bottom edge repeat the last column and row.
+std::vector<u8> compress_image(TextureFormat format, std::span<const u8> rgba, u32 width, u32 height);
+
+/// Next mip level of an rgba8 image with a 2x2 box filter, widened to 3 texels for the last row and column of
+/// odd sizes so no source texel is dropped. With srgb the color channels are averaged
+/// in linear space, otherwise mips of srgb textures come out darker than the original.
+std::vector<u8> downsample_image(std::span<const u8> rgba, u32 width, u32 height, bool srgb);
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "texture_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+static u64 align_up(u64 value, u64 alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/// levels of a full chain down to 1x1
+static u32 full_mip_count(u32 width, u32 height) {
+	return as<u32>(std::bit_width(std::max(width, height)));
+}
+
+void write_texture_file(
+		const std::string& path,
+		TextureFormat format,
+		u32 width,
+		u32 height,
+		std::span<const std::vector<u8>> mips) {
+	if (mips.empty() || mips.size() > std::min(MAX_TEXTURE_MIPS, full_mip_count(width, height))) {
+		throw std::runtime_error("texture: '" + path + "' has an invalid number of mips");
+	}
+
+	TextureFileHeader header {
+		.magic = TEXTURE_FILE_MAGIC,
+		.version = TEXTURE_FILE_VERSION,
+		.format = format,
+		.width = width,
+		.height = height,
+		.mip_count = as<u32>(mips.size())
+	};
+
+	u64 offset = align_up(sizeof(TextureFileHeader), TEXTURE_FILE_ALIGN);
+	for (u32 i = 0; i < header.mip_count; ++i) {
+		if (mips[i].size() != texture_mip_size(width, height, i)) {
+			throw std::runtime_error("texture: mip " + std::to_string(i) + " of '" + path + "' has the wrong size");
+		}
+		header.mips[i] = {offset, mips[i].size()};
+		offset = align_up(offset + mips[i].size(), TEXTURE_FILE_ALIGN);
+	}
+
+	std::ofstream file {path, std::ios::binary | std::ios::trunc};
+	if (!file) {
+		throw std::runtime_error("texture: failed to create '" + path + "'");
+	}
+
+	const char zeros[TEXTURE_FILE_ALIGN] {};
+	file.write(cast<const char*>(&header), sizeof(header));
+	u64 written = sizeof(header);
+	for (u32 i = 0; i < header.mip_count; ++i) {
+		file.write(zeros, as<std::streamsize>(header.mips[i].offset - written));
+		file.write(cast<const char*>(mips[i].data()), as<std::streamsize>(mips[i].size()));
+		written = header.mips[i].offset + mips[i].size();
+	}
+
+	if (!file) {
+		throw std::runtime_error("texture: failed to write '" + path + "'");
+	}
+}
+
+TextureFile::TextureFile(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("texture: failed to open '" + path + "'");
+	}
+
+	struct stat info {};
+	if (fstat(fd, &info) != 0 || as<usize>(info.st_size) < sizeof(TextureFileHeader)) {
+		close(fd);
+		throw std::runtime_error("texture: '" + path + "' is too small to be a texture file");
+	}
+
+	size = as<usize>(info.st_size);
+	auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		throw std::runtime_error("texture: failed to map '" + path + "'");
+	}
+	data = as<const u8*>(mapping);
+	// levels are read one at a time as they're streamed in, reading ahead would page in levels that aren't wanted
+	madvise(mapping, size, MADV_RANDOM);
+
+	memcpy(&header, data, sizeof(header));
+
+	bool valid = header.magic == TEXTURE_FILE_MAGIC && header.version == TEXTURE_FILE_VERSION
+		&& (header.format == TextureFormat::Bc7Srgb || header.format == TextureFormat::Bc5Unorm)
+		&& header.width && header.height
+		&& header.mip_count && header.mip_count <= std::min(MAX_TEXTURE_MIPS, full_mip_count(header.width, header.height));
+
+	for (u32 i = 0; valid && i < header.mip_count; ++i) {
+		const auto& range = header.mips[i];
+		valid = range.offset % TEXTURE_FILE_ALIGN == 0 && range.offset <= size && range.size <= size - range.offset
+			&& range.size == texture_mip_size(header.width, header.height, i);
+	}
+
+	if (!valid) {
+		munmap(mapping, size);
+		data = nullptr;
+		throw std::runtime_error("texture: '" + path + "' is not a valid texture file");
+	}
+}
+
+TextureFile::~TextureFile() {
+	if (data) {
+		munmap(const_cast<u8*>(data), size);
+	}
+}
+
+TextureFile::TextureFile(TextureFile&& other) noexcept
+	: data {std::exchange(other.data, nullptr)}, size {std::exchange(other.size, 0)}, header {other.header} {}
+
+TextureFile& TextureFile::operator=(TextureFile&& other) noexcept {
+	if (this != &other) {
+		if (data) {
+			munmap(const_cast<u8*>(data), size);
+		}
+		data = std::exchange(other.data, nullptr);
+		size = std::exchange(other.size, 0);
+		header = other.header;
+	}
+	return *this;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "types.hpp"
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Block compressed formats the gpu samples directly, both store 4x4 texel blocks in 16 bytes.
+enum class TextureFormat : u32 {
+	/// color in srgb
+	Bc7Srgb,
+	/// two linear channels, e.g. the xy of a normal map
+	Bc5Unorm
+};
+
+constexpr u32 TEXTURE_BLOCK_SIZE = 4;
+constexpr u32 TEXTURE_BLOCK_BYTES = 16;
+/// enough for a 32768 texel wide texture
+constexpr u32 MAX_TEXTURE_MIPS = 16;
+
+/// Size of a mip level along one axis, every level is at least one texel.
+[[nodiscard]] constexpr u32 mip_dimension(u32 size, u32 mip) {
+	return std::max(size >> mip, 1u);
+}
+
+/// Bytes of a tightly packed mip level, rows of blocks without padding.
+[[nodiscard]] constexpr u64 texture_mip_size(u32 width, u32 height, u32 mip) {
+	u64 blocks_x = (mip_dimension(width, mip) + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+	u64 blocks_y = (mip_dimension(height, mip) + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+	return blocks_x * blocks_y * TEXTURE_BLOCK_BYTES;
+}
+
+/// Byte range of one mip level inside a texture file.
+struct TextureFileRange {
+	u64 offset;
+	u64 size;
+};
+
+/// Texture files start with this header followed by the mip levels from the largest down, every level
+/// starts at a multiple of TEXTURE_FILE_ALIGN so it can be copied straight from the mapping. Little endian.
+struct TextureFileHeader {
+	u32 magic;
+	u32 version;
+	TextureFormat format;
+	u32 width;
+	u32 height;
+	u32 mip_count;
+	TextureFileRange mips[MAX_TEXTURE_MIPS];
+};
+
+constexpr u32 TEXTURE_FILE_MAGIC = 0x58455447;
+constexpr u32 TEXTURE_FILE_VERSION = 1;
+constexpr u64 TEXTURE_FILE_ALIGN = 64;
+
+/// Writes a texture file from its compressed mip levels, largest first. Throws on failure.
+void write_texture_file(
+		const std::string& path,
+		TextureFormat format,
+		u32 width,
+		u32 height,
+		std::span<const std::vector<u8>> mips);
+
+/// Read only memory mapping of a texture file. Nothing is read ahead, only the mip levels that are
+/// copied out get paged in, so large textures whose finest levels are never needed cost no io for them.
+class TextureFile {
+public:
+	/// Throws if the file can't be mapped or isn't a valid texture file.
+	explicit TextureFile(const std::string& path);
+	~TextureFile();
+	TextureFile(TextureFile&& other) noexcept;
+	TextureFile& operator=(TextureFile&& other) noexcept;
+	TextureFile(const TextureFile&) = delete;
+	TextureFile& operator=(const TextureFile&) = delete;
+
+	[[nodiscard]] TextureFormat format() const {
+		return header.format;
+	}
+	[[nodiscard]] u32 width() const {
+		return header.width;
+	}
+	[[nodiscard]] u32 height() const {
+		return header.height;
+	}
+	[[nodiscard]] u32 mip_count() const {
+		return header.mip_count;
+	}
+	/// Valid as long as the file is.
+	[[nodiscard]] std::span<const u8> mip(u32 level) const {
+		return {data + header.mips[level].offset, header.mips[level].size};
+	}
+private:
+	const u8* data {};
+	usize size {};
+	TextureFileHeader header {};
+};
\ No newline at end of file
@@ -12,6 +12,13 @@ Window::Window(std::string_view name, u32 width, u32 height, Platform platform)
 
 	SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR, "0");
 
+	if (platform == Platform::OpenGL) {
+		// the default framebuffer's format is fixed when the window is created
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+		SDL_GL_SetAttribute(SDL_GL_FRAMEBUFFER_SRGB_CAPABLE, 1);
+	}
+
 	auto sdl_platform = platform == Platform::OpenGL ? SDL_WINDOW_OPENGL : SDL_WINDOW_VULKAN;
 	inner = SDL_CreateWindow(
 			name.data(),
@@ -0,0 +1,133 @@
+#include "culling/bvh.hpp"
+#include "jobs/job_system.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+/// Culls a field of randomly placed objects from an orbiting camera while some of them move every frame.
+/// Reports the refit and culling times per frame next to a brute force test of every object.
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Timing {
+	std::vector<f64> samples {};
+
+	void report(const char* name) {
+		std::sort(samples.begin(), samples.end());
+		f64 sum = 0;
+		for (auto sample : samples) {
+			sum += sample;
+		}
+		std::printf("%-14s avg %.3fms  p50 %.3fms  p99 %.3fms\n", name,
+			sum / as<f64>(samples.size()), samples[samples.size() / 2], samples[samples.size() * 99 / 100]);
+	}
+};
+
+int main(int argc, char** argv) {
+	u32 object_count = 100000;
+	u32 frames = 200;
+	// fraction of the objects moved every frame
+	f32 moving = 0.1f;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+			object_count = as<u32>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--moving") == 0 && i + 1 < argc) {
+			moving = std::clamp(std::stof(argv[++i]), 0.0f, 1.0f);
+		}
+	}
+
+	JobSystem jobs {};
+	std::mt19937 rng {1};
+	std::uniform_real_distribution<f32> position {-1000, 1000};
+	std::uniform_real_distribution<f32> size {0.5f, 4};
+	std::uniform_real_distribution<f32> step {-1, 1};
+
+	std::vector<Aabb> bounds(object_count);
+	std::vector<u32> proxies(object_count);
+	Bvh bvh;
+	for (u32 i = 0; i < object_count; ++i) {
+		Vec3<f32> center {position(rng), position(rng) * 0.1f, position(rng)};
+		Vec3<f32> extent {size(rng), size(rng), size(rng)};
+		bounds[i] = {center - extent, center + extent};
+		proxies[i] = bvh.insert(bounds[i], i);
+	}
+
+	auto build_start = std::chrono::steady_clock::now();
+	bvh.update();
+	std::printf("%u objects, %u nodes, built in %.3fms, %u threads\n",
+		object_count, bvh.node_count(), ms_since(build_start), jobs.thread_count());
+
+	auto projection = Mat4::perspective(std::numbers::pi_v<f32> / 3, 16.0f / 9.0f, 0.1f, 800);
+	auto moving_count = as<u32>(as<f32>(object_count) * moving);
+
+	Timing update_time, cull_time, parallel_time, brute_time;
+	std::vector<u32> visible, visible_parallel, visible_brute;
+	u64 visible_total = 0;
+	for (u32 frame = 0; frame < frames; ++frame) {
+		// a different window of objects moves every frame
+		for (u32 i = 0; i < moving_count; ++i) {
+			auto index = (frame * moving_count + i) % object_count;
+			Vec3<f32> offset {step(rng), step(rng), step(rng)};
+			bounds[index] = {bounds[index].min + offset, bounds[index].max + offset};
+			bvh.set_bounds(proxies[index], bounds[index]);
+		}
+		auto start = std::chrono::steady_clock::now();
+		bvh.update();
+		update_time.samples.push_back(ms_since(start));
+
+		auto angle = as<f32>(frame) / as<f32>(frames) * 2 * std::numbers::pi_v<f32>;
+		auto view = Mat4::look_at({std::cos(angle) * 300, 50, std::sin(angle) * 300}, {0, 0, 0}, {0, 1, 0});
+		auto frustum = Frustum::from_view_projection(projection * view);
+
+		visible.clear();
+		start = std::chrono::steady_clock::now();
+		bvh.cull(frustum, visible);
+		cull_time.samples.push_back(ms_since(start));
+
+		visible_parallel.clear();
+		start = std::chrono::steady_clock::now();
+		bvh.cull_parallel(jobs, frustum, visible_parallel);
+		parallel_time.samples.push_back(ms_since(start));
+
+		visible_brute.clear();
+		start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < object_count; ++i) {
+			if (frustum_test(frustum, bounds[i]) != Containment::Outside) {
+				visible_brute.push_back(i);
+			}
+		}
+		brute_time.samples.push_back(ms_since(start));
+
+		if (visible != visible_parallel) {
+			std::fprintf(stderr, "frame %u: parallel culling differs from serial culling\n", frame);
+			return 1;
+		}
+		std::sort(visible.begin(), visible.end());
+		if (visible != visible_brute) {
+			std::fprintf(stderr, "frame %u: bvh culling found %zu objects, brute force %zu\n",
+				frame, visible.size(), visible_brute.size());
+			return 1;
+		}
+		visible_total += visible.size();
+	}
+
+	std::printf("%u frames, %u moving objects per frame, %llu visible on average\n",
+		frames, moving_count, as<unsigned long long>(visible_total / frames));
+	update_time.report("refit");
+	cull_time.report("cull");
+	parallel_time.report("cull parallel");
+	brute_time.report("brute force");
+	return 0;
+}
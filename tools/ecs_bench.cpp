@@ -0,0 +1,151 @@
+#include "ecs/world.hpp"
+#include "ecs/command_buffer.hpp"
+#include "components/transform.hpp"
+#include "components/renderable.hpp"
+#include "jobs/job_system.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/// Builds model matrices for entities with a Transform and a Renderable through the ecs queries, serially, per
+/// chunk with the batch kernel and across the job system, next to the same work over plain arrays. Every
+/// frame a slice of the entities is destroyed through a command buffer and recreated to keep the chunks churning.
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Timing {
+	std::vector<f64> samples {};
+
+	void report(const char* name, usize count) {
+		std::sort(samples.begin(), samples.end());
+		f64 sum = 0;
+		for (auto sample : samples) {
+			sum += sample;
+		}
+		auto avg = sum / as<f64>(samples.size());
+		std::printf("%-16s avg %.3fms  p50 %.3fms  p99 %.3fms  %.2fns per entity\n", name,
+			avg, samples[samples.size() / 2], samples[samples.size() * 99 / 100], avg * 1e6 / as<f64>(count));
+	}
+};
+
+/// World matrix written by the queries.
+struct WorldMatrix {
+	Mat4 matrix;
+};
+
+int main(int argc, char** argv) {
+	u32 entity_count = 1000000;
+	u32 frames = 50;
+	// fraction of the entities destroyed and recreated every frame
+	f32 churn = 0.01f;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--entities") == 0 && i + 1 < argc) {
+			entity_count = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--churn") == 0 && i + 1 < argc) {
+			churn = std::clamp(std::stof(argv[++i]), 0.0f, 1.0f);
+		}
+	}
+
+	JobSystem jobs {};
+	std::mt19937 rng {1};
+	std::uniform_real_distribution<f32> position {-1000, 1000};
+	std::uniform_real_distribution<f32> angle {-3.14f, 3.14f};
+	auto random_transform = [&] {
+		return Transform {
+			.position = {position(rng), position(rng), position(rng)},
+			.rotation = Quat::from_euler({angle(rng), angle(rng), angle(rng)})
+		};
+	};
+
+	World world;
+	std::vector<Entity> entities(entity_count);
+	std::vector<Transform> plain_transforms(entity_count);
+	std::vector<Mat4> plain_matrices(entity_count);
+	auto create_start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < entity_count; ++i) {
+		plain_transforms[i] = random_transform();
+		entities[i] = world.create(plain_transforms[i], Renderable {.mesh = nullptr, .material = i % 4}, WorldMatrix {});
+	}
+	std::printf("%u entities created in %.3fms, %u threads\n", entity_count, ms_since(create_start), jobs.thread_count());
+
+	auto churn_count = as<u32>(as<f32>(entity_count) * churn);
+	Timing each_time, chunk_time, parallel_time, plain_time, churn_time;
+	u64 checksum = 0;
+	for (u32 frame = 0; frame < frames; ++frame) {
+		auto start = std::chrono::steady_clock::now();
+		world.each<const Transform, const Renderable, WorldMatrix>([](const Transform& transform, const Renderable&, WorldMatrix& world_matrix) {
+			world_matrix.matrix = transform.matrix();
+		});
+		each_time.samples.push_back(ms_since(start));
+
+		start = std::chrono::steady_clock::now();
+		world.each_chunk<const Transform, const Renderable, WorldMatrix>([](u32 count, const Entity*, const Transform* transforms, const Renderable*, WorldMatrix* matrices) {
+			transforms_to_matrices(transforms, &matrices->matrix, count);
+		});
+		chunk_time.samples.push_back(ms_since(start));
+
+		start = std::chrono::steady_clock::now();
+		world.par_each_chunk<const Transform, const Renderable, WorldMatrix>(jobs, [](u32 count, const Entity*, const Transform* transforms, const Renderable*, WorldMatrix* matrices) {
+			transforms_to_matrices(transforms, &matrices->matrix, count);
+		});
+		parallel_time.samples.push_back(ms_since(start));
+
+		start = std::chrono::steady_clock::now();
+		transforms_to_matrices(plain_transforms.data(), plain_matrices.data(), entity_count);
+		plain_time.samples.push_back(ms_since(start));
+
+		// a different window of entities is destroyed through a command buffer and replaced every frame
+		start = std::chrono::steady_clock::now();
+		CommandBuffer commands;
+		auto first = frame * churn_count;
+		for (u32 i = 0; i < churn_count; ++i) {
+			commands.destroy(entities[(first + i) % entity_count]);
+		}
+		commands.apply(world);
+		for (u32 i = 0; i < churn_count; ++i) {
+			auto index = (first + i) % entity_count;
+			auto stale = entities[index];
+			entities[index] = world.create(random_transform(), Renderable {.mesh = nullptr, .material = index % 4}, WorldMatrix {});
+			// the old handle may share the new entity's slot, it must not reach it
+			world.destroy(stale);
+			if (world.get<Renderable>(stale) || !world.alive(entities[index])) {
+				std::fprintf(stderr, "frame %u: a stale handle reached a live entity\n", frame);
+				return 1;
+			}
+		}
+		churn_time.samples.push_back(ms_since(start));
+
+		world.each<const Renderable>([&](const Renderable& renderable) {
+			checksum += renderable.material;
+		});
+	}
+
+	u64 matched = 0;
+	world.each<const Transform, const WorldMatrix>([&](const Transform&, const WorldMatrix&) {
+		++matched;
+	});
+	if (world.entity_count() != entity_count || matched != entity_count) {
+		std::fprintf(stderr, "%zu entities alive and %llu matched by the query, expected %u\n",
+			world.entity_count(), as<unsigned long long>(matched), entity_count);
+		return 1;
+	}
+
+	std::printf("%u frames, %u entities replaced per frame, checksum %llu\n",
+		frames, churn_count, as<unsigned long long>(checksum));
+	each_time.report("each", entity_count);
+	chunk_time.report("each_chunk", entity_count);
+	parallel_time.report("par_each_chunk", entity_count);
+	plain_time.report("plain arrays", entity_count);
+	churn_time.report("churn", std::max(churn_count, 1u));
+	return 0;
+}
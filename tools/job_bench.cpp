@@ -0,0 +1,282 @@
+#include "jobs/job_system.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Stresses the job system with nested submits, dependencies, parallel_for, submits from a thread that isn't
+/// a worker and a second job system, checking that every job runs exactly once and never before its dependency.
+/// Afterwards measures throughput for empty jobs, small jobs and parallel_for. Exits with 1 at the first broken
+/// invariant.
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Timing {
+	std::vector<f64> samples {};
+
+	void report(const char* name, usize count) {
+		std::sort(samples.begin(), samples.end());
+		f64 sum = 0;
+		for (auto sample : samples) {
+			sum += sample;
+		}
+		auto avg = sum / as<f64>(samples.size());
+		std::printf("%-16s avg %.3fms  p50 %.3fms  p99 %.3fms  %.2fns per job  %.2fM jobs/s\n", name,
+			avg, samples[samples.size() / 2], samples[samples.size() * 99 / 100],
+			avg * 1e6 / as<f64>(count), as<f64>(count) / avg / 1e3);
+	}
+};
+
+/// How often every job of a stress round ran, each slot has to end up at exactly one.
+struct Hits {
+	std::unique_ptr<std::atomic<u32>[]> slots;
+	u32 count;
+
+	explicit Hits(u32 count) : slots {std::make_unique<std::atomic<u32>[]>(count)}, count {count} {}
+
+	void hit(u32 index) {
+		slots[index].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	bool exactly_once() const {
+		for (u32 i = 0; i < count; ++i) {
+			if (slots[i].load() != 1) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+static bool check(bool condition, u32 round, const char* what) {
+	if (!condition) {
+		std::fprintf(stderr, "round %u: %s\n", round, what);
+	}
+	return condition;
+}
+
+/// Every root job spawns children from inside a worker and waits on them, which keeps that worker executing
+/// other jobs in the meantime.
+static bool nested_round(JobSystem& jobs, u32 round, u32 roots, u32 children) {
+	Hits hits {roots * (children + 1)};
+	std::atomic<u32> early_returns {};
+	JobCounter counter;
+	for (u32 root = 0; root < roots; ++root) {
+		jobs.submit([&jobs, &hits, &early_returns, root, children] {
+			auto base = root * (children + 1);
+			hits.hit(base);
+			JobCounter child_counter;
+			for (u32 child = 1; child <= children; ++child) {
+				jobs.submit([&hits, index = base + child] {
+					hits.hit(index);
+				}, &child_counter);
+			}
+			jobs.wait(child_counter);
+			// wait may only return once all children have run
+			for (u32 child = 1; child <= children; ++child) {
+				if (hits.slots[base + child].load() == 0) {
+					early_returns.fetch_add(1);
+					break;
+				}
+			}
+		}, &counter);
+	}
+	jobs.wait(counter);
+	return check(counter.done(), round, "nested: counter isn't zero after wait")
+		&& check(early_returns.load() == 0, round, "nested: wait returned before the children ran")
+		&& check(hits.exactly_once(), round, "nested: a job didn't run exactly once");
+}
+
+/// Jobs depending on a counter only start once every job of that counter has finished.
+static bool dependency_round(JobSystem& jobs, u32 round, u32 count) {
+	Hits first_hits {count};
+	Hits second_hits {count};
+	std::atomic<u32> finished {};
+	std::atomic<u32> started_early {};
+	JobCounter first;
+	JobCounter second;
+	for (u32 i = 0; i < count; ++i) {
+		jobs.submit([&first_hits, &finished, i] {
+			first_hits.hit(i);
+			finished.fetch_add(1, std::memory_order_release);
+		}, &first);
+	}
+	// most of these are submitted while the first batch is still running and get parked as continuations
+	for (u32 i = 0; i < count; ++i) {
+		jobs.submit([&second_hits, &finished, &started_early, i, count] {
+			if (finished.load(std::memory_order_acquire) != count) {
+				started_early.fetch_add(1);
+			}
+			second_hits.hit(i);
+		}, &second, &first);
+	}
+	jobs.wait(second);
+	jobs.wait(first);
+	return check(started_early.load() == 0, round, "dependency: a job started before its dependency finished")
+		&& check(first_hits.exactly_once() && second_hits.exactly_once(), round, "dependency: a job didn't run exactly once");
+}
+
+/// parallel_for covers the range exactly once, also with a batch size that doesn't divide it.
+static bool parallel_for_round(JobSystem& jobs, u32 round, u32 count) {
+	Hits hits {count};
+	JobCounter counter;
+	jobs.parallel_for(count, 7, [&hits](u32 begin, u32 end) {
+		for (u32 i = begin; i < end; ++i) {
+			hits.hit(i);
+		}
+	}, counter);
+	jobs.wait(counter);
+	return check(hits.exactly_once(), round, "parallel_for: an index wasn't visited exactly once");
+}
+
+/// A thread that isn't a worker submits while the workers are busy with jobs from the main thread. More jobs
+/// than a deque holds are submitted at once so the ring has to wrap.
+static bool external_round(JobSystem& jobs, u32 round, u32 count) {
+	Hits main_hits {count};
+	Hits external_hits {count};
+	JobCounter main_counter;
+	JobCounter external_counter;
+	std::thread external {[&] {
+		for (u32 i = 0; i < count; ++i) {
+			jobs.submit([&external_hits, i] {
+				external_hits.hit(i);
+			}, &external_counter);
+		}
+		jobs.wait(external_counter);
+	}};
+	for (u32 i = 0; i < count; ++i) {
+		jobs.submit([&main_hits, i] {
+			main_hits.hit(i);
+		}, &main_counter);
+	}
+	jobs.wait(main_counter);
+	external.join();
+	return check(jobs.thread_index() == 0, round, "external: main thread lost its worker index")
+		&& check(main_hits.exactly_once(), round, "external: a main thread job didn't run exactly once")
+		&& check(external_hits.exactly_once(), round, "external: an external job didn't run exactly once");
+}
+
+/// A second job system created and destroyed on the main thread leaves the first one's worker indices alone,
+/// and jobs of one system submitting to the other go through its external queue.
+static bool second_system_round(JobSystem& jobs, u32 round, u32 count) {
+	Hits hits {count};
+	std::atomic<u32> wrong_index {};
+	{
+		JobSystem other {2};
+		JobCounter counter;
+		for (u32 i = 0; i < count; ++i) {
+			other.submit([&jobs, &other, &hits, &wrong_index, i] {
+				if (jobs.thread_index() != UINT32_MAX && other.thread_index() != 0) {
+					wrong_index.fetch_add(1);
+				}
+				JobCounter inner;
+				jobs.submit([&hits, i] {
+					hits.hit(i);
+				}, &inner);
+				jobs.wait(inner);
+			}, &counter);
+		}
+		other.wait(counter);
+	}
+	return check(wrong_index.load() == 0, round, "second system: a worker of one system had an index in the other")
+		&& check(jobs.thread_index() == 0, round, "second system: main thread lost its worker index")
+		&& check(hits.exactly_once(), round, "second system: a job didn't run exactly once");
+}
+
+/// Submits count jobs running fn from the main thread and waits for them, once per round.
+template<typename F>
+static Timing measure(JobSystem& jobs, u32 rounds, u32 count, const F& fn) {
+	Timing timing;
+	for (u32 round = 0; round < rounds; ++round) {
+		auto start = std::chrono::steady_clock::now();
+		JobCounter counter;
+		for (u32 i = 0; i < count; ++i) {
+			jobs.submit([&fn, i] {
+				fn(i);
+			}, &counter);
+		}
+		jobs.wait(counter);
+		timing.samples.push_back(ms_since(start));
+	}
+	return timing;
+}
+
+int main(int argc, char** argv) {
+	u32 threads = 0;
+	u32 stress_rounds = 50;
+	u32 rounds = 50;
+	u32 count = 100000;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = as<u32>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--stress-rounds") == 0 && i + 1 < argc) {
+			stress_rounds = as<u32>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+			rounds = as<u32>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+			count = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+	}
+
+	JobSystem jobs {threads};
+	std::printf("%u threads\n", jobs.thread_count());
+
+	auto stress_start = std::chrono::steady_clock::now();
+	for (u32 round = 0; round < stress_rounds; ++round) {
+		if (!nested_round(jobs, round, 64, 100)
+			|| !dependency_round(jobs, round, 2000)
+			|| !parallel_for_round(jobs, round, 10007)
+			|| !external_round(jobs, round, as<u32>(JobDeque::CAPACITY) * 2)
+			|| !second_system_round(jobs, round, 500)) {
+			return 1;
+		}
+	}
+	std::printf("%u stress rounds in %.3fms, ok\n", stress_rounds, ms_since(stress_start));
+
+	if (!rounds) {
+		return 0;
+	}
+
+	measure(jobs, rounds, count, [](u32) {}).report("empty", count);
+
+	// a few hundred nanoseconds of work, about what a small gameplay job does
+	std::vector<u32> results(count);
+	measure(jobs, rounds, count, [&results](u32 i) {
+		u32 x = i + 1;
+		for (u32 j = 0; j < 256; ++j) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+		}
+		results[i] = x;
+	}).report("small", count);
+
+	std::vector<f32> values(count * 16, 1.0f);
+	for (u32 batch : {64u, 1024u}) {
+		Timing timing;
+		for (u32 round = 0; round < rounds; ++round) {
+			auto start = std::chrono::steady_clock::now();
+			JobCounter counter;
+			jobs.parallel_for(count, batch, [&values](u32 begin, u32 end) {
+				for (u32 i = begin * 16; i < end * 16; ++i) {
+					values[i] = values[i] * 0.5f + 1.0f;
+				}
+			}, counter);
+			jobs.wait(counter);
+			timing.samples.push_back(ms_since(start));
+		}
+		auto name = "parallel_for " + std::to_string(batch);
+		timing.report(name.c_str(), (count + batch - 1) / batch);
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Measures how long a logging call blocks its caller while many threads log at once. Every call is timed on
+/// its own, the logger thread formats and writes in the background, by default to /dev/null.
+
+static f64 ns_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Timing {
+	std::vector<f64> samples {};
+
+	void report(const char* name) {
+		std::sort(samples.begin(), samples.end());
+		f64 sum = 0;
+		for (auto sample : samples) {
+			sum += sample;
+		}
+		auto avg = sum / as<f64>(samples.size());
+		std::printf("%-16s avg %.1fns  p50 %.1fns  p99 %.1fns  p99.9 %.1fns  max %.1fns\n", name,
+			avg, samples[samples.size() / 2], samples[samples.size() * 99 / 100],
+			samples[samples.size() * 999 / 1000], samples.back());
+	}
+};
+
+int main(int argc, char** argv) {
+	u32 threads = 8;
+	u32 calls = 100000;
+	const char* filename = "/dev/null";
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+			calls = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			filename = argv[++i];
+		}
+	}
+
+	Logger logger {filename};
+	// an area longer than a record is cut instead of spilling into the next one
+	logger.info(std::string(1000, 'a'), "long area {}", 1);
+
+	std::vector<Timing> info_times(threads);
+	std::vector<Timing> text_times(threads);
+	auto start = std::chrono::steady_clock::now();
+	{
+		std::vector<std::jthread> workers;
+		for (u32 thread = 0; thread < threads; ++thread) {
+			workers.emplace_back([&, thread] {
+				auto& info_time = info_times[thread];
+				auto& text_time = text_times[thread];
+				info_time.samples.reserve(calls);
+				text_time.samples.reserve(calls);
+				std::string name = "worker " + std::to_string(thread);
+				for (u32 i = 0; i < calls; ++i) {
+					auto call_start = std::chrono::steady_clock::now();
+					logger.info("bench", "{} frame {} took {}ms, ok {}", name, i, as<f32>(i) * 0.25f, true);
+					info_time.samples.push_back(ns_since(call_start));
+
+					call_start = std::chrono::steady_clock::now();
+					logger.log("bench", "an already formatted line of about the usual length");
+					text_time.samples.push_back(ns_since(call_start));
+				}
+			});
+		}
+	}
+	auto produce_ms = ns_since(start) / 1e6;
+	logger.flush();
+	auto total_ms = ns_since(start) / 1e6;
+
+	Timing info_time;
+	Timing text_time;
+	for (u32 thread = 0; thread < threads; ++thread) {
+		info_time.samples.insert(info_time.samples.end(), info_times[thread].samples.begin(), info_times[thread].samples.end());
+		text_time.samples.insert(text_time.samples.end(), text_times[thread].samples.begin(), text_times[thread].samples.end());
+	}
+	std::printf("%u threads, %u calls each, producers done in %.3fms, flushed after %.3fms\n",
+		threads, calls * 2, produce_ms, total_ms);
+	info_time.report("info");
+	text_time.report("log");
+	return 0;
+}
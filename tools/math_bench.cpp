@@ -0,0 +1,186 @@
+#include "components/transform.hpp"
+#include "math/simd.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/// Times the math kernels against their scalar reference on the same data and checks that both agree.
+/// The kernels use the widest instruction set the build enables, GAME_AVX switches between sse and avx.
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Timing {
+	std::vector<f64> samples {};
+
+	void report(const char* name, usize count) {
+		std::sort(samples.begin(), samples.end());
+		f64 sum = 0;
+		for (auto sample : samples) {
+			sum += sample;
+		}
+		auto avg = sum / as<f64>(samples.size());
+		std::printf("%-24s avg %.3fms  p50 %.3fms  p99 %.3fms  %.2fns per item\n", name,
+			avg, samples[samples.size() / 2], samples[samples.size() * 99 / 100], avg * 1e6 / as<f64>(count));
+	}
+};
+
+/// Runs fn once per round and records how long it took.
+template<typename F>
+static Timing measure(u32 rounds, F&& fn) {
+	Timing timing;
+	for (u32 round = 0; round < rounds; ++round) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		timing.samples.push_back(ms_since(start));
+	}
+	return timing;
+}
+
+static bool nearly_equal(const Mat4& a, const Mat4& b) {
+	for (usize i = 0; i < 16; ++i) {
+		if (std::abs(a.m[i] - b.m[i]) > 1e-3f * std::max(1.0f, std::abs(b.m[i]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool nearly_equal(const Vec3<f32>& a, const Vec3<f32>& b) {
+	auto scale = std::max({1.0f, std::abs(b.x), std::abs(b.y), std::abs(b.z)});
+	return std::abs(a.x - b.x) <= 1e-4f * scale && std::abs(a.y - b.y) <= 1e-4f * scale && std::abs(a.z - b.z) <= 1e-4f * scale;
+}
+
+int main(int argc, char** argv) {
+	u32 count = 100000;
+	u32 rounds = 100;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+			count = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+			rounds = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+	}
+
+#if defined(GAME_SIMD_AVX)
+	const char* isa = "avx";
+#elif defined(GAME_SIMD_SSE)
+	const char* isa = "sse";
+#else
+	const char* isa = "scalar";
+#endif
+	std::printf("%u items, %u rounds, kernels built for %s\n", count, rounds, isa);
+
+	std::mt19937 rng {1};
+	std::uniform_real_distribution<f32> position {-100, 100};
+	std::uniform_real_distribution<f32> angle {-3.14f, 3.14f};
+	std::uniform_real_distribution<f32> scale {0.5f, 2};
+
+	std::vector<Transform> transforms(count);
+	std::vector<Vec3<f32>> positions(count);
+	std::vector<Quat> rotations(count);
+	std::vector<Vec3<f32>> scales(count);
+	std::vector<Mat4> matrices(count);
+	for (u32 i = 0; i < count; ++i) {
+		transforms[i] = {
+			.position = {position(rng), position(rng), position(rng)},
+			.rotation = Quat::from_euler({angle(rng), angle(rng), angle(rng)}),
+			.scale = {scale(rng), scale(rng), scale(rng)}
+		};
+		positions[i] = transforms[i].position;
+		rotations[i] = transforms[i].rotation;
+		scales[i] = transforms[i].scale;
+		matrices[i] = transforms[i].matrix();
+	}
+	auto view_projection = Mat4::perspective(1, 16.0f / 9.0f, 0.1f, 500) * Mat4::look_at({0, 40, 80}, {0, 0, 0}, {0, 1, 0});
+
+	std::vector<Mat4> simd_out(count);
+	std::vector<Mat4> scalar_out(count);
+	std::vector<Vec3<f32>> simd_points(count);
+	std::vector<Vec3<f32>> scalar_points(count);
+	bool ok = true;
+	auto compare = [&](const char* name) {
+		for (u32 i = 0; i < count; ++i) {
+			if (!nearly_equal(simd_out[i], scalar_out[i])) {
+				std::fprintf(stderr, "%s: item %u differs from the scalar reference\n", name, i);
+				ok = false;
+				return;
+			}
+		}
+	};
+
+	auto simd = measure(rounds, [&] {
+		transforms_to_matrices(transforms.data(), simd_out.data(), count);
+	});
+	auto scalar = measure(rounds, [&] {
+		for (u32 i = 0; i < count; ++i) {
+			scalar_out[i] = transforms[i].matrix();
+		}
+	});
+	compare("transforms_to_matrices");
+	simd.report("transforms_to_matrices", count);
+	scalar.report("  scalar", count);
+
+	simd = measure(rounds, [&] {
+		compose_trs(positions.data(), rotations.data(), scales.data(), simd_out.data(), count);
+	});
+	scalar = measure(rounds, [&] {
+		compose_trs_scalar(positions.data(), rotations.data(), scales.data(), scalar_out.data(), count);
+	});
+	compare("compose_trs");
+	simd.report("compose_trs", count);
+	scalar.report("  scalar", count);
+
+	simd = measure(rounds, [&] {
+		for (u32 i = 0; i < count; ++i) {
+			simd_out[i] = view_projection * matrices[i];
+		}
+	});
+	scalar = measure(rounds, [&] {
+		for (u32 i = 0; i < count; ++i) {
+			scalar_out[i] = mat4_mul_scalar(view_projection, matrices[i]);
+		}
+	});
+	compare("Mat4 multiply");
+	simd.report("Mat4 multiply", count);
+	scalar.report("  scalar", count);
+
+	simd = measure(rounds, [&] {
+		for (u32 i = 0; i < count; ++i) {
+			simd_out[i] = matrices[i].inverse();
+		}
+	});
+	scalar = measure(rounds, [&] {
+		for (u32 i = 0; i < count; ++i) {
+			scalar_out[i] = mat4_inverse_scalar(matrices[i]);
+		}
+	});
+	compare("Mat4 inverse");
+	simd.report("Mat4 inverse", count);
+	scalar.report("  scalar", count);
+
+	simd = measure(rounds, [&] {
+		transform_points(view_projection, positions.data(), simd_points.data(), count);
+	});
+	scalar = measure(rounds, [&] {
+		transform_points_scalar(view_projection, positions.data(), scalar_points.data(), count);
+	});
+	for (u32 i = 0; i < count; ++i) {
+		if (!nearly_equal(simd_points[i], scalar_points[i])) {
+			std::fprintf(stderr, "transform_points: item %u differs from the scalar reference\n", i);
+			ok = false;
+			break;
+		}
+	}
+	simd.report("transform_points", count);
+	scalar.report("  scalar", count);
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+#include "mesh/mesh_file.hpp"
+#include "mesh/mesh_optimizer.hpp"
+#include "mesh/obj_loader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+
+/// Offline converter from OBJ to the memory mapped mesh format. The mesh is optimized and gets
+/// a lod chain unless --no-optimize is given, with --bench the load time of both formats is compared afterwards.
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// reads every byte the renderer would upload so the mapping's page faults are part of the measurement
+static u64 touch(const MeshView& view) {
+	u64 sum = 0;
+	auto add = [&](const void* data, usize size) {
+		auto bytes = as<const u8*>(data);
+		for (usize i = 0; i < size; i += 64) {
+			sum += bytes[i];
+		}
+	};
+	add(view.vertices.data(), view.vertices.size_bytes());
+	add(view.indices.data(), view.indices.size_bytes());
+	return sum;
+}
+
+static void bench(const std::string& input, const std::string& output, u32 iterations) {
+	f64 obj_ms = 0;
+	f64 mesh_ms = 0;
+	u64 sink = 0;
+	for (u32 i = 0; i < iterations; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		auto mesh = PackedMesh::pack(load_obj(input));
+		sink += touch(mesh.view());
+		obj_ms += ms_since(start);
+
+		start = std::chrono::steady_clock::now();
+		MeshFile file {output};
+		sink += touch(file.view());
+		mesh_ms += ms_since(start);
+	}
+
+	// both include packing into the gpu layout, which is what an upload needs
+	std::printf("obj parse and pack: %.3fms\n", obj_ms / iterations);
+	std::printf("mesh file map:      %.3fms (%.1fx faster)\n", mesh_ms / iterations, obj_ms / mesh_ms);
+	std::printf("(checksum %llu)\n", as<unsigned long long>(sink));
+}
+
+static void report(const char* name, std::span<const u32> indices, u32 vertex_count) {
+	auto stats = analyze_vertex_cache(indices, vertex_count);
+	std::printf("%-8s %8zu triangles  acmr %.3f  atvr %.3f\n", name, indices.size() / 3, stats.acmr, stats.atvr);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::fprintf(stderr, "usage: %s <input.obj> <output.mesh> [--no-optimize] [--lods count] [--bench iterations]\n", argv[0]);
+		return 1;
+	}
+	std::string input = argv[1];
+	std::string output = argv[2];
+	bool optimize = true;
+	u32 lod_count = 4;
+	u32 iterations = 0;
+	for (int i = 3; i < argc; ++i) {
+		if (strcmp(argv[i], "--no-optimize") == 0) {
+			optimize = false;
+		}
+		else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+			lod_count = std::min(as<u32>(std::stoul(argv[++i])), MAX_MESH_LODS - 1);
+		}
+		else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+			iterations = as<u32>(std::stoul(argv[++i]));
+		}
+	}
+
+	try {
+		auto mesh = load_obj(input);
+
+		std::vector<LodIndices> lods;
+		report("input", mesh.indices, as<u32>(mesh.vertices.size()));
+		if (optimize) {
+			lods = optimize_mesh(mesh, lod_count);
+			report("output", mesh.indices, as<u32>(mesh.vertices.size()));
+			for (usize i = 0; i < lods.size(); ++i) {
+				auto name = "lod " + std::to_string(i + 1);
+				report(name.c_str(), lods[i].indices, as<u32>(mesh.vertices.size()));
+				std::printf("%-8s error %g\n", "", lods[i].error);
+			}
+		}
+
+		// meshlets are built from the final index order
+		auto packed = PackedMesh::pack(mesh, true);
+		for (const auto& lod : lods) {
+			packed.add_lod(lod.indices, lod.error);
+		}
+		write_mesh_file(output, packed.view());
+
+		std::printf("%s: %zu vertices, %zu triangles, %zu meshlets, %zu bytes of vertex data (%zu unpacked)\n",
+			output.c_str(), packed.vertices.size(), mesh.indices.size() / 3, packed.meshlets.size(),
+			packed.vertices.size() * sizeof(PackedVertex), mesh.vertices.size() * sizeof(Vertex));
+
+		if (iterations) {
+			bench(input, output, iterations);
+		}
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,181 @@
+#include "render_backend.hpp"
+#include "components/transform.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// Issues a frame of single draws through the renderer front end with the backend fixed at compile time and
+/// with it picked at runtime, to show what the per draw dispatch costs. The backend queues draws the way
+/// the vulkan renderer's render does, --null turns it into a no-op so only the dispatch is left.
+
+static f64 ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Timing {
+	std::vector<f64> samples {};
+
+	void report(const char* name, u32 draws) {
+		std::sort(samples.begin(), samples.end());
+		f64 sum = 0;
+		for (auto sample : samples) {
+			sum += sample;
+		}
+		auto avg = sum / as<f64>(samples.size());
+		std::printf("%-8s avg %.3fms  p50 %.3fms  p99 %.3fms  %.2fns per draw\n", name,
+			avg, samples[samples.size() / 2], samples[samples.size() * 99 / 100], avg * 1e6 / draws);
+	}
+};
+
+/// Records draws like VulkanRenderer::render, a gpu isn't needed to measure the cpu side.
+class QueueBackend {
+public:
+	GpuMesh upload_mesh(const MeshView&) {
+		return {};
+	}
+	void destroy_mesh(GpuMesh&) {}
+	u32 load_texture(const std::string&) {
+		return VulkanBindless::NONE;
+	}
+	void destroy_texture(u32) {}
+	void render(const GpuMesh& mesh, const Transform& transform) {
+		if (frame_active) {
+			queued_draws.push_back({.model = transform.matrix(), .mesh = &mesh});
+		}
+	}
+	void submit(std::span<const DrawCommand> draws) {
+		queued_draws.insert(queued_draws.end(), draws.begin(), draws.end());
+	}
+	void render_parallel(JobSystem&, std::span<const DrawCommand>) {}
+	u32 add_object(const GpuMesh&, const Mat4&) {
+		return 0;
+	}
+	void update_object(u32, const Mat4&) {}
+	void remove_object(u32) {}
+	void set_view_projection(const Mat4&) {}
+	void set_clear_color(f32, f32, f32, f32) {}
+	void begin(bool) {
+		frame_active = true;
+	}
+	void finish() {
+		queued_draws.clear();
+		frame_active = false;
+	}
+	void resize() {}
+	void mark_input(std::chrono::steady_clock::time_point) {}
+	f64 take_input_latency() {
+		return 0;
+	}
+	[[nodiscard]] f64 gpu_frame_time() const {
+		return 0;
+	}
+private:
+	std::vector<DrawCommand> queued_draws {};
+	bool frame_active {};
+};
+
+class NullBackend {
+public:
+	GpuMesh upload_mesh(const MeshView&) {
+		return {};
+	}
+	void destroy_mesh(GpuMesh&) {}
+	u32 load_texture(const std::string&) {
+		return VulkanBindless::NONE;
+	}
+	void destroy_texture(u32) {}
+	void render(const GpuMesh&, const Transform&) {}
+	void submit(std::span<const DrawCommand>) {}
+	void render_parallel(JobSystem&, std::span<const DrawCommand>) {}
+	u32 add_object(const GpuMesh&, const Mat4&) {
+		return 0;
+	}
+	void update_object(u32, const Mat4&) {}
+	void remove_object(u32) {}
+	void set_view_projection(const Mat4&) {}
+	void set_clear_color(f32, f32, f32, f32) {}
+	void begin(bool) {}
+	void finish() {}
+	void resize() {}
+	void mark_input(std::chrono::steady_clock::time_point) {}
+	f64 take_input_latency() {
+		return 0;
+	}
+	[[nodiscard]] f64 gpu_frame_time() const {
+		return 0;
+	}
+};
+
+template<typename R>
+static Timing run(R& renderer, const GpuMesh& mesh, const std::vector<Transform>& transforms, u32 frames) {
+	Timing timing;
+	// the first frame grows the draw queue and isn't timed
+	renderer.begin(true);
+	for (const auto& transform : transforms) {
+		renderer.render(mesh, transform);
+	}
+	renderer.finish();
+
+	for (u32 frame = 0; frame < frames; ++frame) {
+		renderer.begin(true);
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& transform : transforms) {
+			renderer.render(mesh, transform);
+		}
+		timing.samples.push_back(ms_since(start));
+		renderer.finish();
+	}
+	return timing;
+}
+
+int main(int argc, char** argv) {
+	u32 draw_count = 100000;
+	u32 frames = 200;
+	bool null = false;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc) {
+			draw_count = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = std::max(as<u32>(std::stoul(argv[++i])), 1u);
+		}
+		else if (strcmp(argv[i], "--null") == 0) {
+			null = true;
+		}
+	}
+
+	std::vector<Transform> transforms(draw_count);
+	for (u32 i = 0; i < draw_count; ++i) {
+		transforms[i].position = {as<f32>(i % 256), 0, as<f32>(i / 256)};
+	}
+	GpuMesh mesh {};
+
+	// the runtime choice keeps the compiler from seeing which implementation the virtual calls reach
+	std::unique_ptr<VirtualRenderBackend> virtual_backend;
+	if (null) {
+		virtual_backend = std::make_unique<VirtualRenderBackendImpl<NullBackend>>();
+	}
+	else {
+		virtual_backend = std::make_unique<VirtualRenderBackendImpl<QueueBackend>>();
+	}
+	BasicRenderer<DynamicRenderBackend> dynamic_renderer {std::move(virtual_backend)};
+
+	Timing static_time;
+	if (null) {
+		BasicRenderer<NullBackend> static_renderer {};
+		static_time = run(static_renderer, mesh, transforms, frames);
+	}
+	else {
+		BasicRenderer<QueueBackend> static_renderer {};
+		static_time = run(static_renderer, mesh, transforms, frames);
+	}
+	auto dynamic_time = run(dynamic_renderer, mesh, transforms, frames);
+
+	std::printf("%u draws per frame, %u frames, %s backend\n", draw_count, frames, null ? "null" : "queue");
+	static_time.report("static", draw_count);
+	dynamic_time.report("dynamic", draw_count);
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include "texture/texture_file.hpp"
+#include "texture/texture_compress.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Offline converter from binary PPM to the block compressed texture format with a full mip chain.
+/// Color textures become BC7, --bc5 keeps the red and green channels for normal maps.
+
+struct Image {
+	std::vector<u8> rgba;
+	u32 width;
+	u32 height;
+};
+
+/// reads a P6 header field, skipping whitespace and comments
+static u32 read_field(std::ifstream& file) {
+	int c = file.get();
+	while (file && (std::isspace(c) || c == '#')) {
+		if (c == '#') {
+			while (file && c != '\n') {
+				c = file.get();
+			}
+		}
+		c = file.get();
+	}
+
+	u32 value = 0;
+	bool digits = false;
+	while (file && std::isdigit(c)) {
+		value = value * 10 + as<u32>(c - '0');
+		digits = true;
+		c = file.get();
+	}
+	if (!digits) {
+		throw std::runtime_error("texture: malformed ppm header");
+	}
+	return value;
+}
+
+static Image load_ppm(const std::string& path) {
+	std::ifstream file {path, std::ios::binary};
+	if (!file) {
+		throw std::runtime_error("texture: failed to open '" + path + "'");
+	}
+	char magic[2] {};
+	file.read(magic, 2);
+	if (magic[0] != 'P' || magic[1] != '6') {
+		throw std::runtime_error("texture: '" + path + "' is not a binary ppm");
+	}
+
+	Image image {};
+	image.width = read_field(file);
+	image.height = read_field(file);
+	// the single whitespace after the max value was consumed by read_field
+	if (read_field(file) != 255 || !image.width || !image.height) {
+		throw std::runtime_error("texture: '" + path + "' has to be an 8 bit ppm");
+	}
+
+	std::vector<u8> rgb(as<usize>(image.width) * image.height * 3);
+	file.read(cast<char*>(rgb.data()), as<std::streamsize>(rgb.size()));
+	if (!file) {
+		throw std::runtime_error("texture: '" + path + "' is truncated");
+	}
+
+	image.rgba.resize(as<usize>(image.width) * image.height * 4);
+	for (usize i = 0; i < as<usize>(image.width) * image.height; ++i) {
+		memcpy(&image.rgba[i * 4], &rgb[i * 3], 3);
+		image.rgba[i * 4 + 3] = 255;
+	}
+	return image;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::fprintf(stderr, "usage: %s <input.ppm> <output.tex> [--bc5] [--mips count]\n", argv[0]);
+		return 1;
+	}
+	std::string input = argv[1];
+	std::string output = argv[2];
+	auto format = TextureFormat::Bc7Srgb;
+	u32 max_mips = MAX_TEXTURE_MIPS;
+	for (int i = 3; i < argc; ++i) {
+		if (strcmp(argv[i], "--bc5") == 0) {
+			format = TextureFormat::Bc5Unorm;
+		}
+		else if (strcmp(argv[i], "--mips") == 0 && i + 1 < argc) {
+			max_mips = std::clamp(as<u32>(std::stoul(argv[++i])), 1u, MAX_TEXTURE_MIPS);
+		}
+	}
+
+	try {
+		auto image = load_ppm(input);
+		auto level = image;
+		std::vector<std::vector<u8>> mips;
+		u64 bytes = 0;
+		// down to 1x1, every level is filtered from the previous one
+		while (mips.size() < max_mips) {
+			mips.push_back(compress_image(format, level.rgba, level.width, level.height));
+			bytes += mips.back().size();
+			if (level.width == 1 && level.height == 1) {
+				break;
+			}
+			level.rgba = downsample_image(level.rgba, level.width, level.height, format == TextureFormat::Bc7Srgb);
+			level.width = mip_dimension(level.width, 1);
+			level.height = mip_dimension(level.height, 1);
+		}
+		write_texture_file(output, format, image.width, image.height, mips);
+
+		std::printf("%s: %ux%u %s, %zu mips, %llu bytes (%zu uncompressed)\n", output.c_str(), image.width, image.height,
+			format == TextureFormat::Bc7Srgb ? "bc7" : "bc5", mips.size(), as<unsigned long long>(bytes), image.rgba.size());
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,123 @@
+#include "memory/tlsf.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+
+/// Allocates and frees random sizes and alignments and checks the allocator against a model of the live
+/// allocations after every step, no gpu is involved. Exits with 1 at the first broken invariant.
+
+struct Live {
+	u64 size;
+	u32 node;
+};
+
+static bool check(bool condition, u64 step, const char* what) {
+	if (!condition) {
+		std::fprintf(stderr, "step %llu: %s\n", as<unsigned long long>(step), what);
+	}
+	return condition;
+}
+
+/// Live allocations are disjoint, in bounds and reported in offset order, the bookkeeping adds up.
+static bool check_state(const Tlsf& tlsf, const std::map<u64, Live>& live, u64 step) {
+	u64 used = 0;
+	u64 end = 0;
+	auto expected = live.begin();
+	bool ordered = true;
+	tlsf.for_each_allocation([&](const Tlsf::Allocation& allocation) {
+		if (expected == live.end() || expected->first != allocation.offset
+			|| expected->second.size != allocation.size || expected->second.node != allocation.node
+			|| allocation.offset < end) {
+			ordered = false;
+			return;
+		}
+		end = allocation.offset + allocation.size;
+		used += allocation.size;
+		++expected;
+	});
+	return check(ordered && expected == live.end(), step, "allocations don't match the model or overlap")
+		&& check(end <= tlsf.capacity(), step, "allocation past the end")
+		&& check(used == tlsf.used(), step, "used bytes don't match the allocations")
+		&& check(live.size() == tlsf.allocation_count(), step, "allocation count doesn't match")
+		&& check(tlsf.largest_free_block() <= tlsf.capacity() - used, step, "free block larger than the free space");
+}
+
+int main(int argc, char** argv) {
+	u64 capacity = 64 * 1024 * 1024;
+	u32 steps = 200000;
+	u32 seed = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+			capacity = std::max(as<u64>(std::stoull(argv[++i])), Tlsf::ALIGN);
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			steps = as<u32>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = as<u32>(std::stoul(argv[++i]));
+		}
+	}
+
+	Tlsf tlsf {capacity};
+	std::map<u64, Live> live;
+	std::mt19937_64 rng {seed};
+	// mostly small sizes with a long tail, like buffers next to the odd large image
+	std::uniform_int_distribution<u32> size_log2 {0, 22};
+	std::uniform_int_distribution<u32> alignment_log2 {0, 16};
+	std::uniform_int_distribution<u32> percent {0, 99};
+	u32 failed_allocs = 0;
+
+	for (u64 step = 0; step < steps; ++step) {
+		// the free probability follows the fill level so the heap keeps hovering around full
+		bool do_free = !live.empty() && percent(rng) < 30 + tlsf.used() * 40 / capacity;
+		if (do_free) {
+			auto it = live.begin();
+			std::advance(it, std::uniform_int_distribution<usize> {0, live.size() - 1}(rng));
+			tlsf.free(it->second.node);
+			live.erase(it);
+		}
+		else {
+			auto size = std::uniform_int_distribution<u64> {1, u64 {1} << size_log2(rng)}(rng);
+			auto alignment = u64 {1} << alignment_log2(rng);
+			auto largest = tlsf.largest_free_block();
+			auto allocation = tlsf.alloc(size, alignment);
+			if (!allocation) {
+				++failed_allocs;
+				// good fit only rounds a request up by a fraction of its size class, twice the size plus
+				// the alignment padding is always found
+				if (!check(largest < 2 * (size + alignment) + Tlsf::ALIGN, step, "alloc failed with a large enough free block")) {
+					return 1;
+				}
+			}
+			else if (!check(allocation->offset % std::max(alignment, Tlsf::ALIGN) == 0, step, "misaligned offset")
+				|| !check(allocation->size >= size, step, "allocation smaller than requested")
+				|| !check(!live.contains(allocation->offset), step, "offset handed out twice")) {
+				return 1;
+			}
+			else {
+				live[allocation->offset] = {.size = allocation->size, .node = allocation->node};
+			}
+		}
+
+		if (!check_state(tlsf, live, step)) {
+			return 1;
+		}
+	}
+
+	auto final_count = live.size();
+	for (const auto& [offset, allocation] : live) {
+		tlsf.free(allocation.node);
+	}
+	live.clear();
+	// freeing everything has to merge the heap back into a single block
+	if (!check_state(tlsf, live, steps)
+		|| !check(tlsf.largest_free_block() == capacity, steps, "free blocks weren't merged")) {
+		return 1;
+	}
+
+	std::printf("%u steps, %u failed allocations, %zu live at the end, ok\n", steps, failed_allocs, final_count);
+	return 0;
+}
@@ -0,0 +1,166 @@
+#include "components/transform_store.hpp"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+/// Checks hierarchy maintenance of the transform store: destroying cascades to every descendant, reparenting
+/// keeps parents ahead of their children and world matrices follow, and cycles are rejected.
+
+static u32 failures = 0;
+
+static void check(bool condition, const char* test, const char* what) {
+	if (!condition) {
+		std::fprintf(stderr, "%s: %s\n", test, what);
+		++failures;
+	}
+}
+
+static bool nearly_equal(const Vec3<f32>& a, const Vec3<f32>& b) {
+	return std::abs(a.x - b.x) < 1e-4f && std::abs(a.y - b.y) < 1e-4f && std::abs(a.z - b.z) < 1e-4f;
+}
+
+static Vec3<f32> world_position(const TransformStore& store, TransformId id) {
+	const auto& m = store.world_matrix(id);
+	return {m.m[12], m.m[13], m.m[14]};
+}
+
+static Transform at(f32 x) {
+	return {.position = {x, 0, 0}};
+}
+
+static void destroy_cascades_through_reparented_chain() {
+	const char* test = "destroy cascades through a reparented chain";
+	TransformStore store;
+	auto a = store.create(at(1));
+	auto b = store.create(at(2));
+	auto c = store.create(at(3));
+	// c ends up the root of c -> b -> a although it was created last
+	store.set_parent(a, b);
+	store.set_parent(b, c);
+	store.destroy(c);
+	store.update();
+	check(store.size() == 0, test, "descendants of the destroyed root survived");
+}
+
+static void destroy_keeps_unrelated() {
+	const char* test = "destroy keeps unrelated transforms";
+	TransformStore store;
+	auto root = store.create(at(1));
+	auto child = store.create(at(1), root);
+	store.create(at(1), child);
+	auto other = store.create(at(5));
+	auto other_child = store.create(at(1), other);
+	store.update();
+
+	store.destroy(root);
+	store.update();
+	check(store.size() == 2, test, "wrong number of transforms left");
+	check(nearly_equal(world_position(store, other_child), {6, 0, 0}), test, "survivor's world matrix is wrong");
+
+	// the freed ids are handed out again
+	auto reused = store.create(at(7), other_child);
+	store.update();
+	check(store.size() == 3, test, "create after destroy didn't add a transform");
+	check(nearly_equal(world_position(store, reused), {13, 0, 0}), test, "new child's world matrix is wrong");
+}
+
+static void reparent_orders_and_propagates() {
+	const char* test = "reparenting orders and propagates";
+	TransformStore store;
+	auto child = store.create(at(1));
+	auto middle = store.create(at(10));
+	auto root = store.create(at(100));
+	store.set_parent(child, middle);
+	store.set_parent(middle, root);
+	store.update();
+
+	check(store.index_of(root) < store.index_of(middle) && store.index_of(middle) < store.index_of(child), test,
+		"parents don't come before their children");
+	check(nearly_equal(world_position(store, child), {111, 0, 0}), test, "world matrix after reparenting is wrong");
+
+	// moving the root dirties the whole chain
+	store.set_position(root, {200, 0, 0});
+	store.update();
+	check(nearly_equal(world_position(store, child), {211, 0, 0}), test, "parent change didn't reach the grandchild");
+	check(store.changed(store.index_of(child)), test, "grandchild isn't reported as changed");
+
+	// detaching keeps the local transform as the world transform
+	store.set_parent(middle, TransformStore::NONE);
+	store.update();
+	check(nearly_equal(world_position(store, middle), {10, 0, 0}), test, "detached transform kept its parent's offset");
+	check(nearly_equal(world_position(store, child), {11, 0, 0}), test, "child of the detached transform is wrong");
+}
+
+static void cycles_are_rejected() {
+	const char* test = "cycles are rejected";
+	TransformStore store;
+	auto a = store.create(at(1));
+	auto b = store.create(at(1), a);
+	auto c = store.create(at(1), b);
+
+	auto rejects = [&](TransformId id, TransformId parent) {
+		try {
+			store.set_parent(id, parent);
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	};
+	check(rejects(a, a), test, "a transform was parented to itself");
+	check(rejects(a, c), test, "a transform was parented to its grandchild");
+	check(rejects(b, c), test, "a transform was parented to its child");
+
+	// the rejected calls changed nothing, so update terminates with the original hierarchy
+	store.update();
+	check(nearly_equal(world_position(store, c), {3, 0, 0}), test, "hierarchy changed by a rejected call");
+}
+
+static void stale_ids_are_ignored() {
+	const char* test = "stale ids are ignored";
+	TransformStore store;
+	auto old = store.create(at(1));
+	store.destroy(old);
+	store.update();
+	// the slot is reused, the old id must not reach the new transform
+	auto reused = store.create(at(2));
+	check(old.index == reused.index && old != reused, test, "slot wasn't reused with a new generation");
+	check(!store.alive(old) && store.alive(reused), test, "stale id reported alive");
+
+	store.destroy(old);
+	store.set_position(old, {50, 0, 0});
+	store.update();
+	check(store.size() == 1, test, "destroying a stale id removed the new transform");
+	check(nearly_equal(world_position(store, reused), {2, 0, 0}), test, "setting through a stale id moved the new transform");
+
+	auto throws = [&](auto&& fn) {
+		try {
+			fn();
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	};
+	check(throws([&] { (void) store.get(old); }), test, "get accepted a stale id");
+	check(throws([&] { store.create(at(1), old); }), test, "create accepted a stale parent");
+
+	// destroyed transforms are dead before the update that frees them
+	store.destroy(reused);
+	check(!store.alive(reused), test, "destroyed transform still alive before the update");
+}
+
+int main() {
+	destroy_cascades_through_reparented_chain();
+	destroy_keeps_unrelated();
+	reparent_orders_and_propagates();
+	cycles_are_rejected();
+	stale_ids_are_ignored();
+
+	if (failures) {
+		std::fprintf(stderr, "%u checks failed\n", failures);
+		return 1;
+	}
+	std::printf("ok\n");
+	return 0;
+}